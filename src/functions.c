@@ -10,6 +10,24 @@
 #include "PHY/CODING/nrLDPC_decoder/nrLDPC_types.h"
 #include "PHY/CODING/nrLDPC_extern.h"
 #include <dlfcn.h>
+#include "nr_tb_segmentation.h"
+#include "nr_rate_matching.h"
+#include "nr_rate_recovery.h"
+#include "nr_harq_compress.h"
+#include "nr_crc_fold.h"
+#include "nr_gold.h"
+#include "nr_scramble_mod.h"
+#include "nr_layer_demap.h"
+#include "nr_layer_mapping.h"
+#include "nr_llr.h"
+#include "nr_mmse_llr.h"
+#include "nr_dft_plan.h"
+#include "nr_ofdm_batch.h"
+#include "nr_fft.h"
+#include "nr_re_mapping.h"
+#include "nr_ptrs.h"
+#include "nr_dmrs.h"
+#include "nr_arena.h"
 
 /* Gray-coded amplitude levels for 16-QAM */
 static const int32_t qam16_levels[4] = { -3, -1, +1, +3 };
@@ -36,10 +54,11 @@ typedef struct ofdm_ctx_s {
     int nb_symbols;
     int nb_prefix_samples;
     int nb_tx;        /* number of TX antennas */
-    c16_t **input;    /* frequency-domain input per antenna [nb_tx][fftsize] */
+    c16_t **input;    /* frequency-domain input per antenna [nb_tx][nb_symbols * fftsize] */
     c16_t **output;   /* time-domain output per antenna [nb_tx][nb_symbols * (prefix+fftsize)] */
-    void *dlh;        /* handle from dlopen for libdfts.so (optional) */
     uint32_t *rnd_state; /* xorshift PRNG state per antenna [nb_tx] */
+    nr_arena_t *arena;   /* thread arena holding the context and its buffers */
+    size_t arena_mark;   /* arena offset before the context */
 } ofdm_ctx_t;
 
 /* xorshift32 PRNG: faster and thread-local friendly than rand() */
@@ -78,98 +97,72 @@ static int getenv_int(const char *name, int defval)
     return (int)v;
 }
 
-/* Initialize OFDM context: load dfts lib (path via env or default), allocate aligned buffers */
-static ofdm_ctx_t *ofdm_init(const char *dfts_path, int fftsize, int nb_symbols, int nb_prefix_samples, int nb_tx)
+/* Helper: monotonic timestamp in nanoseconds for latency reports */
+static inline uint64_t now_ns(void)
 {
-    ofdm_ctx_t *c = calloc(1, sizeof(*c));
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Initialize OFDM context: check that fftsize has a DFT plan (building the
+ * plans and setting the dft / idft globals PHY_ofdm_mod() runs on, see
+ * nr_dft_plan.h), allocate the context and its buffers from the thread arena,
+ * pinned across slot resets */
+static ofdm_ctx_t *ofdm_init(int fftsize, int nb_symbols, int nb_prefix_samples, int nb_tx)
+{
+    if (!nr_dft_plan_get(fftsize, 1)) {
+        printf("ofdm_init: no DFT plan for FFT size %d\n", fftsize);
+        return NULL;
+    }
+
+    nr_arena_t *arena = nr_arena_thread();
+    if (!arena) return NULL;
+    const size_t mark = nr_arena_mark(arena);
+
+    ofdm_ctx_t *c = nr_arena_calloc(arena, 1, sizeof(*c));
     if (!c) return NULL;
 
+    c->arena = arena;
+    c->arena_mark = mark;
+
     c->fftsize = fftsize;
     c->nb_symbols = nb_symbols;
     c->nb_prefix_samples = nb_prefix_samples;
     c->nb_tx = nb_tx;
 
-    size_t in_sz = sizeof(c16_t) * (size_t)fftsize;
+    size_t in_sz = sizeof(c16_t) * (size_t)nb_symbols * (size_t)fftsize;
     size_t out_sz = sizeof(c16_t) * (size_t)nb_symbols * (size_t)(nb_prefix_samples + fftsize);
 
     /* Allocate per-antenna buffers */
-    c->input = calloc(nb_tx, sizeof(c16_t*));
-    c->output = calloc(nb_tx, sizeof(c16_t*));
-    c->rnd_state = calloc(nb_tx, sizeof(uint32_t));
-    
+    c->input = nr_arena_alloc(arena, nb_tx * sizeof(c16_t*));
+    c->output = nr_arena_alloc(arena, nb_tx * sizeof(c16_t*));
+    c->rnd_state = nr_arena_alloc(arena, nb_tx * sizeof(uint32_t));
     if (!c->input || !c->output || !c->rnd_state) {
-        free(c->input);
-        free(c->output);
-        free(c->rnd_state);
-        free(c);
+        nr_arena_release(arena, mark);
         return NULL;
     }
 
     for (int aa = 0; aa < nb_tx; aa++) {
-        c->input[aa] = aligned_alloc(32, in_sz);
-        c->output[aa] = aligned_alloc(32, out_sz);
+        c->input[aa] = nr_arena_calloc(arena, 1, in_sz);
+        c->output[aa] = nr_arena_calloc(arena, 1, out_sz);
         if (!c->input[aa] || !c->output[aa]) {
-            for (int i = 0; i <= aa; i++) {
-                free(c->input[i]);
-                free(c->output[i]);
-            }
-            free(c->input);
-            free(c->output);
-            free(c->rnd_state);
-            free(c);
+            nr_arena_release(arena, mark);
             return NULL;
         }
-        memset(c->input[aa], 0, in_sz);
-        memset(c->output[aa], 0, out_sz);
         /* Independent PRNG seed per antenna */
         c->rnd_state[aa] = (uint32_t)time(NULL) ^ (uint32_t)aa;
     }
 
-    /* Load libdfts: prefer env var, then provided path, then default relative path */
-    const char *env = getenv("OAI_DFTS_LIB");
-    const char *path = env ? env : dfts_path;
-    if (!path) path = "./libdfts.so";
-
-    c->dlh = dlopen(path, RTLD_NOW | RTLD_LOCAL);
-    if (!c->dlh) {
-        /* try relative to project build dir */
-        c->dlh = dlopen("/home/anderson/dev/oai_isolation/ext/openair/cmake_targets/ran_build/build/libdfts.so", RTLD_NOW | RTLD_LOCAL);
-        if (!c->dlh) {
-            /* leave idft as-is; caller should check */
-            printf("ofdm_init: dlopen failed (%s)\n", dlerror());
-        }
-    }
-
-    if (c->dlh) {
-        idft = (idftfunc_t)dlsym(c->dlh, "idft_implementation");
-        if (!idft) {
-            printf("ofdm_init: dlsym idft_implementation failed: %s\n", dlerror());
-        }
-    }
-
+    nr_arena_pin(arena);
     return c;
 }
 
+/* Gives the context and everything allocated after it back to the arena */
 static void ofdm_free(ofdm_ctx_t *c)
 {
     if (!c) return;
-    if (c->dlh) dlclose(c->dlh);
-    
-    /* Free per-antenna buffers */
-    if (c->input) {
-        for (int aa = 0; aa < c->nb_tx; aa++) {
-            free(c->input[aa]);
-        }
-        free(c->input);
-    }
-    if (c->output) {
-        for (int aa = 0; aa < c->nb_tx; aa++) {
-            free(c->output[aa]);
-        }
-        free(c->output);
-    }
-    free(c->rnd_state);
-    free(c);
+    nr_arena_release(c->arena, c->arena_mark);
 }
 
 /* Lightweight precoding context to hold buffers and frame params for do_onelayer */
@@ -180,16 +173,27 @@ typedef struct precoding_ctx_s {
     int fftsize;
     c16_t *tx_layer;       /* input layer signal (per layer) */
     c16_t *output;         /* output after precoding (per symbol) */
+    c16_t *dmrs;           /* DMRS of one symbol when generated without cache */
+    nr_dmrs_cache_t *dmrs_cache;
     NR_DL_FRAME_PARMS *frame_parms;
     nfapi_nr_dl_tti_pdsch_pdu_rel15_t *rel15;
     uint32_t rnd_state;    /* xorshift PRNG state */
+    nr_arena_t *arena;     /* thread arena holding the context and its buffers */
+    size_t arena_mark;
 } precoding_ctx_t;
 
-/* Initialize precoding context with aligned buffers */
+/* Initialize precoding context with its buffers in the thread arena, pinned
+ * across slot resets */
 static precoding_ctx_t *precoding_init(int nb_layers, int symbol_sz, int rbSize)
 {
-    precoding_ctx_t *c = calloc(1, sizeof(*c));
+    nr_arena_t *arena = nr_arena_thread();
+    if (!arena) return NULL;
+    const size_t mark = nr_arena_mark(arena);
+
+    precoding_ctx_t *c = nr_arena_calloc(arena, 1, sizeof(*c));
     if (!c) return NULL;
+    c->arena = arena;
+    c->arena_mark = mark;
 
     c->nb_layers = nb_layers;
     c->symbol_sz = symbol_sz;
@@ -200,31 +204,33 @@ static precoding_ctx_t *precoding_init(int nb_layers, int symbol_sz, int rbSize)
     size_t layer_sz = sizeof(c16_t) * (size_t)symbol_sz * (size_t)nb_layers;
     size_t output_sz = sizeof(c16_t) * (size_t)symbol_sz;
 
-    c->tx_layer = aligned_alloc(64, layer_sz);
-    c->output = aligned_alloc(64, output_sz);
-
-    if (!c->tx_layer || !c->output) {
-        free(c->tx_layer);
-        free(c->output);
-        free(c);
+    c->tx_layer = nr_arena_calloc(arena, 1, layer_sz);
+    c->output = nr_arena_calloc(arena, 1, output_sz);
+    /* DMRS type 1 of the rbSize RBs: 6 per RB; the cache holds two DMRS
+     * symbols of every slot of a frame */
+    c->dmrs = nr_arena_alloc(arena, sizeof(c16_t) * (size_t)rbSize * 6);
+    if (!c->tx_layer || !c->output || !c->dmrs) {
+        nr_arena_release(arena, mark);
+        return NULL;
+    }
+    c->dmrs_cache = nr_dmrs_cache_init(64, rbSize * 6);
+    if (!c->dmrs_cache) {
+        nr_arena_release(arena, mark);
         return NULL;
     }
-
-    memset(c->tx_layer, 0, layer_sz);
-    memset(c->output, 0, output_sz);
 
     /* PRNG seed per-context */
     c->rnd_state = (uint32_t)time(NULL) ^ (uint32_t)(uintptr_t)c;
 
+    nr_arena_pin(arena);
     return c;
 }
 
 static void precoding_free(precoding_ctx_t *c)
 {
     if (!c) return;
-    free(c->tx_layer);
-    free(c->output);
-    free(c);
+    nr_dmrs_cache_free(c->dmrs_cache);
+    nr_arena_release(c->arena, c->arena_mark);
 }
 
 void nr_precoding()
@@ -241,6 +247,13 @@ void nr_precoding()
     const int symbol_sz   = nb_rb * 12;                           /* REs per symbol over allocated RBs */
     const int nb_symbols  = 14;                                   /* 14 OFDM symbols per slot */
     const int num_iterations = getenv_int("OAI_ITERS", 1000000); /* elevated iterations */
+    /* DMRS type 1 on symbols 2 and 11 (type A, one additional position) with
+     * 2 CDM groups without data (DMRS-only symbols, ports 0-3) or 1 (DMRS and
+     * data interleaved) */
+    const uint16_t dmrs_pos = (uint16_t)getenv_int("OAI_DMRS_POS", 0x0804);
+    const int dmrs_cdm      = getenv_int("OAI_DMRS_CDM", 2);
+    const int dmrs_cached   = getenv_int("OAI_DMRS_CACHE", 1);
+    const int slots_per_frame = 20;                               /* 30 kHz SCS */
 
     /* Initialize precoding context and allocate buffers */
     precoding_ctx_t *ctx = precoding_init(nb_layers, symbol_sz, nb_rb);
@@ -266,7 +279,8 @@ void nr_precoding()
         .BWPStart = 0,
         .qamModOrder = { (uint8_t)mod_order, (uint8_t)mod_order },
         .nrOfLayers = nb_layers,
-        .dlDmrsSymbPos = 0x00,  /* No DMRS in this test */
+        .dlDmrsSymbPos = dmrs_pos,
+        .numDmrsCdmGrpsNoData = (uint8_t)dmrs_cdm,
         .pduBitmap = 0x00,      /* No PTRS in this test */
         .NrOfCodewords = 1,
         .StartSymbolIndex = 0,
@@ -278,9 +292,14 @@ void nr_precoding()
 
     printf("Precoding loop: layers=%d, RBs=%d, mod_order=%d, symbol_sz=%d, symbols/slot=%d\n", 
            nb_layers, nb_rb, mod_order, symbol_sz, nb_symbols);
+    printf("DMRS: symbols=0x%04x, CDM groups without data=%d, %s\n", dmrs_pos, dmrs_cdm,
+           dmrs_cached ? "cached per slot" : "generated per symbol");
+    uint64_t dmrs_ns = 0;
 
     /* Main precoding loop: iterate and call do_onelayer for each symbol */
     for (int iter = 0; iter < num_iterations; iter++) {
+        /* One iteration is one slot: its scratch goes back to the arena */
+        nr_arena_reset(ctx->arena);
         if ((iter % 100) == 0) printf("--- Precoding iteration %d ---\n", iter);
 
         /* Fill tx_layer with random constellation samples according to mod_order */
@@ -321,12 +340,27 @@ void nr_precoding()
         }
 
         /* Process each OFDM symbol in the slot */
+        const int slot = iter % slots_per_frame;
         for (int l_symbol = 0; l_symbol < nb_symbols; l_symbol++) {
+            /* DMRS of the symbol, from RB 0 of the allocation (rbStart = BWPStart = 0) */
+            c16_t *dmrs_start = NULL;
+            if (dmrs_pos & (1 << l_symbol)) {
+                const uint64_t t0 = now_ns();
+                if (dmrs_cached) {
+                    dmrs_start = (c16_t *)nr_dmrs_cache_get(ctx->dmrs_cache, slot, l_symbol, rel15.dlDmrsScramblingId,
+                                                            rel15.SCID, nb_rb * 6);
+                } else {
+                    nr_dmrs_generate(slot, l_symbol, rel15.dlDmrsScramblingId, rel15.SCID, nb_rb * 6, ctx->dmrs);
+                    dmrs_start = ctx->dmrs;
+                }
+                dmrs_ns += now_ns() - t0;
+            }
+
             /* Call real do_onelayer for each layer */
             for (int layer = 0; layer < nb_layers; layer++) {
                 int re_processed = do_onelayer(
                     ctx->frame_parms,           /* frame parameters */
-                    0,                          /* slot */
+                    slot,                       /* slot */
                     ctx->rel15,                 /* PDU config */
                     layer,                      /* layer index */
                     ctx->output,                /* output buffer */
@@ -335,12 +369,11 @@ void nr_precoding()
                     symbol_sz,                  /* symbol size */
                     l_symbol,                   /* symbol index */
                     0,                          /* dlPtrsSymPos */
-                    0,                          /* n_ptrs */
                     1000,                       /* amplitude */
                     15000,                      /* amplitude_dmrs */
                     0,                          /* l_prime */
                     NFAPI_NR_DMRS_TYPE1,        /* dmrs_type */
-                    NULL                        /* dmrs_start */
+                    dmrs_start                  /* dmrs_start */
                 );
 
                 if ((iter % 100) == 0 && l_symbol == 0) {
@@ -351,6 +384,12 @@ void nr_precoding()
         }
     }
 
+    printf("\nDMRS sequences: %.1f ns per slot", (double)dmrs_ns / num_iterations);
+    if (dmrs_cached)
+        printf(", cache hits=%llu misses=%llu", (unsigned long long)ctx->dmrs_cache->gold->hits,
+               (unsigned long long)ctx->dmrs_cache->gold->misses);
+    printf("\n");
+
     printf("\n=== Final output samples (layer 0, symbol 0) ===\n");
     for (int i = 0; i < 16 && i < symbol_sz; i++) {
         printf("output[%02d] = (r=%d,i=%d)\n", i, ctx->output[i].r, ctx->output[i].i);
@@ -363,28 +402,46 @@ void nr_precoding()
 void nr_scramble(){
     /* Initialize the logging system first */
     logInit();
+
+    /* CRC tables are needed by the TB encoder feeding the scrambler */
+    crcTableInit();
     
-    /* Requested parameters */
-    const uint32_t size   = 82368;      /* bits */
+    /* Requested parameters: the scrambled length is the rate-matched codeword
+     * length G of the allocation, not a fixed size */
+    const int nb_rb       = getenv_int("OAI_RB", 143);
+    const uint8_t Qm      = (uint8_t)getenv_int("OAI_QM", 4);
+    const uint8_t layers  = (uint8_t)getenv_int("OAI_LAYERS", 1);
+    const uint16_t R      = (uint16_t)getenv_int("OAI_CODE_RATE", 490);
+    const uint8_t rv      = (uint8_t)getenv_int("OAI_RV", 0);
+    const uint32_t size   = (uint32_t)nb_rb * 12 * 12 * Qm * layers;   /* bits, G */
     const uint8_t  q      = 0;
     const uint32_t Nid    = 0;
     const uint32_t n_RNTI = 0xFFFF;    /* 65535 */
     
     /* Derived buffer sizes based on requested bit size */
-    const uint32_t in_bytes = (size + 7) / 8;           /* input bytes */
+    const uint32_t in_bytes = (size + 31) & ~31u;       /* one bit per byte, whole 32-bit words */
     const uint32_t out_words = (size + 31) / 32;        /* output 32-bit words */
-    
-    uint8_t  *in  = malloc(in_bytes);
-    uint32_t *out = malloc(out_words * sizeof(uint32_t));
-    if (!in || !out) {
-        printf("nr_scramble: buffer allocation failed (in=%p, out=%p)\n", (void*)in, (void*)out);
-        free(in);
-        free(out);
+    const uint32_t A = nr_tbs_compute((uint32_t)nb_rb * 12 * 12, R, Qm, layers);
+    
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    uint8_t  *in  = nr_scratch_alloc(&scratch, in_bytes);
+    uint32_t *out = nr_scratch_alloc(&scratch, out_words * sizeof(uint32_t));
+    uint8_t  *tb  = nr_scratch_alloc(&scratch, (A + 7) / 8);
+    uint8_t  *f   = nr_scratch_alloc(&scratch, out_words * sizeof(uint32_t));
+    nr_tb_encoder_t *enc = nr_tb_encoder_init(A, 1);
+    nr_rm_ctx_t *rm = nr_rm_init(size);
+    if (!enc || !rm) {
+        printf("nr_scramble: encoder allocation failed\n");
+        nr_tb_encoder_free(enc);
+        nr_rm_free(rm);
+        nr_scratch_end(&scratch);
         return;
     }
     
     memset(in, 0, in_bytes);
     memset(out, 0, out_words * sizeof(uint32_t));
+    memset(f, 0, out_words * sizeof(uint32_t));
     
     /* Optional: seed the input with a small sample pattern */
     const uint8_t sample[] = {
@@ -392,21 +449,55 @@ void nr_scramble(){
         0xFF, 0x35, 0xA8, 0x44, 0xF9, 0x21, 0x92, 0xAA,
         0x68, 0x28, 0x2A
     };
-    memcpy(in, sample, sizeof(sample) < in_bytes ? sizeof(sample) : in_bytes);
+    for (uint32_t i = 0; i < A / 8; i++)
+        tb[i] = sample[i % sizeof(sample)];
+
+    /* LDPC encoding and rate matching produce the G bits the scrambler consumes */
+    if (nr_tb_encoder_encode(enc, tb, A, R) < 0 || nr_rate_matching_tb(rm, enc, size, Qm, layers, rv, f) != (int)size) {
+        printf("nr_scramble: encoding/rate matching failed (A=%u, G=%u)\n", A, size);
+        nr_tb_encoder_free(enc);
+        nr_rm_free(rm);
+        nr_scratch_end(&scratch);
+        return;
+    }
+    nr_rm_unpack_bits(f, size, in);
     
     const int iterations = getenv_int("OAI_ITERS", 100000000);
     const int verbose = getenv("OAI_VERBOSE") != NULL;
+    /* OAI_GOLD_CACHE=0 regenerates the Gold sequence in every call, as OAI does */
+    const int use_cache = getenv_int("OAI_GOLD_CACHE", 1);
+
+    printf("Starting scrambling tests (%d iterations, TBS=%u, C=%u, G=%u bits, Gold cache %s)...\n",
+           iterations, A, enc->seg.C, size, use_cache ? "on" : "off");
+
+    nr_gold_cache_t *gold = use_cache ? nr_gold_cache_init(16, size) : NULL;
+    if (use_cache) {
+        /* The cached path must reproduce nr_codeword_scrambling */
+        nr_codeword_scrambling(in, size, q, Nid, n_RNTI, out);
+        if (!gold || nr_codeword_scrambling_cached(gold, in, size, q, Nid, n_RNTI, (uint32_t *)f) < 0
+            || memcmp(out, f, out_words * sizeof(uint32_t))) {
+            printf("nr_scramble: cached scrambling does not match nr_codeword_scrambling\n");
+            nr_gold_cache_free(gold);
+            gold = NULL;
+        }
+    }
 
-    printf("Starting scrambling tests (%d iterations)...\n", iterations);
-    
     /* Run scrambling with lightweight logging */
+    const uint64_t t0 = now_ns();
     for (int iter = 0; iter < iterations; ++iter) {
-        in[0] = (uint8_t)iter; /* vary a byte so each run differs */
-        nr_codeword_scrambling(in, size, q, Nid, n_RNTI, out);
+        in[0] = (uint8_t)(iter & 1); /* vary a bit so each run differs */
+        if (gold)
+            nr_codeword_scrambling_cached(gold, in, size, q, Nid, n_RNTI, out);
+        else
+            nr_codeword_scrambling(in, size, q, Nid, n_RNTI, out);
         if (verbose && (iter % 100) == 0) {
             printf("iter %d: out[0]=0x%08X\n", iter, (unsigned)out[0]);
         }
     }
+    printf("Scrambling: %.3f us per codeword\n", (now_ns() - t0) / 1e3 / (iterations > 0 ? iterations : 1));
+    if (gold)
+        printf("Gold cache: %llu hits, %llu misses\n", (unsigned long long)gold->hits, (unsigned long long)gold->misses);
+    nr_gold_cache_free(gold);
     
     /* Print a small slice of the output buffer */
     int roundedSz = (size + 31) / 32;
@@ -418,8 +509,9 @@ void nr_scramble(){
     }
     
     /* Cleanup */
-    free(in);
-    free(out);
+    nr_scratch_end(&scratch);
+    nr_tb_encoder_free(enc);
+    nr_rm_free(rm);
     
 }
 
@@ -460,39 +552,20 @@ void nr_ofdm_modulation()
 {
     logInit();   // required by OAI
 
-    /* Try to load the dfts shared object directly and retrieve the
-     * dispatcher `idft_implementation` to set the global `idft` pointer.
-     * This avoids the higher-level loader which depends on the config
-     * subsystem (which isn't initialized in this small test program).
-     */
-    #include <dlfcn.h>
-    // See if this wont pose a problem for contenainers
-    const char *libpath = "/home/anderson/dev/oai_isolation/ext/openair/cmake_targets/ran_build/build/libdfts.so";
-    void *dlh = dlopen(libpath, RTLD_NOW | RTLD_LOCAL);
-    if (!dlh) {
-        printf("Warning: dlopen(%s) failed: %s\n", libpath, dlerror());
-    } else {
-        idft = (idftfunc_t)dlsym(dlh, "idft_implementation");
-        if (!idft) {
-            printf("Warning: dlsym(idft_implementation) failed: %s\n", dlerror());
-        }
-    }
-
     /* Group core parameters together */
-    const int fftsize        = 1024;
+    const int fftsize        = getenv_int("OAI_FFT", 1024);
+    const int mu             = getenv_int("OAI_MU", 1);   // numerology (30 kHz)
     const int nb_symbols     = 14;          // number of OFDM symbols
     const int num_iterations = 1000000;   // number of iterations
     const int nb_tx          = 8;          // number of transmit antennas
 
-    /* Automate CP length according to FFT size (1024 or 2048) */
-    const int nb_prefix_samples = (fftsize == 2048)
-                                  ? 176
-                                  : (fftsize == 1024 ? 88 : (176 * fftsize / 2048));
+    /* CP length of 38.211 for any FFT size: the long CP of the first symbol,
+     * 88 at 1024 and 176 at 2048 for 30 kHz */
+    const int nb_prefix_samples = nr_cp_length(fftsize, mu, 0, 0);
     const Extension_t extype    = CYCLIC_PREFIX;
 
     /* Initialize context and buffers once, reuse across iterations */
-    ofdm_ctx_t *ctx = ofdm_init("/home/anderson/dev/oai_isolation/ext/openair/cmake_targets/ran_build/build/libdfts.so",
-                                fftsize, nb_symbols, nb_prefix_samples, nb_tx);
+    ofdm_ctx_t *ctx = ofdm_init(fftsize, nb_symbols, nb_prefix_samples, nb_tx);
     if (!ctx) {
         printf("ofdm_init failed\n");
         return;
@@ -503,6 +576,7 @@ void nr_ofdm_modulation()
            fftsize, nb_symbols, nb_prefix_samples, nb_tx, num_iterations);
 
     for (int iter = 0; iter < num_iterations; iter++) {
+        nr_arena_reset(ctx->arena);
         if ((iter % 10) == 0) printf("\n--- OFDM modulation iteration %d ---\n", iter);
 
         /* Process each antenna */
@@ -600,15 +674,10 @@ void nr_modulation_test()
     const size_t out_sz = num_symbols * sizeof(int16_t) * 2;
     const size_t in_sz = ((length + 31) / 32) * sizeof(uint32_t);
     
-    uint32_t *in = aligned_alloc(32, in_sz);
-    int16_t *out = aligned_alloc(32, out_sz);
-    
-    if (!in || !out) {
-        printf("nr_modulation_test: buffer allocation failed\n");
-        free(in);
-        free(out);
-        return;
-    }
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    uint32_t *in = nr_scratch_alloc(&scratch, in_sz);
+    int16_t *out = nr_scratch_alloc(&scratch, out_sz);
     
     memset(out, 0, out_sz);
     
@@ -661,8 +730,7 @@ void nr_modulation_test()
         printf("  ... (%u more points)\n", table_size - 16);
     }
     
-    free(in);
-    free(out);
+    nr_scratch_end(&scratch);
     printf("\n=== NR Modulation test completed (%s) ===\n", mod_name);
 }
 
@@ -688,17 +756,12 @@ void nr_layermapping()
     printf("Running %d iterations...\n", num_iterations);
     
     /* Allocate modulated symbols buffer (aligned) */
-    c16_t (*mod_symbs)[nbCodes][encoded_len] = aligned_alloc(64, sizeof(c16_t) * nbCodes * encoded_len);
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    c16_t (*mod_symbs)[nbCodes][encoded_len] = nr_scratch_alloc(&scratch, sizeof(c16_t) * nbCodes * encoded_len);
     
     /* Allocate tx_layers output buffer (aligned) */
-    c16_t (*tx_layers)[n_layers][layerSz] = aligned_alloc(64, sizeof(c16_t) * n_layers * layerSz);
-    
-    if (!mod_symbs || !tx_layers) {
-        printf("nr_layermapping: buffer allocation failed\n");
-        free(mod_symbs);
-        free(tx_layers);
-        return;
-    }
+    c16_t (*tx_layers)[n_layers][layerSz] = nr_scratch_alloc(&scratch, sizeof(c16_t) * n_layers * layerSz);
     
     memset(mod_symbs, 0, sizeof(c16_t) * nbCodes * encoded_len);
     memset(tx_layers, 0, sizeof(c16_t) * n_layers * layerSz);
@@ -749,8 +812,7 @@ void nr_layermapping()
         }
     }
     
-    free(mod_symbs);
-    free(tx_layers);
+    nr_scratch_end(&scratch);
     printf("=== NR Layer Mapping tests completed ===\n");
 }
 
@@ -784,11 +846,9 @@ void nr_ldpc()
     printf("Running %d test runs...\n", num_runs);
     
     /* Allocate input buffer - only for the single segment we need */
-    uint8_t *input_seg = malloc((K + 7) / 8);
-    if (!input_seg) {
-        printf("nr_ldpc: input buffer allocation failed\n");
-        return;
-    }
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    uint8_t *input_seg = nr_scratch_alloc(&scratch, (K + 7) / 8);
     memset(input_seg, 0, (K + 7) / 8);
     
     /* Create array of pointers for the encoder (expects uint8_t **) */
@@ -796,12 +856,7 @@ void nr_ldpc()
     input[0] = input_seg;
     
     /* Allocate output buffer */
-    uint8_t *output = malloc(output_buffer_size);
-    if (!output) {
-        printf("nr_ldpc: output buffer allocation failed\n");
-        free(input_seg);
-        return;
-    }
+    uint8_t *output = nr_scratch_alloc(&scratch, output_buffer_size);
     memset(output, 0, output_buffer_size);
     
     /* LDPC encoder parameters structure */
@@ -848,8 +903,7 @@ void nr_ldpc()
     }
     
     /* Cleanup */
-    free(input_seg);
-    free(output);
+    nr_scratch_end(&scratch);
     printf("=== NR LDPC Encoder tests completed ===\n");
 }
 
@@ -888,25 +942,26 @@ void nr_ch_estimation()
 
     /* Allocate RX frequency-domain data buffer (flat) and dl_ch (flat) */
     const int rx_len = nb_antennas_rx * ofdm_symbol_size;
-    int32_t *rxdataF_data = aligned_alloc(32, rx_len * sizeof(int32_t));
-    if (!rxdataF_data) { printf("nr_ch_estimation: rxdataF allocation failed\n"); return; }
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    int32_t *rxdataF_data = nr_scratch_alloc(&scratch, rx_len * sizeof(int32_t));
     memset(rxdataF_data, 0, rx_len * sizeof(int32_t));
 
-    int32_t *dl_ch_data = aligned_alloc(32, rx_len * sizeof(int32_t));
-    if (!dl_ch_data) { printf("nr_ch_estimation: dl_ch allocation failed\n"); free(rxdataF_data); return; }
+    int32_t *dl_ch_data = nr_scratch_alloc(&scratch, rx_len * sizeof(int32_t));
     memset(dl_ch_data, 0, rx_len * sizeof(int32_t));
 
     /* Initialize noise variance array */
-    uint32_t *nvar = aligned_alloc(32, nb_antennas_rx * sizeof(uint32_t));
-    if (!nvar) {
-        printf("nr_ch_estimation: nvar allocation failed\n");
-        free(rxdataF_data);
-        free(dl_ch_data);
-        return;
-    }
+    uint32_t *nvar = nr_scratch_alloc(&scratch, nb_antennas_rx * sizeof(uint32_t));
     for (int i = 0; i < nb_antennas_rx; i++) nvar[i] = 255;
-    
-    printf("Running %d iterations of PDSCH channel estimation...\n", num_iterations);
+
+    /* Allocated REs of each antenna, pulled out of the grid row from
+     * first_carrier_offset (wrapping at the FFT edge) so the estimators only
+     * see the nb_rb_pdsch RBs, not the guard bands and DC */
+    const nr_re_pattern_t alloc_re = {.data_mask = NR_RE_MASK_ALL};
+    const int nb_re = (int)nr_re_count(&alloc_re, nb_rb_pdsch);
+    int32_t *rx_re = nr_scratch_alloc(&scratch, nb_antennas_rx * nb_re * sizeof(int32_t));
+
+    printf("Running %d iterations of PDSCH channel estimation over %d REs per antenna...\n", num_iterations, nb_re);
 
     int use_real = 0;
     const char *use_real_env = getenv("OAI_USE_REAL_EST");
@@ -917,8 +972,8 @@ void nr_ch_estimation()
         printf("Using simplified LS channel estimation path. Set OAI_USE_REAL_EST=1 to enable real path.\n");
     }
 
-    /* Com LS simples, nosso dl_ch cobre [ant][k] do tamanho rx_len */
-    const int dl_ch_words = rx_len;
+    /* dl_ch cobre [ant][k] sobre os REs alocados */
+    const int dl_ch_words = nb_antennas_rx * nb_re;
     
     /* Initialize PRNG for noise generation (separate from signal PRNG) */
     uint32_t noise_seed = 0x12345678u;
@@ -974,13 +1029,21 @@ void nr_ch_estimation()
             }
         }
 
+        for (int ant = 0; ant < nb_antennas_rx; ant++)
+            nr_re_extract((const c16_t *)(rxdataF_data + ant * ofdm_symbol_size),
+                          ofdm_symbol_size,
+                          first_carrier_offset,
+                          nb_rb_pdsch,
+                          &alloc_re,
+                          (c16_t *)(rx_re + ant * nb_re));
+
         if (!use_real) {
             /* LS simples: Ĥ[k] = Y[k] / P[k]; escolher P = 8192 (1<<13) real */
             const int pr = 8192; /* 2^13 */
             for (int ant = 0; ant < nb_antennas_rx; ant++) {
-                int base = ant * ofdm_symbol_size;
-                for (int k = 0; k < ofdm_symbol_size; k++) {
-                    int32_t y = rxdataF_data[base + k];
+                int base = ant * nb_re;
+                for (int k = 0; k < nb_re; k++) {
+                    int32_t y = rx_re[base + k];
                     int16_t yr = (int16_t)(y & 0xFFFF);
                     int16_t yi = (int16_t)((y >> 16) & 0xFFFF);
                     int16_t hr = (int16_t)(yr / pr);
@@ -993,10 +1056,12 @@ void nr_ch_estimation()
              * usando cast de ponteiro de função para evitar conflito de protótipos. */
 
             /* Frame parms mínimo compatível com stub */
-            struct { int ofdm_symbol_size; int N_RB_DL; int nb_antennas_rx; } fp_min = {
+            /* The stub walks nb_re entries per antenna: the compact REs */
+            struct { int ofdm_symbol_size; int N_RB_DL; int nb_antennas_rx; int nb_re; } fp_min = {
                 .ofdm_symbol_size = ofdm_symbol_size,
                 .N_RB_DL = nb_rb_pdsch,
-                .nb_antennas_rx = nb_antennas_rx
+                .nb_antennas_rx = nb_antennas_rx,
+                .nb_re = nb_re
             };
 
             /* Usar símbolo DMRS (2) para estimativa */
@@ -1011,7 +1076,7 @@ void nr_ch_estimation()
                                         0, /* gNB_id */
                                         nb_antennas_rx,
                                         dl_ch_data,
-                                        rxdataF_data,
+                                        rx_re,
                                         nvar);
 
             if (verbose && iter == 0) {
@@ -1022,7 +1087,7 @@ void nr_ch_estimation()
                 printf("    real-path wrote_real=%d dl_ch_data[0]=0x%08X rxF[0]=0x%08X\n",
                        wrote_real,
                        ((uint32_t *)dl_ch_data)[0],
-                       ((uint32_t *)rxdataF_data)[0]);
+                       ((uint32_t *)rx_re)[0]);
             }
         }
 
@@ -1046,9 +1111,7 @@ void nr_ch_estimation()
     }
     
     /* Cleanup */
-    free(rxdataF_data);
-    free(dl_ch_data);
-    free(nvar);
+    nr_scratch_end(&scratch);
     printf("=== NR Channel Estimation (PDSCH) tests completed ===\n");
 }
 
@@ -1079,11 +1142,9 @@ void nr_descrambling()
         printf("Iterations: %d (set OAI_ITERS), verbose=%d (set OAI_VERBOSE)\n", num_iterations, verbose);
     
     /* Allocate LLR buffer (aligned to 32 bytes for SIMD) - int16_t for soft bits */
-    int16_t *llr = aligned_alloc(32, buffer_size * sizeof(int16_t));
-    if (!llr) {
-        printf("nr_descrambling: llr allocation failed\n");
-        return;
-    }
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    int16_t *llr = nr_scratch_alloc(&scratch, buffer_size * sizeof(int16_t));
     memset(llr, 0, buffer_size * sizeof(int16_t));
     
     /* Optional: seed the LLR input with a sample pattern (soft values) */
@@ -1098,15 +1159,34 @@ void nr_descrambling()
         llr[i] = sample_llr[i];
     }
     
-    printf("Running %d iterations of DLSCH descrambling...\n", num_iterations);
+    /* OAI_GOLD_CACHE=0 regenerates the Gold sequence in every call, as OAI does */
+    nr_gold_cache_t *gold = getenv_int("OAI_GOLD_CACHE", 1) ? nr_gold_cache_init(16, size) : NULL;
+    if (gold) {
+        /* The cached path must reproduce nr_dlsch_unscrambling */
+        int16_t ref[64], chk[64];
+        for (int i = 0; i < 64; i++) ref[i] = chk[i] = (int16_t)(100 + i);
+        nr_dlsch_unscrambling(ref, 64, q, Nid, n_RNTI);
+        nr_codeword_unscrambling_cached(gold, chk, 64, q, Nid, n_RNTI);
+        if (memcmp(ref, chk, sizeof(ref))) {
+            printf("nr_descrambling: cached descrambling does not match nr_dlsch_unscrambling\n");
+            nr_gold_cache_free(gold);
+            gold = NULL;
+        }
+    }
+
+    printf("Running %d iterations of DLSCH descrambling (Gold cache %s)...\n", num_iterations, gold ? "on" : "off");
     
     /* Main descrambling loop */
+    const uint64_t t0 = now_ns();
     for (int iter = 0; iter < num_iterations; iter++) {
         /* Vary first LLR so each run differs */
         llr[0] = (int16_t)((iter * 7) & 0xFF);
         
         /* Call nr_dlsch_unscrambling to descramble the LLRs */
-        nr_dlsch_unscrambling(llr, size, q, Nid, n_RNTI);
+        if (gold)
+            nr_codeword_unscrambling_cached(gold, llr, size, q, Nid, n_RNTI);
+        else
+            nr_dlsch_unscrambling(llr, size, q, Nid, n_RNTI);
 
         if (verbose && (iter % 100) == 0) {
             printf("  iter %4d: llr[0]=%d llr[1]=%d llr[2]=%d\n",
@@ -1114,13 +1194,16 @@ void nr_descrambling()
         }
     }
     
+    printf("Descrambling: %.3f us per codeword\n", (now_ns() - t0) / 1e3 / (num_iterations > 0 ? num_iterations : 1));
+    nr_gold_cache_free(gold);
+
     printf("\n=== Final descrambled LLR output (first 16 values) ===\n");
     for (int i = 0; i < 16 && i < (int)size; i++) {
         printf("llr[%02d] = %d\n", i, llr[i]);
     }
     
     /* Cleanup */
-    free(llr);
+    nr_scratch_end(&scratch);
     printf("=== NR DLSCH Descrambling tests completed ===\n");
 }
 
@@ -1148,23 +1231,16 @@ void nr_layer_demapping_test()
     printf("Running %d iterations...\n", num_iterations);
     
     /* Allocate layer LLR buffers (input to demapping) */
-    int16_t (*llr_layers)[layer_sz] = aligned_alloc(32, Nl * layer_sz * sizeof(int16_t));
-    if (!llr_layers) {
-        printf("nr_layer_demapping_test: llr_layers allocation failed\n");
-        return;
-    }
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    int16_t (*llr_layers)[layer_sz] = nr_scratch_alloc(&scratch, Nl * layer_sz * sizeof(int16_t));
     memset(llr_layers, 0, Nl * layer_sz * sizeof(int16_t));
     
     /* Allocate codeword LLR buffers (output from demapping) */
     int16_t *llr_cw[2];
-    llr_cw[0] = aligned_alloc(32, length * sizeof(int16_t));
-    llr_cw[1] = aligned_alloc(32, length * sizeof(int16_t));
+    llr_cw[0] = nr_scratch_alloc(&scratch, length * sizeof(int16_t));
+    llr_cw[1] = nr_scratch_alloc(&scratch, length * sizeof(int16_t));
     
-    if (!llr_cw[0] || !llr_cw[1]) {
-        printf("nr_layer_demapping_test: llr_cw allocation failed\n");
-        free(llr_layers);
-        return;
-    }
     memset(llr_cw[0], 0, length * sizeof(int16_t));
     memset(llr_cw[1], 0, length * sizeof(int16_t));
     
@@ -1208,9 +1284,7 @@ void nr_layer_demapping_test()
     }
     
     /* Cleanup */
-    free(llr_layers);
-    free(llr_cw[0]);
-    free(llr_cw[1]);
+    nr_scratch_end(&scratch);
     printf("=== NR Layer Demapping tests completed ===\n");
 }
 
@@ -1238,11 +1312,9 @@ void nr_crc_check()
     printf("Running %d iterations...\n", num_iterations);
     
     /* Allocate data buffer with CRC space (aligned) */
-    uint8_t *data = aligned_alloc(32, total_bytes);
-    if (!data) {
-        printf("nr_crc_check: data buffer allocation failed\n");
-        return;
-    }
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    uint8_t *data = nr_scratch_alloc(&scratch, total_bytes);
     memset(data, 0, total_bytes);
     
     /* Seed data with sample pattern */
@@ -1337,7 +1409,7 @@ void nr_crc_check()
     printf("data[%u] = 0x%02X (CRC byte 2)\n", payload_bytes + 2, data[payload_bytes + 2]);
     
     /* Cleanup */
-    free(data);
+    nr_scratch_end(&scratch);
     printf("=== NR CRC Check tests completed ===\n");
 }
 
@@ -1357,7 +1429,7 @@ void nr_soft_demod()
     const uint32_t llr_offset_symbol = 0;       /* LLR offset in output buffer */
     const int num_iterations = getenv_int("OAI_ITERS", 100000000); /* elevated iterations */
     const int snr_db = getenv_int("OAI_SNR", 10);               /* SNR in dB */
-    const int mod_order = getenv_int("OAI_MOD_ORDER", 6);       /* 2/4/6/8 -> QPSK/16QAM/64QAM/256QAM */
+    const int mod_order = getenv_int("OAI_MOD_ORDER", 6);       /* 2/4/6/8/10 -> QPSK .. 1024QAM */
     
         printf("Soft demod parameters: rx_symbol_size=%u, nbRx=%d, Nl=%d, len=%u\n",
             rx_size_symbol, nbRx, Nl, len);
@@ -1365,41 +1437,24 @@ void nr_soft_demod()
         printf("Running %d iterations...\n", num_iterations);
     
     /* Allocate rxdataF_comp buffer (compensated received symbols) */
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
     int32_t (*rxdataF_comp)[nbRx][rx_size_symbol * NR_SYMBOLS_PER_SLOT] = 
-        aligned_alloc(32, sizeof(int32_t) * Nl * nbRx * rx_size_symbol * NR_SYMBOLS_PER_SLOT);
-    if (!rxdataF_comp) {
-        printf("nr_soft_demod: rxdataF_comp allocation failed\n");
-        return;
-    }
+        nr_scratch_alloc(&scratch, sizeof(int32_t) * Nl * nbRx * rx_size_symbol * NR_SYMBOLS_PER_SLOT);
     memset(rxdataF_comp, 0, sizeof(int32_t) * Nl * nbRx * rx_size_symbol * NR_SYMBOLS_PER_SLOT);
     
     /* Allocate channel magnitude buffers for QAM demodulation */
-    c16_t *dl_ch_mag = aligned_alloc(32, sizeof(c16_t) * rx_size_symbol);
-    c16_t *dl_ch_magb = aligned_alloc(32, sizeof(c16_t) * rx_size_symbol);
-    c16_t *dl_ch_magr = aligned_alloc(32, sizeof(c16_t) * rx_size_symbol);
-    
-    if (!dl_ch_mag || !dl_ch_magb || !dl_ch_magr) {
-        printf("nr_soft_demod: channel magnitude buffer allocation failed\n");
-        free(rxdataF_comp);
-        free(dl_ch_mag);
-        free(dl_ch_magb);
-        return;
-    }
+    c16_t *dl_ch_mag = nr_scratch_alloc(&scratch, sizeof(c16_t) * rx_size_symbol);
+    c16_t *dl_ch_magb = nr_scratch_alloc(&scratch, sizeof(c16_t) * rx_size_symbol);
+    c16_t *dl_ch_magr = nr_scratch_alloc(&scratch, sizeof(c16_t) * rx_size_symbol);
+    
     memset(dl_ch_mag, 0, sizeof(c16_t) * rx_size_symbol);
     memset(dl_ch_magb, 0, sizeof(c16_t) * rx_size_symbol);
     memset(dl_ch_magr, 0, sizeof(c16_t) * rx_size_symbol);
     
     /* Allocate layer LLR output buffer */
-    const int layer_llr_size = len * 8;  /* Max bits per RE (256-QAM) */
-    int16_t (*layer_llr)[layer_llr_size] = aligned_alloc(32, sizeof(int16_t) * Nl * layer_llr_size);
-    if (!layer_llr) {
-        printf("nr_soft_demod: layer_llr allocation failed\n");
-        free(rxdataF_comp);
-        free(dl_ch_mag);
-        free(dl_ch_magb);
-        free(dl_ch_magr);
-        return;
-    }
+    const int layer_llr_size = len * 10; /* Max bits per RE (1024-QAM) */
+    int16_t (*layer_llr)[layer_llr_size] = nr_scratch_alloc(&scratch, sizeof(int16_t) * Nl * layer_llr_size);
     memset(layer_llr, 0, sizeof(int16_t) * Nl * layer_llr_size);
     
     /* Create mock NR_UE_DLSCH_t structures for two codewords */
@@ -1414,40 +1469,21 @@ void nr_soft_demod()
     NR_DL_UE_HARQ_t *dlsch0_harq = NULL;
     NR_DL_UE_HARQ_t *dlsch1_harq = NULL;
     
-    /* Seed rxdataF_comp with sample received symbols (I/Q pairs) */
-    /* Seed channel magnitude buffers per modulation order */
-    for (uint32_t i = 0; i < len; i++) {
-        /* Rough scaling per constellation; these magnitudes are illustrative */
-        if (mod_order >= 8) {
-            dl_ch_mag[i].r = 0x1800;
-            dl_ch_mag[i].i = 0x1800;
-            dl_ch_magb[i].r = 0x3000;
-            dl_ch_magb[i].i = 0x3000;
-            dl_ch_magr[i].r = 0x6000;
-            dl_ch_magr[i].i = 0x6000;
-        } else if (mod_order >= 6) {
-            dl_ch_mag[i].r = 0x2000;
-            dl_ch_mag[i].i = 0x2000;
-            dl_ch_magb[i].r = 0x4000;
-            dl_ch_magb[i].i = 0x4000;
-            dl_ch_magr[i].r = 0x5000;
-            dl_ch_magr[i].i = 0x5000;
-        } else if (mod_order >= 4) {
-            dl_ch_mag[i].r = 0x3000;
-            dl_ch_mag[i].i = 0x3000;
-            dl_ch_magb[i].r = 0x4000;
-            dl_ch_magb[i].i = 0x4000;
-            dl_ch_magr[i].r = 0x5000;
-            dl_ch_magr[i].i = 0x5000;
-        } else { /* QPSK */
-            dl_ch_mag[i].r = 0x4000;
-            dl_ch_mag[i].i = 0x4000;
-            dl_ch_magb[i].r = 0x4000;
-            dl_ch_magb[i].i = 0x4000;
-            dl_ch_magr[i].r = 0x4000;
-            dl_ch_magr[i].i = 0x4000;
+    /* Channel magnitude thresholds from a synthetic channel of layer 0, as
+     * the equalizer derives them (unit gain, no MMSE correction) */
+    int32_t (*dl_ch_est)[rx_size_symbol] = nr_scratch_alloc(&scratch, sizeof(int32_t) * nbRx * rx_size_symbol);
+    for (int rx = 0; rx < nbRx; rx++) {
+        for (uint32_t i = 0; i < rx_size_symbol; i++) {
+            int16_t ch_r = (int16_t)(12000 + ((rx * 1000 + i) % 4000) - 2000);
+            int16_t ch_i = (int16_t)(11000 + ((rx * 1200 + i) % 3500) - 1750);
+            dl_ch_est[rx][i] = ((int32_t)ch_i << 16) | (int32_t)(uint16_t)ch_r;
         }
     }
+    const int ch_shift = nr_mmse_channel_shift(rx_size_symbol, nbRx, 1, dl_ch_est, len);
+    nr_mmse_equalize_layer(rx_size_symbol, nbRx, 0, dl_ch_est, 0, len, ch_shift, mod_order, 1 << 14, 0, NULL, NULL,
+                           (int32_t *)dl_ch_mag, (int32_t *)dl_ch_magb, (int32_t *)dl_ch_magr);
+    printf("Thresholds of RE 0: mag=%d magb=%d magr=%d (shift %d)\n",
+           dl_ch_mag[0].r, dl_ch_magb[0].r, dl_ch_magr[0].r, ch_shift);
     
     printf("Starting soft demodulation loop...\n");
     
@@ -1504,11 +1540,7 @@ void nr_soft_demod()
     }
     
     /* Cleanup */
-    free(rxdataF_comp);
-    free(dl_ch_mag);
-    free(dl_ch_magb);
-    free(dl_ch_magr);
-    free(layer_llr);
+    nr_scratch_end(&scratch);
     printf("=== NR Soft Demodulation tests completed ===\n");
 }
 
@@ -1541,12 +1573,10 @@ void nr_mmse_eq()
     printf("NOTE: Using simplified MMSE wrapper (demonstrates structure)\n\n");
     
     /* Allocate rxdataF_comp buffer (compensated received symbols) */
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
     int32_t (*rxdataF_comp)[n_rx][rx_size_symbol * NR_SYMBOLS_PER_SLOT] = 
-        aligned_alloc(32, sizeof(int32_t) * nl * n_rx * rx_size_symbol * NR_SYMBOLS_PER_SLOT);
-    if (!rxdataF_comp) {
-        printf("nr_mmse_eq: rxdataF_comp allocation failed\n");
-        return;
-    }
+        nr_scratch_alloc(&scratch, sizeof(int32_t) * nl * n_rx * rx_size_symbol * NR_SYMBOLS_PER_SLOT);
     
     /* Pre-fill rxdataF_comp with simulated received signal data */
     for (int layer = 0; layer < nl; layer++) {
@@ -1564,19 +1594,12 @@ void nr_mmse_eq()
     
     /* Allocate channel magnitude buffers for QAM */
     c16_t (*dl_ch_mag)[n_rx][rx_size_symbol] = 
-        aligned_alloc(32, sizeof(c16_t) * nl * n_rx * rx_size_symbol);
+        nr_scratch_alloc(&scratch, sizeof(c16_t) * nl * n_rx * rx_size_symbol);
     c16_t (*dl_ch_magb)[n_rx][rx_size_symbol] = 
-        aligned_alloc(32, sizeof(c16_t) * nl * n_rx * rx_size_symbol);
+        nr_scratch_alloc(&scratch, sizeof(c16_t) * nl * n_rx * rx_size_symbol);
     c16_t (*dl_ch_magr)[n_rx][rx_size_symbol] = 
-        aligned_alloc(32, sizeof(c16_t) * nl * n_rx * rx_size_symbol);
+        nr_scratch_alloc(&scratch, sizeof(c16_t) * nl * n_rx * rx_size_symbol);
     
-    if (!dl_ch_mag || !dl_ch_magb || !dl_ch_magr) {
-        printf("nr_mmse_eq: channel magnitude buffer allocation failed\n");
-        free(rxdataF_comp);
-        free(dl_ch_mag);
-        free(dl_ch_magb);
-        return;
-    }
     memset(dl_ch_mag, 0, sizeof(c16_t) * nl * n_rx * rx_size_symbol);
     memset(dl_ch_magb, 0, sizeof(c16_t) * nl * n_rx * rx_size_symbol);
     memset(dl_ch_magr, 0, sizeof(c16_t) * nl * n_rx * rx_size_symbol);
@@ -1584,15 +1607,7 @@ void nr_mmse_eq()
     /* Allocate channel estimates buffer */
     const int matrixSz = n_rx * nl;
     int32_t (*dl_ch_estimates_ext)[rx_size_symbol] = 
-        aligned_alloc(32, sizeof(int32_t) * matrixSz * rx_size_symbol);
-    if (!dl_ch_estimates_ext) {
-        printf("nr_mmse_eq: dl_ch_estimates_ext allocation failed\n");
-        free(rxdataF_comp);
-        free(dl_ch_mag);
-        free(dl_ch_magb);
-        free(dl_ch_magr);
-        return;
-    }
+        nr_scratch_alloc(&scratch, sizeof(int32_t) * matrixSz * rx_size_symbol);
     memset(dl_ch_estimates_ext, 0, sizeof(int32_t) * matrixSz * rx_size_symbol);
     
     /* Seed rxdataF_comp with sample received symbols (I/Q pairs) */
@@ -1626,19 +1641,9 @@ void nr_mmse_eq()
         }
     }
     
-    /* Seed channel magnitude buffers with typical values for 16-QAM */
-    for (int layer = 0; layer < nl; layer++) {
-        for (int ant = 0; ant < n_rx; ant++) {
-            for (int i = 0; i < length; i++) {
-                dl_ch_mag[layer][ant][i].r = 0x2000;   /* Level 1 magnitude */
-                dl_ch_mag[layer][ant][i].i = 0x2000;
-                dl_ch_magb[layer][ant][i].r = 0x4000;  /* Level 2 magnitude */
-                dl_ch_magb[layer][ant][i].i = 0x4000;
-                dl_ch_magr[layer][ant][i].r = 0x6000;  /* Level 3 magnitude */
-                dl_ch_magr[layer][ant][i].i = 0x6000;
-            }
-        }
-    }
+    /* Channel magnitude thresholds are an output of nr_dlsch_mmse, derived
+     * from the channel estimates with this output shift */
+    const int ch_shift = nr_mmse_channel_shift(rx_size_symbol, n_rx, nl, dl_ch_estimates_ext, length);
     
     printf("Starting MMSE equalization loop...\n");
     printf("(Calling nr_dlsch_mmse for MMSE equalization)\n\n");
@@ -1646,16 +1651,7 @@ void nr_mmse_eq()
     /* Save original pre-filled data for restoration each iteration */
     const int total_size = rx_size_symbol * NR_SYMBOLS_PER_SLOT;
     int32_t (*original_data)[n_rx][total_size] = 
-        aligned_alloc(32, sizeof(int32_t) * nl * n_rx * total_size);
-    if (!original_data) {
-        printf("nr_mmse_eq: original_data allocation failed\n");
-        free(rxdataF_comp);
-        free(dl_ch_mag);
-        free(dl_ch_magb);
-        free(dl_ch_magr);
-        free(dl_ch_estimates_ext);
-        return;
-    }
+        nr_scratch_alloc(&scratch, sizeof(int32_t) * nl * n_rx * total_size);
     
     for (int layer = 0; layer < nl; layer++) {
         for (int ant = 0; ant < n_rx; ant++) {
@@ -1688,7 +1684,7 @@ void nr_mmse_eq()
                       dl_ch_estimates_ext,
                       nb_rb,
                       mod_order,
-                      0,           /* shift */
+                      ch_shift,
                       symbol,
                       length,
                       noise_var);
@@ -1704,14 +1700,14 @@ void nr_mmse_eq()
     for (int i = 0; i < 8; i++) {
         printf("  rxdataF_comp[%d] = 0x%08X\n", i, final_ptr[i]);
     }
+    printf("LLR thresholds of RE 0 per layer (shift %d):\n", ch_shift);
+    for (int layer = 0; layer < nl; layer++) {
+        printf("  layer %d: mag=%d magb=%d magr=%d\n", layer,
+               dl_ch_mag[layer][0][0].r, dl_ch_magb[layer][0][0].r, dl_ch_magr[layer][0][0].r);
+    }
     
     /* Cleanup */
-    free(rxdataF_comp);
-    free(dl_ch_mag);
-    free(dl_ch_magb);
-    free(dl_ch_magr);
-    free(dl_ch_estimates_ext);
-    free(original_data);
+    nr_scratch_end(&scratch);
     printf("=== NR MMSE Equalization tests completed ===\n");
 }
 
@@ -1744,20 +1740,13 @@ void nr_ldpc_dec()
     /* Input LLR buffer (soft bits: int8_t LLR values) */
     /* For BG1, block length N = 66*Z (38.212 rate-1/3) */
     const int input_llr_size = 66 * Z;
-    int8_t *p_llr = aligned_alloc(32, input_llr_size * sizeof(int8_t));
-    if (!p_llr) {
-        printf("nr_ldpc_dec: Failed to allocate input LLR buffer\n");
-        return;
-    }
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    int8_t *p_llr = nr_scratch_alloc(&scratch, input_llr_size * sizeof(int8_t));
     memset(p_llr, 0, input_llr_size * sizeof(int8_t));
     
     /* Output decoded bits buffer (int8_t: decoded bits, one per element) */
-    int8_t *p_out = aligned_alloc(32, output_bytes * sizeof(int8_t));
-    if (!p_out) {
-        printf("nr_ldpc_dec: Failed to allocate output buffer\n");
-        free(p_llr);
-        return;
-    }
+    int8_t *p_out = nr_scratch_alloc(&scratch, output_bytes * sizeof(int8_t));
     memset(p_out, 0, output_bytes * sizeof(int8_t));
     
     /* LDPC decoder parameters structure */
@@ -1790,16 +1779,8 @@ void nr_ldpc_dec()
     /* Buffers for encoding and LLR generation */
     const int info_bytes = (Kprime + 7) / 8;
     const int code_bits = 66 * Z; /* full block length for BG1 rate-1/3 */
-    uint8_t *info_bits = aligned_alloc(32, info_bytes);
-    uint8_t *coded_bits = aligned_alloc(32, code_bits);
-    if (!info_bits || !coded_bits) {
-        printf("nr_ldpc_dec: Failed to allocate info/coded buffers\n");
-        free(info_bits);
-        free(coded_bits);
-        free(p_llr);
-        free(p_out);
-        return;
-    }
+    uint8_t *info_bits = nr_scratch_alloc(&scratch, info_bytes);
+    uint8_t *coded_bits = nr_scratch_alloc(&scratch, code_bits);
     memset(info_bits, 0, info_bytes);
     memset(coded_bits, 0, code_bits);
 
@@ -1879,10 +1860,7 @@ void nr_ldpc_dec()
            (float)total_iterations / num_iterations);
     
     /* Cleanup */
-    free(coded_bits);
-    free(info_bits);
-    free(p_llr);
-    free(p_out);
+    nr_scratch_end(&scratch);
     printf("=== NR LDPC Decoder tests completed ===\n");
 }
 
@@ -1910,21 +1888,14 @@ void nr_ofdm_demo()
            ofdm_symbol_size, nb_prefix_samples, symbols_per_slot, nb_antennas_rx);
     
     /* Allocate RX data buffers (aligned) */
-    int32_t *rxdata = aligned_alloc(32, samples_per_frame * sizeof(int32_t));
-    if (!rxdata) {
-        printf("nr_ofdm_demo: rxdata allocation failed\n");
-        return;
-    }
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    int32_t *rxdata = nr_scratch_alloc(&scratch, samples_per_frame * sizeof(int32_t));
     memset(rxdata, 0, samples_per_frame * sizeof(int32_t));
     
     /* Allocate RX frequency-domain buffer for the whole slot (14 symbols) */
     const int fd_per_slot_words = ofdm_symbol_size * symbols_per_slot; /* int32 per complex RE */
-    int32_t *rxdataF = aligned_alloc(32, fd_per_slot_words * sizeof(int32_t));
-    if (!rxdataF) {
-        printf("nr_ofdm_demo: rxdataF allocation failed\n");
-        free(rxdata);
-        return;
-    }
+    int32_t *rxdataF = nr_scratch_alloc(&scratch, fd_per_slot_words * sizeof(int32_t));
     memset(rxdataF, 0, fd_per_slot_words * sizeof(int32_t));
     
     /* Minimal frame parms struct matching nr_slot_fep expected layout */
@@ -1983,9 +1954,6 @@ void nr_ofdm_demo()
                int samples_per_symbol = ofdm_symbol_size + nb_prefix_samples;
                int symbol_offset = slot_offset + (symbol * samples_per_symbol);
            
-               /* Clear only the region for this symbol */
-               memset(&rxdataF[symbol * ofdm_symbol_size], 0, ofdm_symbol_size * sizeof(int32_t));
-           
                /* Call nr_slot_fep to perform DFT on time-domain OFDM symbol */
                int result = nr_slot_fep(
                    NULL,                                       /* PHY_VARS_NR_UE (NULL for this demo) */
@@ -2018,7 +1986,2519 @@ void nr_ofdm_demo()
     }
     
     /* Cleanup */
-    free(rxdata);
-    free(rxdataF);
+    nr_scratch_end(&scratch);
     printf("=== NR OFDM FEP Demonstration completed ===\n");
-}
\ No newline at end of file
+}
+
+/* Checks the code blocks of the last TB encoded by enc against 38.212 5.2.2:
+ * the segmentation of nr_tb_segmentation_params(), C * K' = B + C * L,
+ * K = Kb * Zc and F = K - K' fillers set to zero, the CRC24B of every block
+ * (OAI crc24b) and the TB with its CRC rebuilt from the block payloads.
+ * Returns the number of failed checks. */
+static int tb_check_segments(nr_tb_encoder_t *enc, const uint8_t *tb, uint32_t A, uint16_t R)
+{
+    const nr_tb_seg_t *seg = &enc->seg;
+    nr_tb_seg_t ref;
+    int errors = 0;
+
+    if (nr_tb_segmentation_params(A, R, &ref) < 0) return 1;
+    if (memcmp(seg, &ref, sizeof(ref)) != 0) errors++;
+
+    const uint32_t L_tb = ref.L_tb;
+    const uint32_t B = ref.B;
+    const uint32_t C = ref.C;
+    const uint32_t L_cb = ref.L_cb;
+
+    if (seg->C * seg->Kprime != B + C * L_cb) errors++;
+    if (seg->K != (seg->BG == 1 ? 22u : 10u) * seg->Zc || seg->Kb * seg->Zc < seg->Kprime || seg->F != seg->K - seg->Kprime)
+        errors++;
+    if (errors) return errors;
+
+    const uint32_t payload = seg->Kprime - L_cb;
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    uint8_t *tb_crc = nr_scratch_calloc(&scratch, (B + 7) / 8 + 1, 1);
+    for (uint32_t r = 0; r < C; r++) {
+        const uint8_t *cb = enc->cb_in + (size_t)r * enc->cb_in_stride;
+        if (L_cb && crc24b((uint8_t *)cb, seg->Kprime) != 0) errors++;
+        for (uint32_t k = seg->Kprime; k < seg->K; k++)
+            if ((cb[k >> 3] >> (7 - (k & 7))) & 1) {
+                errors++;
+                break;
+            }
+        for (uint32_t k = 0; k < payload; k++)
+            if ((cb[k >> 3] >> (7 - (k & 7))) & 1) tb_crc[(r * payload + k) >> 3] |= 0x80 >> ((r * payload + k) & 7);
+    }
+
+    /* The payloads put back together are the TB followed by its CRC */
+    if (memcmp(tb_crc, tb, A / 8) != 0) errors++;
+    if ((L_tb == 24 ? crc24a(tb_crc, B) : crc16(tb_crc, B)) != 0) errors++;
+    nr_scratch_end(&scratch);
+    return errors;
+}
+
+void nr_tb_encode_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    /* CRC tables are needed by the TB/CB CRC attachment */
+    crcTableInit();
+
+    printf("=== Starting NR TB Encode (CRC + segmentation + parallel LDPC) tests ===\n");
+
+    const int nb_threads     = getenv_int("OAI_THREADS", 4);
+    const int num_iterations = getenv_int("OAI_ITERS", 1000);
+    const int nb_layers      = getenv_int("OAI_LAYERS", 1);
+    const uint16_t R         = (uint16_t)getenv_int("OAI_CODE_RATE", 948);  /* code rate x1024 */
+    const int nb_symbols     = 12;                                           /* PDSCH data symbols per slot */
+
+    /* Allocations from a couple of QPSK RBs up to a full 273-RB 256-QAM slot */
+    const struct { int nb_rb; int Qm; } cases[] = {
+        {   2, 2 }, {   8, 2 }, {  24, 4 }, {  52, 6 },
+        { 106, 6 }, { 273, 6 }, { 273, 8 }
+    };
+    const int nb_cases = sizeof(cases) / sizeof(cases[0]);
+
+    const uint32_t max_A = nr_tbs_compute(273 * 12 * nb_symbols, R, 8, nb_layers);
+
+    printf("Parameters: threads=%d, layers=%d, R=%u/1024, symbols=%d, iterations=%d, max TBS=%u bits\n",
+           nb_threads, nb_layers, R, nb_symbols, num_iterations, max_A);
+
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    uint8_t *tb = nr_scratch_alloc(&scratch, ((max_A / 8) + 63) & ~63u);
+    nr_tb_encoder_t *enc_st = nr_tb_encoder_init(max_A, 1);
+    nr_tb_encoder_t *enc_mt = nr_tb_encoder_init(max_A, nb_threads);
+    if (!enc_st || !enc_mt) {
+        printf("nr_tb_encode_test: allocation failed\n");
+        nr_tb_encoder_free(enc_st);
+        nr_tb_encoder_free(enc_mt);
+        nr_scratch_end(&scratch);
+        return;
+    }
+
+    uint32_t rnd_state = 0x7B5EED01u ^ (uint32_t)time(NULL);
+
+    printf("\n  RBs Qm      TBS BG    C     K'   Zc    F | 1 thread avg us | %2d threads avg/min/max us | speedup\n",
+           nb_threads);
+
+    for (int c = 0; c < nb_cases; c++) {
+        const uint32_t A = nr_tbs_compute(cases[c].nb_rb * 12 * nb_symbols, R, cases[c].Qm, nb_layers);
+
+        for (uint32_t i = 0; i < A / 8; i++)
+            tb[i] = (uint8_t)xorshift32(&rnd_state);
+
+        nr_tb_seg_t seg;
+        if (nr_tb_segmentation_params(A, R, &seg) != 0) {
+            printf("  %3d %2d %8u: segmentation failed\n", cases[c].nb_rb, cases[c].Qm, A);
+            continue;
+        }
+
+        /* Single-thread reference, then the pooled encoder */
+        uint64_t sum_st = 0;
+        for (int iter = 0; iter < num_iterations; iter++) {
+            tb[0] = (uint8_t)iter;
+            uint64_t t0 = now_ns();
+            nr_tb_encoder_encode(enc_st, tb, A, R);
+            sum_st += now_ns() - t0;
+        }
+
+        uint64_t sum_mt = 0, min_mt = UINT64_MAX, max_mt = 0;
+        int errors = 0;
+        for (int iter = 0; iter < num_iterations; iter++) {
+            tb[0] = (uint8_t)iter;
+            uint64_t t0 = now_ns();
+            if (nr_tb_encoder_encode(enc_mt, tb, A, R) != (int)seg.C) errors++;
+            uint64_t dt = now_ns() - t0;
+            sum_mt += dt;
+            if (dt < min_mt) min_mt = dt;
+            if (dt > max_mt) max_mt = dt;
+        }
+        const int seg_errors = tb_check_segments(enc_mt, tb, A, R);
+
+        const double avg_st = sum_st / 1e3 / num_iterations;
+        const double avg_mt = sum_mt / 1e3 / num_iterations;
+        printf("  %3d %2d %8u %2u %4u %6u %4u %4u | %15.1f | %8.1f/%7.1f/%7.1f  | %6.2fx%s%s\n",
+               cases[c].nb_rb, cases[c].Qm, A, seg.BG, seg.C, seg.Kprime, seg.Zc, seg.F,
+               avg_st, avg_mt, min_mt / 1e3, max_mt / 1e3, avg_st / avg_mt,
+               errors ? " (encoder errors)" : "", seg_errors ? " (segmentation mismatch)" : "");
+    }
+
+    printf("\n=== Final encoded output (CB 0 of the last TB, first 8 bytes) ===\n");
+    for (int i = 0; i < 8; i++) {
+        printf("cb_out[0][%d] = 0x%02X\n", i, nr_tb_encoder_cb_output(enc_mt, 0)[i]);
+    }
+
+    nr_scratch_end(&scratch);
+    nr_tb_encoder_free(enc_st);
+    nr_tb_encoder_free(enc_mt);
+    printf("=== NR TB Encode tests completed ===\n");
+}
+
+void nr_rate_matching_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    /* CRC tables are needed by the TB/CB CRC attachment */
+    crcTableInit();
+
+    printf("=== Starting NR Rate Matching (bit selection + bit interleaving) tests ===\n");
+
+    const int num_iterations = getenv_int("OAI_ITERS", 1000);
+    const int nb_layers      = getenv_int("OAI_LAYERS", 1);
+    const int nb_symbols     = 12;                  /* PDSCH data symbols per slot */
+
+    /* Allocations and code rates roughly following the MCS table 1/2 ranges */
+    const struct { int nb_rb; int Qm; uint16_t R; } cases[] = {
+        {  24, 2, 308 }, { 106, 2, 602 }, { 106, 4, 658 }, { 273, 4, 490 },
+        { 106, 6, 873 }, { 273, 6, 754 }, { 273, 8, 948 }
+    };
+    const int nb_cases = sizeof(cases) / sizeof(cases[0]);
+
+    const uint32_t max_A = nr_tbs_compute(273 * 12 * nb_symbols, 948, 8, nb_layers);
+    const uint32_t max_G = 273 * 12 * nb_symbols * 8 * nb_layers;
+
+    printf("Parameters: layers=%d, symbols=%d, iterations=%d\n", nb_layers, nb_symbols, num_iterations);
+
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    uint8_t *tb    = nr_scratch_alloc(&scratch, ((max_A / 8) + 63) & ~63u);
+    uint8_t *f     = nr_scratch_alloc(&scratch, ((max_G / 8) + 64) & ~63u);
+    uint8_t *f_ref = nr_scratch_alloc(&scratch, ((max_G / 8) + 64) & ~63u);
+    nr_tb_encoder_t *enc = nr_tb_encoder_init(max_A, 1);
+    nr_rm_ctx_t *rm = nr_rm_init(max_G);
+    if (!enc || !rm) {
+        printf("nr_rate_matching_test: allocation failed\n");
+        nr_tb_encoder_free(enc);
+        nr_rm_free(rm);
+        nr_scratch_end(&scratch);
+        return;
+    }
+    memset(f, 0, ((max_G / 8) + 64) & ~63u);
+    memset(f_ref, 0, ((max_G / 8) + 64) & ~63u);
+
+    uint32_t rnd_state = 0x5EED0027u ^ (uint32_t)time(NULL);
+
+    printf("\n  RBs Qm    R        G      TBS    C   Zc rv | ref us/TB | simd us/TB | simd Gbit/s | speedup | match\n");
+
+    for (int c = 0; c < nb_cases; c++) {
+        const uint8_t Qm = (uint8_t)cases[c].Qm;
+        const uint32_t G = (uint32_t)cases[c].nb_rb * 12 * nb_symbols * Qm * nb_layers;
+        const uint32_t A = nr_tbs_compute(cases[c].nb_rb * 12 * nb_symbols, cases[c].R, Qm, nb_layers);
+
+        for (uint32_t i = 0; i < A / 8; i++)
+            tb[i] = (uint8_t)xorshift32(&rnd_state);
+
+        if (nr_tb_encoder_encode(enc, tb, A, cases[c].R) < 0) {
+            printf("  %3d %2d %4u: TB encoding failed (A=%u)\n", cases[c].nb_rb, Qm, cases[c].R, A);
+            continue;
+        }
+
+        for (uint8_t rv = 0; rv < 4; rv++) {
+            /* Bit-by-bit 38.212 reference, code block by code block */
+            const int ref_iters = num_iterations / 10 > 0 ? num_iterations / 10 : 1;
+            uint64_t t0 = now_ns();
+            for (int iter = 0; iter < ref_iters; iter++) {
+                uint32_t off = 0;
+                for (uint32_t r = 0; r < enc->seg.C; r++) {
+                    const uint32_t E = nr_rm_get_E(&enc->seg, G, Qm, nb_layers, r);
+                    nr_rate_matching_cb_ref(nr_tb_encoder_cb_output(enc, r), &enc->seg, enc->seg.Ncb, rv, Qm, E, f_ref, off);
+                    off += E;
+                }
+            }
+            const double ref_us = (now_ns() - t0) / 1e3 / ref_iters;
+
+            t0 = now_ns();
+            int ret = 0;
+            for (int iter = 0; iter < num_iterations; iter++)
+                ret = nr_rate_matching_tb(rm, enc, G, Qm, (uint8_t)nb_layers, rv, f);
+            const double simd_us = (now_ns() - t0) / 1e3 / num_iterations;
+
+            const int match = (ret == (int)G) && !memcmp(f, f_ref, G / 8);
+            printf("  %3d %2d %4u %8u %8u %4u %4u %2u | %9.2f | %10.2f | %11.2f | %6.1fx | %s\n",
+                   cases[c].nb_rb, Qm, cases[c].R, G, A, enc->seg.C, enc->seg.Zc, rv,
+                   ref_us, simd_us, G / (simd_us * 1e3), ref_us / simd_us, match ? "yes" : "NO");
+        }
+    }
+
+    printf("\n=== Final rate-matched output (last TB, first 8 bytes) ===\n");
+    for (int i = 0; i < 8; i++) {
+        printf("f[%d] = 0x%02X\n", i, f[i]);
+    }
+
+    /* LBRM: Ncb below seg->Ncb, ending before, inside and after the fillers,
+     * with E > Ncb so that the selection wraps around the limited buffer */
+    const uint32_t A_lbrm = nr_tbs_compute(24 * 12 * nb_symbols, 308, 2, 1);
+    for (uint32_t i = 0; i < A_lbrm / 8; i++)
+        tb[i] = (uint8_t)xorshift32(&rnd_state);
+    if (nr_tb_encoder_encode(enc, tb, A_lbrm, 308) >= 0) {
+        const nr_tb_seg_t *seg = &enc->seg;
+        const uint32_t fs = seg->Kprime - 2 * seg->Zc;
+        const uint32_t fe = seg->K - 2 * seg->Zc;
+        const uint32_t lbrm_Ncb[3] = { fs - fs / 4, (fs + fe) / 2, fe + (seg->Ncb - fe) / 2 };
+
+        printf("\n  LBRM    TBS   Ncb    fs    fe rv     E | match\n");
+        for (int l = 0; l < 3; l++) {
+            const uint32_t Ncb = lbrm_Ncb[l];
+            const uint32_t E = (Ncb + Ncb / 2 + 7) & ~7u;
+            for (uint8_t rv = 0; rv < 4; rv++) {
+                memset(f, 0, E / 8);
+                memset(f_ref, 0, E / 8);
+                const int ret = nr_rate_matching_cb(rm, nr_tb_encoder_cb_output(enc, 0), seg, Ncb, rv, 2, E, f, 0);
+                nr_rate_matching_cb_ref(nr_tb_encoder_cb_output(enc, 0), seg, Ncb, rv, 2, E, f_ref, 0);
+                const int match = (ret == (int)E) && !memcmp(f, f_ref, E / 8);
+                printf("       %6u %5u %5u %5u %2u %5u | %s\n", A_lbrm, Ncb, fs, fe, rv, E, match ? "yes" : "NO");
+            }
+        }
+    }
+
+    nr_scratch_end(&scratch);
+    nr_tb_encoder_free(enc);
+    nr_rm_free(rm);
+    printf("=== NR Rate Matching tests completed ===\n");
+}
+
+void nr_harq_combining_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    /* CRC tables are needed by the TB/CB CRC attachment */
+    crcTableInit();
+
+    printf("=== Starting NR Rate Recovery + HARQ soft combining tests ===\n");
+
+    const int num_iterations = getenv_int("OAI_ITERS", 2000);   /* received TBs per configuration */
+    const int nb_layers      = getenv_int("OAI_LAYERS", 1);
+    const int nb_symbols     = 12;                              /* PDSCH data symbols per slot */
+    const uint8_t rv_seq[4]  = { 0, 2, 3, 1 };                  /* 38.214 Table 5.1.2.1-2 order */
+
+    const struct { int nb_rb; int Qm; uint16_t R; } cases[] = {
+        { 106, 4, 658 }, { 273, 6, 754 }, { 273, 8, 948 }
+    };
+    const int nb_cases = sizeof(cases) / sizeof(cases[0]);
+    const int procs_cfg[2] = { 8, 16 };
+    const int bits_cfg[2] = { 16, 8 };
+
+    const uint32_t max_A = nr_tbs_compute(273 * 12 * nb_symbols, 948, 8, nb_layers);
+    const uint32_t max_G = 273 * 12 * nb_symbols * 8 * nb_layers;
+
+    printf("Parameters: layers=%d, symbols=%d, TBs per configuration=%d, RV sequence 0,2,3,1\n",
+           nb_layers, nb_symbols, num_iterations);
+
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    uint8_t *tb  = nr_scratch_alloc(&scratch, ((max_A / 8) + 63) & ~63u);
+    uint8_t *f   = nr_scratch_alloc(&scratch, ((max_G / 8) + 64) & ~63u);
+    int16_t *llr = nr_scratch_alloc(&scratch, 4 * (size_t)max_G * sizeof(int16_t));
+    nr_tb_encoder_t *enc = nr_tb_encoder_init(max_A, 1);
+    nr_rm_ctx_t *rm = nr_rm_init(max_G);
+    if (!enc || !rm) {
+        printf("nr_harq_combining_test: allocation failed\n");
+        nr_tb_encoder_free(enc);
+        nr_rm_free(rm);
+        nr_scratch_end(&scratch);
+        return;
+    }
+    memset(f, 0, ((max_G / 8) + 64) & ~63u);
+
+    uint32_t rnd_state = 0x5EED0028u ^ (uint32_t)time(NULL);
+
+    printf("\n  RBs Qm        G    C procs bits | pool MB | us/TB  | MLLR/s  | GB/s touched | hard errors after 4 RVs\n");
+
+    for (int c = 0; c < nb_cases; c++) {
+        const uint8_t Qm = (uint8_t)cases[c].Qm;
+        const uint32_t G = (uint32_t)cases[c].nb_rb * 12 * nb_symbols * Qm * nb_layers;
+        const uint32_t A = nr_tbs_compute(cases[c].nb_rb * 12 * nb_symbols, cases[c].R, Qm, nb_layers);
+
+        for (uint32_t i = 0; i < A / 8; i++)
+            tb[i] = (uint8_t)xorshift32(&rnd_state);
+        if (nr_tb_encoder_encode(enc, tb, A, cases[c].R) < 0) {
+            printf("  %3d %2d: TB encoding failed (A=%u)\n", cases[c].nb_rb, Qm, A);
+            continue;
+        }
+        const nr_tb_seg_t *seg = &enc->seg;
+
+        /* One noisy LLR vector per RV: bit 0 -> positive LLR, mean 24, sigma 16 */
+        for (int t = 0; t < 4; t++) {
+            nr_rate_matching_tb(rm, enc, G, Qm, (uint8_t)nb_layers, rv_seq[t], f);
+            for (uint32_t n = 0; n < G; n++) {
+                const int bit = (f[n >> 3] >> (n & 7)) & 1;
+                llr[(size_t)t * G + n] = (int16_t)lrint((bit ? -24.0 : 24.0) + 16.0 * gaussian_noise(&rnd_state));
+            }
+        }
+
+        for (int pc = 0; pc < 2; pc++) {
+            for (int bc = 0; bc < 2; bc++) {
+                const int nb_procs = procs_cfg[pc];
+                nr_harq_pool_t *pool = nr_harq_pool_init(nb_procs, seg->C, G, bits_cfg[bc]);
+                if (!pool) {
+                    printf("  %3d %2d: HARQ pool allocation failed (%d procs)\n", cases[c].nb_rb, Qm, nb_procs);
+                    continue;
+                }
+
+                /* Processes are served round-robin, each walking the RV sequence */
+                uint64_t t0 = now_ns();
+                for (int iter = 0; iter < num_iterations; iter++) {
+                    const int pid = iter % nb_procs;
+                    const int t = (iter / nb_procs) & 3;
+                    if (t == 0) nr_harq_proc_reset(pool, pid, seg);
+                    nr_rate_recovery_tb(pool, pid, seg, G, Qm, (uint8_t)nb_layers, rv_seq[t], llr + (size_t)t * G);
+                }
+                const double us = (now_ns() - t0) / 1e3 / num_iterations;
+
+                /* Hard decisions of process 0 after a full RV cycle against the encoder output */
+                nr_harq_proc_reset(pool, 0, seg);
+                for (int t = 0; t < 4; t++)
+                    nr_rate_recovery_tb(pool, 0, seg, G, Qm, (uint8_t)nb_layers, rv_seq[t], llr + (size_t)t * G);
+                uint32_t errors = 0;
+                for (uint32_t r = 0; r < seg->C; r++) {
+                    const uint8_t *d = nr_tb_encoder_cb_output(enc, r);
+                    for (uint32_t k = 0; k < seg->Ncb; k++) {
+                        if (k + 2 * seg->Zc >= seg->Kprime && k + 2 * seg->Zc < seg->K) continue;
+                        const int v = (bits_cfg[bc] == 16) ? nr_harq_cb_buffer16(pool, 0, r)[k] : nr_harq_cb_buffer8(pool, 0, r)[k];
+                        const uint32_t bit = 2 * seg->Zc + k;
+                        if (v != 0 && (v < 0) != ((d[bit >> 3] >> (7 - (bit & 7))) & 1)) errors++;
+                    }
+                }
+
+                /* Each LLR is read once and its soft-buffer entry read and written once */
+                const double bytes = G * (2.0 + 2.0 * bits_cfg[bc] / 8);
+                printf("  %3d %2d %8u %4u %5d %4d | %7.1f | %6.1f | %7.1f | %12.2f | %u\n",
+                       cases[c].nb_rb, Qm, G, seg->C, nb_procs, bits_cfg[bc],
+                       pool->mem_size / 1048576.0, us, G / us, bytes / (us * 1e3), errors);
+
+                nr_harq_pool_free(pool);
+            }
+        }
+    }
+
+    /* LBRM: recovery on a limited Ncb ending before, inside and after the
+     * fillers, E > Ncb wrapping around it, against a bit-by-bit placement */
+    const uint32_t A_lbrm = nr_tbs_compute(24 * 12 * nb_symbols, 308, 2, 1);
+    for (uint32_t i = 0; i < A_lbrm / 8; i++)
+        tb[i] = (uint8_t)xorshift32(&rnd_state);
+    if (nr_tb_encoder_encode(enc, tb, A_lbrm, 308) >= 0) {
+        const nr_tb_seg_t *seg = &enc->seg;
+        const uint32_t fs = seg->Kprime - 2 * seg->Zc;
+        const uint32_t fe = seg->K - 2 * seg->Zc;
+        const uint32_t lbrm_Ncb[3] = { fs - fs / 4, (fs + fe) / 2, fe + (seg->Ncb - fe) / 2 };
+        int16_t *w     = nr_scratch_alloc(&scratch, seg->Ncb * sizeof(int16_t));
+        int16_t *w_ref = nr_scratch_alloc(&scratch, seg->Ncb * sizeof(int16_t));
+        int16_t *e     = nr_scratch_alloc(&scratch, 2 * (size_t)seg->Ncb * sizeof(int16_t));
+
+        printf("\n  LBRM    TBS   Ncb    fs    fe     E | RVs 0,2,3,1 combined match\n");
+        for (int l = 0; l < 3; l++) {
+            nr_tb_seg_t lseg = *seg;
+            lseg.Ncb = lbrm_Ncb[l];
+            const uint32_t E = (lseg.Ncb + lseg.Ncb / 2 + 7) & ~7u;
+            const uint32_t Er = E / 2;
+            memset(w, 0, lseg.Ncb * sizeof(int16_t));
+            memset(w_ref, 0, lseg.Ncb * sizeof(int16_t));
+
+            int ret = 0;
+            for (int t = 0; t < 4; t++) {
+                nr_rate_matching_cb_ref(nr_tb_encoder_cb_output(enc, 0), seg, lseg.Ncb, rv_seq[t], 2, E, f, 0);
+                for (uint32_t n = 0; n < E; n++)
+                    llr[n] = (int16_t)(((f[n >> 3] >> (n & 7)) & 1) ? -(t + 1) : 24 + t);
+                ret |= nr_rate_recovery_cb_into16(w, e, &lseg, rv_seq[t], 2, E, llr) != (int)E;
+
+                /* Selected bit k went to row k / Er, column k % Er of the interleaver */
+                const uint32_t k0 = nr_rm_get_k0(seg->BG, seg->Zc, lseg.Ncb, rv_seq[t]);
+                for (uint32_t k = 0, j = 0; k < E; j++) {
+                    const uint32_t pos = (k0 + j) % lseg.Ncb;
+                    if (pos >= fs && pos < fe) continue;
+                    w_ref[pos] += llr[(k % Er) * 2 + k / Er];
+                    k++;
+                }
+            }
+            const int match = !ret && !memcmp(w, w_ref, lseg.Ncb * sizeof(int16_t));
+            printf("       %6u %5u %5u %5u %5u | %s\n", A_lbrm, lseg.Ncb, fs, fe, E, match ? "yes" : "NO");
+        }
+    }
+
+    nr_scratch_end(&scratch);
+    nr_tb_encoder_free(enc);
+    nr_rm_free(rm);
+    printf("=== NR Rate Recovery + HARQ soft combining tests completed ===\n");
+}
+
+void nr_harq_compress_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    /* CRC tables are needed by the TB/CB CRC attachment */
+    crcTableInit();
+
+    printf("=== Starting NR compressed HARQ soft-buffer tests ===\n");
+
+    const int num_iterations = getenv_int("OAI_ITERS", 1000);   /* received TBs per store */
+    const int nb_ues         = getenv_int("OAI_UES", 4);
+    const int nb_layers      = getenv_int("OAI_LAYERS", 1);
+    const int nb_rb          = getenv_int("OAI_RB", 273);
+    const uint8_t Qm         = (uint8_t)getenv_int("OAI_QM", 6);
+    const uint16_t R         = (uint16_t)getenv_int("OAI_CODE_RATE", 754);
+    const int snr_db         = getenv_int("OAI_SNR", 3);        /* per-LLR SNR of a single transmission */
+    const int nb_symbols     = 12;                              /* PDSCH data symbols per slot */
+    const int procs_per_ue   = 16;
+    const int nb_procs       = nb_ues * procs_per_ue;
+    const uint8_t rv_seq[4]  = { 0, 2, 3, 1 };
+
+    const uint32_t G = (uint32_t)nb_rb * 12 * nb_symbols * Qm * nb_layers;
+    const uint32_t A = nr_tbs_compute(nb_rb * 12 * nb_symbols, R, Qm, nb_layers);
+
+    printf("Parameters: %d UEs x %d HARQ processes, RBs=%d, Qm=%d, R=%u/1024, layers=%d, TBS=%u, G=%u, SNR=%d dB, iterations=%d\n",
+           nb_ues, procs_per_ue, nb_rb, Qm, R, nb_layers, A, G, snr_db, num_iterations);
+
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    uint8_t *tb  = nr_scratch_alloc(&scratch, ((A / 8) + 63) & ~63u);
+    uint8_t *f   = nr_scratch_alloc(&scratch, ((G / 8) + 64) & ~63u);
+    int16_t *llr = nr_scratch_alloc(&scratch, 4 * (size_t)G * sizeof(int16_t));
+    int16_t *ref = nr_scratch_alloc(&scratch, 66 * 384 * sizeof(int16_t));
+    int16_t *w   = nr_scratch_alloc(&scratch, 66 * 384 * sizeof(int16_t));
+    int8_t *z    = nr_scratch_alloc(&scratch, 68 * 384);
+    int8_t *dec  = nr_scratch_alloc(&scratch, 8448 / 8 + 64);
+    nr_tb_encoder_t *enc = nr_tb_encoder_init(A, 1);
+    nr_rm_ctx_t *rm = nr_rm_init(G);
+    nr_harq_pool_t *ref_pool = nr_harq_pool_init(1, 1 + G / 24, G, 16);
+    if (!enc || !rm || !ref_pool) {
+        printf("nr_harq_compress_test: allocation failed\n");
+        nr_tb_encoder_free(enc);
+        nr_rm_free(rm);
+        nr_harq_pool_free(ref_pool);
+        nr_scratch_end(&scratch);
+        return;
+    }
+    memset(f, 0, ((G / 8) + 64) & ~63u);
+
+    uint32_t rnd_state = 0x5EED0029u ^ (uint32_t)time(NULL);
+    for (uint32_t i = 0; i < A / 8; i++)
+        tb[i] = (uint8_t)xorshift32(&rnd_state);
+    if (nr_tb_encoder_encode(enc, tb, A, R) < 0) {
+        printf("nr_harq_compress_test: TB encoding failed (A=%u)\n", A);
+        nr_tb_encoder_free(enc);
+        nr_rm_free(rm);
+        nr_harq_pool_free(ref_pool);
+        nr_scratch_end(&scratch);
+        return;
+    }
+    const nr_tb_seg_t *seg = &enc->seg;
+
+    /* One noisy LLR vector per RV, scaled like the int16 demapper output (bit 0 -> positive) */
+    const double sigma = 64.0 / pow(10.0, snr_db / 20.0);
+    for (int t = 0; t < 4; t++) {
+        nr_rate_matching_tb(rm, enc, G, Qm, (uint8_t)nb_layers, rv_seq[t], f);
+        for (uint32_t n = 0; n < G; n++) {
+            const int bit = (f[n >> 3] >> (n & 7)) & 1;
+            llr[(size_t)t * G + n] = (int16_t)lrint((bit ? -64.0 : 64.0) + sigma * gaussian_noise(&rnd_state));
+        }
+    }
+
+    /* Full-precision reference after the four transmissions */
+    nr_harq_proc_reset(ref_pool, 0, seg);
+    for (int t = 0; t < 4; t++)
+        nr_rate_recovery_tb(ref_pool, 0, seg, G, Qm, (uint8_t)nb_layers, rv_seq[t], llr + (size_t)t * G);
+
+    t_nrLDPC_dec_params decParams = {
+        .BG = seg->BG,
+        .Z = (uint16_t)seg->Zc,
+        .R = (seg->BG == 1) ? 13 : 15,          /* mother code rate */
+        .numMaxIter = 8,
+        .Kprime = (int)seg->Kprime,
+        .outMode = nrLDPC_outMode_BITINT8,
+        .crc_type = 24,
+        .check_crc = NULL
+    };
+    t_nrLDPC_time_stats timeStats = {0};
+    decode_abort_t abortFlag = {0};
+
+    printf("\n  store        | MB per UE | saving | us/TB  | SQNR dB | sign flips | dec iters | dec us/CB\n");
+
+    /* qbits 16/8: plain pools, 6/5/4: compressed store */
+    const int store_bits[5] = { 16, 8, 6, 5, 4 };
+    for (int s = 0; s < 5; s++) {
+        const int qb = store_bits[s];
+        nr_harq_pool_t *pool = NULL;
+        nr_harq_cstore_t *cst = NULL;
+        size_t mem_size;
+        if (qb >= 8) {
+            pool = nr_harq_pool_init(nb_procs, seg->C, G, qb);
+            mem_size = pool ? pool->mem_size : 0;
+        } else {
+            cst = nr_harq_cstore_init(nb_procs, seg->C, G, qb);
+            mem_size = cst ? cst->mem_size : 0;
+        }
+        if (!pool && !cst) {
+            printf("  %2d bits: store allocation failed\n", qb);
+            continue;
+        }
+
+        uint64_t t0 = now_ns();
+        for (int iter = 0; iter < num_iterations; iter++) {
+            const int pid = iter % nb_procs;
+            const int t = (iter / nb_procs) & 3;
+            if (pool) {
+                if (t == 0) nr_harq_proc_reset(pool, pid, seg);
+                nr_rate_recovery_tb(pool, pid, seg, G, Qm, (uint8_t)nb_layers, rv_seq[t], llr + (size_t)t * G);
+            } else {
+                if (t == 0) nr_harq_cstore_reset(cst, pid, seg);
+                nr_harq_cstore_combine_tb(cst, pid, seg, G, Qm, (uint8_t)nb_layers, rv_seq[t], llr + (size_t)t * G);
+            }
+        }
+        const double us = (now_ns() - t0) / 1e3 / num_iterations;
+
+        /* Process 0 after the full RV cycle against the int16 reference */
+        if (pool) nr_harq_proc_reset(pool, 0, seg);
+        else nr_harq_cstore_reset(cst, 0, seg);
+        for (int t = 0; t < 4; t++) {
+            if (pool) nr_rate_recovery_tb(pool, 0, seg, G, Qm, (uint8_t)nb_layers, rv_seq[t], llr + (size_t)t * G);
+            else nr_harq_cstore_combine_tb(cst, 0, seg, G, Qm, (uint8_t)nb_layers, rv_seq[t], llr + (size_t)t * G);
+        }
+
+        double sig = 0.0, err = 0.0, dec_ns = 0.0;
+        uint32_t flips = 0;
+        int iters = 0;
+        for (uint32_t r = 0; r < seg->C; r++) {
+            memcpy(ref, nr_harq_cb_buffer16(ref_pool, 0, r), seg->Ncb * sizeof(int16_t));
+            if (qb == 16) {
+                memcpy(w, nr_harq_cb_buffer16(pool, 0, r), seg->Ncb * sizeof(int16_t));
+            } else if (qb == 8) {
+                for (uint32_t k = 0; k < seg->Ncb; k++) w[k] = nr_harq_cb_buffer8(pool, 0, r)[k];
+            } else {
+                nr_harq_cstore_read_cb(cst, 0, r, seg, w);
+            }
+            for (uint32_t k = 0; k < seg->Ncb; k++) {
+                sig += (double)ref[k] * ref[k];
+                err += (double)(w[k] - ref[k]) * (w[k] - ref[k]);
+                if ((w[k] < 0) != (ref[k] < 0) && ref[k] != 0) flips++;
+            }
+
+            if (pool) nr_harq_cb_decoder_input(pool, 0, r, seg, z);
+            else nr_harq_cstore_decoder_input(cst, 0, r, seg, z);
+            memset(&abortFlag, 0, sizeof(abortFlag));
+            t0 = now_ns();
+            iters += LDPCdecoder(&decParams, z, dec, &timeStats, &abortFlag);
+            dec_ns += now_ns() - t0;
+        }
+
+        const double mb_per_ue = mem_size / 1048576.0 / nb_ues;
+        const double mb_ref = (double)nb_procs * seg->C * ((66 * 384 * 2 + 63) & ~63) / 1048576.0 / nb_ues;
+        char name[16];
+        snprintf(name, sizeof(name), "%s%d", qb >= 8 ? "int" : "bfp", qb);
+        printf("  %-12s | %9.1f | %5.1fx | %6.1f | %7.1f | %10u | %9.2f | %9.2f\n",
+               name, mb_per_ue, mb_ref / mb_per_ue, us,
+               err > 0.0 ? 10.0 * log10(sig / err) : 99.0, flips,
+               (double)iters / seg->C, dec_ns / 1e3 / seg->C);
+
+        nr_harq_pool_free(pool);
+        nr_harq_cstore_free(cst);
+    }
+
+    nr_scratch_end(&scratch);
+    nr_tb_encoder_free(enc);
+    nr_rm_free(rm);
+    nr_harq_pool_free(ref_pool);
+    printf("=== NR compressed HARQ soft-buffer tests completed ===\n");
+}
+
+void nr_crc_fold_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    /* The OAI table functions are the bit-exactness reference */
+    crcTableInit();
+
+    printf("=== Starting NR CRC folding (PCLMULQDQ) tests ===\n");
+
+    const int num_iterations = getenv_int("OAI_ITERS", 10000);
+    const uint32_t max_bits = N + 24;
+    const size_t buf_bytes = ((max_bits / 8) + 64) & ~(size_t)63;
+
+    printf("Parameters: iterations=%d, carry-less multiply path: %s\n",
+           num_iterations, nr_crc_fold_accelerated() ? "yes" : "no (table fallback)");
+
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    uint8_t *data = nr_scratch_alloc(&scratch, buf_bytes);
+
+    uint32_t rnd_state = 0x5EED0030u ^ (uint32_t)time(NULL);
+    for (size_t i = 0; i < buf_bytes; i++)
+        data[i] = (uint8_t)xorshift32(&rnd_state);
+
+    const struct { nr_crc_type_t type; const char *name; unsigned int (*ref)(unsigned char *, int); } crcs[] = {
+        { NR_CRC_24A, "crc24a", crc24a }, { NR_CRC_24B, "crc24b", crc24b }, { NR_CRC_24C, "crc24c", crc24c },
+        { NR_CRC_16,  "crc16",  crc16 },  { NR_CRC_11,  "crc11",  crc11 },  { NR_CRC_6,   "crc6",   crc6 }
+    };
+    const int nb_crcs = sizeof(crcs) / sizeof(crcs[0]);
+
+    /* Every bit length up to a few blocks, then a sweep up to the largest TB */
+    int mismatches = 0, checked = 0;
+    for (int c = 0; c < nb_crcs; c++) {
+        for (uint32_t len = 1; len <= max_bits; len += (len < 1100 ? 1 : 61)) {
+            checked++;
+            if (nr_crc_fold(crcs[c].type, data, len) != crcs[c].ref(data, len)) {
+                if (mismatches < 8)
+                    printf("  %s mismatch at %u bits: fold 0x%08X ref 0x%08X\n", crcs[c].name, len,
+                           nr_crc_fold(crcs[c].type, data, len), crcs[c].ref(data, len));
+                mismatches++;
+            }
+        }
+    }
+    printf("Bit-exactness vs OAI tables: %d lengths checked, %d mismatches\n", checked, mismatches);
+
+    /* Polar payloads, LDPC code blocks, and TBs */
+    const uint32_t sizes[] = { 64, 140, 1024, 3816, 8424, 25344, N };
+
+    printf("\n  crc     bits | table ns | fold ns | table GB/s | fold GB/s | speedup\n");
+
+    for (int c = 0; c < nb_crcs; c++) {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            const uint32_t len = sizes[s];
+            volatile uint32_t sink = 0;
+
+            uint64_t t0 = now_ns();
+            for (int iter = 0; iter < num_iterations; iter++)
+                sink ^= crcs[c].ref(data, len);
+            const double table_ns = (double)(now_ns() - t0) / num_iterations;
+
+            t0 = now_ns();
+            for (int iter = 0; iter < num_iterations; iter++)
+                sink ^= nr_crc_fold(crcs[c].type, data, len);
+            const double fold_ns = (double)(now_ns() - t0) / num_iterations;
+            (void)sink;
+
+            printf("  %-6s %5u | %8.1f | %7.1f | %10.2f | %9.2f | %6.1fx\n",
+                   crcs[c].name, len, table_ns, fold_ns,
+                   len / 8.0 / table_ns, len / 8.0 / fold_ns, table_ns / fold_ns);
+        }
+    }
+
+    nr_scratch_end(&scratch);
+    printf("=== NR CRC folding tests completed ===\n");
+}
+
+void nr_crc_multi_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    /* The OAI table functions are the bit-exactness reference */
+    crcTableInit();
+
+    printf("=== Starting NR multi-buffer CRC24B (interleaved lanes) tests ===\n");
+
+    const int num_iterations = getenv_int("OAI_ITERS", 2000);
+    const int nb_cbs         = getenv_int("OAI_CBS", 48);   /* code blocks per TB */
+    const size_t stride      = ((NR_LDPC_KCB_BG1 + 24) / 8 + 63) & ~(size_t)63;
+
+    printf("Parameters: code blocks=%d, iterations=%d, carry-less multiply path: %s\n",
+           nb_cbs, num_iterations, nr_crc_fold_accelerated() ? "yes" : "no (table fallback)");
+
+    if (nb_cbs < 1) {
+        printf("nr_crc_multi_test: OAI_CBS must be positive\n");
+        return;
+    }
+
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    uint8_t *mem = nr_scratch_alloc(&scratch, nb_cbs * stride);
+    uint8_t **cbs = nr_scratch_alloc(&scratch, nb_cbs * sizeof(*cbs));
+    uint8_t *ok = nr_scratch_alloc(&scratch, nb_cbs);
+
+    uint32_t rnd_state = 0x5EED0031u ^ (uint32_t)time(NULL);
+    for (size_t i = 0; i < nb_cbs * stride; i++)
+        mem[i] = (uint8_t)xorshift32(&rnd_state);
+    for (int r = 0; r < nb_cbs; r++)
+        cbs[r] = mem + r * stride;
+
+    /* Code block sizes K' - 24: BG1/BG2 maximum and a few smaller ones */
+    const uint32_t payloads[] = { 8424, 3816, 2040, 1000 };
+    const int lanes[] = { 1, 4, 8, 16 };
+
+    printf("\n  payload lanes | attach us/TB | attach Gbit/s | check us/TB | check Gbit/s | speedup | valid\n");
+
+    for (size_t p = 0; p < sizeof(payloads) / sizeof(payloads[0]); p++) {
+        const uint32_t payload = payloads[p];
+        double single_us = 0.0;
+
+        for (size_t li = 0; li < sizeof(lanes) / sizeof(lanes[0]); li++) {
+            const int L = lanes[li];
+
+            /* lanes = 1 is the single-buffer path */
+            uint64_t t0 = now_ns();
+            for (int iter = 0; iter < num_iterations; iter++) {
+                for (int r = 0; r < nb_cbs; r += L) {
+                    const int nb = (nb_cbs - r) < L ? nb_cbs - r : L;
+                    if (L == 1) {
+                        const uint32_t crc = nr_crc_fold(NR_CRC_24B, cbs[r], payload);
+                        nr_bits_put(cbs[r], payload, crc >> 8, 24);
+                    } else {
+                        nr_crc_fold_attach_multi(NR_CRC_24B, cbs + r, nb, payload);
+                    }
+                }
+            }
+            const double attach_us = (now_ns() - t0) / 1e3 / num_iterations;
+
+            int nb_valid = 0;
+            t0 = now_ns();
+            for (int iter = 0; iter < num_iterations; iter++) {
+                nb_valid = 0;
+                for (int r = 0; r < nb_cbs; r += L) {
+                    const int nb = (nb_cbs - r) < L ? nb_cbs - r : L;
+                    if (L == 1)
+                        nb_valid += nr_crc_fold_check(NR_CRC_24B, cbs[r], payload + 24);
+                    else
+                        nb_valid += nr_crc_fold_check_multi(NR_CRC_24B, (const uint8_t *const *)cbs + r, nb, payload + 24, ok);
+                }
+            }
+            const double check_us = (now_ns() - t0) / 1e3 / num_iterations;
+            if (L == 1) single_us = attach_us + check_us;
+
+            /* The OAI table CRC24B of a block with its CRC attached is zero */
+            for (int r = 0; r < nb_cbs; r++)
+                if (crc24b(cbs[r], payload + 24) != 0)
+                    nb_valid = -1;
+
+            const double bits = (double)nb_cbs * payload;
+            printf("  %7u %5d | %12.2f | %13.2f | %11.2f | %12.2f | %6.1fx | %d/%d\n",
+                   payload, L, attach_us, bits / (attach_us * 1e3), check_us, bits / (check_us * 1e3),
+                   single_us / (attach_us + check_us), nb_valid, nb_cbs);
+        }
+
+        /* A flipped payload bit must be caught in its lane only */
+        const int nb = nb_cbs < NR_CRC_MAX_LANES ? nb_cbs : NR_CRC_MAX_LANES;
+        const int bad = nb / 2;
+        cbs[bad][3] ^= 0x10;
+        const int valid = nr_crc_fold_check_multi(NR_CRC_24B, (const uint8_t *const *)cbs, nb, payload + 24, ok);
+        printf("  corrupted code block %d: %d/%d lanes valid, corruption %s\n",
+               bad, valid, nb, ok[bad] ? "NOT detected" : "detected");
+        cbs[bad][3] ^= 0x10;
+    }
+
+    nr_scratch_end(&scratch);
+    printf("=== NR multi-buffer CRC tests completed ===\n");
+}
+
+/* check_crc callback running the folding CRC as a separate pass over the
+ * decoder output, for comparison with the fused mode */
+static int ldpc_crc_separate(uint8_t *decoded_bytes, uint32_t n, uint8_t crc_type)
+{
+    const int type = nr_crc_from_oai(crc_type);
+    return type >= 0 && nr_crc_fold_check((nr_crc_type_t)type, decoded_bytes, n);
+}
+
+void nr_ldpc_dec_crc_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    /* check_crc() of the OAI library uses the CRC tables */
+    crcTableInit();
+
+    printf("=== Starting NR LDPC decoding with CRC termination tests ===\n");
+
+    const uint16_t Z = 384;
+    const int Kprime = 22 * Z;                  /* BG1 code block, CRC24B included */
+    const int num_iterations = getenv_int("OAI_ITERS", 20000);
+    const int snr_db = getenv_int("OAI_SNR", 10);
+
+    printf("Parameters: BG=1, Z=%u, K'=%d bits (CRC24B), SNR=%d dB, iterations=%d\n",
+           Z, Kprime, snr_db, num_iterations);
+
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    int8_t *llr = nr_scratch_alloc(&scratch, 68 * Z);
+    uint8_t *info = nr_scratch_alloc(&scratch, (Kprime / 8 + 64) & ~63);
+    uint8_t *out = nr_scratch_alloc(&scratch, (Kprime / 8 + 64) & ~63);
+    memset(llr, 0, 68 * Z);
+    memset(out, 0, (Kprime / 8 + 64) & ~63);
+
+    /* Random payload with its CRC24B, BPSK over AWGN with the OAI LLR sign
+     * (bit 0 -> positive LLR) */
+    uint32_t rnd_state = 0x5EED0032u ^ (uint32_t)time(NULL);
+    for (int i = 0; i < Kprime / 8; i++)
+        info[i] = (uint8_t)xorshift32(&rnd_state);
+    nr_bits_put(info, Kprime - 24, nr_crc_fold(NR_CRC_24B, info, Kprime - 24) >> 8, 24);
+
+    const double sigma = 1.0 / sqrt(2.0 * pow(10.0, snr_db / 10.0));
+    for (int i = 0; i < Kprime; i++) {
+        const int bit = (info[i >> 3] >> (7 - (i & 7))) & 1;
+        double v = 2.0 * ((bit ? -1.0 : 1.0) + sigma * gaussian_noise(&rnd_state)) / (sigma * sigma);
+        if (v > 127.0) v = 127.0;
+        if (v < -127.0) v = -127.0;
+        llr[i] = (int8_t)v;
+    }
+
+    const struct { const char *name; int (*check)(uint8_t *, uint32_t, uint8_t); } modes[] = {
+        { "OAI check_crc pass", check_crc },
+        { "fold CRC pass",      ldpc_crc_separate },
+        { "fused stream CRC",   nr_crc_fold_check_crc }
+    };
+
+    t_nrLDPC_time_stats timeStats = {0};
+    decode_abort_t abortFlag = {0};
+
+    printf("\n  mode               | corrupt | us/CB  | avg iter | CRC ok | output ok\n");
+
+    for (int corrupt = 0; corrupt < 2; corrupt++) {
+        /* A strong wrong LLR in the payload: parity check passes, CRC does not */
+        const int8_t saved = llr[100];
+        if (corrupt) llr[100] = (int8_t)(llr[100] > 0 ? -100 : 100);
+
+        for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+            t_nrLDPC_dec_params decParams = {
+                .BG = 1,
+                .Z = Z,
+                .R = 13,
+                .numMaxIter = 8,
+                .Kprime = Kprime,
+                .outMode = nrLDPC_outMode_BIT,
+                .crc_type = CRC24_B,
+                .check_crc = modes[m].check
+            };
+
+            long long total_iter = 0;
+            int nb_ok = 0;
+            const uint64_t t0 = now_ns();
+            for (int iter = 0; iter < num_iterations; iter++) {
+                const int32_t numIter = LDPCdecoder(&decParams, llr, (int8_t *)out, &timeStats, &abortFlag);
+                total_iter += numIter;
+                nb_ok += numIter <= decParams.numMaxIter;
+            }
+            const double us = (now_ns() - t0) / 1e3 / num_iterations;
+
+            printf("  %-18s | %7s | %6.2f | %8.2f | %6.1f%% | %s\n", modes[m].name, corrupt ? "yes" : "no",
+                   us, (double)total_iter / num_iterations, 100.0 * nb_ok / num_iterations,
+                   memcmp(out, info, Kprime / 8) ? "differs" : "yes");
+        }
+        llr[100] = saved;
+    }
+
+    nr_scratch_end(&scratch);
+    printf("=== NR LDPC decoding with CRC termination tests completed ===\n");
+}
+
+void nr_gold_cache_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    printf("=== Starting NR Gold sequence cache tests ===\n");
+
+    const int num_slots     = getenv_int("OAI_ITERS", 20000);
+    const int ues_per_slot  = getenv_int("OAI_UES_PER_SLOT", 8);
+    const uint32_t Nid      = 101;                       /* cell id of the data scrambling */
+    const uint32_t max_G    = 273 * 12 * 12 * 8 * 4;     /* 273 RBs, 256-QAM, 4 layers */
+
+    printf("Parameters: slots=%d, UEs scheduled per slot=%d, Nid=%u\n", num_slots, ues_per_slot, Nid);
+
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    uint8_t *in = nr_scratch_alloc(&scratch, max_G);
+    uint32_t *out = nr_scratch_alloc(&scratch, max_G / 8);
+    uint32_t *ref = nr_scratch_alloc(&scratch, max_G / 8);
+
+    uint32_t rnd_state = 0x5EED0033u ^ (uint32_t)time(NULL);
+    for (uint32_t i = 0; i < max_G; i++)
+        in[i] = (uint8_t)(xorshift32(&rnd_state) & 1);
+
+    /* Bit-exactness of both kernels against the OAI functions */
+    {
+        nr_gold_cache_t *cache = nr_gold_cache_init(4, max_G);
+        int16_t *l_ref = nr_scratch_alloc(&scratch, 4096 * sizeof(int16_t));
+        int16_t *l_chk = nr_scratch_alloc(&scratch, 4096 * sizeof(int16_t));
+        int ok = cache != NULL;
+        for (uint32_t len = 1; ok && len <= 4096; len += 37) {
+            const uint32_t rnti = xorshift32(&rnd_state) & 0xFFFF;
+            const uint8_t q = (uint8_t)(len & 1);
+            nr_codeword_scrambling(in, len, q, Nid, rnti, ref);
+            nr_codeword_scrambling_cached(cache, in, len, q, Nid, rnti, out);
+            ok = !memcmp(out, ref, ((len + 31) / 32) * sizeof(uint32_t));
+            for (uint32_t i = 0; i < len; i++) l_ref[i] = l_chk[i] = (int16_t)(xorshift32(&rnd_state) & 0x7FF) - 1024;
+            nr_codeword_unscrambling(l_ref, len, q, Nid, rnti);
+            nr_codeword_unscrambling_cached(cache, l_chk, len, q, Nid, rnti);
+            ok = ok && !memcmp(l_ref, l_chk, len * sizeof(int16_t));
+        }
+        printf("Bit-exactness vs nr_codeword_scrambling/unscrambling: %s\n", ok ? "yes" : "NO");
+        nr_gold_cache_free(cache);
+    }
+
+    /* UE populations: each UE has its C-RNTI, a preferred allocation and a
+     * Zipf-like activity, so a few UEs are scheduled most of the slots */
+    const int populations[] = { 8, 32, 128, 512 };
+    const int cache_sizes[] = { 16, 64, 256 };
+    const int nb_rb_opts[] = { 24, 52, 106, 273 };
+    const uint8_t qm_opts[] = { 2, 4, 6, 8 };
+
+    printf("\n   UEs entries | hit rate | extends | evictions | cached us/CW | OAI us/CW | speedup\n");
+
+    for (size_t p = 0; p < sizeof(populations) / sizeof(populations[0]); p++) {
+        const int nb_ues = populations[p];
+        /* Per population, back to the arena at the end of the iteration */
+        nr_scratch_t ues;
+        nr_scratch_begin(&ues);
+        uint32_t *rnti = nr_scratch_alloc(&ues, nb_ues * sizeof(uint32_t));
+        uint32_t *G = nr_scratch_alloc(&ues, nb_ues * sizeof(uint32_t));
+        double *cdf = nr_scratch_alloc(&ues, nb_ues * sizeof(double));
+        double acc = 0.0;
+        for (int u = 0; u < nb_ues; u++) {
+            rnti[u] = 0x4601 + 17 * u;
+            G[u] = (uint32_t)nb_rb_opts[xorshift32(&rnd_state) % 4] * 12 * 12 * qm_opts[xorshift32(&rnd_state) % 4];
+            acc += 1.0 / (u + 1);
+            cdf[u] = acc;
+        }
+
+        for (size_t cs = 0; cs < sizeof(cache_sizes) / sizeof(cache_sizes[0]); cs++) {
+            nr_gold_cache_t *cache = nr_gold_cache_init(cache_sizes[cs], max_G);
+            if (!cache) continue;
+
+            uint32_t traffic_state = 0x7A11u + (uint32_t)p;
+            uint64_t cached_ns = 0, oai_ns = 0, nb_cw = 0;
+            for (int slot = 0; slot < num_slots; slot++) {
+                for (int k = 0; k < ues_per_slot; k++) {
+                    const double x = acc * (xorshift32(&traffic_state) / 4294967296.0);
+                    int u = 0;
+                    while (u < nb_ues - 1 && cdf[u] < x) u++;
+                    /* Allocations move around a little from slot to slot */
+                    const uint32_t len = G[u] - (xorshift32(&traffic_state) % 4) * 12 * 12 * 2;
+
+                    uint64_t t0 = now_ns();
+                    nr_codeword_scrambling_cached(cache, in, len, 0, Nid, rnti[u], out);
+                    cached_ns += now_ns() - t0;
+                    /* The uncached reference on a subset of the codewords */
+                    if ((slot & 15) == 0) {
+                        t0 = now_ns();
+                        nr_codeword_scrambling(in, len, 0, Nid, rnti[u], ref);
+                        oai_ns += now_ns() - t0;
+                    }
+                    nb_cw++;
+                }
+            }
+            const uint64_t nb_ref = (nb_cw + 15) / 16;
+            const uint64_t lookups = cache->hits + cache->misses;
+            printf("  %4d %7d | %7.2f%% | %7.2f%% | %9llu | %12.2f | %9.2f | %6.1fx\n",
+                   nb_ues, cache_sizes[cs], 100.0 * cache->hits / lookups, 100.0 * cache->extends / lookups,
+                   (unsigned long long)cache->evictions, cached_ns / 1e3 / nb_cw, oai_ns / 1e3 / nb_ref,
+                   (oai_ns / (double)nb_ref) / (cached_ns / (double)nb_cw));
+            nr_gold_cache_free(cache);
+        }
+        nr_scratch_end(&ues);
+    }
+
+    nr_scratch_end(&scratch);
+    printf("=== NR Gold sequence cache tests completed ===\n");
+}
+
+/* c(n) the way OAI generates it for nr_codeword_scrambling(): the loop of
+ * lte_gold_generic(), one register pair stepped 32 bits per word from the
+ * Nc = 1600 warm-up, no leap-ahead and no lanes */
+static void gold_oai_serial(uint32_t c_init, uint32_t *c, uint32_t nwords)
+{
+    uint32_t x1 = 1 + (1U << 31);
+    uint32_t x2 = c_init ^ ((c_init ^ (c_init >> 1) ^ (c_init >> 2) ^ (c_init >> 3)) << 31);
+    for (uint32_t n = 1; n < 50 + nwords; n++) {
+        x1 = (x1 >> 1) ^ (x1 >> 4);
+        x1 = x1 ^ (x1 << 31) ^ (x1 << 28);
+        x2 = (x2 >> 1) ^ (x2 >> 2) ^ (x2 >> 3) ^ (x2 >> 4);
+        x2 = x2 ^ (x2 << 31) ^ (x2 << 30) ^ (x2 << 29) ^ (x2 << 28);
+        if (n >= 50) c[n - 50] = x1 ^ x2;
+    }
+}
+
+void nr_gold_leap_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    printf("=== Starting NR Gold leap-ahead generator tests ===\n");
+
+    const int num_iterations = getenv_int("OAI_ITERS", 200);
+    const int nb_threads     = getenv_int("OAI_THREADS", 4);
+    const int nb_layers      = getenv_int("OAI_LAYERS", 4);
+    const uint32_t Nid       = 101;
+    const uint32_t rnti      = 0x4601;
+    /* 273 RBs, 12 data symbols, 256-QAM */
+    const uint32_t G         = 273 * 12 * 12 * 8 * (uint32_t)nb_layers;
+    const uint32_t nwords    = (G + 31) / 32;
+
+    printf("Parameters: iterations=%d, threads=%d, layers=%d, G=%u bits\n", num_iterations, nb_threads, nb_layers, G);
+
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    uint8_t *in = nr_scratch_alloc(&scratch, (G + 63) & ~63u);
+    uint32_t *c = nr_scratch_alloc(&scratch, nwords * sizeof(uint32_t) + 64);
+    uint32_t *ref = nr_scratch_alloc(&scratch, nwords * sizeof(uint32_t) + 64);
+    uint32_t *out = nr_scratch_alloc(&scratch, nwords * sizeof(uint32_t) + 64);
+    worker_pool_t *pool = worker_pool_init(nb_threads);
+    if (!pool) {
+        printf("nr_gold_leap_test: allocation failed\n");
+        worker_pool_free(pool);
+        nr_scratch_end(&scratch);
+        return;
+    }
+
+    uint32_t rnd_state = 0x5EED0034u ^ (uint32_t)time(NULL);
+    for (uint32_t i = 0; i < G; i++)
+        in[i] = (uint8_t)(xorshift32(&rnd_state) & 1);
+
+    /* The whole sequence and leaps to random offsets against the OAI serial
+     * generator, then the threaded scrambling against OAI */
+    {
+        const uint32_t c_init = nr_gold_pdsch_cinit(rnti, 0, Nid);
+        gold_oai_serial(c_init, ref, nwords);
+        nr_gold_generate(c_init, c, nwords);
+        int ok = !memcmp(c, ref, nwords * sizeof(uint32_t));
+        for (int t = 0; ok && t < 64; t++) {
+            const uint32_t off = xorshift32(&rnd_state) % nwords;
+            const uint32_t n = 1 + xorshift32(&rnd_state) % (nwords - off);
+            nr_gold_generate_at(c_init, off, c, n);
+            ok = !memcmp(c, ref + off, n * sizeof(uint32_t));
+        }
+        printf("Lanes and leap-ahead vs OAI serial generation: %s\n", ok ? "yes" : "NO");
+
+        ok = 1;
+        for (uint32_t len = 1; ok && len <= G; len = len * 3 + 29) {
+            const uint8_t q = (uint8_t)(len & 1);
+            nr_codeword_scrambling(in, len, q, Nid, rnti, ref);
+            nr_codeword_scrambling_mt(pool, in, len, q, Nid, rnti, out);
+            ok = !memcmp(out, ref, ((len + 31) / 32) * sizeof(uint32_t));
+        }
+        printf("Bit-exactness vs nr_codeword_scrambling: %s\n", ok ? "yes" : "NO");
+    }
+
+    /* Generation of the whole sequence: the OAI register pair, eight SIMD
+     * lanes, then the lanes of every thread */
+    uint64_t serial_ns = 0, lanes_ns = 0, mt_ns = 0;
+    for (int it = 0; it < num_iterations; it++) {
+        const uint32_t c_init = nr_gold_pdsch_cinit(rnti + it, 0, Nid);
+        uint64_t t0 = now_ns();
+        gold_oai_serial(c_init, c, nwords);
+        serial_ns += now_ns() - t0;
+        t0 = now_ns();
+        nr_gold_generate(c_init, c, nwords);
+        lanes_ns += now_ns() - t0;
+        t0 = now_ns();
+        nr_gold_generate_mt(pool, c_init, c, nwords);
+        mt_ns += now_ns() - t0;
+    }
+
+    /* Scrambling of the codeword */
+    uint64_t oai_ns = 0, scr_mt_ns = 0;
+    for (int it = 0; it < num_iterations; it++) {
+        uint64_t t0 = now_ns();
+        nr_codeword_scrambling(in, G, 0, Nid, rnti + it, ref);
+        oai_ns += now_ns() - t0;
+        t0 = now_ns();
+        nr_codeword_scrambling_mt(pool, in, G, 0, Nid, rnti + it, out);
+        scr_mt_ns += now_ns() - t0;
+    }
+
+    const double gbits = (double)G * num_iterations;
+    printf("\n  Stage                         | us/CW   | Gbit/s\n");
+    printf("  Gold serial (OAI)             | %7.2f | %6.2f\n", serial_ns / 1e3 / num_iterations, gbits / serial_ns);
+    printf("  Gold 8 SIMD lanes             | %7.2f | %6.2f\n", lanes_ns / 1e3 / num_iterations, gbits / lanes_ns);
+    printf("  Gold %2d threads x 8 lanes     | %7.2f | %6.2f\n", worker_pool_size(pool), mt_ns / 1e3 / num_iterations, gbits / mt_ns);
+    printf("  Scrambling OAI                | %7.2f | %6.2f\n", oai_ns / 1e3 / num_iterations, gbits / oai_ns);
+    printf("  Scrambling %2d threads         | %7.2f | %6.2f  (%.1fx)\n", worker_pool_size(pool),
+           scr_mt_ns / 1e3 / num_iterations, gbits / scr_mt_ns, (double)oai_ns / scr_mt_ns);
+
+    worker_pool_free(pool);
+    nr_scratch_end(&scratch);
+    printf("=== NR Gold leap-ahead generator tests completed ===\n");
+}
+
+void nr_scramble_mod_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    printf("=== Starting NR fused scrambling + modulation tests ===\n");
+
+    const int num_iterations = getenv_int("OAI_ITERS", 2000);
+    const int nb_rb          = getenv_int("OAI_RB", 273);
+    const int nb_layers      = getenv_int("OAI_LAYERS", 1);
+    const uint32_t Nid       = 101;
+    const uint32_t rnti      = 0x4601;
+    const uint32_t max_G     = (uint32_t)nb_rb * 12 * 12 * 8 * nb_layers;
+    /* One spare word for the reads of nr_modulation() past the last symbol */
+    const uint32_t max_words = (max_G + 31) / 32 + 1;
+
+    printf("Parameters: iterations=%d, RBs=%d, layers=%d\n", num_iterations, nb_rb, nb_layers);
+
+    /* The OAI chain scrambles one bit per byte, the fused kernel reads the
+     * same codeword packed LSB-first */
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    uint8_t *bits = nr_scratch_alloc(&scratch, max_G);
+    uint32_t *f = nr_scratch_alloc(&scratch, max_words * sizeof(uint32_t));
+    uint32_t *scr = nr_scratch_alloc(&scratch, max_words * sizeof(uint32_t));
+    int16_t *sym_ref = nr_scratch_alloc(&scratch, (max_G / 2) * 2 * sizeof(int16_t));
+    int16_t *sym = nr_scratch_alloc(&scratch, (max_G / 2) * 2 * sizeof(int16_t));
+    int16_t *table = nr_scratch_alloc(&scratch, 256 * 2 * sizeof(int16_t));
+    uint32_t *points = nr_scratch_alloc(&scratch, (8 * 256 / 32 + 1) * sizeof(uint32_t));
+    nr_gold_cache_t *gold = nr_gold_cache_init(4, max_G);
+    if (!gold) {
+        printf("nr_scramble_mod_test: allocation failed\n");
+        nr_gold_cache_free(gold);
+        nr_scratch_end(&scratch);
+        return;
+    }
+    memset(scr, 0, max_words * sizeof(uint32_t));
+
+    uint32_t rnd_state = 0x5EED0035u ^ (uint32_t)time(NULL);
+    for (uint32_t i = 0; i < max_words; i++)
+        f[i] = xorshift32(&rnd_state);
+    for (uint32_t i = 0; i < max_G; i++)
+        bits[i] = (f[i >> 5] >> (i & 31)) & 1;
+
+    const uint8_t qm_list[] = { 2, 4, 6, 8 };
+
+    printf("\n  Qm |       G | exact | OAI scr+mod us | fused us | speedup\n");
+    for (size_t m = 0; m < sizeof(qm_list) / sizeof(qm_list[0]); m++) {
+        const uint8_t Qm = qm_list[m];
+        const uint32_t G = (uint32_t)nb_rb * 12 * 12 * Qm * nb_layers;
+
+        /* Constellation of nr_modulation(): the symbols 0 .. 2^Qm - 1 in a row */
+        memset(points, 0, (8 * 256 / 32 + 1) * sizeof(uint32_t));
+        for (uint32_t idx = 0; idx < (1u << Qm); idx++)
+            for (int b = 0; b < Qm; b++)
+                points[(idx * Qm + b) >> 5] |= ((idx >> b) & 1) << ((idx * Qm + b) & 31);
+        nr_modulation(points, (uint32_t)Qm << Qm, Qm, table);
+
+        /* Bit-exactness against the OAI stages over lengths cutting the last word */
+        int ok = 1;
+        for (uint32_t len = Qm; ok && len <= G; len = (len * 5 + 3) / Qm * Qm) {
+            const uint32_t *c = nr_gold_cache_get(gold, nr_gold_pdsch_cinit(rnti, 0, Nid), len);
+            nr_codeword_scrambling(bits, len, 0, Nid, rnti, scr);
+            nr_modulation(scr, len, Qm, sym_ref);
+            ok = nr_scramble_modulate(f, len, c, Qm, table, sym) == (int)(len / Qm)
+                 && !memcmp(sym, sym_ref, (len / Qm) * 2 * sizeof(int16_t));
+        }
+
+        uint64_t sep_ns = 0, fused_ns = 0;
+        for (int it = 0; it < num_iterations; it++) {
+            const uint32_t n_RNTI = rnti + (it & 3);
+            uint64_t t0 = now_ns();
+            nr_codeword_scrambling(bits, G, 0, Nid, n_RNTI, scr);
+            nr_modulation(scr, G, Qm, sym_ref);
+            sep_ns += now_ns() - t0;
+
+            t0 = now_ns();
+            nr_scramble_modulate_cached(gold, f, G, 0, Nid, n_RNTI, Qm, table, sym);
+            fused_ns += now_ns() - t0;
+        }
+        ok = ok && !memcmp(sym, sym_ref, (G / Qm) * 2 * sizeof(int16_t));
+
+        printf("  %2u | %7u | %5s | %14.2f | %8.2f | %6.2fx\n", Qm, G, ok ? "yes" : "NO",
+               sep_ns / 1e3 / num_iterations, fused_ns / 1e3 / num_iterations, (double)sep_ns / fused_ns);
+    }
+
+    nr_scratch_end(&scratch);
+    nr_gold_cache_free(gold);
+    printf("=== NR fused scrambling + modulation tests completed ===\n");
+}
+
+void nr_llr_fused_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    printf("=== Starting NR fused layer demapping + descrambling + int8 tests ===\n");
+
+    const int num_iterations = getenv_int("OAI_ITERS", 2000);
+    const uint32_t Nid       = 101;
+    const uint32_t rnti      = 0x4601;
+    const uint32_t lengths[] = { 13728, 82368 };
+    const uint32_t max_len   = 82368;
+
+    printf("Parameters: iterations=%d\n", num_iterations);
+
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    int16_t *llr_layers = nr_scratch_alloc(&scratch, (size_t)max_len * sizeof(int16_t));
+    int16_t *llr_cw[2];
+    llr_cw[0] = nr_scratch_alloc(&scratch, (size_t)max_len * sizeof(int16_t));
+    llr_cw[1] = nr_scratch_alloc(&scratch, (size_t)max_len * sizeof(int16_t));
+    int8_t *ref = nr_scratch_alloc(&scratch, max_len);
+    int8_t *out = nr_scratch_alloc(&scratch, max_len);
+    nr_gold_cache_t *gold = nr_gold_cache_init(4, max_len);
+    if (!gold) {
+        printf("nr_llr_fused_test: allocation failed\n");
+        nr_scratch_end(&scratch);
+        return;
+    }
+
+    /* LLRs spread past the int8 range so the saturation matters */
+    uint32_t rnd_state = 0x5EED0036u ^ (uint32_t)time(NULL);
+    for (uint32_t i = 0; i < max_len; i++)
+        llr_layers[i] = (int16_t)((int32_t)(xorshift32(&rnd_state) & 0x3FF) - 512);
+
+    printf("\n  length Nl Qm | exact | 3 passes us | fused us | speedup\n");
+    for (size_t li = 0; li < sizeof(lengths) / sizeof(lengths[0]); li++) {
+        for (uint8_t Nl = 1; Nl <= 4; Nl++) {
+            for (uint8_t Qm = 2; Qm <= 8; Qm += 2) {
+                const uint32_t length = lengths[li] / (Nl * Qm) * (Nl * Qm);
+                const uint32_t layer_sz = length / Nl;
+                const int16_t (*layers)[layer_sz] = (const int16_t (*)[layer_sz])llr_layers;
+
+                uint64_t sep_ns = 0, fused_ns = 0;
+                for (int it = 0; it < num_iterations; it++) {
+                    uint64_t t0 = now_ns();
+                    nr_dlsch_layer_demapping(llr_cw, Nl, Qm, length, 0, -1, layer_sz, (int16_t (*)[layer_sz])layers);
+                    nr_codeword_unscrambling_cached(gold, llr_cw[0], length, 0, Nid, rnti);
+                    nr_llr16_to_int8(llr_cw[0], length, ref);
+                    sep_ns += now_ns() - t0;
+
+                    t0 = now_ns();
+                    nr_layer_demap_unscramble8_cached(gold, llr_layers, layer_sz, Nl, Qm, length, 0, Nid, rnti, out);
+                    fused_ns += now_ns() - t0;
+                }
+                const int ok = !memcmp(ref, out, length);
+                printf("  %6u %2u %2u | %5s | %11.2f | %8.2f | %6.2fx\n", length, Nl, Qm, ok ? "yes" : "NO",
+                       sep_ns / 1e3 / num_iterations, fused_ns / 1e3 / num_iterations, (double)sep_ns / fused_ns);
+            }
+        }
+    }
+
+    nr_scratch_end(&scratch);
+    nr_gold_cache_free(gold);
+    printf("=== NR fused layer demapping + descrambling + int8 tests completed ===\n");
+}
+
+/* The former scalar loop of nr_dlsch_layer_demapping() */
+static void layer_demap_scalar(const int16_t *llr_layers, uint32_t layer_sz, uint8_t Nl, uint8_t Qm,
+                               uint32_t length, int16_t *cw)
+{
+    for (uint32_t i = 0; i < length / Nl / Qm; i++)
+        for (uint8_t l = 0; l < Nl; l++)
+            for (uint8_t m = 0; m < Qm; m++)
+                cw[Nl * Qm * i + l * Qm + m] = llr_layers[l * layer_sz + i * Qm + m];
+}
+
+void nr_layer_demap_simd_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    printf("=== Starting NR SIMD layer demapping tests ===\n");
+
+    const int num_iterations = getenv_int("OAI_ITERS", 5000);
+    const uint32_t max_len   = (uint32_t)getenv_int("OAI_LEN", 82368);
+
+    printf("Parameters: iterations=%d, codeword LLRs=%u\n", num_iterations, max_len);
+
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    int16_t *llr_layers = nr_scratch_alloc(&scratch, ((size_t)max_len * sizeof(int16_t) + 63) & ~(size_t)63);
+    int16_t *ref = nr_scratch_alloc(&scratch, ((size_t)max_len * sizeof(int16_t) + 63) & ~(size_t)63);
+    int16_t *cw = nr_scratch_alloc(&scratch, ((size_t)max_len * sizeof(int16_t) + 63) & ~(size_t)63);
+
+    uint32_t rnd_state = 0x5EED0037u ^ (uint32_t)time(NULL);
+    for (uint32_t i = 0; i < max_len; i++)
+        llr_layers[i] = (int16_t)xorshift32(&rnd_state);
+
+    printf("\n  Nl Qm | length | exact | scalar us | SIMD us | speedup\n");
+    for (uint8_t Nl = 1; Nl <= 4; Nl++) {
+        for (uint8_t Qm = 2; Qm <= 8; Qm += 2) {
+            const uint32_t length = max_len / (Nl * Qm) * (Nl * Qm);
+            const uint32_t layer_sz = length / Nl;
+            const nr_layer_demap_fn demap = nr_layer_demap_get(Nl, Qm);
+
+            memset(cw, 0, length * sizeof(int16_t));
+            layer_demap_scalar(llr_layers, layer_sz, Nl, Qm, length, ref);
+            demap(llr_layers, layer_sz, length / (Nl * Qm), cw);
+            const int ok = !memcmp(ref, cw, length * sizeof(int16_t));
+
+            uint64_t t0 = now_ns();
+            for (int it = 0; it < num_iterations; it++)
+                layer_demap_scalar(llr_layers, layer_sz, Nl, Qm, length, ref);
+            const uint64_t scalar_ns = now_ns() - t0;
+            t0 = now_ns();
+            for (int it = 0; it < num_iterations; it++)
+                demap(llr_layers, layer_sz, length / (Nl * Qm), cw);
+            const uint64_t simd_ns = now_ns() - t0;
+
+            printf("  %2u %2u | %6u | %5s | %9.2f | %7.2f | %6.2fx\n", Nl, Qm, length, ok ? "yes" : "NO",
+                   scalar_ns / 1e3 / num_iterations, simd_ns / 1e3 / num_iterations, (double)scalar_ns / simd_ns);
+        }
+    }
+
+    nr_scratch_end(&scratch);
+    printf("=== NR SIMD layer demapping tests completed ===\n");
+}
+
+/* nr_layer_map() of n symbols per layer against 38.211 7.3.1.3 written out */
+static int layer_map_exact(const c16_t *const cw_symbs[2], uint8_t Nl, uint32_t n, c16_t *tx_layers)
+{
+    int nl_cw[2];
+    nr_layer_cw_split(Nl, nl_cw);
+    if (nr_layer_map(cw_symbs, Nl, n, tx_layers) < 0) return 0;
+    for (int q = 0, base = 0; q < 2; base += nl_cw[q], q++)
+        for (uint32_t i = 0; i < n; i++)
+            for (int l = 0; l < nl_cw[q]; l++) {
+                const c16_t a = tx_layers[(size_t)(base + l) * n + i];
+                const c16_t b = cw_symbs[q][(size_t)nl_cw[q] * i + l];
+                if (a.r != b.r || a.i != b.i) return 0;
+            }
+    return 1;
+}
+
+void nr_layermapping_mimo_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    printf("=== Starting NR 1-8 layer mapping / demapping tests ===\n");
+
+    const int num_iterations = getenv_int("OAI_ITERS", 2000);
+    const int nb_rb          = getenv_int("OAI_RB", 273);
+    const uint8_t Qm         = (uint8_t)getenv_int("OAI_QM", 6);
+    /* REs of one layer in the slot: 12 data symbols of nb_rb RBs */
+    const uint32_t layer_sz  = (uint32_t)nb_rb * 12 * 12;
+    const size_t sym_bytes   = (size_t)NR_MAX_LAYERS * layer_sz * sizeof(c16_t);
+    const size_t llr_bytes   = (size_t)NR_MAX_LAYERS * layer_sz * Qm * sizeof(int16_t);
+
+    printf("Parameters: iterations=%d, RBs=%d, Qm=%u, REs per layer=%u\n", num_iterations, nb_rb, Qm, layer_sz);
+
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    c16_t *mod_symbs = nr_scratch_alloc(&scratch, sym_bytes);
+    c16_t *tx_layers = nr_scratch_alloc(&scratch, sym_bytes);
+    int16_t *llr_layers = nr_scratch_alloc(&scratch, llr_bytes);
+    int16_t *llr_cw[2];
+    llr_cw[0] = nr_scratch_alloc(&scratch, llr_bytes);
+    llr_cw[1] = nr_scratch_alloc(&scratch, llr_bytes);
+
+    uint32_t rnd_state = 0x5EED0038u ^ (uint32_t)time(NULL);
+    for (size_t i = 0; i < (size_t)NR_MAX_LAYERS * layer_sz; i++) {
+        mod_symbs[i].r = (int16_t)xorshift32(&rnd_state);
+        mod_symbs[i].i = (int16_t)xorshift32(&rnd_state);
+    }
+    for (size_t i = 0; i < (size_t)NR_MAX_LAYERS * layer_sz * Qm; i++)
+        llr_layers[i] = (int16_t)xorshift32(&rnd_state);
+
+    printf("\n  Nl  CW0+CW1 | exact | map us | map Msym/s | demap us | demap MLLR/s\n");
+    for (uint8_t Nl = 1; Nl <= NR_MAX_LAYERS; Nl++) {
+        int nl_cw[2];
+        nr_layer_cw_split(Nl, nl_cw);
+        const c16_t *cw_symbs[2] = { mod_symbs, mod_symbs + (size_t)nl_cw[0] * layer_sz };
+        const uint32_t length = Nl * layer_sz * Qm;
+
+        /* Both directions against 38.211 7.3.1.3 written out. layer_sz is a
+         * multiple of 4, the shorter layers also reach the scalar tail of
+         * the mapping. */
+        const uint32_t map_sizes[] = { layer_sz, layer_sz - 1, layer_sz - 2, layer_sz - 3, 7, 3, 1 };
+        int ok = 1;
+        for (size_t s = 0; s < sizeof(map_sizes) / sizeof(map_sizes[0]); s++)
+            ok = ok && layer_map_exact(cw_symbs, Nl, map_sizes[s], tx_layers);
+        nr_dlsch_layer_demapping(llr_cw, Nl, Qm, length, 0, Nl > 4 ? 1 : -1, layer_sz * Qm,
+                                 (int16_t (*)[layer_sz * Qm])llr_layers);
+        for (int q = 0, base = 0; ok && q < 2; base += nl_cw[q], q++) {
+            for (uint32_t i = 0; ok && i < layer_sz; i++)
+                for (int l = 0; l < nl_cw[q]; l++) {
+                    for (int m = 0; m < Qm; m++)
+                        ok = ok && llr_cw[q][((size_t)nl_cw[q] * i + l) * Qm + m]
+                                   == llr_layers[(size_t)(base + l) * layer_sz * Qm + (size_t)i * Qm + m];
+                }
+        }
+
+        uint64_t t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            nr_layer_map(cw_symbs, Nl, layer_sz, tx_layers);
+        const uint64_t map_ns = now_ns() - t0;
+        t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            nr_dlsch_layer_demapping(llr_cw, Nl, Qm, length, 0, Nl > 4 ? 1 : -1, layer_sz * Qm,
+                                     (int16_t (*)[layer_sz * Qm])llr_layers);
+        const uint64_t demap_ns = now_ns() - t0;
+
+        printf("  %2u  %3d+%-3d | %5s | %6.2f | %10.1f | %8.2f | %12.1f\n", Nl, nl_cw[0], nl_cw[1], ok ? "yes" : "NO",
+               map_ns / 1e3 / num_iterations, (double)Nl * layer_sz * num_iterations / (map_ns / 1e3),
+               demap_ns / 1e3 / num_iterations, (double)length * num_iterations / (demap_ns / 1e3));
+    }
+
+    nr_scratch_end(&scratch);
+    printf("=== NR 1-8 layer mapping / demapping tests completed ===\n");
+}
+
+/* Max-log LLRs written out: y, then t_k = sat16(mag_k - |t_(k-1)|) per level,
+ * 1024-QAM taking magr >> 1 as fourth threshold */
+static void llr_scalar(uint8_t Qm, const int32_t *rxF, const c16_t *const mags[3], int16_t *llr, uint32_t nb_re)
+{
+    for (uint32_t re = 0; re < nb_re; re++) {
+        int t[2] = { ((const c16_t *)rxF)[re].r, ((const c16_t *)rxF)[re].i };
+        for (int k = 0; k < Qm / 2; k++) {
+            if (k > 0) {
+                const c16_t m = mags[k < 4 ? k - 1 : 2][re];
+                const int mk[2] = { k < 4 ? m.r : m.r >> 1, k < 4 ? m.i : m.i >> 1 };
+                for (int c = 0; c < 2; c++) {
+                    const int a = t[c] == INT16_MIN ? INT16_MIN : abs(t[c]);
+                    const int d = mk[c] - a;
+                    t[c] = d > INT16_MAX ? INT16_MAX : d < INT16_MIN ? INT16_MIN : d;
+                }
+            }
+            llr[re * Qm + 2 * k] = (int16_t)t[0];
+            llr[re * Qm + 2 * k + 1] = (int16_t)t[1];
+        }
+    }
+}
+
+/* LLRs of nb_re REs from the OAI routine of Qm (2 .. 8) */
+static void llr_oai(uint8_t Qm, int32_t *rxF, c16_t *const mags[3], int16_t *llr, uint32_t nb_re)
+{
+    switch (Qm) {
+        case 2: nr_qpsk_llr(rxF, llr, nb_re); break;
+        case 4: nr_16qam_llr(rxF, mags[0], llr, nb_re); break;
+        case 6: nr_64qam_llr(rxF, mags[0], mags[1], llr, nb_re); break;
+        case 8: nr_256qam_llr(rxF, mags[0], mags[1], mags[2], llr, nb_re); break;
+    }
+}
+
+void nr_llr_simd_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    printf("=== Starting NR max-log LLR (QPSK .. 1024-QAM) tests ===\n");
+
+    const int num_iterations = getenv_int("OAI_ITERS", 5000);
+    /* One symbol of 273 RBs by default, plus an odd tail */
+    const uint32_t nb_re     = (uint32_t)getenv_int("OAI_LEN", 273 * 12 + 7);
+    const int avx512         = nr_llr_avx512();
+
+    printf("Parameters: iterations=%d, REs=%u, AVX-512BW=%s\n", num_iterations, nb_re, avx512 ? "yes" : "no");
+
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    int32_t *rxF = nr_scratch_alloc(&scratch, ((size_t)nb_re * sizeof(int32_t) + 63) & ~(size_t)63);
+    c16_t *mag = nr_scratch_alloc(&scratch, ((size_t)3 * nb_re * sizeof(c16_t) + 63) & ~(size_t)63);
+    int16_t *ref = nr_scratch_alloc(&scratch, ((size_t)nb_re * 10 * sizeof(int16_t) + 63) & ~(size_t)63);
+    int16_t *llr = nr_scratch_alloc(&scratch, ((size_t)nb_re * 10 * sizeof(int16_t) + 63) & ~(size_t)63);
+    int16_t *oai = nr_scratch_alloc(&scratch, ((size_t)nb_re * 10 * sizeof(int16_t) + 63) & ~(size_t)63);
+
+    uint32_t rnd_state = 0x5EED0039u ^ (uint32_t)time(NULL);
+    for (uint32_t i = 0; i < nb_re; i++) {
+        /* Off -32768, whose |.| the scalar tails of OAI take as 32768 and
+         * pabsw as -32768 */
+        int16_t y[2];
+        for (int c = 0; c < 2; c++) {
+            y[c] = (int16_t)xorshift32(&rnd_state);
+            if (y[c] == INT16_MIN) y[c] = INT16_MIN + 1;
+        }
+        memcpy(&rxF[i], y, sizeof(y));
+    }
+    /* Halving thresholds as the equalizer gives them, around one amplitude */
+    for (uint32_t i = 0; i < nb_re; i++) {
+        const int16_t h = (int16_t)(8192 + (xorshift32(&rnd_state) & 0x3fff));
+        for (int k = 0; k < 3; k++) {
+            mag[k * nb_re + i].r = h >> k;
+            mag[k * nb_re + i].i = h >> k;
+        }
+    }
+    const c16_t *const mags[3] = { mag, mag + nb_re, mag + 2 * nb_re };
+    c16_t *const oai_mags[3] = { mag, mag + nb_re, mag + 2 * nb_re };
+    /* OAI comparison: the whole symbol and short odd lengths, which only
+     * run the tails of both */
+    const uint32_t lengths[] = { nb_re, 1, 3, 5, 7, 9, 15, 17, 31, 33 };
+    const int nb_lengths = sizeof(lengths) / sizeof(lengths[0]);
+
+    printf("\n  Qm | exact | OAI exact | scalar MLLR/s | SSE MLLR/s | AVX-512 MLLR/s\n");
+    for (uint8_t Qm = 2; Qm <= NR_QAM1024_MOD_ORDER; Qm += 2) {
+        const nr_llr_fn kernels[2] = { nr_llr_get_sse(Qm), avx512 ? nr_llr_get(Qm) : NULL };
+        const double nb_llr = (double)nb_re * Qm * num_iterations;
+        double rate[3] = { 0, 0, 0 };
+        int ok = 1;
+
+        llr_scalar(Qm, rxF, mags, ref, nb_re);
+        for (int k = 0; k < 2; k++) {
+            if (!kernels[k]) continue;
+            memset(llr, 0, (size_t)nb_re * Qm * sizeof(int16_t));
+            kernels[k](rxF, (const int32_t *)mags[0], (const int32_t *)mags[1], (const int32_t *)mags[2], llr, nb_re);
+            ok = ok && !memcmp(ref, llr, (size_t)nb_re * Qm * sizeof(int16_t));
+        }
+
+        /* Bit-exact against the OAI routine the kernel replaces, 1024-QAM
+         * has none */
+        int oai_ok = 1;
+        for (int n = 0; n < nb_lengths && Qm < NR_QAM1024_MOD_ORDER; n++) {
+            const uint32_t len = lengths[n] < nb_re ? lengths[n] : nb_re;
+            llr_oai(Qm, rxF, oai_mags, oai, len);
+            for (int k = 0; k < 2; k++) {
+                if (!kernels[k]) continue;
+                kernels[k](rxF, (const int32_t *)mags[0], (const int32_t *)mags[1], (const int32_t *)mags[2], llr, len);
+                oai_ok = oai_ok && !memcmp(oai, llr, (size_t)len * Qm * sizeof(int16_t));
+            }
+        }
+
+        uint64_t t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            llr_scalar(Qm, rxF, mags, ref, nb_re);
+        rate[0] = nb_llr / ((now_ns() - t0) / 1e3);
+        for (int k = 0; k < 2; k++) {
+            if (!kernels[k]) continue;
+            t0 = now_ns();
+            for (int it = 0; it < num_iterations; it++)
+                kernels[k](rxF, (const int32_t *)mags[0], (const int32_t *)mags[1], (const int32_t *)mags[2], llr, nb_re);
+            rate[k + 1] = nb_llr / ((now_ns() - t0) / 1e3);
+        }
+
+        printf("  %2u | %5s | %9s | %13.1f | %10.1f | %14.1f\n", Qm, ok ? "yes" : "NO",
+               Qm == NR_QAM1024_MOD_ORDER ? "-" : oai_ok ? "yes" : "NO", rate[0], rate[1], rate[2]);
+    }
+
+    nr_scratch_end(&scratch);
+    printf("=== NR max-log LLR tests completed ===\n");
+}
+
+void nr_mmse_llr_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    printf("=== Starting NR fused MMSE equalization + LLR tests ===\n");
+
+    const int num_iterations      = getenv_int("OAI_ITERS", 2000);
+    const int nb_rb               = getenv_int("OAI_RB", 273);
+    const unsigned char mod_order = (unsigned char)getenv_int("OAI_MOD_ORDER", 8);
+    const int snr_db              = getenv_int("OAI_SNR", 20);
+    const unsigned char n_rx      = 4;
+    const unsigned char nl        = 4;
+    const uint32_t rx_size_symbol = 4096;
+    const int length              = nb_rb * 12;
+    const unsigned char symbol    = 5;
+    const uint32_t sz             = (uint32_t)length * 10;
+    const uint32_t noise_var      = (uint32_t)((1u << 15) / pow(10.0, snr_db / 10.0));
+
+    printf("Parameters: iterations=%d, RBs=%d, mod_order=%u, nl=%u, n_rx=%u, tile=%d RBs\n",
+           num_iterations, nb_rb, mod_order, nl, n_rx, NR_MMSE_TILE_RB);
+    if (length > (int)rx_size_symbol || !nr_llr_get(mod_order)) {
+        printf("nr_mmse_llr_test: unsupported RBs / modulation order\n");
+        return;
+    }
+
+    const size_t comp_words = (size_t)nl * n_rx * rx_size_symbol * NR_SYMBOLS_PER_SLOT;
+    const size_t mag_words  = (size_t)nl * n_rx * rx_size_symbol;
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    int32_t (*rxdataF_comp)[n_rx][rx_size_symbol * NR_SYMBOLS_PER_SLOT] = nr_scratch_alloc(&scratch, comp_words * sizeof(int32_t));
+    int32_t (*rxdataF_orig)[n_rx][rx_size_symbol * NR_SYMBOLS_PER_SLOT] = nr_scratch_alloc(&scratch, comp_words * sizeof(int32_t));
+    int32_t (*dl_ch_estimates_ext)[rx_size_symbol] = nr_scratch_alloc(&scratch, mag_words * sizeof(int32_t));
+    c16_t (*dl_ch_mag)[n_rx][rx_size_symbol] = nr_scratch_alloc(&scratch, mag_words * sizeof(c16_t));
+    c16_t (*dl_ch_magb)[n_rx][rx_size_symbol] = nr_scratch_alloc(&scratch, mag_words * sizeof(c16_t));
+    c16_t (*dl_ch_magr)[n_rx][rx_size_symbol] = nr_scratch_alloc(&scratch, mag_words * sizeof(c16_t));
+    int16_t (*llr_ref)[sz] = nr_scratch_alloc(&scratch, (size_t)nl * sz * sizeof(int16_t));
+    int16_t (*llr_fused)[sz] = nr_scratch_alloc(&scratch, (size_t)nl * sz * sizeof(int16_t));
+
+    /* Channel taps small enough for the diagonal inverse of four layers to
+     * leave a non-zero Q14 gain, so that the equalized symbols are not all 0 */
+    uint32_t rnd_state = 0x5EED0040u ^ (uint32_t)time(NULL);
+    for (size_t i = 0; i < comp_words; i++)
+        ((int32_t *)rxdataF_orig)[i] = (int32_t)(xorshift32(&rnd_state) & 0x7fff7fffu) - 0x40004000;
+    for (size_t i = 0; i < mag_words; i++) {
+        const int16_t ch_r = (int16_t)((xorshift32(&rnd_state) & 0x1f) - 0x10);
+        const int16_t ch_i = (int16_t)((xorshift32(&rnd_state) & 0x1f) - 0x10);
+        ((int32_t *)dl_ch_estimates_ext)[i] = ((int32_t)ch_i << 16) | (int32_t)(uint16_t)ch_r;
+    }
+    memcpy(rxdataF_comp, rxdataF_orig, comp_words * sizeof(int32_t));
+    const int ch_shift = nr_mmse_channel_shift(rx_size_symbol, n_rx, nl, dl_ch_estimates_ext, length);
+
+    /* One layer per nr_dlsch_llr call, each with the thresholds the
+     * equalizer wrote for it */
+    NR_UE_DLSCH_t dlsch[2];
+    memset(dlsch, 0, sizeof(dlsch));
+    dlsch[0].Nl = 1;
+    dlsch[0].dlsch_config.qamModOrder = mod_order;
+
+    /* Three paths, each producing the LLRs of antenna 0 of every layer:
+     *  0: nr_dlsch_mmse + nr_dlsch_llr, the receiver as it stands: all n_rx
+     *     antennas equalized though only antenna 0 reaches the LLRs, and the
+     *     OAI LLR routines up to 256-QAM (context only)
+     *  1: the baseline, the same work as the fused path in two passes:
+     *     antenna 0 equalized back into rxdataF_comp, then read again by the
+     *     nr_llr kernel the fused path uses
+     *  2: nr_dlsch_mmse_llr, equalization and LLRs per tile
+     * Paths 0 and 1 equalize in place, the symbol is restored before each run
+     * outside the timing. Runs alternate in batches and the best batch of each
+     * path is kept, against frequency and cache noise. */
+    enum { PATH_ALL_RX, PATH_SEPARATE, PATH_FUSED, NB_PATHS };
+    const int nb_batches = 8;
+    const int batch_iters = num_iterations / nb_batches > 0 ? num_iterations / nb_batches : 1;
+    uint64_t best_ns[NB_PATHS] = { UINT64_MAX, UINT64_MAX, UINT64_MAX };
+    int ok[NB_PATHS] = { 1, 1, 1 };
+    int32_t inv_re[nl], inv_im[nl];
+
+    for (int b = 0; b < nb_batches; b++)
+        for (int p = 0; p < NB_PATHS; p++) {
+            uint64_t ns = 0;
+            for (int it = 0; it < batch_iters; it++) {
+                for (int l = 0; l < nl && p != PATH_FUSED; l++)
+                    for (int a = 0; a < n_rx; a++)
+                        memcpy(&rxdataF_comp[l][a][symbol * rx_size_symbol], &rxdataF_orig[l][a][symbol * rx_size_symbol],
+                               length * sizeof(int32_t));
+                const uint64_t t0 = now_ns();
+                if (p == PATH_ALL_RX) {
+                    nr_dlsch_mmse(rx_size_symbol, n_rx, nl, rxdataF_comp, dl_ch_mag, dl_ch_magb, dl_ch_magr,
+                                  dl_ch_estimates_ext, nb_rb, mod_order, ch_shift, symbol, length, noise_var);
+                } else if (p == PATH_SEPARATE) {
+                    nr_mmse_layer_gains(rx_size_symbol, n_rx, nl, dl_ch_estimates_ext, length, noise_var, inv_re, inv_im);
+                    for (int l = 0; l < nl; l++) {
+                        int32_t *y = &rxdataF_comp[l][0][symbol * rx_size_symbol];
+                        nr_mmse_equalize_layer(rx_size_symbol, n_rx, l, dl_ch_estimates_ext, 0, length, ch_shift,
+                                               mod_order, inv_re[l], inv_im[l], y, y, (int32_t *)dl_ch_mag[l][0],
+                                               (int32_t *)dl_ch_magb[l][0], (int32_t *)dl_ch_magr[l][0]);
+                    }
+                }
+                if (p == PATH_ALL_RX) {
+                    for (int l = 0; l < nl; l++)
+                        nr_dlsch_llr(rx_size_symbol, n_rx, sz, llr_ref + l, rxdataF_comp + l, dl_ch_mag[l][0],
+                                     dl_ch_magb[l][0], dl_ch_magr[l][0], NULL, NULL, symbol, length, dlsch, 0);
+                } else if (p == PATH_SEPARATE) {
+                    for (int l = 0; l < nl; l++)
+                        nr_llr_compute(mod_order, &rxdataF_comp[l][0][symbol * rx_size_symbol],
+                                       (const int32_t *)dl_ch_mag[l][0], (const int32_t *)dl_ch_magb[l][0],
+                                       (const int32_t *)dl_ch_magr[l][0], llr_ref[l], length);
+                } else {
+                    nr_dlsch_mmse_llr(rx_size_symbol, n_rx, nl, rxdataF_orig, dl_ch_estimates_ext, mod_order, ch_shift,
+                                      symbol, length, noise_var, sz, llr_fused, 0);
+                }
+                ns += now_ns() - t0;
+            }
+            if (ns < best_ns[p]) best_ns[p] = ns;
+            /* Each stage path against the fused LLRs of the previous batch */
+            if (b > 0 && p != PATH_FUSED)
+                for (int l = 0; l < nl; l++)
+                    ok[p] = ok[p] && !memcmp(llr_ref[l], llr_fused[l], (size_t)length * mod_order * sizeof(int16_t));
+        }
+
+    static const char *const names[NB_PATHS] = { "mmse all RX + llr", "mmse RX 0 + llr", "nr_dlsch_mmse_llr" };
+    printf("\n  path              | equalized RX | us / symbol | MLLR/s   | vs fused LLRs\n");
+    for (int p = 0; p < NB_PATHS; p++)
+        printf("  %-17s | %12d | %11.2f | %8.1f | %s\n", names[p], p == PATH_ALL_RX ? n_rx : 1,
+               best_ns[p] / 1e3 / batch_iters, (double)nl * length * mod_order * batch_iters / (best_ns[p] / 1e3),
+               p == PATH_FUSED ? "-" : ok[p] ? "exact" : "MISMATCH");
+    /* Like for like: same equalization and LLR kernel, the difference is
+     * the rxdataF_comp round trip between the stages. Against path 0 QPSK
+     * differs, OAI scaling its LLRs. */
+    printf("  fused vs separate stages on RX 0: %.2fx (nr_dlsch_mmse also equalizes the %d other RX antennas)\n",
+           (double)best_ns[PATH_SEPARATE] / best_ns[PATH_FUSED], n_rx - 1);
+
+    nr_scratch_end(&scratch);
+    printf("=== NR fused MMSE equalization + LLR tests completed ===\n");
+}
+
+void nr_dft_plan_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    printf("=== Starting NR DFT plan cache tests ===\n");
+
+    const int num_iterations = getenv_int("OAI_ITERS", 1000);
+    const int sizes[] = { 128, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192 };
+    const int nb_sizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    uint64_t t0 = now_ns();
+    if (nr_dft_plan_init() < 0) {
+        printf("nr_dft_plan_test: no DFT backend available\n");
+        return;
+    }
+    const char *want = getenv("OAI_DFT_BACKEND");
+    printf("DFT backends set up in %.1f us, active backend %s (OAI_DFT_BACKEND=%s)\n", (now_ns() - t0) / 1e3,
+           nr_dft_backend_name(nr_dft_plan_backend()), want && *want ? want : "unset");
+
+    /* Cost of a lookup, what a context pays when it changes numerology */
+    volatile uintptr_t sink = 0;
+    t0 = now_ns();
+    for (int it = 0; it < num_iterations; it++)
+        for (int s = 0; s < nb_sizes; s++)
+            sink += (uintptr_t)nr_dft_plan_get(sizes[s], it & 1);
+    printf("plan lookup: %.1f ns\n", (double)(now_ns() - t0) / ((double)num_iterations * nb_sizes));
+
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    c16_t *in = nr_scratch_alloc(&scratch, 8192 * sizeof(c16_t));
+    c16_t *out = nr_scratch_alloc(&scratch, 8192 * sizeof(c16_t));
+    uint32_t rnd_state = 0x5EED0042u;
+    for (int i = 0; i < 8192; i++) {
+        in[i].r = (int16_t)(xorshift32(&rnd_state) & 0x0fff) - 0x800;
+        in[i].i = (int16_t)(xorshift32(&rnd_state) & 0x0fff) - 0x800;
+    }
+
+    printf("\n  size | CP0 / CP (mu=1) | backend | DFT us | IDFT us\n");
+    for (int s = 0; s < nb_sizes; s++) {
+        const nr_dft_plan_t *plan = nr_dft_plan_get(sizes[s], 1);
+        t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            nr_dft_plan_dft(plan, (int16_t *)in, (int16_t *)out);
+        const uint64_t dft_ns = now_ns() - t0;
+        t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            nr_dft_plan_idft(plan, (int16_t *)in, (int16_t *)out);
+        const uint64_t idft_ns = now_ns() - t0;
+        printf("  %4d | %6d / %-6d | %7s | %6.2f | %7.2f\n", sizes[s], nr_cp_length(sizes[s], 1, 0, 0),
+               nr_cp_length(sizes[s], 1, 0, 1), nr_dft_backend_name(plan->backend), dft_ns / 1e3 / num_iterations,
+               idft_ns / 1e3 / num_iterations);
+    }
+
+    /* Two carriers of different numerologies, one slot of 14 IDFTs each in
+     * turn, the plan being switched per slot */
+    const nr_dft_plan_t *carriers[2] = { nr_dft_plan_get(1536, 1), nr_dft_plan_get(4096, 1) };
+    t0 = now_ns();
+    for (int it = 0; it < num_iterations; it++) {
+        const nr_dft_plan_t *plan = carriers[it & 1];
+        for (int symb = 0; symb < 14; symb++)
+            nr_dft_plan_idft(plan, (int16_t *)in, (int16_t *)out);
+    }
+    printf("\nalternating 1536 / 4096 slots: %.2f us per slot\n", (now_ns() - t0) / 1e3 / num_iterations);
+
+    nr_scratch_end(&scratch);
+    printf("=== NR DFT plan cache tests completed ===\n");
+}
+
+void nr_ofdm_batch_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    printf("=== Starting NR batched OFDM modulation tests ===\n");
+
+    const int num_iterations = getenv_int("OAI_ITERS", 100);
+    const int nb_threads     = getenv_int("OAI_THREADS", 4);
+    const int fftsize        = getenv_int("OAI_FFT", 4096);
+    const int mu             = getenv_int("OAI_MU", 1);
+    const int alloc_rb       = getenv_int("OAI_ALLOC_RB", 0);
+    const int nb_symbols     = 14;
+    const int tx_counts[]    = { 1, 2, 4, 8, 16, 32, 64 };
+    const int nb_counts      = sizeof(tx_counts) / sizeof(tx_counts[0]);
+    const int max_tx         = tx_counts[nb_counts - 1];
+
+    nr_ofdm_slot_t slot;
+    if (nr_ofdm_slot_init(&slot, fftsize, mu, 0, nb_symbols) < 0) {
+        printf("nr_ofdm_batch_test: no slot layout for FFT size %d\n", fftsize);
+        return;
+    }
+    /* OAI_ALLOC_RB > 0: allocation of that many RBs around DC */
+    if (alloc_rb > 0)
+        nr_ofdm_slot_set_alloc(&slot, fftsize - 6 * alloc_rb, 0, alloc_rb);
+    printf("Parameters: iterations=%d, threads=%d, fftsize=%d, mu=%d, CP=%d/%d, slot=%u samples, "
+           "allocation=%d bins from %d, backend=%s\n",
+           num_iterations, nb_threads, fftsize, mu, slot.cp[0], slot.cp[1], slot.slot_samples,
+           slot.alloc_len, slot.alloc_start,
+           nr_dft_backend_name(slot.plan->backend));
+
+    const size_t grid_sz = (size_t)max_tx * nb_symbols * fftsize;
+    const size_t td_sz = (size_t)max_tx * slot.slot_samples;
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    c16_t *txdataF = nr_scratch_alloc(&scratch, grid_sz * sizeof(c16_t));
+    c16_t *txdata = nr_scratch_alloc(&scratch, td_sz * sizeof(c16_t));
+    c16_t *ref = nr_scratch_alloc(&scratch, td_sz * sizeof(c16_t));
+    c16_t *tmp = nr_scratch_alloc(&scratch, fftsize * sizeof(c16_t));
+    worker_pool_t *serial = worker_pool_init(1);
+    worker_pool_t *pool = worker_pool_init(nb_threads);
+    if (!serial || !pool) {
+        printf("nr_ofdm_batch_test: allocation failed\n");
+        worker_pool_free(serial);
+        worker_pool_free(pool);
+        nr_scratch_end(&scratch);
+        return;
+    }
+
+    uint32_t rnd_state = 0x5EED0043u ^ (uint32_t)time(NULL);
+    for (size_t k = 0; k < grid_sz; k++) {
+        uint32_t r = xorshift32(&rnd_state);
+        txdataF[k].r = (int16_t)qam16_levels[r & 3];
+        txdataF[k].i = (int16_t)qam16_levels[(r >> 2) & 3];
+        /* The grid is zero outside the allocation */
+        if ((k % fftsize + fftsize - slot.alloc_start) % fftsize >= (size_t)slot.alloc_len)
+            txdataF[k].r = txdataF[k].i = 0;
+    }
+
+    /* Reference: symbol by symbol IDFT then CP copy, antenna after antenna */
+    for (int aa = 0; aa < max_tx; aa++)
+        for (int l = 0; l < nb_symbols; l++) {
+            c16_t *sym = ref + (size_t)aa * slot.slot_samples + slot.offset[l];
+            nr_dft_plan_idft(slot.plan, (int16_t *)(txdataF + ((size_t)aa * nb_symbols + l) * fftsize), (int16_t *)tmp);
+            memcpy(sym, tmp + fftsize - slot.cp[l], slot.cp[l] * sizeof(c16_t));
+            memcpy(sym + slot.cp[l], tmp, fftsize * sizeof(c16_t));
+        }
+    nr_ofdm_mod_batch(pool, &slot, max_tx, txdataF, txdata);
+    size_t errors = 0;
+    for (size_t k = 0; k < td_sz; k++)
+        errors += txdata[k].r != ref[k].r || txdata[k].i != ref[k].i;
+    printf("batch vs symbol-by-symbol reference (%d antennas): %zu mismatching samples\n", max_tx, errors);
+
+    /* Per-slot TX front end: PHY_ofdm_mod() per antenna (constant short CP)
+     * against the batched modulator on 1 and nb_threads threads */
+    printf("\n  nb_tx | PHY_ofdm_mod us | batch 1 thr us | batch %2d thr us | us per antenna\n", nb_threads);
+    for (int c = 0; c < nb_counts; c++) {
+        const int nb_tx = tx_counts[c];
+
+        uint64_t t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            for (int aa = 0; aa < nb_tx; aa++)
+                PHY_ofdm_mod((int *)(txdataF + (size_t)aa * nb_symbols * fftsize),
+                             (int *)(txdata + (size_t)aa * slot.slot_samples),
+                             fftsize, nb_symbols, slot.cp[1], CYCLIC_PREFIX);
+        const uint64_t phy_ns = now_ns() - t0;
+
+        t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            nr_ofdm_mod_batch(serial, &slot, nb_tx, txdataF, txdata);
+        const uint64_t serial_ns = now_ns() - t0;
+
+        t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            nr_ofdm_mod_batch(pool, &slot, nb_tx, txdataF, txdata);
+        const uint64_t pool_ns = now_ns() - t0;
+
+        printf("  %5d | %15.1f | %14.1f | %15.1f | %14.2f\n", nb_tx,
+               phy_ns / 1e3 / num_iterations, serial_ns / 1e3 / num_iterations,
+               pool_ns / 1e3 / num_iterations, pool_ns / 1e3 / num_iterations / nb_tx);
+    }
+
+    nr_scratch_end(&scratch);
+    worker_pool_free(serial);
+    worker_pool_free(pool);
+    printf("=== NR batched OFDM modulation tests completed ===\n");
+}
+
+void nr_slot_fep_batch_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    printf("=== Starting NR slot FEP batch tests ===\n");
+
+    const int num_iterations = getenv_int("OAI_ITERS", 100);
+    const int nb_threads     = getenv_int("OAI_THREADS", 4);
+    const int fftsize        = getenv_int("OAI_FFT", 4096);
+    const int mu             = getenv_int("OAI_MU", 1);
+    const int alloc_rb       = getenv_int("OAI_ALLOC_RB", 0);
+    const int nb_symbols     = 14;
+    const int offset_divisor = 8;
+    const int rx_counts[]    = { 1, 2, 4, 8, 16, 32, 64 };
+    const int nb_counts      = sizeof(rx_counts) / sizeof(rx_counts[0]);
+    const int max_rx         = rx_counts[nb_counts - 1];
+
+    nr_ofdm_slot_t slot;
+    if (nr_ofdm_slot_init(&slot, fftsize, mu, 0, nb_symbols) < 0) {
+        printf("nr_slot_fep_batch_test: no slot layout for FFT size %d\n", fftsize);
+        return;
+    }
+    /* OAI_ALLOC_RB > 0: allocation of that many RBs around DC */
+    if (alloc_rb > 0)
+        nr_ofdm_slot_set_alloc(&slot, fftsize - 6 * alloc_rb, 0, alloc_rb);
+    printf("Parameters: iterations=%d, threads=%d, fftsize=%d, mu=%d, CP=%d/%d, slot=%u samples, "
+           "allocation=%d bins from %d, backend=%s\n",
+           num_iterations, nb_threads, fftsize, mu, slot.cp[0], slot.cp[1], slot.slot_samples,
+           slot.alloc_len, slot.alloc_start,
+           nr_dft_backend_name(slot.plan->backend));
+
+    const size_t td_sz = (size_t)max_rx * slot.slot_samples;
+    const size_t grid_sz = (size_t)max_rx * nb_symbols * fftsize;
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    c16_t *rxdata = nr_scratch_alloc(&scratch, td_sz * sizeof(c16_t));
+    c16_t *rxdataF = nr_scratch_alloc(&scratch, grid_sz * sizeof(c16_t));
+    c16_t *ref = nr_scratch_alloc(&scratch, grid_sz * sizeof(c16_t));
+    c16_t *tmp = nr_scratch_alloc(&scratch, fftsize * sizeof(c16_t));
+    worker_pool_t *serial = worker_pool_init(1);
+    worker_pool_t *pool = worker_pool_init(nb_threads);
+    if (!serial || !pool) {
+        printf("nr_slot_fep_batch_test: allocation failed\n");
+        worker_pool_free(serial);
+        worker_pool_free(pool);
+        nr_scratch_end(&scratch);
+        return;
+    }
+
+    uint32_t rnd_state = 0x5EED0044u ^ (uint32_t)time(NULL);
+    for (size_t k = 0; k < td_sz; k++) {
+        rxdata[k].r = (int16_t)(xorshift32(&rnd_state) & 0x0fff) - 0x800;
+        rxdata[k].i = (int16_t)(xorshift32(&rnd_state) & 0x0fff) - 0x800;
+    }
+
+    /* Reference: window copied out symbol by symbol, then one DFT each */
+    for (int aa = 0; aa < max_rx; aa++)
+        for (int l = 0; l < nb_symbols; l++) {
+            const int start = slot.cp[l] - slot.cp[l] / offset_divisor;
+            memcpy(tmp, rxdata + (size_t)aa * slot.slot_samples + slot.offset[l] + start, fftsize * sizeof(c16_t));
+            nr_dft_plan_dft(slot.plan, (int16_t *)tmp, (int16_t *)(ref + ((size_t)aa * nb_symbols + l) * fftsize));
+        }
+    nr_ofdm_fep_batch(pool, &slot, max_rx, rxdata, slot.slot_samples, offset_divisor, rxdataF);
+    size_t errors = 0;
+    for (size_t k = 0; k < grid_sz; k++) {
+        /* Only the allocation bins are written by a pruned DFT */
+        if ((k % fftsize + fftsize - slot.alloc_start) % fftsize >= (size_t)slot.alloc_len) continue;
+        errors += rxdataF[k].r != ref[k].r || rxdataF[k].i != ref[k].i;
+    }
+    printf("batch vs symbol-by-symbol reference (%d antennas): %zu mismatching REs in the allocation\n", max_rx, errors);
+
+    /* nr_slot_fep() view of the slot: constant CP after symbol 0 */
+    struct fep_frame_parms {
+        int ofdm_symbol_size;
+        int samples_per_slot_wCP;
+        int nb_prefix_samples;
+        int nb_prefix_samples0;
+        int nb_antennas_rx;
+        int symbols_per_slot;
+        int slots_per_frame;
+        int ofdm_offset_divisor;
+    } frame_parms = {
+        .ofdm_symbol_size = fftsize,
+        .samples_per_slot_wCP = (fftsize + slot.cp[1]) * nb_symbols,
+        .nb_prefix_samples = slot.cp[1],
+        .nb_prefix_samples0 = slot.cp[0],
+        .nb_antennas_rx = 1,
+        .symbols_per_slot = nb_symbols,
+        .slots_per_frame = 1,
+        .ofdm_offset_divisor = offset_divisor
+    };
+
+    /* Slot FEP latency: per-symbol nr_slot_fep() with a memset of the row
+     * before each call, antenna after antenna, against the batched front end
+     * on 1 and nb_threads threads */
+    printf("\n  nb_rx | nr_slot_fep us | batch 1 thr us | batch %2d thr us | us per antenna\n", nb_threads);
+    for (int c = 0; c < nb_counts; c++) {
+        const int nb_rx = rx_counts[c];
+
+        uint64_t t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            for (int aa = 0; aa < nb_rx; aa++) {
+                c16_t *fd = rxdataF + (size_t)aa * nb_symbols * fftsize;
+                for (int l = 0; l < nb_symbols; l++) {
+                    memset(fd + l * fftsize, 0, fftsize * sizeof(c16_t));
+                    nr_slot_fep(NULL, &frame_parms, 0, l, fd, 0, 0, rxdata + (size_t)aa * slot.slot_samples);
+                }
+            }
+        const uint64_t fep_ns = now_ns() - t0;
+
+        t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            nr_ofdm_fep_batch(serial, &slot, nb_rx, rxdata, slot.slot_samples, offset_divisor, rxdataF);
+        const uint64_t serial_ns = now_ns() - t0;
+
+        t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            nr_ofdm_fep_batch(pool, &slot, nb_rx, rxdata, slot.slot_samples, offset_divisor, rxdataF);
+        const uint64_t pool_ns = now_ns() - t0;
+
+        printf("  %5d | %14.1f | %14.1f | %15.1f | %14.2f\n", nb_rx,
+               fep_ns / 1e3 / num_iterations, serial_ns / 1e3 / num_iterations,
+               pool_ns / 1e3 / num_iterations, pool_ns / 1e3 / num_iterations / nb_rx);
+    }
+
+    nr_scratch_end(&scratch);
+    worker_pool_free(serial);
+    worker_pool_free(pool);
+    printf("=== NR slot FEP batch tests completed ===\n");
+}
+
+void nr_fft_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    printf("=== Starting NR built-in FFT tests ===\n");
+
+    const int num_iterations = getenv_int("OAI_ITERS", 1000);
+    const int sizes[] = { 128, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192 };
+    const int nb_sizes = sizeof(sizes) / sizeof(sizes[0]);
+    const int max_size = sizes[nb_sizes - 1];
+
+    if (nr_dft_plan_init() < 0) {
+        printf("nr_fft_test: no DFT backend available\n");
+        return;
+    }
+    const int have_libdfts = nr_dft_plan_get_backend(NR_DFT_BACKEND_LIBDFTS, 1024, 1) != NULL;
+    printf("Parameters: iterations=%d, default backend %s, libdfts %s\n", num_iterations,
+           nr_dft_backend_name(nr_dft_plan_backend()), have_libdfts ? "loaded" : "not available");
+
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    c16_t *in = nr_scratch_alloc(&scratch, max_size * sizeof(c16_t));
+    c16_t *out = nr_scratch_alloc(&scratch, max_size * sizeof(c16_t));
+    c16_t *back = nr_scratch_alloc(&scratch, max_size * sizeof(c16_t));
+    c16_t *lib = nr_scratch_alloc(&scratch, max_size * sizeof(c16_t));
+    float *fbuf = nr_scratch_alloc(&scratch, 2 * max_size * sizeof(float));
+    float *fwork = nr_scratch_alloc(&scratch, 2 * max_size * sizeof(float));
+    float *fsrc = nr_scratch_alloc(&scratch, 2 * max_size * sizeof(float));
+    double *tw = nr_scratch_alloc(&scratch, 2 * max_size * sizeof(double));
+
+    uint32_t rnd_state = 0x5EED0045u ^ (uint32_t)time(NULL);
+
+    printf("\n  size | SNR dB | IDFT(DFT) err | builtin DFT / IDFT us | float DFT us | libdfts DFT / IDFT us | vs libdfts max\n");
+    for (int si = 0; si < nb_sizes; si++) {
+        const int n = sizes[si];
+        const nr_dft_plan_t *bi = nr_dft_plan_get_backend(NR_DFT_BACKEND_BUILTIN, n, 1);
+        const nr_dft_plan_t *ld = nr_dft_plan_get_backend(NR_DFT_BACKEND_LIBDFTS, n, 1);
+        for (int k = 0; k < n; k++) {
+            in[k].r = (int16_t)(xorshift32(&rnd_state) & 0x0fff) - 0x800;
+            in[k].i = (int16_t)(xorshift32(&rnd_state) & 0x0fff) - 0x800;
+        }
+
+        /* Accuracy against a double precision DFT scaled by 1 / sqrt(n) */
+        nr_dft_plan_dft(bi, (int16_t *)in, (int16_t *)out);
+        for (int k = 0; k < n; k++) {
+            tw[2 * k] = cos(-2.0 * M_PI * k / n);
+            tw[2 * k + 1] = sin(-2.0 * M_PI * k / n);
+        }
+        double sig = 0, err = 0;
+        for (int j = 0; j < n; j++) {
+            double re = 0, im = 0;
+            for (int k = 0, e = 0; k < n; k++, e = (e + j) % n) {
+                re += in[k].r * tw[2 * e] - in[k].i * tw[2 * e + 1];
+                im += in[k].r * tw[2 * e + 1] + in[k].i * tw[2 * e];
+            }
+            re /= sqrt((double)n);
+            im /= sqrt((double)n);
+            sig += re * re + im * im;
+            err += (re - out[j].r) * (re - out[j].r) + (im - out[j].i) * (im - out[j].i);
+        }
+        nr_dft_plan_idft(bi, (int16_t *)out, (int16_t *)back);
+        int rt_err = 0;
+        for (int k = 0; k < n; k++) {
+            const int e = abs(back[k].r - in[k].r) > abs(back[k].i - in[k].i) ? abs(back[k].r - in[k].r) : abs(back[k].i - in[k].i);
+            if (e > rt_err) rt_err = e;
+        }
+
+        uint64_t t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            nr_dft_plan_dft(bi, (int16_t *)in, (int16_t *)out);
+        const uint64_t dft_ns = now_ns() - t0;
+        t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            nr_dft_plan_idft(bi, (int16_t *)in, (int16_t *)back);
+        const uint64_t idft_ns = now_ns() - t0;
+
+        const nr_fft_t *f = nr_fft_init(n);
+        uint64_t float_ns = 0;
+        if (f) {
+            /* The float transform clobbers its input: reload it every time */
+            for (int k = 0; k < 2 * n; k++)
+                fsrc[k] = ((int16_t *)in)[k];
+            t0 = now_ns();
+            for (int it = 0; it < num_iterations; it++) {
+                memcpy(fbuf, fsrc, 2 * n * sizeof(float));
+                nr_fft_float(f, fbuf, fwork, 0);
+            }
+            float_ns = now_ns() - t0;
+            nr_fft_free((nr_fft_t *)f);
+        }
+
+        if (ld) {
+            nr_dft_plan_dft(bi, (int16_t *)in, (int16_t *)out);
+            nr_dft_plan_dft(ld, (int16_t *)in, (int16_t *)lib);
+            int lib_err = 0;
+            for (int k = 0; k < n; k++) {
+                const int e = abs(lib[k].r - out[k].r) > abs(lib[k].i - out[k].i) ? abs(lib[k].r - out[k].r) : abs(lib[k].i - out[k].i);
+                if (e > lib_err) lib_err = e;
+            }
+            t0 = now_ns();
+            for (int it = 0; it < num_iterations; it++)
+                nr_dft_plan_dft(ld, (int16_t *)in, (int16_t *)lib);
+            const uint64_t ld_dft_ns = now_ns() - t0;
+            t0 = now_ns();
+            for (int it = 0; it < num_iterations; it++)
+                nr_dft_plan_idft(ld, (int16_t *)in, (int16_t *)lib);
+            const uint64_t ld_idft_ns = now_ns() - t0;
+            printf("  %4d | %6.1f | %13d | %9.2f / %-9.2f | %12.2f | %9.2f / %-9.2f | %14d\n", n,
+                   10 * log10(sig / err), rt_err, dft_ns / 1e3 / num_iterations, idft_ns / 1e3 / num_iterations,
+                   float_ns / 1e3 / num_iterations, ld_dft_ns / 1e3 / num_iterations,
+                   ld_idft_ns / 1e3 / num_iterations, lib_err);
+        } else {
+            printf("  %4d | %6.1f | %13d | %9.2f / %-9.2f | %12.2f | %21s | %14s\n", n,
+                   10 * log10(sig / err), rt_err, dft_ns / 1e3 / num_iterations, idft_ns / 1e3 / num_iterations,
+                   float_ns / 1e3 / num_iterations, "-", "-");
+        }
+    }
+
+    nr_scratch_end(&scratch);
+    printf("=== NR built-in FFT tests completed ===\n");
+}
+
+void nr_fft_pruned_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    printf("=== Starting NR pruned FFT tests ===\n");
+
+    const int num_iterations = getenv_int("OAI_ITERS", 1000);
+    const int fftsize        = getenv_int("OAI_FFT", 4096);
+    /* Allocation over the FFT size, in 1/64 */
+    const int fractions[]    = { 2, 4, 8, 16, 24, 32, 40, 51 };
+    const int nb_fractions   = sizeof(fractions) / sizeof(fractions[0]);
+
+    nr_fft_t *f = nr_fft_init(fftsize);
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    c16_t *grid = nr_scratch_alloc(&scratch, fftsize * sizeof(c16_t));
+    c16_t *full = nr_scratch_alloc(&scratch, fftsize * sizeof(c16_t));
+    c16_t *pruned = nr_scratch_alloc(&scratch, fftsize * sizeof(c16_t));
+    c16_t *td = nr_scratch_alloc(&scratch, fftsize * sizeof(c16_t));
+    if (!f) {
+        printf("nr_fft_pruned_test: allocation failed\n");
+        nr_fft_free(f);
+        nr_scratch_end(&scratch);
+        return;
+    }
+    printf("Parameters: iterations=%d, fftsize=%d\n", num_iterations, fftsize);
+
+    uint32_t rnd_state = 0x5EED0046u ^ (uint32_t)time(NULL);
+    for (int k = 0; k < fftsize; k++) {
+        td[k].r = (int16_t)(xorshift32(&rnd_state) & 0x0fff) - 0x800;
+        td[k].i = (int16_t)(xorshift32(&rnd_state) & 0x0fff) - 0x800;
+    }
+
+    printf("\n  RBs | alloc %% | TX IDFT full / pruned us | saving %% | RX DFT full / pruned us | saving %% | mismatches\n");
+    for (int fi = 0; fi < nb_fractions; fi++) {
+        /* Carrier of nb_rb RBs around DC, all of them allocated */
+        const int nb_rb = fractions[fi] * fftsize / (64 * 12);
+        int start, len;
+        nr_fft_rb_range(fftsize, fftsize - 6 * nb_rb, 0, nb_rb, &start, &len);
+
+        memset(grid, 0, fftsize * sizeof(c16_t));
+        for (int k = 0; k < len; k++) {
+            uint32_t r = xorshift32(&rnd_state);
+            grid[(start + k) % fftsize].r = (int16_t)qam16_levels[r & 3];
+            grid[(start + k) % fftsize].i = (int16_t)qam16_levels[(r >> 2) & 3];
+        }
+
+        /* Pruned and full transforms must agree on what the pruned one gives */
+        int errors = 0;
+        nr_fft_int16(f, (int16_t *)grid, (int16_t *)full, 1, 1);
+        nr_fft_int16_pruned(f, (int16_t *)grid, (int16_t *)pruned, 1, 1, start, len, 0, fftsize);
+        for (int k = 0; k < fftsize; k++)
+            errors += full[k].r != pruned[k].r || full[k].i != pruned[k].i;
+        nr_fft_int16(f, (int16_t *)td, (int16_t *)full, 0, 1);
+        nr_fft_int16_pruned(f, (int16_t *)td, (int16_t *)pruned, 0, 1, 0, fftsize, start, len);
+        for (int k = 0; k < len; k++) {
+            const int b = (start + k) % fftsize;
+            errors += full[b].r != pruned[b].r || full[b].i != pruned[b].i;
+        }
+
+        uint64_t t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            nr_fft_int16(f, (int16_t *)grid, (int16_t *)full, 1, 1);
+        const uint64_t tx_full_ns = now_ns() - t0;
+        t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            nr_fft_int16_pruned(f, (int16_t *)grid, (int16_t *)pruned, 1, 1, start, len, 0, fftsize);
+        const uint64_t tx_pruned_ns = now_ns() - t0;
+        t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            nr_fft_int16(f, (int16_t *)td, (int16_t *)full, 0, 1);
+        const uint64_t rx_full_ns = now_ns() - t0;
+        t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            nr_fft_int16_pruned(f, (int16_t *)td, (int16_t *)pruned, 0, 1, 0, fftsize, start, len);
+        const uint64_t rx_pruned_ns = now_ns() - t0;
+
+        printf("  %3d | %7.1f | %10.2f / %-11.2f | %8.1f | %10.2f / %-10.2f | %8.1f | %10d\n", nb_rb,
+               100.0 * len / fftsize, tx_full_ns / 1e3 / num_iterations, tx_pruned_ns / 1e3 / num_iterations,
+               100.0 * (1.0 - (double)tx_pruned_ns / tx_full_ns), rx_full_ns / 1e3 / num_iterations,
+               rx_pruned_ns / 1e3 / num_iterations, 100.0 * (1.0 - (double)rx_pruned_ns / rx_full_ns), errors);
+    }
+
+    nr_fft_free(f);
+    nr_scratch_end(&scratch);
+    printf("=== NR pruned FFT tests completed ===\n");
+}
+
+/* Per-subcarrier reference of nr_re_extract() / nr_re_map() */
+static uint32_t re_mapping_ref(c16_t *grid, int fftsize, int start_sc, int nb_rb, const nr_re_pattern_t *p, c16_t *re, int map)
+{
+    uint32_t n = 0;
+    for (int k = 0; k < 12 * nb_rb; k++) {
+        const int rb = k / 12, sc = k % 12;
+        const int ptrs = p->ptrs_period > 0 && rb >= p->ptrs_rb_offset && (rb - p->ptrs_rb_offset) % p->ptrs_period == 0;
+        if (!(p->data_mask & (1 << sc)) || (ptrs && sc == p->ptrs_sc))
+            continue;
+        const int bin = (start_sc + k) % fftsize;
+        if (map)
+            grid[bin] = re[n++];
+        else
+            re[n++] = grid[bin];
+    }
+    return n;
+}
+
+void nr_re_mapping_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    printf("=== Starting NR RE mapping tests ===\n");
+
+    const int num_iterations = getenv_int("OAI_ITERS", 10000);
+    const int fftsize        = getenv_int("OAI_FFT", 4096);
+    const int nb_rb          = getenv_int("OAI_RB", 273);
+    if (12 * nb_rb > fftsize) {
+        printf("nr_re_mapping_test: %d RBs do not fit FFT size %d\n", nb_rb, fftsize);
+        return;
+    }
+    /* Carrier centred on DC as in OAI, so the allocation wraps at the FFT edge */
+    const int start_sc = fftsize - 6 * nb_rb;
+
+    const struct {
+        const char *name;
+        nr_re_pattern_t p;
+    } patterns[] = {
+        { "data",              { .data_mask = NR_RE_MASK_ALL } },
+        { "data + PTRS K=2",   { .data_mask = NR_RE_MASK_ALL, .ptrs_period = 2, .ptrs_rb_offset = 1, .ptrs_sc = 0 } },
+        { "DMRS type 1, 1 CDM", { .data_mask = nr_re_dmrs_data_mask(1, 1) } },
+        { "DMRS type 2, 1 CDM", { .data_mask = nr_re_dmrs_data_mask(2, 1) } },
+        { "DMRS type 2, 2 CDM", { .data_mask = nr_re_dmrs_data_mask(2, 2) } },
+    };
+    const int nb_patterns = sizeof(patterns) / sizeof(patterns[0]);
+
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    c16_t *grid = nr_scratch_alloc(&scratch, fftsize * sizeof(c16_t));
+    c16_t *grid_ref = nr_scratch_alloc(&scratch, fftsize * sizeof(c16_t));
+    c16_t *re = nr_scratch_alloc(&scratch, fftsize * sizeof(c16_t));
+    c16_t *re_ref = nr_scratch_alloc(&scratch, fftsize * sizeof(c16_t));
+    printf("Parameters: iterations=%d, fftsize=%d, RBs=%d, first subcarrier=%d\n", num_iterations, fftsize, nb_rb,
+           start_sc);
+
+    uint32_t rnd_state = 0x5EED0047u ^ (uint32_t)time(NULL);
+    for (int k = 0; k < fftsize; k++) {
+        grid[k].r = (int16_t)xorshift32(&rnd_state);
+        grid[k].i = (int16_t)xorshift32(&rnd_state);
+    }
+
+    printf("\n  pattern            |  REs | extract ref / vec ns | speedup | map ref / vec ns | speedup | mismatches\n");
+    for (int pi = 0; pi < nb_patterns; pi++) {
+        const nr_re_pattern_t *p = &patterns[pi].p;
+
+        /* Extraction, then mapping of modified REs, against the reference */
+        int errors = 0;
+        const uint32_t nb_re = nr_re_extract(grid, fftsize, start_sc, nb_rb, p, re);
+        errors += nb_re != re_mapping_ref(grid, fftsize, start_sc, nb_rb, p, re_ref, 0) || nb_re != nr_re_count(p, nb_rb);
+        for (uint32_t k = 0; k < nb_re; k++) {
+            errors += re[k].r != re_ref[k].r || re[k].i != re_ref[k].i;
+            re[k].r = re_ref[k].r = (int16_t)~re[k].r;
+        }
+        memcpy(grid_ref, grid, fftsize * sizeof(c16_t));
+        nr_re_map(re, fftsize, start_sc, nb_rb, p, grid);
+        re_mapping_ref(grid_ref, fftsize, start_sc, nb_rb, p, re_ref, 1);
+        errors += memcmp(grid, grid_ref, fftsize * sizeof(c16_t)) != 0;
+
+        uint64_t t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            re_mapping_ref(grid, fftsize, start_sc, nb_rb, p, re_ref, 0);
+        const uint64_t ext_ref_ns = now_ns() - t0;
+        t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            nr_re_extract(grid, fftsize, start_sc, nb_rb, p, re);
+        const uint64_t ext_ns = now_ns() - t0;
+        t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            re_mapping_ref(grid_ref, fftsize, start_sc, nb_rb, p, re_ref, 1);
+        const uint64_t map_ref_ns = now_ns() - t0;
+        t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++)
+            nr_re_map(re, fftsize, start_sc, nb_rb, p, grid);
+        const uint64_t map_ns = now_ns() - t0;
+
+        printf("  %-18s | %4u | %9.1f / %-8.1f | %7.2f | %7.1f / %-7.1f | %7.2f | %10d\n", patterns[pi].name, nb_re,
+               (double)ext_ref_ns / num_iterations, (double)ext_ns / num_iterations, (double)ext_ref_ns / ext_ns,
+               (double)map_ref_ns / num_iterations, (double)map_ns / num_iterations, (double)map_ref_ns / map_ns,
+               errors);
+    }
+
+    nr_scratch_end(&scratch);
+    printf("=== NR RE mapping tests completed ===\n");
+}
+
+void nr_ptrs_test()
+{
+    /* Initialize the logging system first */
+    logInit();
+
+    printf("=== Starting NR PTRS tests ===\n");
+
+    const int num_iterations = getenv_int("OAI_ITERS", 1000);
+    const int fftsize        = getenv_int("OAI_FFT", 4096);
+    const int nb_rb          = getenv_int("OAI_RB", 273);
+    const int K              = getenv_int("OAI_PTRS_K", 2);
+    const int L              = getenv_int("OAI_PTRS_L", 1);
+    const int nb_symbols     = 14;
+    const uint16_t dmrs_pos  = 0x0004;   /* DMRS on symbol 2, DMRS only (2 CDM groups without data) */
+    const int amp            = 1000;
+    const int sz             = 12 * nb_rb;
+    if (sz > fftsize || (K != 2 && K != 4) || (L != 1 && L != 2 && L != 4)) {
+        printf("nr_ptrs_test: unsupported RBs %d / FFT %d / K %d / L %d\n", nb_rb, fftsize, K, L);
+        return;
+    }
+
+    NR_DL_FRAME_PARMS frame_parms = {
+        .N_RB_DL = nb_rb,
+        .ofdm_symbol_size = fftsize,
+        .first_carrier_offset = fftsize - 6 * nb_rb,
+        .nb_antennas_tx = 1,
+        .symbols_per_slot = nb_symbols
+    };
+    nfapi_nr_dl_tti_pdsch_pdu_rel15_t rel15 = {
+        .rnti = 0x4601,
+        .rbStart = 0,
+        .rbSize = nb_rb,
+        .nrOfLayers = 1,
+        .dlDmrsSymbPos = dmrs_pos,
+        .dmrsConfigType = 0,
+        .numDmrsCdmGrpsNoData = 2,
+        .NrOfCodewords = 1,
+        .StartSymbolIndex = 0,
+        .NrOfSymbols = nb_symbols,
+        .dlDmrsScramblingId = 0x1a2,
+        .SCID = 0,
+        .PTRSPortIndex = 1,
+        .PTRSTimeDensity = L,
+        .PTRSFreqDensity = K,
+        .PTRSReOffset = 1,
+        .pduBitmap = 0x1
+    };
+    const int slot = 3;
+    const int start_sc = frame_parms.first_carrier_offset;
+    const uint16_t ptrs_pos = nr_ptrs_symbol_mask(0, nb_symbols, L, dmrs_pos);
+    const uint16_t data_pos = (uint16_t)(((1 << nb_symbols) - 1) & ~dmrs_pos);
+
+    nr_re_pattern_t ptrs = {.data_mask = NR_RE_MASK_ALL};
+    nr_ptrs_set_pattern(&ptrs, 1, 0, rel15.PTRSReOffset, K, nb_rb, rel15.rnti);
+    const nr_re_pattern_t data = {.data_mask = NR_RE_MASK_ALL};
+    const int nb_ptrs = nr_ptrs_count(&ptrs, nb_rb);
+
+    /* Slot buffers from the thread arena; the PTRS scratch of do_onelayer()
+     * comes and goes above them */
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    c16_t *tx_layer = nr_scratch_alloc(&scratch, nb_symbols * sz * sizeof(c16_t));
+    c16_t *dmrs = nr_scratch_alloc(&scratch, sz / 2 * sizeof(c16_t));
+    c16_t *txF = nr_scratch_alloc(&scratch, nb_symbols * fftsize * sizeof(c16_t));
+    c16_t *rxF = nr_scratch_alloc(&scratch, nb_symbols * fftsize * sizeof(c16_t));
+    c16_t *rx_re = nr_scratch_alloc(&scratch, nb_symbols * sz * sizeof(c16_t));
+    c16_t *tx_re = nr_scratch_alloc(&scratch, sz * sizeof(c16_t));
+    c16_t *ref = nr_scratch_alloc(&scratch, nb_symbols * nb_ptrs * sizeof(c16_t));
+    c16_t *rx_ptrs = nr_scratch_alloc(&scratch, nb_ptrs * sizeof(c16_t));
+    c16_t *ch = nr_scratch_alloc(&scratch, nb_ptrs * sizeof(c16_t));
+    printf("Parameters: iterations=%d, fftsize=%d, RBs=%d, K=%d, L=%d, PTRS symbols=0x%04x, PTRS REs/symbol=%d\n",
+           num_iterations, fftsize, nb_rb, K, L, ptrs_pos, nb_ptrs);
+
+    uint32_t rnd_state = 0x5EED0048u ^ (uint32_t)time(NULL);
+    for (int k = 0; k < nb_symbols * sz; k++) {
+        uint32_t r = xorshift32(&rnd_state);
+        tx_layer[k].r = (int16_t)qam16_levels[r & 3];
+        tx_layer[k].i = (int16_t)qam16_levels[(r >> 2) & 3];
+    }
+    for (int k = 0; k < sz / 2; k++) {
+        dmrs[k].r = (xorshift32(&rnd_state) & 1) ? -NR_DMRS_AMP : NR_DMRS_AMP;
+        dmrs[k].i = (xorshift32(&rnd_state) & 1) ? -NR_DMRS_AMP : NR_DMRS_AMP;
+    }
+    /* Unit channel, its estimate at the PTRS REs is a real constant */
+    for (int i = 0; i < nb_ptrs; i++)
+        ch[i] = (c16_t){16384, 0};
+
+    /* TX slot, with and without PTRS */
+    uint64_t tx_ns[2] = {0, 0};
+    for (int with_ptrs = 0; with_ptrs < 2; with_ptrs++) {
+        memset(txF, 0, nb_symbols * fftsize * sizeof(c16_t));
+        const uint64_t t0 = now_ns();
+        for (int it = 0; it < num_iterations; it++) {
+            for (int l = 0; l < nb_symbols; l++)
+                do_onelayer(&frame_parms, slot, &rel15, 0, txF + l * fftsize, tx_layer + l * sz, start_sc, fftsize, l,
+                            with_ptrs ? ptrs_pos : 0, amp, (int16_t)amp, 0, NFAPI_NR_DMRS_TYPE1, dmrs);
+        }
+        tx_ns[with_ptrs] = now_ns() - t0;
+    }
+
+    /* The PTRS symbols must hold the layer data on the data REs of the
+     * pattern and the QPSK sequence on the PTRS REs */
+    int tx_errors = 0;
+    for (int l = 0; l < nb_symbols; l++) {
+        if (!(ptrs_pos & (1 << l))) continue;
+        /* The first nb_ptrs DMRS points, as do_onelayer() (OAI shortcut) */
+        nr_dmrs_generate(slot, l, rel15.dlDmrsScramblingId, rel15.SCID, nb_ptrs, ref + l * nb_ptrs);
+        const uint32_t n = nr_re_extract(txF + l * fftsize, fftsize, start_sc, nb_rb, &ptrs, tx_re);
+        for (uint32_t k = 0; k < n; k++) {
+            const c16_t e = c16mulRealShift(tx_layer[l * sz + k], amp, 15);
+            tx_errors += tx_re[k].r != e.r || tx_re[k].i != e.i;
+        }
+        nr_ptrs_extract(txF + l * fftsize, fftsize, start_sc, nb_rb, &ptrs, rx_ptrs);
+        for (int i = 0; i < nb_ptrs; i++) {
+            const c16_t e = c16mulRealShift(ref[l * nb_ptrs + i], amp, 15);
+            tx_errors += rx_ptrs[i].r != e.r || rx_ptrs[i].i != e.i;
+        }
+    }
+
+    /* Phase noise: a common phase per symbol drifting over the slot */
+    float phi[NR_PTRS_MAX_SYMBOLS];
+    const float phi0 = ((float)(xorshift32(&rnd_state) & 0xffff) / 65536.0f - 0.5f) * (float)M_PI / 2;
+    for (int l = 0; l < nb_symbols; l++) {
+        phi[l] = phi0 + 0.03f * l;
+        memcpy(rxF + l * fftsize, txF + l * fftsize, fftsize * sizeof(c16_t));
+        nr_ptrs_derotate(rxF + l * fftsize, fftsize, -phi[l]);
+    }
+
+    /* RX slot: data RE extraction, CPE of the PTRS symbols, interpolation,
+     * derotation of the data REs */
+    float phase[NR_PTRS_MAX_SYMBOLS] = {0};
+    uint64_t ext_ns = 0, cpe_ns = 0, derot_ns = 0;
+    for (int it = 0; it < num_iterations; it++) {
+        uint64_t t0 = now_ns();
+        for (int l = 0; l < nb_symbols; l++)
+            if (data_pos & (1 << l))
+                nr_re_extract(rxF + l * fftsize, fftsize, start_sc, nb_rb, (ptrs_pos & (1 << l)) ? &ptrs : &data,
+                              rx_re + l * sz);
+        uint64_t t1 = now_ns();
+        ext_ns += t1 - t0;
+        for (int l = 0; l < nb_symbols; l++) {
+            if (!(ptrs_pos & (1 << l))) continue;
+            nr_ptrs_extract(rxF + l * fftsize, fftsize, start_sc, nb_rb, &ptrs, rx_ptrs);
+            phase[l] = nr_ptrs_cpe(rx_ptrs, ch, ref + l * nb_ptrs, nb_ptrs);
+        }
+        nr_ptrs_interpolate(ptrs_pos, data_pos, phase);
+        t0 = now_ns();
+        cpe_ns += t0 - t1;
+        for (int l = 0; l < nb_symbols; l++)
+            if (data_pos & (1 << l))
+                nr_ptrs_derotate(rx_re + l * sz, (ptrs_pos & (1 << l)) ? sz - nb_ptrs : sz, phase[l]);
+        derot_ns += now_ns() - t0;
+    }
+
+    /* Estimated phases and derotated data against the TX slot */
+    float max_phase_err = 0;
+    int max_re_err = 0;
+    for (int l = 0; l < nb_symbols; l++) {
+        if (!(data_pos & (1 << l))) continue;
+        const float e = fabsf(phase[l] - phi[l]);
+        if (e > max_phase_err) max_phase_err = e;
+        const uint32_t n = nr_re_extract(txF + l * fftsize, fftsize, start_sc, nb_rb,
+                                         (ptrs_pos & (1 << l)) ? &ptrs : &data, tx_re);
+        nr_re_extract(rxF + l * fftsize, fftsize, start_sc, nb_rb, (ptrs_pos & (1 << l)) ? &ptrs : &data,
+                      rx_re + l * sz);
+        nr_ptrs_derotate(rx_re + l * sz, n, phase[l]);
+        for (uint32_t k = 0; k < n; k++) {
+            const int d = abs(rx_re[l * sz + k].r - tx_re[k].r) + abs(rx_re[l * sz + k].i - tx_re[k].i);
+            if (d > max_re_err) max_re_err = d;
+        }
+    }
+
+    const double slot_tx0 = (double)tx_ns[0] / 1e3 / num_iterations;
+    const double slot_tx1 = (double)tx_ns[1] / 1e3 / num_iterations;
+    printf("\n  TX do_onelayer per slot: %.2f us without PTRS, %.2f us with PTRS (%+.1f %%), mismatches %d\n",
+           slot_tx0, slot_tx1, 100.0 * (slot_tx1 / slot_tx0 - 1.0), tx_errors);
+    printf("  RX per slot: RE extraction %.2f us, CPE estimation %.2f us, derotation %.2f us\n",
+           (double)ext_ns / 1e3 / num_iterations, (double)cpe_ns / 1e3 / num_iterations,
+           (double)derot_ns / 1e3 / num_iterations);
+    printf("  RX accuracy: max CPE error %.4f rad, max derotated RE error %d\n", max_phase_err, max_re_err);
+
+    nr_scratch_end(&scratch);
+    printf("=== NR PTRS tests completed ===\n");
+}
@@ -18,6 +18,12 @@ extern void init_byte2m128i(void);
 /* CRC table initialization needed before using check_crc */
 extern void crcTableInit(void);
 
+/* OAI soft demappers, the reference of the nr_llr kernels */
+extern void nr_qpsk_llr(int32_t *rxdataF_comp, int16_t *llr, uint32_t nb_re);
+extern void nr_16qam_llr(int32_t *rxdataF_comp, c16_t *ch_mag_in, int16_t *llr, uint32_t nb_re);
+extern void nr_64qam_llr(int32_t *rxdataF_comp, c16_t *ch_mag, c16_t *ch_mag2, int16_t *llr, uint32_t nb_re);
+extern void nr_256qam_llr(int32_t *rxdataF_comp, c16_t *ch_mag, c16_t *ch_mag2, c16_t *ch_mag3, int16_t *llr, uint32_t nb_re);
+
 #define POLY 0x1864CFB
 #define INIT 0xB704CE
 #define N 40976
@@ -34,12 +40,34 @@ void nr_layermapping();
 void nr_ldpc();
 void nr_precoding();
 void nr_modulation_test();
+void nr_tb_encode_test();
+void nr_rate_matching_test();
+void nr_crc_fold_test();
+void nr_crc_multi_test();
+void nr_gold_cache_test();
+void nr_gold_leap_test();
+void nr_layermapping_mimo_test();
+void nr_scramble_mod_test();
+void nr_harq_combining_test();
+void nr_harq_compress_test();
+void nr_llr_fused_test();
+void nr_layer_demap_simd_test();
+void nr_llr_simd_test();
+void nr_mmse_llr_test();
+void nr_dft_plan_test();
+void nr_ofdm_batch_test();
+void nr_slot_fep_batch_test();
+void nr_fft_test();
+void nr_fft_pruned_test();
+void nr_re_mapping_test();
+void nr_ptrs_test();
 //
 void nr_ofdm_demo();
 void nr_ch_estimation();
 void nr_descrambling();
 void nr_layer_demapping_test();
 void nr_crc_check();
+void nr_ldpc_dec_crc_test();
 void nr_soft_demod();
 void nr_mmse_eq();
 void nr_ldpc_dec();
@@ -8,8 +8,20 @@ static void dispatch(const char *fn)
     if (!strcmp(fn, "nr_scramble"))     { nr_scramble(); return; }
     if (!strcmp(fn, "nr_modulation"))   { nr_modulation_test(); return; }
     if (!strcmp(fn, "nr_layermapping")) { nr_layermapping(); return; }
+    if (!strcmp(fn, "nr_layermapping_mimo")) { nr_layermapping_mimo_test(); return; }
     if (!strcmp(fn, "nr_precoding"))    { nr_precoding(); return; }
     if (!strcmp(fn, "nr_ofdm_mod"))     { nr_ofdm_modulation(); return; }
+    if (!strcmp(fn, "nr_tb_encode"))    { nr_tb_encode_test(); return; }
+    if (!strcmp(fn, "nr_rate_matching")) { nr_rate_matching_test(); return; }
+    if (!strcmp(fn, "nr_crc_fold"))     { nr_crc_fold_test(); return; }
+    if (!strcmp(fn, "nr_crc_multi"))    { nr_crc_multi_test(); return; }
+    if (!strcmp(fn, "nr_gold_cache"))   { nr_gold_cache_test(); return; }
+    if (!strcmp(fn, "nr_gold_leap"))    { nr_gold_leap_test(); return; }
+    if (!strcmp(fn, "nr_scramble_mod")) { nr_scramble_mod_test(); return; }
+    if (!strcmp(fn, "nr_dft_plan"))     { nr_dft_plan_test(); return; }
+    if (!strcmp(fn, "nr_ofdm_batch"))   { nr_ofdm_batch_test(); return; }
+    if (!strcmp(fn, "nr_fft"))          { nr_fft_test(); return; }
+    if (!strcmp(fn, "nr_fft_pruned"))   { nr_fft_pruned_test(); return; }
 
     /* UE side */
     if (!strcmp(fn, "nr_ofdm_demo"))        { nr_ofdm_demo(); return; }
@@ -20,6 +32,16 @@ static void dispatch(const char *fn)
     if (!strcmp(fn, "nr_descrambling"))     { nr_descrambling(); return; }
     if (!strcmp(fn, "nr_ldpc_dec"))         { nr_ldpc_dec(); return; }
     if (!strcmp(fn, "nr_crc_check"))        { nr_crc_check(); return; }
+    if (!strcmp(fn, "nr_ldpc_dec_crc"))     { nr_ldpc_dec_crc_test(); return; }
+    if (!strcmp(fn, "nr_harq_combining"))   { nr_harq_combining_test(); return; }
+    if (!strcmp(fn, "nr_harq_compress"))    { nr_harq_compress_test(); return; }
+    if (!strcmp(fn, "nr_llr_fused"))        { nr_llr_fused_test(); return; }
+    if (!strcmp(fn, "nr_layer_demap_simd")) { nr_layer_demap_simd_test(); return; }
+    if (!strcmp(fn, "nr_llr_simd"))         { nr_llr_simd_test(); return; }
+    if (!strcmp(fn, "nr_mmse_llr"))         { nr_mmse_llr_test(); return; }
+    if (!strcmp(fn, "nr_slot_fep_batch"))   { nr_slot_fep_batch_test(); return; }
+    if (!strcmp(fn, "nr_re_mapping"))       { nr_re_mapping_test(); return; }
+    if (!strcmp(fn, "nr_ptrs"))             { nr_ptrs_test(); return; }
 
     printf("Unknown function '%s'.\n", fn);
 }
@@ -0,0 +1,124 @@
+/*
+ * Per-thread slot arena: one anonymous mapping per thread, bump allocation,
+ * reset once per slot.
+ */
+
+#include "nr_arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+nr_arena_t *nr_arena_create(size_t size)
+{
+    nr_arena_t *a = calloc(1, sizeof(*a));
+    if (!a) return NULL;
+
+    /* Address space only: pages are backed when first written */
+    size = (size + 4095) & ~(size_t)4095;
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) {
+        printf("nr_arena_create: cannot reserve %zu bytes\n", size);
+        free(a);
+        return NULL;
+    }
+    a->base = p;
+    a->size = size;
+    return a;
+}
+
+void nr_arena_destroy(nr_arena_t *a)
+{
+    if (!a) return;
+    munmap(a->base, a->size);
+    free(a);
+}
+
+static pthread_key_t arena_key;
+static pthread_once_t arena_once = PTHREAD_ONCE_INIT;
+static __thread nr_arena_t *thread_arena;
+
+static void arena_thread_exit(void *a)
+{
+    nr_arena_destroy(a);
+}
+
+static void arena_key_init(void)
+{
+    pthread_key_create(&arena_key, arena_thread_exit);
+}
+
+nr_arena_t *nr_arena_thread(void)
+{
+    if (thread_arena) return thread_arena;
+
+    pthread_once(&arena_once, arena_key_init);
+    size_t mb = NR_ARENA_DEFAULT_MB;
+    const char *s = getenv("OAI_ARENA_MB");
+    if (s && atoi(s) > 0) mb = (size_t)atoi(s);
+    thread_arena = nr_arena_create(mb << 20);
+    if (thread_arena) pthread_setspecific(arena_key, thread_arena);
+    return thread_arena;
+}
+
+void *nr_arena_alloc(nr_arena_t *a, size_t bytes)
+{
+    const size_t need = (bytes + NR_ARENA_ALIGN - 1) & ~(size_t)(NR_ARENA_ALIGN - 1);
+    if (need > a->size - a->used) {
+        printf("nr_arena_alloc: %zu bytes requested, %zu of %zu left\n", bytes, a->size - a->used, a->size);
+        return NULL;
+    }
+    void *p = a->base + a->used;
+    a->used += need;
+    if (a->used > a->peak) a->peak = a->used;
+    return p;
+}
+
+void *nr_arena_calloc(nr_arena_t *a, size_t n, size_t size)
+{
+    void *p = nr_arena_alloc(a, n * size);
+    if (p) memset(p, 0, n * size);
+    return p;
+}
+
+void nr_scratch_begin(nr_scratch_t *s)
+{
+    s->arena = nr_arena_thread();
+    s->mark = s->arena ? nr_arena_mark(s->arena) : 0;
+    s->heap = NULL;
+}
+
+void *nr_scratch_alloc(nr_scratch_t *s, size_t bytes)
+{
+    const size_t need = (bytes + NR_ARENA_ALIGN - 1) & ~(size_t)(NR_ARENA_ALIGN - 1);
+    nr_arena_t *a = s->arena;
+    if (a && need <= a->size - a->used) return nr_arena_alloc(a, bytes);
+
+    /* One aligned header in front of the buffer links it for nr_scratch_end() */
+    char *h = aligned_alloc(NR_ARENA_ALIGN, NR_ARENA_ALIGN + (need ? need : NR_ARENA_ALIGN));
+    if (!h) {
+        fprintf(stderr, "nr_scratch_alloc: %zu bytes, no room in the arena and none on the heap\n", bytes);
+        abort();
+    }
+    *(void **)h = s->heap;
+    s->heap = h;
+    return h + NR_ARENA_ALIGN;
+}
+
+void *nr_scratch_calloc(nr_scratch_t *s, size_t n, size_t size)
+{
+    void *p = nr_scratch_alloc(s, n * size);
+    memset(p, 0, n * size);
+    return p;
+}
+
+void nr_scratch_end(nr_scratch_t *s)
+{
+    if (s->arena) nr_arena_release(s->arena, s->mark);
+    while (s->heap) {
+        void *next = *(void **)s->heap;
+        free(s->heap);
+        s->heap = next;
+    }
+}
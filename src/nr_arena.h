@@ -0,0 +1,92 @@
+#ifndef NR_ARENA_H
+#define NR_ARENA_H
+
+#include <stddef.h>
+
+/* Per-thread bump allocator for kernel buffers. Each thread owns one arena,
+ * a single reserved mapping whose pages are faulted in the first time a slot
+ * reaches them and then stay: allocation is a 64-byte aligned pointer bump,
+ * there is no free, and nr_arena_reset() once per slot takes every scratch
+ * buffer of the slot back at once. After the first slot the steady state
+ * neither calls malloc nor takes page faults.
+ *
+ * Buffers that outlive a slot (kernel contexts) are allocated first and then
+ * pinned: nr_arena_reset() goes back to the pin, not to the start. Short
+ * scratch inside a kernel is scoped with nr_scratch_begin() /
+ * nr_scratch_end(), a mark and release like a stack frame. */
+
+#define NR_ARENA_ALIGN 64
+
+/* Reserved size of a thread arena: OAI_ARENA_MB, 256 MB by default */
+#define NR_ARENA_DEFAULT_MB 256
+
+typedef struct nr_arena_s {
+    char *base;
+    size_t size;     /* reserved bytes */
+    size_t used;     /* bump offset */
+    size_t pinned;   /* offset nr_arena_reset() goes back to */
+    size_t peak;     /* largest used so far, the pages touched */
+} nr_arena_t;
+
+/* Arena reserving size bytes, NULL when the mapping fails */
+nr_arena_t *nr_arena_create(size_t size);
+void nr_arena_destroy(nr_arena_t *a);
+
+/* Arena of the calling thread, created on first use and destroyed when the
+ * thread exits. NULL when it cannot be created. */
+nr_arena_t *nr_arena_thread(void);
+
+/* bytes rounded up to NR_ARENA_ALIGN, NULL (and a message) when the arena is
+ * full. The memory is not cleared. */
+void *nr_arena_alloc(nr_arena_t *a, size_t bytes);
+
+/* nr_arena_alloc() of n * size bytes, cleared */
+void *nr_arena_calloc(nr_arena_t *a, size_t n, size_t size);
+
+static inline size_t nr_arena_mark(const nr_arena_t *a)
+{
+    return a->used;
+}
+
+/* Frees everything allocated since mark, pinned buffers included */
+static inline void nr_arena_release(nr_arena_t *a, size_t mark)
+{
+    a->used = mark;
+    if (a->pinned > mark) a->pinned = mark;
+}
+
+/* Keeps what is allocated so far across nr_arena_reset() */
+static inline void nr_arena_pin(nr_arena_t *a)
+{
+    a->pinned = a->used;
+}
+
+/* Start of a slot: frees the scratch of the previous one */
+static inline void nr_arena_reset(nr_arena_t *a)
+{
+    a->used = a->pinned;
+}
+
+/* Scratch of one call, the way every arena user gets its buffers: they come
+ * from the thread arena above a mark, and from the heap when there is no
+ * arena or it has no room left. nr_scratch_end() gives both back. Running
+ * out of heap as well is fatal (message and abort), so callers never see
+ * NULL and have no failure path of their own. */
+typedef struct {
+    nr_arena_t *arena;  /* NULL: heap only */
+    size_t mark;
+    void *heap;         /* heap fallbacks, chained through their header */
+} nr_scratch_t;
+
+void nr_scratch_begin(nr_scratch_t *s);
+
+/* bytes, NR_ARENA_ALIGN aligned and not cleared; never NULL */
+void *nr_scratch_alloc(nr_scratch_t *s, size_t bytes);
+
+/* nr_scratch_alloc() of n * size bytes, cleared */
+void *nr_scratch_calloc(nr_scratch_t *s, size_t n, size_t size);
+
+/* Frees everything allocated since nr_scratch_begin() */
+void nr_scratch_end(nr_scratch_t *s);
+
+#endif
@@ -0,0 +1,391 @@
+/*
+ * Carry-less multiply folding CRC for the NR polynomials.
+ *
+ * Every CRC of degree d is computed as a 32-bit CRC over P' = P * x^(32-d),
+ * whose remainder is the d-bit CRC left-aligned in 32 bits, i.e. the OAI
+ * crc24a()/crc16()/... return value. 16-byte blocks are folded four at a time
+ * (x^512, x^576) then one at a time (x^128, x^192), the 128-bit state is
+ * reduced to 64 bits (x^96, x^64) and to the CRC with a Barrett step. The
+ * bytes and bits after the last full block use the byte table.
+ */
+
+#include "nr_crc_fold.h"
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <immintrin.h>
+
+typedef struct {
+    uint32_t poly;        /* P' without its x^32 term */
+    int len;
+    uint64_t k512, k576;  /* x^512, x^576 mod P' */
+    uint64_t k128, k192;  /* x^128, x^192 mod P' */
+    uint64_t k64, k96;    /* x^64, x^96 mod P' */
+    uint64_t mu;          /* floor(x^64 / P') */
+    uint32_t table[256];  /* byte table, same content as OAI crcTableInit */
+} crc_fold_consts_t;
+
+static crc_fold_consts_t crc_consts[NR_CRC_TYPES];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+static int crc_use_clmul;
+
+/* Left-aligned generators as in OAI crc_byte.c (including its crc11 one) */
+static const struct { uint32_t poly; int len; } crc_defs[NR_CRC_TYPES] = {
+    [NR_CRC_24A] = { 0x864CFB00, 24 },
+    [NR_CRC_24B] = { 0x80006300, 24 },
+    [NR_CRC_24C] = { 0xB2B11700, 24 },
+    [NR_CRC_16]  = { 0x10210000, 16 },
+    [NR_CRC_11]  = { 0xE2100000, 11 },
+    [NR_CRC_6]   = { 0x84000000,  6 },
+};
+
+/* x^n mod P' (P' = x^32 + poly) */
+static uint64_t xpow_mod(uint32_t poly, int n)
+{
+    uint64_t r = 1;
+    for (int i = 0; i < n; i++) {
+        r <<= 1;
+        if (r >> 32) r = (r & 0xFFFFFFFFu) ^ poly;
+    }
+    return r;
+}
+
+/* floor(x^64 / P'), a degree-32 polynomial */
+static uint64_t barrett_mu(uint32_t poly)
+{
+    const unsigned __int128 P = ((unsigned __int128)1 << 32) | poly;
+    unsigned __int128 rem = (unsigned __int128)1 << 64;
+    uint64_t q = 0;
+    for (int i = 64; i >= 32; i--) {
+        if ((rem >> i) & 1) {
+            rem ^= P << (i - 32);
+            q |= 1ull << (i - 32);
+        }
+    }
+    return q;
+}
+
+static void crc_fold_build(void)
+{
+    for (int t = 0; t < NR_CRC_TYPES; t++) {
+        crc_fold_consts_t *c = &crc_consts[t];
+        c->len = crc_defs[t].len;
+        c->poly = crc_defs[t].poly;
+        c->k512 = xpow_mod(c->poly, 512);
+        c->k576 = xpow_mod(c->poly, 576);
+        c->k128 = xpow_mod(c->poly, 128);
+        c->k192 = xpow_mod(c->poly, 192);
+        c->k64 = xpow_mod(c->poly, 64);
+        c->k96 = xpow_mod(c->poly, 96);
+        c->mu = barrett_mu(c->poly);
+
+        for (int b = 0; b < 256; b++) {
+            uint32_t crc = (uint32_t)b << 24;
+            for (int i = 0; i < 8; i++)
+                crc = (crc & 0x80000000u) ? (crc << 1) ^ c->poly : crc << 1;
+            c->table[b] = crc;
+        }
+    }
+
+    __builtin_cpu_init();
+    crc_use_clmul = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+}
+
+void nr_crc_fold_init(void)
+{
+    pthread_once(&crc_once, crc_fold_build);
+}
+
+int nr_crc_fold_accelerated(void)
+{
+    nr_crc_fold_init();
+    return crc_use_clmul;
+}
+
+int nr_crc_len(nr_crc_type_t type)
+{
+    return crc_defs[type].len;
+}
+
+/* Continue crc over nbytes whole bytes then rbits (< 8) bits of in */
+static inline uint32_t crc_table_tail(const crc_fold_consts_t *c, uint32_t crc, const uint8_t *in,
+                                      uint32_t nbytes, int rbits)
+{
+    for (uint32_t i = 0; i < nbytes; i++)
+        crc = (crc << 8) ^ c->table[in[i] ^ (crc >> 24)];
+    if (rbits > 0)
+        crc = (crc << rbits) ^ c->table[(in[nbytes] >> (8 - rbits)) ^ (crc >> (32 - rbits))];
+    return crc;
+}
+
+/* Same over nb buffers, bytes [off, off + nbytes) then rbits bits */
+static inline void crc_table_tail_multi(const crc_fold_consts_t *c, uint32_t *crc, const uint8_t *const *in, int nb,
+                                        uint32_t off, uint32_t nbytes, int rbits)
+{
+    for (uint32_t i = off; i < off + nbytes; i++)
+        for (int l = 0; l < nb; l++)
+            crc[l] = (crc[l] << 8) ^ c->table[in[l][i] ^ (crc[l] >> 24)];
+    if (rbits > 0)
+        for (int l = 0; l < nb; l++)
+            crc[l] = (crc[l] << rbits) ^ c->table[(in[l][off + nbytes] >> (8 - rbits)) ^ (crc[l] >> (32 - rbits))];
+}
+
+/* nbits bits MSB-first at bit pos */
+static uint32_t crc_get_bits(const uint8_t *in, uint32_t pos, int nbits)
+{
+    uint32_t v = 0;
+    for (uint32_t i = pos; i < pos + nbits; i++)
+        v = (v << 1) | ((in[i >> 3] >> (7 - (i & 7))) & 1);
+    return v;
+}
+
+static void crc_put_bits(uint8_t *out, uint32_t pos, uint32_t v, int nbits)
+{
+    for (int k = 0; k < nbits; k++) {
+        const uint32_t i = pos + k;
+        const uint8_t m = (uint8_t)(0x80 >> (i & 7));
+        if ((v >> (nbits - 1 - k)) & 1)
+            out[i >> 3] |= m;
+        else
+            out[i >> 3] &= (uint8_t)~m;
+    }
+}
+
+uint32_t nr_crc_table(nr_crc_type_t type, const uint8_t *in, uint32_t bitlen)
+{
+    nr_crc_fold_init();
+    return crc_table_tail(&crc_consts[type], 0, in, bitlen >> 3, bitlen & 7);
+}
+
+#define LOAD_BLOCK(p, i) _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)((p) + 16 * (i))), bswap)
+#define FOLD(s, k) _mm_xor_si128(_mm_clmulepi64_si128((s), (k), 0x11), _mm_clmulepi64_si128((s), (k), 0x00))
+
+/* CRC of the message whose folded 128-bit state is s */
+__attribute__((target("pclmul,sse4.1")))
+static inline uint32_t crc_fold_reduce(const crc_fold_consts_t *c, __m128i s)
+{
+    /* S * x^32 mod P': the high half goes through x^96, the low half is
+     * shifted by 32, then bits 64..95 go through x^64 */
+    const __m128i kred = _mm_set_epi64x(0, (long long)c->k96);
+    const __m128i k64 = _mm_set_epi64x(0, (long long)c->k64);
+    __m128i u = _mm_xor_si128(_mm_clmulepi64_si128(s, kred, 0x01), _mm_slli_si128(_mm_move_epi64(s), 4));
+    __m128i v = _mm_xor_si128(_mm_clmulepi64_si128(u, k64, 0x01), _mm_move_epi64(u));
+
+    /* Barrett: q = ((V >> 32) * mu) >> 32, crc = V ^ q * P' */
+    const __m128i mu = _mm_set_epi64x(0, (long long)c->mu);
+    const __m128i P = _mm_set_epi64x(0, (long long)((1ull << 32) | c->poly));
+    __m128i t = _mm_clmulepi64_si128(_mm_srli_epi64(v, 32), mu, 0x00);
+    t = _mm_clmulepi64_si128(_mm_srli_epi64(t, 32), P, 0x00);
+    return (uint32_t)_mm_cvtsi128_si32(_mm_xor_si128(v, t));
+}
+
+/* Fold nblocks >= 1 whole 16-byte blocks into the state s of the blocks
+ * before them (zero for a new message) */
+__attribute__((target("pclmul,sse4.1")))
+static __m128i crc_fold_continue(const crc_fold_consts_t *c, __m128i s, const uint8_t *in, uint32_t nblocks)
+{
+    /* First message byte becomes the most significant byte of the lane */
+    const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m128i k128 = _mm_set_epi64x((long long)c->k192, (long long)c->k128);
+    uint32_t b = 0;
+
+    if (nblocks >= 8) {
+        /* Four independent chains hide the multiply latency */
+        const __m128i k512 = _mm_set_epi64x((long long)c->k576, (long long)c->k512);
+        __m128i s0 = _mm_xor_si128(FOLD(s, k128), LOAD_BLOCK(in, 0));
+        __m128i s1 = LOAD_BLOCK(in, 1), s2 = LOAD_BLOCK(in, 2), s3 = LOAD_BLOCK(in, 3);
+        for (b = 4; b + 4 <= nblocks; b += 4) {
+            s0 = _mm_xor_si128(FOLD(s0, k512), LOAD_BLOCK(in, b + 0));
+            s1 = _mm_xor_si128(FOLD(s1, k512), LOAD_BLOCK(in, b + 1));
+            s2 = _mm_xor_si128(FOLD(s2, k512), LOAD_BLOCK(in, b + 2));
+            s3 = _mm_xor_si128(FOLD(s3, k512), LOAD_BLOCK(in, b + 3));
+        }
+        s = _mm_xor_si128(FOLD(s0, k128), s1);
+        s = _mm_xor_si128(FOLD(s, k128), s2);
+        s = _mm_xor_si128(FOLD(s, k128), s3);
+    }
+    for (; b < nblocks; b++)
+        s = _mm_xor_si128(FOLD(s, k128), LOAD_BLOCK(in, b));
+    return s;
+}
+
+/* CRC (init 0) of nblocks >= 1 whole 16-byte blocks */
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc_fold_blocks(const crc_fold_consts_t *c, const uint8_t *in, uint32_t nblocks)
+{
+    return crc_fold_reduce(c, crc_fold_continue(c, _mm_setzero_si128(), in, nblocks));
+}
+
+/* Streaming helpers: the folded state lives in nr_crc_stream_t as two words */
+__attribute__((target("pclmul,sse4.1")))
+static void crc_fold_stream_blocks(const crc_fold_consts_t *c, uint64_t *state, const uint8_t *in, uint32_t nblocks)
+{
+    __m128i s = _mm_loadu_si128((const __m128i *)state);
+    _mm_storeu_si128((__m128i *)state, crc_fold_continue(c, s, in, nblocks));
+}
+
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc_fold_stream_reduce(const crc_fold_consts_t *c, const uint64_t *state)
+{
+    return crc_fold_reduce(c, _mm_loadu_si128((const __m128i *)state));
+}
+
+/* Same for nb buffers of the same length, one fold chain per buffer: the
+ * chains are independent, so nb of them keep the multiplier busy */
+__attribute__((target("pclmul,sse4.1")))
+static void crc_fold_blocks_multi(const crc_fold_consts_t *c, const uint8_t *const *in, int nb,
+                                  uint32_t nblocks, uint32_t *crc)
+{
+    const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m128i k128 = _mm_set_epi64x((long long)c->k192, (long long)c->k128);
+    __m128i s[NR_CRC_MAX_LANES];
+
+    for (int l = 0; l < nb; l++)
+        s[l] = LOAD_BLOCK(in[l], 0);
+    for (uint32_t b = 1; b < nblocks; b++)
+        for (int l = 0; l < nb; l++)
+            s[l] = _mm_xor_si128(FOLD(s[l], k128), LOAD_BLOCK(in[l], b));
+    for (int l = 0; l < nb; l++)
+        crc[l] = crc_fold_reduce(c, s[l]);
+}
+
+#undef LOAD_BLOCK
+#undef FOLD
+
+uint32_t nr_crc_fold(nr_crc_type_t type, const uint8_t *in, uint32_t bitlen)
+{
+    nr_crc_fold_init();
+    const crc_fold_consts_t *c = &crc_consts[type];
+    const uint32_t nbytes = bitlen >> 3;
+    const uint32_t nblocks = crc_use_clmul ? nbytes >> 4 : 0;
+
+    uint32_t crc = nblocks ? crc_fold_blocks(c, in, nblocks) : 0;
+    return crc_table_tail(c, crc, in + 16 * nblocks, nbytes - 16 * nblocks, bitlen & 7);
+}
+
+int nr_crc_fold_check(nr_crc_type_t type, const uint8_t *in, uint32_t n)
+{
+    const int L = nr_crc_len(type);
+    if (n <= (uint32_t)L) return 0;
+
+    const uint32_t crc = nr_crc_fold(type, in, n - L) >> (32 - L);
+    return crc == crc_get_bits(in, n - L, L);
+}
+
+int nr_crc_fold_multi(nr_crc_type_t type, const uint8_t *const *in, int nb, uint32_t bitlen, uint32_t *crc)
+{
+    if (nb < 1 || nb > NR_CRC_MAX_LANES) return -1;
+
+    nr_crc_fold_init();
+    const crc_fold_consts_t *c = &crc_consts[type];
+    const uint32_t nbytes = bitlen >> 3;
+    const uint32_t nblocks = crc_use_clmul ? nbytes >> 4 : 0;
+
+    if (nblocks)
+        crc_fold_blocks_multi(c, in, nb, nblocks, crc);
+    else
+        memset(crc, 0, nb * sizeof(*crc));
+    crc_table_tail_multi(c, crc, in, nb, 16 * nblocks, nbytes - 16 * nblocks, bitlen & 7);
+    return 0;
+}
+
+int nr_crc_fold_attach_multi(nr_crc_type_t type, uint8_t *const *buf, int nb, uint32_t bitlen)
+{
+    uint32_t crc[NR_CRC_MAX_LANES];
+    if (nr_crc_fold_multi(type, (const uint8_t *const *)buf, nb, bitlen, crc) < 0) return -1;
+
+    const int L = nr_crc_len(type);
+    for (int l = 0; l < nb; l++)
+        crc_put_bits(buf[l], bitlen, crc[l] >> (32 - L), L);
+    return 0;
+}
+
+int nr_crc_fold_check_multi(nr_crc_type_t type, const uint8_t *const *in, int nb, uint32_t n, uint8_t *ok)
+{
+    const int L = nr_crc_len(type);
+    uint32_t crc[NR_CRC_MAX_LANES];
+    if (n <= (uint32_t)L || nr_crc_fold_multi(type, in, nb, n - L, crc) < 0) return -1;
+
+    int nb_ok = 0;
+    for (int l = 0; l < nb; l++) {
+        ok[l] = (crc[l] >> (32 - L)) == crc_get_bits(in[l], n - L, L);
+        nb_ok += ok[l];
+    }
+    return nb_ok;
+}
+
+void nr_crc_stream_init(nr_crc_stream_t *st, nr_crc_type_t type)
+{
+    nr_crc_fold_init();
+    memset(st, 0, sizeof(*st));
+    st->type = type;
+}
+
+int nr_crc_stream_update(nr_crc_stream_t *st, const uint8_t *in, uint32_t bitlen)
+{
+    if (st->rbits) {
+        printf("nr_crc_stream_update: update after a chunk ending inside a byte\n");
+        return -1;
+    }
+
+    const crc_fold_consts_t *c = &crc_consts[st->type];
+    uint32_t nbytes = bitlen >> 3;
+    st->rbits = bitlen & 7;
+    st->bitlen += bitlen;
+
+    if (!crc_use_clmul) {
+        st->crc = crc_table_tail(c, st->crc, in, nbytes, st->rbits);
+        return 0;
+    }
+
+    /* Complete the pending block first */
+    if (st->npend) {
+        const uint32_t n = (16 - st->npend) < nbytes ? 16 - st->npend : nbytes;
+        memcpy(st->pend + st->npend, in, n);
+        st->npend += n;
+        in += n;
+        nbytes -= n;
+        if (st->npend < 16) goto keep_tail;
+        crc_fold_stream_blocks(c, st->fold, st->pend, 1);
+        st->npend = 0;
+    }
+
+    const uint32_t nblocks = nbytes >> 4;
+    if (nblocks) {
+        crc_fold_stream_blocks(c, st->fold, in, nblocks);
+        in += 16 * nblocks;
+        nbytes -= 16 * nblocks;
+    }
+    memcpy(st->pend, in, nbytes);
+    st->npend = nbytes;
+
+keep_tail:
+    /* The byte holding the last rbits bits is kept after the pending bytes */
+    if (st->rbits) st->pend[st->npend] = in[nbytes];
+    return 0;
+}
+
+uint32_t nr_crc_stream_final(const nr_crc_stream_t *st)
+{
+    const crc_fold_consts_t *c = &crc_consts[st->type];
+    if (!crc_use_clmul) return st->crc;
+
+    const int full = (st->bitlen >> 3) >= 16;
+    const uint32_t crc = full ? crc_fold_stream_reduce(c, st->fold) : 0;
+    return crc_table_tail(c, crc, st->pend, st->npend, st->rbits);
+}
+
+int nr_crc_fold_check_crc(uint8_t *decoded_bytes, uint32_t n, uint8_t crc_type)
+{
+    const int type = nr_crc_from_oai(crc_type);
+    if (type < 0) return 0;
+    return nr_crc_fold_check((nr_crc_type_t)type, decoded_bytes, n);
+}
+
+int nr_crc_from_oai(int crc_type)
+{
+    /* CRC24_A 0, CRC24_B 1, CRC16 2, CRC8 3, CRC11 4, CRC6 5 (coding_defs.h) */
+    static const int map[] = { NR_CRC_24A, NR_CRC_24B, NR_CRC_16, -1, NR_CRC_11, NR_CRC_6 };
+    if (crc_type < 0 || crc_type >= (int)(sizeof(map) / sizeof(map[0]))) return -1;
+    return map[crc_type];
+}
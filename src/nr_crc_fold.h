@@ -0,0 +1,85 @@
+#ifndef NR_CRC_FOLD_H
+#define NR_CRC_FOLD_H
+
+#include <stdint.h>
+
+/* NR CRCs (38.212 5.1) computed by folding 16-byte blocks with carry-less
+ * multiplies (PCLMULQDQ), the last partial block and the trailing bits going
+ * through the usual byte table.
+ *
+ * Results use the OAI layout: the CRC is left-aligned in the 32-bit return
+ * value (crc24a() and friends), so nr_crc_fold(NR_CRC_24A, in, n) == crc24a(in, n)
+ * for any bit length n. Input is MSB-first. Without PCLMULQDQ the whole
+ * buffer takes the table path. */
+
+typedef enum {
+    NR_CRC_24A = 0,   /* 0x1864CFB */
+    NR_CRC_24B,       /* 0x1800063 */
+    NR_CRC_24C,       /* 0x1B2B117 */
+    NR_CRC_16,        /* 0x11021 */
+    NR_CRC_11,        /* 0xE21, left-aligned as OAI does (0xE2100000) */
+    NR_CRC_6,         /* 0x61 */
+    NR_CRC_TYPES
+} nr_crc_type_t;
+
+/* Build the fold constants and byte tables; called lazily by the functions below */
+void nr_crc_fold_init(void);
+
+/* CRC length in bits */
+int nr_crc_len(nr_crc_type_t type);
+
+/* CRC of the first bitlen bits of in, left-aligned */
+uint32_t nr_crc_fold(nr_crc_type_t type, const uint8_t *in, uint32_t bitlen);
+
+/* Table-only reference of nr_crc_fold */
+uint32_t nr_crc_table(nr_crc_type_t type, const uint8_t *in, uint32_t bitlen);
+
+/* 1 when the last nr_crc_len(type) bits of the n-bit block in are the CRC of
+ * the bits before them, 0 otherwise (same contract as check_crc) */
+int nr_crc_fold_check(nr_crc_type_t type, const uint8_t *in, uint32_t n);
+
+/* Multi-buffer variants: nb (1..NR_CRC_MAX_LANES) independent buffers of the
+ * same bit length are processed in interleaved lanes, which hides the latency
+ * of the per-buffer dependency chain (e.g. the CRC24B of the code blocks of a
+ * TB). They return -1 when nb is out of range. */
+#define NR_CRC_MAX_LANES 16
+
+/* crc[l] = nr_crc_fold(type, in[l], bitlen) */
+int nr_crc_fold_multi(nr_crc_type_t type, const uint8_t *const *in, int nb, uint32_t bitlen, uint32_t *crc);
+
+/* Write the CRC of the first bitlen bits of buf[l] at bit bitlen, MSB-first */
+int nr_crc_fold_attach_multi(nr_crc_type_t type, uint8_t *const *buf, int nb, uint32_t bitlen);
+
+/* ok[l] = nr_crc_fold_check(type, in[l], n). Returns the number of valid buffers. */
+int nr_crc_fold_check_multi(nr_crc_type_t type, const uint8_t *const *in, int nb, uint32_t n, uint8_t *ok);
+
+/* Streaming CRC over a message delivered in chunks, e.g. as the decoder
+ * produces hard bits. Every chunk but the last must be a whole number of
+ * bytes; the result equals nr_crc_fold() over the concatenation. */
+typedef struct nr_crc_stream_s {
+    nr_crc_type_t type;
+    uint64_t fold[2];         /* folded state of the whole 16-byte blocks so far */
+    uint8_t pend[17];         /* bytes of the incomplete block, then the partial byte */
+    uint32_t npend;
+    uint32_t bitlen;          /* bits consumed so far */
+    int rbits;                /* bits of the partial byte, 0 while open */
+    uint32_t crc;             /* running CRC without PCLMULQDQ */
+} nr_crc_stream_t;
+
+void nr_crc_stream_init(nr_crc_stream_t *st, nr_crc_type_t type);
+/* Returns 0, or -1 when the previous chunk ended inside a byte */
+int nr_crc_stream_update(nr_crc_stream_t *st, const uint8_t *in, uint32_t bitlen);
+/* Left-aligned CRC of everything consumed so far */
+uint32_t nr_crc_stream_final(const nr_crc_stream_t *st);
+
+/* nr_crc_type_t of an OAI crc_type (CRC24_A, CRC24_B, ...), -1 if unsupported */
+int nr_crc_from_oai(int crc_type);
+
+/* Drop-in for the OAI check_crc() callback of the LDPC decoder parameters;
+ * the decoder recognises it and computes the CRC while producing hard bits */
+int nr_crc_fold_check_crc(uint8_t *decoded_bytes, uint32_t n, uint8_t crc_type);
+
+/* 1 when the carry-less multiply path is in use */
+int nr_crc_fold_accelerated(void);
+
+#endif
@@ -0,0 +1,183 @@
+/*
+ * DFT / IDFT plan cache over libdfts, loaded once per process, and the
+ * in-tree FFT of nr_fft.h.
+ */
+
+#include "nr_dft_plan.h"
+#include "nr_fft.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include "PHY/TOOLS/tools_defs.h"
+
+/* libdfts of the OAI build tree, set by CMake */
+#ifndef NR_DFTS_LIB
+#define NR_DFTS_LIB "libdfts.so"
+#endif
+
+static const int dft_sizes[NR_DFT_NB_SIZES] = {128, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192};
+
+static pthread_once_t dft_once = PTHREAD_ONCE_INIT;
+static void *dft_handle;
+static int dft_available[NR_DFT_NB_BACKENDS];
+static int dft_default = -1;
+static nr_dft_plan_t dft_plans[NR_DFT_NB_BACKENDS][NR_DFT_NB_SIZES][2];
+
+/* Built-in backend: FFT plan of each size, found from the get_dft() /
+ * get_idft() index the nr_dft_fn signature carries */
+static nr_fft_t *dft_fft[NR_DFT_NB_SIZES];
+static nr_fft_t *dft_fft_of_idx[256];
+static nr_fft_t *idft_fft_of_idx[256];
+
+static void builtin_dft(uint8_t sizeidx, int16_t *in, int16_t *out, unsigned char scale_flag)
+{
+    nr_fft_int16(dft_fft_of_idx[sizeidx], in, out, 0, scale_flag);
+}
+
+static void builtin_idft(uint8_t sizeidx, int16_t *in, int16_t *out, unsigned char scale_flag)
+{
+    nr_fft_int16(idft_fft_of_idx[sizeidx], in, out, 1, scale_flag);
+}
+
+static void dft_fill_plans(int backend, nr_dft_fn dft_fn, nr_dft_fn idft_fn, nr_fft_t *const *fft)
+{
+    for (int s = 0; s < NR_DFT_NB_SIZES; s++)
+        for (int scale = 0; scale < 2; scale++) {
+            nr_dft_plan_t *p = &dft_plans[backend][s][scale];
+            p->size = dft_sizes[s];
+            p->scale = (unsigned char)scale;
+            p->dft_idx = (uint8_t)get_dft(dft_sizes[s]);
+            p->idft_idx = (uint8_t)get_idft(dft_sizes[s]);
+            p->backend = backend;
+            p->dft = dft_fn;
+            p->idft = idft_fn;
+            p->fft = fft ? fft[s] : NULL;
+        }
+    dft_available[backend] = 1;
+}
+
+static void dft_load_libdfts(void)
+{
+    const char *path = getenv("OAI_DFTS_LIB");
+    if (!path || !*path) path = NR_DFTS_LIB;
+
+    dft_handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!dft_handle)
+        dft_handle = dlopen("libdfts.so", RTLD_NOW | RTLD_LOCAL);
+    if (!dft_handle) {
+        printf("nr_dft_plan_init: dlopen failed (%s)\n", dlerror());
+        return;
+    }
+
+    /* dfts_autoinit() fills the twiddle / radix tables, load_module_shlib()
+     * runs it before OAI uses the library */
+    int (*autoinit)(void) = (int (*)(void))dlsym(dft_handle, "dfts_autoinit");
+    nr_dft_fn dft_fn = (nr_dft_fn)dlsym(dft_handle, "dft_implementation");
+    nr_dft_fn idft_fn = (nr_dft_fn)dlsym(dft_handle, "idft_implementation");
+    if (!autoinit || !dft_fn || !idft_fn) {
+        printf("nr_dft_plan_init: %s not found in libdfts\n",
+               !autoinit ? "dfts_autoinit" : !dft_fn ? "dft_implementation" : "idft_implementation");
+        dlclose(dft_handle);
+        dft_handle = NULL;
+        return;
+    }
+    autoinit();
+    dft_fill_plans(NR_DFT_BACKEND_LIBDFTS, dft_fn, idft_fn, NULL);
+}
+
+static void dft_build_builtin(void)
+{
+    for (int s = 0; s < NR_DFT_NB_SIZES; s++) {
+        dft_fft[s] = nr_fft_init(dft_sizes[s]);
+        if (!dft_fft[s]) {
+            printf("nr_dft_plan_init: built-in FFT of size %d failed\n", dft_sizes[s]);
+            return;
+        }
+        dft_fft_of_idx[(uint8_t)get_dft(dft_sizes[s])] = dft_fft[s];
+        idft_fft_of_idx[(uint8_t)get_idft(dft_sizes[s])] = dft_fft[s];
+    }
+    dft_fill_plans(NR_DFT_BACKEND_BUILTIN, builtin_dft, builtin_idft, dft_fft);
+}
+
+static void dft_plan_build(void)
+{
+    const char *want = getenv("OAI_DFT_BACKEND");
+    const int builtin_only = want && !strcmp(want, "builtin");
+
+    if (!builtin_only)
+        dft_load_libdfts();
+    dft_build_builtin();
+
+    if (want && *want && strcmp(want, "builtin") && strcmp(want, "libdfts"))
+        printf("nr_dft_plan_init: unknown OAI_DFT_BACKEND '%s'\n", want);
+    if (dft_available[NR_DFT_BACKEND_LIBDFTS] && !builtin_only)
+        dft_default = NR_DFT_BACKEND_LIBDFTS;
+    else if (dft_available[NR_DFT_BACKEND_BUILTIN])
+        dft_default = NR_DFT_BACKEND_BUILTIN;
+    else
+        return;
+    if (dft_default == NR_DFT_BACKEND_BUILTIN && !builtin_only)
+        printf("nr_dft_plan_init: libdfts not available, using the built-in FFT\n");
+
+    dft = (dftfunc_t)dft_plans[dft_default][0][0].dft;
+    idft = (idftfunc_t)dft_plans[dft_default][0][0].idft;
+}
+
+int nr_dft_plan_init(void)
+{
+    pthread_once(&dft_once, dft_plan_build);
+    return dft_default < 0 ? -1 : 0;
+}
+
+int nr_dft_plan_backend(void)
+{
+    nr_dft_plan_init();
+    return dft_default;
+}
+
+const char *nr_dft_backend_name(int backend)
+{
+    return backend == NR_DFT_BACKEND_LIBDFTS ? "libdfts" : backend == NR_DFT_BACKEND_BUILTIN ? "builtin" : "none";
+}
+
+static inline int dft_size_slot(int size)
+{
+    switch (size) {
+        case 128:  return 0;
+        case 256:  return 1;
+        case 384:  return 2;
+        case 512:  return 3;
+        case 768:  return 4;
+        case 1024: return 5;
+        case 1536: return 6;
+        case 2048: return 7;
+        case 3072: return 8;
+        case 4096: return 9;
+        case 6144: return 10;
+        case 8192: return 11;
+        default:   return -1;
+    }
+}
+
+const nr_dft_plan_t *nr_dft_plan_get_backend(int backend, int size, unsigned char scale)
+{
+    const int s = dft_size_slot(size);
+    if (s < 0 || backend < 0 || backend >= NR_DFT_NB_BACKENDS) return NULL;
+    nr_dft_plan_init();
+    return dft_available[backend] ? &dft_plans[backend][s][scale ? 1 : 0] : NULL;
+}
+
+const nr_dft_plan_t *nr_dft_plan_get(int size, unsigned char scale)
+{
+    return nr_dft_plan_get_backend(nr_dft_plan_backend(), size, scale);
+}
+
+int nr_cp_length(int size, int mu, int slot, int symbol)
+{
+    /* Symbol index within the subframe; 7 * 2^mu starts the second half */
+    const int l = (slot % (1 << mu)) * 14 + symbol;
+    const int cp = 144 * size / 2048;
+    return (l == 0 || l == 7 << mu) ? cp + (16 << mu) * size / 2048 : cp;
+}
@@ -0,0 +1,90 @@
+#ifndef NR_DFT_PLAN_H
+#define NR_DFT_PLAN_H
+
+#include <stdint.h>
+#include "nr_fft.h"
+
+/* Process-wide cache of DFT / IDFT plans. Two backends provide them: libdfts
+ * of the OAI build, opened once (OAI_DFTS_LIB, then the OAI build tree given
+ * by NR_DFTS_LIB, then the loader path), and the in-tree FFT of nr_fft.h,
+ * always there. OAI_DFT_BACKEND=libdfts|builtin picks the default backend;
+ * without it libdfts is used when it loads and the built-in FFT otherwise.
+ * A plan is built for every NR FFT size and both scale flags, so that a
+ * context only keeps a plan pointer and switching numerology costs nothing
+ * per slot. The OAI globals dft and idft are set to the default backend for
+ * PHY_ofdm_mod() and the like. */
+
+/* dft_implementation() / idft_implementation() of libdfts, sizeidx being
+ * get_dft() / get_idft() of the size for both backends */
+typedef void (*nr_dft_fn)(uint8_t sizeidx, int16_t *in, int16_t *out, unsigned char scale_flag);
+
+typedef struct {
+    int size;                /* FFT size */
+    unsigned char scale;     /* scale_flag given to libdfts */
+    uint8_t dft_idx;         /* get_dft(size) */
+    uint8_t idft_idx;        /* get_idft(size) */
+    int backend;             /* NR_DFT_BACKEND_* */
+    nr_dft_fn dft;
+    nr_dft_fn idft;
+    const nr_fft_t *fft;     /* built-in backend, NULL for libdfts */
+} nr_dft_plan_t;
+
+/* 128, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192 */
+#define NR_DFT_NB_SIZES 12
+
+#define NR_DFT_BACKEND_LIBDFTS 0
+#define NR_DFT_BACKEND_BUILTIN 1
+#define NR_DFT_NB_BACKENDS     2
+
+/* Open libdfts, build the plans of both backends and pick the default one;
+ * called lazily by nr_dft_plan_get(). Returns -1 when no backend is usable. */
+int nr_dft_plan_init(void);
+
+/* Default backend, NR_DFT_BACKEND_* */
+int nr_dft_plan_backend(void);
+
+const char *nr_dft_backend_name(int backend);
+
+/* Plan of size and scale flag (0 or 1) of the default backend, NULL for a size
+ * outside the list above */
+const nr_dft_plan_t *nr_dft_plan_get(int size, unsigned char scale);
+
+/* Same from a given backend, NULL as well when that backend is not available */
+const nr_dft_plan_t *nr_dft_plan_get_backend(int backend, int size, unsigned char scale);
+
+static inline void nr_dft_plan_dft(const nr_dft_plan_t *p, int16_t *in, int16_t *out)
+{
+    p->dft(p->dft_idx, in, out, p->scale);
+}
+
+static inline void nr_dft_plan_idft(const nr_dft_plan_t *p, int16_t *in, int16_t *out)
+{
+    p->idft(p->idft_idx, in, out, p->scale);
+}
+
+/* Transforms of an allocation narrower than the FFT, nr_fft_int16_pruned():
+ * the IDFT only reads the in_len bins from in_start, the DFT only writes the
+ * out_len bins from out_start. libdfts has no pruning and runs the full
+ * transform, which needs the IDFT input to be zero outside its range. */
+static inline void nr_dft_plan_idft_pruned(const nr_dft_plan_t *p, int16_t *in, int16_t *out, int in_start, int in_len)
+{
+    if (p->fft)
+        nr_fft_int16_pruned(p->fft, in, out, 1, p->scale, in_start, in_len, 0, p->size);
+    else
+        nr_dft_plan_idft(p, in, out);
+}
+
+static inline void nr_dft_plan_dft_pruned(const nr_dft_plan_t *p, int16_t *in, int16_t *out, int out_start, int out_len)
+{
+    if (p->fft)
+        nr_fft_int16_pruned(p->fft, in, out, 0, p->scale, 0, p->size, out_start, out_len);
+    else
+        nr_dft_plan_dft(p, in, out);
+}
+
+/* Cyclic prefix in samples of symbol l of slot at FFT size and numerology mu,
+ * normal CP (38.211 5.3.1): 144 * size / 2048, plus 16 * 2^mu * size / 2048
+ * for the first symbol of each half subframe */
+int nr_cp_length(int size, int mu, int slot, int symbol);
+
+#endif
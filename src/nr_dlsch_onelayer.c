@@ -6,6 +6,9 @@
 #include "nr_dlsch_onelayer.h"
 #include "common/platform_types.h"
 #include "PHY/MODULATION/nr_modulation.h"
+#include "nr_dmrs.h"
+#include "nr_ptrs.h"
+#include "nr_arena.h"
 #include <string.h>
 
 /* Helper functions extracted from nr_dlsch.c */
@@ -67,6 +70,45 @@ static inline int no_ptrs_dmrs_case(c16_t *output, c16_t *txl, const int amp, co
     return sz;
 }
 
+/* Scales len REs of txl into the grid from bin k, wrapping at symbol_sz */
+static inline void map_scaled_wrap(c16_t *output, int symbol_sz, int k, c16_t *txl, const int amp, int len)
+{
+    const int first = k + len > symbol_sz ? symbol_sz - k : len;
+    no_ptrs_dmrs_case(output + k, txl, amp, first);
+    if (first < len) no_ptrs_dmrs_case(output, txl + first, amp, len - first);
+}
+
+/* PTRS symbol: the data REs between two PTRS REs are one contiguous run, so
+ * the symbol is the runs of no_ptrs_dmrs_case() with the PTRS REs between
+ * them instead of a PTRS test on every subcarrier */
+static inline int do_ptrs_symbol(c16_t *output,
+                                 int start_sc,
+                                 int symbol_sz,
+                                 int sz,
+                                 c16_t *txl,
+                                 const int amp,
+                                 const nr_re_pattern_t *p,
+                                 const c16_t *mod_ptrs,
+                                 int nb_ptrs)
+{
+    c16_t *in = txl;
+    int k = 0;
+    int bin = start_sc;
+    for (int i = 0; i < nb_ptrs; i++) {
+        const int k_ptrs = 12 * (p->ptrs_rb_offset + i * p->ptrs_period) + p->ptrs_sc;
+        map_scaled_wrap(output, symbol_sz, bin, in, amp, k_ptrs - k);
+        in += k_ptrs - k;
+        bin += k_ptrs - k;
+        if (bin >= symbol_sz) bin -= symbol_sz;
+        output[bin] = c16mulRealShift(mod_ptrs[i], amp, 15);
+        if (++bin == symbol_sz) bin = 0;
+        k = k_ptrs + 1;
+    }
+    map_scaled_wrap(output, symbol_sz, bin, in, amp, sz - k);
+    in += sz - k;
+    return in - txl;
+}
+
 /* Main do_onelayer function - maps one layer to output with basic DMRS/PTRS handling */
 int do_onelayer(NR_DL_FRAME_PARMS *frame_parms,
                 int slot,
@@ -78,7 +120,6 @@ int do_onelayer(NR_DL_FRAME_PARMS *frame_parms,
                 int symbol_sz,
                 int l_symbol,
                 uint16_t dlPtrsSymPos,
-                int n_ptrs,
                 int amp,
                 int16_t amp_dmrs,
                 int l_prime,
@@ -101,10 +142,35 @@ int do_onelayer(NR_DL_FRAME_PARMS *frame_parms,
         ptrs_symbol = is_ptrs_symbol(l_symbol, dlPtrsSymPos);
     }
 
-    if (ptrs_symbol) {
-        /* PTRS modulation - skip for simplified test */
-        txl += upper_limit;
-        if (remaining_re > 0) txl += remaining_re;
+    if (ptrs_symbol && rel15->PTRSFreqDensity > 0) {
+        /* One PTRS RE every PTRSFreqDensity RBs, on the lowest port of
+         * PTRSPortIndex; the other layers leave that RE empty */
+        const int ptrs_port = rel15->PTRSPortIndex ? __builtin_ctz(rel15->PTRSPortIndex) : 0;
+        nr_re_pattern_t p = {.data_mask = NR_RE_MASK_ALL};
+        nr_ptrs_set_pattern(&p,
+                            dmrs_Type == NFAPI_NR_DMRS_TYPE1 ? 1 : 2,
+                            ptrs_port,
+                            rel15->PTRSReOffset,
+                            rel15->PTRSFreqDensity,
+                            rel15->rbSize,
+                            rel15->rnti);
+        /* The PTRS count of the pattern, not ceil(rbSize / K), which is one
+         * too many when the first PTRS RB is not RB 0 */
+        const int nb_ptrs = nr_ptrs_count(&p, rel15->rbSize);
+        nr_scratch_t scratch;
+        nr_scratch_begin(&scratch);
+        c16_t *mod_ptrs = nr_scratch_alloc(&scratch, nb_ptrs * sizeof(c16_t));
+        /* PTRS i takes point i of the DMRS sequence of the symbol (as
+         * nr_gold_pdsch() + nr_modulation()): the first nb_ptrs points, the
+         * shortcut OAI takes, not the point of the PTRS subcarrier that
+         * 38.211 7.4.1.2 uses. The receiver (nr_ptrs_test) builds its
+         * reference the same way; change both sides or neither. */
+        if (layer % 4 == ptrs_port)
+            nr_dmrs_generate(slot, l_symbol, rel15->dlDmrsScramblingId, rel15->SCID, nb_ptrs, mod_ptrs);
+        else
+            memset(mod_ptrs, 0, nb_ptrs * sizeof(c16_t));
+        txl += do_ptrs_symbol(output, start_sc, symbol_sz, sz, txl, amp, &p, mod_ptrs, nb_ptrs);
+        nr_scratch_end(&scratch);
     } 
     else if (rel15->dlDmrsSymbPos & (1 << l_symbol)) {
         /* DMRS symbol - handle basic case */
@@ -119,11 +185,14 @@ int do_onelayer(NR_DL_FRAME_PARMS *frame_parms,
                         txl += interleave_with_0_signal_first(output, dmrs_start + upper_limit / 2, amp_dmrs, remaining_re);
                 } 
                 else if (dmrs_port == 1) {
-                    c16_t dmrs[sz / 2];
+                    nr_scratch_t scratch;
+                    nr_scratch_begin(&scratch);
+                    c16_t *dmrs = nr_scratch_alloc(&scratch, sz / 2 * sizeof(c16_t));
                     neg_dmrs(dmrs_start, dmrs, sz / 2);
                     txl += interleave_with_0_signal_first(output + start_sc, dmrs, amp_dmrs, upper_limit);
                     if (remaining_re > 0)
                         txl += interleave_with_0_signal_first(output, dmrs + upper_limit / 2, amp_dmrs, remaining_re);
+                    nr_scratch_end(&scratch);
                 } 
                 else if (dmrs_port == 2) {
                     txl += interleave_with_0_start_with_0(output + start_sc, dmrs_start, amp_dmrs, upper_limit);
@@ -131,11 +200,14 @@ int do_onelayer(NR_DL_FRAME_PARMS *frame_parms,
                         txl += interleave_with_0_start_with_0(output, dmrs_start + upper_limit / 2, amp_dmrs, remaining_re);
                 }
                 else {
-                    c16_t dmrs[sz / 2];
+                    nr_scratch_t scratch;
+                    nr_scratch_begin(&scratch);
+                    c16_t *dmrs = nr_scratch_alloc(&scratch, sz / 2 * sizeof(c16_t));
                     neg_dmrs(dmrs_start, dmrs, sz / 2);
                     txl += interleave_with_0_start_with_0(output + start_sc, dmrs, amp_dmrs, upper_limit);
                     if (remaining_re > 0)
                         txl += interleave_with_0_start_with_0(output, dmrs + upper_limit / 2, amp_dmrs, remaining_re);
+                    nr_scratch_end(&scratch);
                 }
             } 
             else {
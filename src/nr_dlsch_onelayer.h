@@ -16,7 +16,6 @@ int do_onelayer(NR_DL_FRAME_PARMS *frame_parms,
                 int symbol_sz,
                 int l_symbol,
                 uint16_t dlPtrsSymPos,
-                int n_ptrs,
                 int amp,
                 int16_t amp_dmrs,
                 int l_prime,
@@ -0,0 +1,92 @@
+/*
+ * PDSCH DMRS sequence generation and a cache of modulated sequences built
+ * on the gold sequence cache.
+ */
+
+#include "nr_dmrs.h"
+#include "nr_arena.h"
+#include <stdlib.h>
+
+void nr_dmrs_qpsk(const uint32_t *c, int n, c16_t *out)
+{
+    /* One word gives 16 QPSK points */
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint32_t w = c[i >> 4];
+        for (int j = 0; j < 16; j++, w >>= 2) {
+            out[i + j].r = (w & 1) ? -NR_DMRS_AMP : NR_DMRS_AMP;
+            out[i + j].i = (w & 2) ? -NR_DMRS_AMP : NR_DMRS_AMP;
+        }
+    }
+    for (; i < n; i++) {
+        const uint32_t b = c[i >> 4] >> ((2 * i) & 31);
+        out[i].r = (b & 1) ? -NR_DMRS_AMP : NR_DMRS_AMP;
+        out[i].i = (b & 2) ? -NR_DMRS_AMP : NR_DMRS_AMP;
+    }
+}
+
+void nr_dmrs_generate(int slot, int l, uint32_t Nid, uint8_t n_scid, int n, c16_t *out)
+{
+    /* Gold words on the thread arena, not a VLA sized by the allocation */
+    const int words = (2 * n + 31) / 32 + 1;
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    uint32_t *c = nr_scratch_alloc(&scratch, words * sizeof(uint32_t));
+    nr_gold_generate(nr_gold_pdsch_dmrs_cinit(slot, l, Nid, n_scid), c, words);
+    nr_dmrs_qpsk(c, n, out);
+    nr_scratch_end(&scratch);
+}
+
+nr_dmrs_cache_t *nr_dmrs_cache_init(int nb_entries, int max_len)
+{
+    if (nb_entries < 1 || max_len < 1) return NULL;
+
+    nr_dmrs_cache_t *cache = calloc(1, sizeof(*cache));
+    if (!cache) return NULL;
+
+    cache->max_len = max_len;
+    cache->gold = nr_gold_cache_init(nb_entries, 2 * (uint32_t)max_len);
+    cache->c_init = calloc(nb_entries, sizeof(uint32_t));
+    cache->len = calloc(nb_entries, sizeof(int));
+    cache->mem = aligned_alloc(64, ((size_t)nb_entries * max_len * sizeof(c16_t) + 63) & ~(size_t)63);
+    if (!cache->gold || !cache->c_init || !cache->len || !cache->mem) {
+        nr_dmrs_cache_free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+void nr_dmrs_cache_free(nr_dmrs_cache_t *cache)
+{
+    if (!cache) return;
+    nr_gold_cache_free(cache->gold);
+    free(cache->c_init);
+    free(cache->len);
+    free(cache->mem);
+    free(cache);
+}
+
+const c16_t *nr_dmrs_cache_get(nr_dmrs_cache_t *cache, int slot, int l, uint32_t Nid, uint8_t n_scid, int n)
+{
+    if (n < 1 || n > cache->max_len) return NULL;
+
+    const uint32_t c_init = nr_gold_pdsch_dmrs_cinit(slot, l, Nid, n_scid);
+    const uint32_t *c = nr_gold_cache_get(cache->gold, c_init, 2 * (uint32_t)n);
+    if (!c) return NULL;
+
+    /* The modulated sequence lives at the index of the gold entry; a new
+     * c_init in that entry, or a longer request, modulates what is missing */
+    const int e = (int)((c - cache->gold->mem) / cache->gold->max_words);
+    c16_t *seq = cache->mem + (size_t)e * cache->max_len;
+    if (cache->c_init[e] != c_init || cache->len[e] == 0) {
+        cache->c_init[e] = c_init;
+        cache->len[e] = 0;
+    }
+    if (cache->len[e] < n) {
+        /* Whole words only, the modulated prefix ends on a 16-point boundary */
+        const int from = cache->len[e] & ~15;
+        nr_dmrs_qpsk(c + (from >> 4), n - from, seq + from);
+        cache->len[e] = n;
+    }
+    return seq;
+}
@@ -0,0 +1,45 @@
+#ifndef NR_DMRS_H
+#define NR_DMRS_H
+
+#include <stdint.h>
+#include "common/platform_types.h"
+#include "nr_gold.h"
+
+/* PDSCH DMRS sequence (38.211 7.4.1.1.1): QPSK of the gold sequence of
+ * nr_gold_pdsch_dmrs_cinit() for (slot, symbol, scrambling ID, n_SCID), the
+ * sequence the PTRS of a symbol reuses. r(n) of the carrier starts at common
+ * RB 0, so an allocation takes it from element 6 * (BWPStart + rbStart) for
+ * type 1 (4 * ... for type 2), what dmrs_start of do_onelayer() points to.
+ *
+ * The cache keeps modulated sequences next to the gold sequences of an
+ * nr_gold_cache_t, whose hash and LRU it shares: the DMRS of a slot pattern
+ * seen in a previous frame is a lookup. */
+
+/* Q15 amplitude of the QPSK points, 1 / sqrt(2) */
+#define NR_DMRS_AMP 23170
+
+/* QPSK points r(0..n-1) of the first 2n bits of the gold sequence c, packed
+ * as in nr_gold_generate() */
+void nr_dmrs_qpsk(const uint32_t *c, int n, c16_t *out);
+
+/* r(0..n-1) of symbol l of slot, generated from scratch */
+void nr_dmrs_generate(int slot, int l, uint32_t Nid, uint8_t n_scid, int n, c16_t *out);
+
+typedef struct nr_dmrs_cache_s {
+    nr_gold_cache_t *gold;
+    int max_len;
+    uint32_t *c_init;   /* [entries] c_init of the modulated sequence of each gold entry */
+    int *len;           /* [entries] modulated length, 0 when none */
+    c16_t *mem;         /* [entries][max_len] */
+} nr_dmrs_cache_t;
+
+/* Cache of nb_entries sequences of up to max_len DMRS symbols, N_RB_DL * 6
+ * for the whole carrier */
+nr_dmrs_cache_t *nr_dmrs_cache_init(int nb_entries, int max_len);
+void nr_dmrs_cache_free(nr_dmrs_cache_t *cache);
+
+/* r(0..n-1) of symbol l of slot, valid until the entry is evicted. Returns
+ * NULL when n exceeds max_len. Hits and misses are those of cache->gold. */
+const c16_t *nr_dmrs_cache_get(nr_dmrs_cache_t *cache, int slot, int l, uint32_t Nid, uint8_t n_scid, int n);
+
+#endif
@@ -0,0 +1,382 @@
+/*
+ * Mixed-radix Stockham FFT on complex floats, with int16 entry points scaled
+ * as libdfts. Stage t of radix p over the current length n = p * m and stride
+ * s maps x[r + s * (q + m * k)], k < p, through a radix-p butterfly and the
+ * twiddles w_n^(j q) to y[r + s * (p * q + j)]; the next stage works on
+ * length m with stride p * s.
+ *
+ * Two complex floats share an SSE vector: two values of r once s >= 2, two
+ * values of q in the first stage (s == 1), where the outputs are scattered
+ * with movsd / movhpd. The odd leftover runs on one lane.
+ */
+
+#include "nr_fft.h"
+#include "nr_arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <simde/x86/sse4.1.h>
+
+struct nr_fft_s {
+    int size;
+    int nb_stages;
+    int radix[NR_FFT_MAX_STAGES];
+    int m[NR_FFT_MAX_STAGES];      /* current length / radix */
+    int s[NR_FFT_MAX_STAGES];      /* stride */
+    float *tw[NR_FFT_MAX_STAGES];  /* w_n^(j q) at [(j - 1) * m + q], forward sign */
+};
+
+nr_fft_t *nr_fft_init(int size)
+{
+    if (size < 2) return NULL;
+
+    nr_fft_t *f = calloc(1, sizeof(*f));
+    if (!f) return NULL;
+    f->size = size;
+
+    /* Radix 4 first, then 2, 3 and 5 */
+    static const int radices[] = { 4, 2, 3, 5 };
+    int rest = size;
+    for (int i = 0; i < 4; i++)
+        while (rest % radices[i] == 0) {
+            if (f->nb_stages == NR_FFT_MAX_STAGES) {
+                rest = 0;
+                break;
+            }
+            f->radix[f->nb_stages++] = radices[i];
+            rest /= radices[i];
+        }
+    if (rest != 1) {
+        printf("nr_fft_init: size %d is not 2^a 3^b 5^c\n", size);
+        free(f);
+        return NULL;
+    }
+
+    int n = size, s = 1;
+    for (int t = 0; t < f->nb_stages; t++) {
+        const int p = f->radix[t], m = n / p;
+        f->m[t] = m;
+        f->s[t] = s;
+        f->tw[t] = malloc(sizeof(float) * 2 * (p - 1) * m);
+        if (!f->tw[t]) {
+            nr_fft_free(f);
+            return NULL;
+        }
+        for (int j = 1; j < p; j++)
+            for (int q = 0; q < m; q++) {
+                const double a = -2.0 * M_PI * (double)j * q / n;
+                f->tw[t][2 * ((j - 1) * m + q)] = (float)cos(a);
+                f->tw[t][2 * ((j - 1) * m + q) + 1] = (float)sin(a);
+            }
+        n = m;
+        s *= p;
+    }
+    return f;
+}
+
+void nr_fft_free(nr_fft_t *f)
+{
+    if (!f) return;
+    for (int t = 0; t < f->nb_stages; t++)
+        free(f->tw[t]);
+    free(f);
+}
+
+int nr_fft_size(const nr_fft_t *f)
+{
+    return f->size;
+}
+
+/* ---- Butterflies on two complex per vector ---- */
+
+static inline simde__m128 fft_swap(simde__m128 a)
+{
+    return simde_mm_shuffle_ps(a, a, SIMDE_MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static inline simde__m128 fft_cmul(simde__m128 a, simde__m128 w)
+{
+    const simde__m128 t1 = simde_mm_mul_ps(a, simde_mm_moveldup_ps(w));
+    const simde__m128 t2 = simde_mm_mul_ps(fft_swap(a), simde_mm_movehdup_ps(w));
+    return simde_mm_addsub_ps(t1, t2);
+}
+
+/* a * (-i) forward, a * i inverse: rot is the sign mask of the lanes to
+ * negate after swapping re and im */
+static inline simde__m128 fft_rot(simde__m128 a, simde__m128 rot)
+{
+    return simde_mm_xor_ps(fft_swap(a), rot);
+}
+
+static inline simde__m128 fft_scale(simde__m128 a, float c)
+{
+    return simde_mm_mul_ps(a, simde_mm_set1_ps(c));
+}
+
+static inline __attribute__((always_inline))
+void fft_bfly(const int p, simde__m128 *a, simde__m128 rot)
+{
+    if (p == 2) {
+        const simde__m128 t = a[0];
+        a[0] = simde_mm_add_ps(t, a[1]);
+        a[1] = simde_mm_sub_ps(t, a[1]);
+    } else if (p == 3) {
+        const simde__m128 t1 = simde_mm_add_ps(a[1], a[2]);
+        const simde__m128 t2 = simde_mm_sub_ps(a[0], fft_scale(t1, 0.5f));
+        const simde__m128 t3 = fft_rot(fft_scale(simde_mm_sub_ps(a[1], a[2]), 0.86602540378443865f), rot);
+        a[0] = simde_mm_add_ps(a[0], t1);
+        a[1] = simde_mm_add_ps(t2, t3);
+        a[2] = simde_mm_sub_ps(t2, t3);
+    } else if (p == 4) {
+        const simde__m128 s02 = simde_mm_add_ps(a[0], a[2]);
+        const simde__m128 d02 = simde_mm_sub_ps(a[0], a[2]);
+        const simde__m128 s13 = simde_mm_add_ps(a[1], a[3]);
+        const simde__m128 d13 = fft_rot(simde_mm_sub_ps(a[1], a[3]), rot);
+        a[0] = simde_mm_add_ps(s02, s13);
+        a[1] = simde_mm_add_ps(d02, d13);
+        a[2] = simde_mm_sub_ps(s02, s13);
+        a[3] = simde_mm_sub_ps(d02, d13);
+    } else {
+        const float c1 = 0.30901699437494742f, c2 = -0.80901699437494742f;
+        const float s1 = 0.95105651629515357f, s2 = 0.58778525229247313f;
+        const simde__m128 t1 = simde_mm_add_ps(a[1], a[4]);
+        const simde__m128 t2 = simde_mm_add_ps(a[2], a[3]);
+        const simde__m128 t3 = simde_mm_sub_ps(a[1], a[4]);
+        const simde__m128 t4 = simde_mm_sub_ps(a[2], a[3]);
+        const simde__m128 u1 = simde_mm_add_ps(a[0], simde_mm_add_ps(fft_scale(t1, c1), fft_scale(t2, c2)));
+        const simde__m128 u2 = simde_mm_add_ps(a[0], simde_mm_add_ps(fft_scale(t1, c2), fft_scale(t2, c1)));
+        const simde__m128 v1 = fft_rot(simde_mm_add_ps(fft_scale(t3, s1), fft_scale(t4, s2)), rot);
+        const simde__m128 v2 = fft_rot(simde_mm_sub_ps(fft_scale(t3, s2), fft_scale(t4, s1)), rot);
+        a[0] = simde_mm_add_ps(a[0], simde_mm_add_ps(t1, t2));
+        a[1] = simde_mm_add_ps(u1, v1);
+        a[4] = simde_mm_sub_ps(u1, v1);
+        a[2] = simde_mm_add_ps(u2, v2);
+        a[3] = simde_mm_sub_ps(u2, v2);
+    }
+}
+
+/* ---- Stages ---- */
+
+static inline simde__m128 fft_load_one(const float *p)
+{
+    return simde_mm_castpd_ps(simde_mm_load_sd((const double *)p));
+}
+
+static inline void fft_store_one(float *p, simde__m128 a)
+{
+    simde_mm_store_sd((double *)p, simde_mm_castps_pd(a));
+}
+
+/* One butterfly on the low lane, at (q, r) */
+static inline __attribute__((always_inline))
+void fft_stage_one(const int p, int m, int s, int q, int r, const float *tw, const float *x, float *y,
+                   simde__m128 rot, simde__m128 conj)
+{
+    simde__m128 a[5];
+    for (int k = 0; k < p; k++)
+        a[k] = fft_load_one(x + 2 * (r + s * (q + m * k)));
+    fft_bfly(p, a, rot);
+    for (int j = 1; j < p; j++)
+        a[j] = fft_cmul(a[j], simde_mm_xor_ps(fft_load_one(tw + 2 * ((j - 1) * m + q)), conj));
+    for (int j = 0; j < p; j++)
+        fft_store_one(y + 2 * (r + s * (p * q + j)), a[j]);
+}
+
+/* Linear pieces of a cyclic range of [0, n) */
+typedef struct {
+    int nb;
+    int lo[2];
+    int hi[2];
+} fft_span_t;
+
+static fft_span_t fft_span(int start, int len, int n)
+{
+    fft_span_t sp = { .nb = 1, .lo = { 0, 0 }, .hi = { n, 0 } };
+    if (len >= n) return sp;
+    start %= n;
+    sp.lo[0] = start;
+    if (start + len <= n) {
+        sp.hi[0] = start + len;
+    } else {
+        sp.hi[0] = n;
+        sp.nb = 2;
+        sp.lo[1] = 0;
+        sp.hi[1] = start + len - n;
+    }
+    return sp;
+}
+
+/* Butterflies of the q in qs and r in rs; outputs of other q or r are not
+ * written */
+static inline __attribute__((always_inline))
+void fft_stage(const int p, int m, int s, const float *tw, const float *x, float *y,
+               simde__m128 rot, simde__m128 conj, const fft_span_t *qs, const fft_span_t *rs)
+{
+    simde__m128 a[5];
+
+    if (s == 1) {
+        for (int i = 0; i < qs->nb; i++) {
+            int q = qs->lo[i];
+            for (; q + 2 <= qs->hi[i]; q += 2) {
+                for (int k = 0; k < p; k++)
+                    a[k] = simde_mm_loadu_ps(x + 2 * (q + m * k));
+                fft_bfly(p, a, rot);
+                for (int j = 1; j < p; j++)
+                    a[j] = fft_cmul(a[j], simde_mm_xor_ps(simde_mm_loadu_ps(tw + 2 * ((j - 1) * m + q)), conj));
+                for (int j = 0; j < p; j++) {
+                    fft_store_one(y + 2 * (p * q + j), a[j]);
+                    simde_mm_storeh_pd((double *)(y + 2 * (p * (q + 1) + j)), simde_mm_castps_pd(a[j]));
+                }
+            }
+            if (q < qs->hi[i])
+                fft_stage_one(p, m, 1, q, 0, tw, x, y, rot, conj);
+        }
+        return;
+    }
+
+    for (int i = 0; i < qs->nb; i++)
+        for (int q = qs->lo[i]; q < qs->hi[i]; q++) {
+            simde__m128 w[5];
+            for (int j = 1; j < p; j++)
+                w[j] = simde_mm_xor_ps(simde_mm_castpd_ps(simde_mm_load1_pd((const double *)(tw + 2 * ((j - 1) * m + q)))), conj);
+            for (int e = 0; e < rs->nb; e++) {
+                int r = rs->lo[e];
+                for (; r + 2 <= rs->hi[e]; r += 2) {
+                    for (int k = 0; k < p; k++)
+                        a[k] = simde_mm_loadu_ps(x + 2 * (r + s * (q + m * k)));
+                    fft_bfly(p, a, rot);
+                    for (int j = 1; j < p; j++)
+                        a[j] = fft_cmul(a[j], w[j]);
+                    for (int j = 0; j < p; j++)
+                        simde_mm_storeu_ps(y + 2 * (r + s * (p * q + j)), a[j]);
+                }
+                if (r < rs->hi[e])
+                    fft_stage_one(p, m, s, q, r, tw, x, y, rot, conj);
+            }
+        }
+}
+
+#define FFT_STAGE(P) \
+    static void fft_stage_##P(int m, int s, const float *tw, const float *x, float *y, \
+                              simde__m128 rot, simde__m128 conj, const fft_span_t *qs, const fft_span_t *rs) \
+    { \
+        fft_stage(P, m, s, tw, x, y, rot, conj, qs, rs); \
+    }
+
+FFT_STAGE(2)
+FFT_STAGE(3)
+FFT_STAGE(4)
+FFT_STAGE(5)
+
+float *nr_fft_float_pruned(const nr_fft_t *f, float *buf, float *work, int inverse,
+                           int in_start, int in_len, int out_start, int out_len)
+{
+    /* Sign masks: imaginary lanes (conjugate, * -i after the swap) and real
+     * lanes (* i after the swap) */
+    const simde__m128 neg_im = simde_mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f);
+    const simde__m128 neg_re = simde_mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f);
+    const simde__m128 rot = inverse ? neg_re : neg_im;
+    const simde__m128 conj = inverse ? neg_im : simde_mm_setzero_ps();
+
+    /* Every subsequence of a stage has its non-zero inputs in the same cyclic
+     * range of in_len, the input range modulo the subsequence length, as long
+     * as that range is shorter than the subsequence. Output r' + s' * u of the
+     * last stages only feeds bin r' + s' * u, so the butterflies at r are
+     * needed when r is in the output range modulo s. */
+    int in_pos = in_start % f->size;
+    float *x = buf, *y = work;
+    for (int t = 0; t < f->nb_stages; t++) {
+        const int p = f->radix[t], m = f->m[t], s = f->s[t];
+        const int pruned_in = in_len < m;
+        const fft_span_t qs = fft_span(in_pos, pruned_in ? in_len : m, m);
+        const fft_span_t rs = fft_span(out_start, out_len < s ? out_len : s, s);
+        switch (p) {
+            case 2: fft_stage_2(m, s, f->tw[t], x, y, rot, conj, &qs, &rs); break;
+            case 3: fft_stage_3(m, s, f->tw[t], x, y, rot, conj, &qs, &rs); break;
+            case 4: fft_stage_4(m, s, f->tw[t], x, y, rot, conj, &qs, &rs); break;
+            default: fft_stage_5(m, s, f->tw[t], x, y, rot, conj, &qs, &rs); break;
+        }
+        if (pruned_in) {
+            /* Butterflies of q outside the range only see zeros: their
+             * outputs, [s p q, s p (q + 1)), are zero */
+            const fft_span_t zs = fft_span(in_pos % m + in_len, m - in_len, m);
+            for (int i = 0; i < zs.nb; i++)
+                memset(y + 2 * s * p * zs.lo[i], 0, sizeof(float) * 2 * s * p * (zs.hi[i] - zs.lo[i]));
+            in_pos %= m;
+        }
+        float *tmp = x;
+        x = y;
+        y = tmp;
+    }
+    return x;
+}
+
+float *nr_fft_float(const nr_fft_t *f, float *buf, float *work, int inverse)
+{
+    return nr_fft_float_pruned(f, buf, work, inverse, 0, f->size, 0, f->size);
+}
+
+/* int16 samples [k0, k0 + n) of in to floats */
+static void fft_from_int16(const int16_t *in, float *a, int k0, int n)
+{
+    int k = k0;
+    for (; k + 4 <= k0 + n; k += 4) {
+        const simde__m128i v = simde_mm_loadu_si128((const simde__m128i *)(in + 2 * k));
+        simde_mm_storeu_ps(a + 2 * k, simde_mm_cvtepi32_ps(simde_mm_cvtepi16_epi32(v)));
+        simde_mm_storeu_ps(a + 2 * k + 4, simde_mm_cvtepi32_ps(simde_mm_cvtepi16_epi32(simde_mm_srli_si128(v, 8))));
+    }
+    for (; k < k0 + n; k++) {
+        a[2 * k] = in[2 * k];
+        a[2 * k + 1] = in[2 * k + 1];
+    }
+}
+
+/* Samples [k0, k0 + n) of r times g, rounded and saturated to int16 */
+static void fft_to_int16(const float *r, float g, int16_t *out, int k0, int n)
+{
+    const simde__m128 vg = simde_mm_set1_ps(g);
+    int k = k0;
+    for (; k + 4 <= k0 + n; k += 4) {
+        const simde__m128i lo = simde_mm_cvtps_epi32(simde_mm_mul_ps(simde_mm_loadu_ps(r + 2 * k), vg));
+        const simde__m128i hi = simde_mm_cvtps_epi32(simde_mm_mul_ps(simde_mm_loadu_ps(r + 2 * k + 4), vg));
+        simde_mm_storeu_si128((simde__m128i *)(out + 2 * k), simde_mm_packs_epi32(lo, hi));
+    }
+    for (; k < k0 + n; k++)
+        for (int c = 0; c < 2; c++) {
+            const long v = lrintf(r[2 * k + c] * g);
+            out[2 * k + c] = (int16_t)(v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : v);
+        }
+}
+
+void nr_fft_int16_pruned(const nr_fft_t *f, const int16_t *in, int16_t *out, int inverse, int scale_flag,
+                         int in_start, int in_len, int out_start, int out_len)
+{
+    const int N = f->size;
+    const size_t bytes = sizeof(float) * 2 * N;
+
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    float *a = nr_scratch_alloc(&scratch, 2 * bytes);
+    float *b = a + 2 * N;
+
+    const fft_span_t is = fft_span(in_start, in_len, N);
+    if (in_len < N)
+        memset(a, 0, bytes);
+    for (int i = 0; i < is.nb; i++)
+        fft_from_int16(in, a, is.lo[i], is.hi[i] - is.lo[i]);
+
+    const float *r = nr_fft_float_pruned(f, a, b, inverse, in_start, in_len, out_start, out_len);
+
+    const float g = scale_flag ? (float)(1.0 / sqrt((double)N)) : 1.0f;
+    const fft_span_t os = fft_span(out_start, out_len, N);
+    for (int i = 0; i < os.nb; i++)
+        fft_to_int16(r, g, out, os.lo[i], os.hi[i] - os.lo[i]);
+
+    nr_scratch_end(&scratch);
+}
+
+void nr_fft_int16(const nr_fft_t *f, const int16_t *in, int16_t *out, int inverse, int scale_flag)
+{
+    nr_fft_int16_pruned(f, in, out, inverse, scale_flag, 0, f->size, 0, f->size);
+}
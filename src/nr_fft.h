@@ -0,0 +1,65 @@
+#ifndef NR_FFT_H
+#define NR_FFT_H
+
+#include <stdint.h>
+
+/* In-tree mixed-radix FFT, the fallback of libdfts. Sizes are 2^a 3^b 5^c,
+ * which covers every NR FFT size (128 to 8192 and the 3 * 2^k ones). Each
+ * plan is a chain of self-sorting (Stockham) radix 4, 2, 3 and 5 stages with
+ * precomputed twiddles, the butterflies running on two complex floats per
+ * SSE vector. No bit reversal pass is needed, the last stage writes the
+ * output in natural order.
+ *
+ * Complex values are interleaved (re, im): float pairs for nr_fft_float(),
+ * int16 pairs for nr_fft_int16() as in libdfts. */
+
+/* Radix stages of the largest plan: 8192 = 4^6 * 2 */
+#define NR_FFT_MAX_STAGES 16
+
+typedef struct nr_fft_s nr_fft_t;
+
+/* Plan of size, NULL when size is not 2^a 3^b 5^c or below 2 */
+nr_fft_t *nr_fft_init(int size);
+
+void nr_fft_free(nr_fft_t *f);
+
+int nr_fft_size(const nr_fft_t *f);
+
+/* Unscaled DFT (inverse: IDFT, sign + in the exponent) of the size complex
+ * floats of buf. buf and work (size complex floats each, 16-byte aligned) are
+ * both clobbered; the result is in the one returned. */
+float *nr_fft_float(const nr_fft_t *f, float *buf, float *work, int inverse);
+
+/* DFT / IDFT of size int16 complex samples with the scaling of libdfts
+ * dft/idft_implementation(): 1 / sqrt(size) with scale_flag, none without.
+ * The output is rounded to nearest and saturated. in and out may be the same
+ * buffer. */
+void nr_fft_int16(const nr_fft_t *f, const int16_t *in, int16_t *out, int inverse, int scale_flag);
+
+/* Pruned transforms for allocations narrower than the FFT. Only the in_len
+ * samples from in_start are non-zero and only the out_len bins from out_start
+ * are needed (others are not written); both ranges are cyclic modulo size, as
+ * an allocation around DC is. Stages whose subsequences are longer than in_len
+ * skip the butterflies that only see zeros, the last stages skip the
+ * butterflies that feed no needed bin: the saving is large for narrow
+ * allocations and vanishes once in_len and out_len exceed size / radix.
+ * Lengths are at least 1.
+ *
+ * The float version reads the whole of buf in its first stage: samples
+ * outside the input range must be zero. The int16 version does not read them,
+ * it converts the input range into a cleared scratch of the thread arena. */
+float *nr_fft_float_pruned(const nr_fft_t *f, float *buf, float *work, int inverse,
+                           int in_start, int in_len, int out_start, int out_len);
+
+void nr_fft_int16_pruned(const nr_fft_t *f, const int16_t *in, int16_t *out, int inverse, int scale_flag,
+                         int in_start, int in_len, int out_start, int out_len);
+
+/* Bins of nb_rb RBs from start_rb in the OAI grid layout, where RB 0 starts
+ * at first_carrier_offset and the carrier wraps around DC */
+static inline void nr_fft_rb_range(int size, int first_carrier_offset, int start_rb, int nb_rb, int *start, int *len)
+{
+    *start = (first_carrier_offset + 12 * start_rb) % size;
+    *len = 12 * nb_rb;
+}
+
+#endif
@@ -0,0 +1,394 @@
+/*
+ * Gold sequence generation (38.211 5.2.1) with GF(2) leap-ahead, LRU cache of
+ * packed sequences per scrambling identity and the XOR / sign-flip
+ * (de)scrambling kernels.
+ */
+
+#include "nr_gold.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <simde/x86/sse2.h>
+
+/* 32 steps of x1(n + 31) = x1(n + 3) + x1(n) and
+ * x2(n + 31) = x2(n + 3) + x2(n + 2) + x2(n + 1) + x2(n), as lte_gold_generic() */
+static inline uint32_t gold_next(uint32_t *x1, uint32_t *x2)
+{
+    *x1 = (*x1 >> 1) ^ (*x1 >> 4);
+    *x1 = *x1 ^ (*x1 << 31) ^ (*x1 << 28);
+    *x2 = (*x2 >> 1) ^ (*x2 >> 2) ^ (*x2 >> 3) ^ (*x2 >> 4);
+    *x2 = *x2 ^ (*x2 << 31) ^ (*x2 << 30) ^ (*x2 << 29) ^ (*x2 << 28);
+    return *x1 ^ *x2;
+}
+
+/* Registers after the Nc = 1600 warm-up: the next gold_next() returns c(0..31) */
+static void gold_start(uint32_t c_init, uint32_t *x1, uint32_t *x2)
+{
+    *x1 = 1 + (1U << 31);
+    *x2 = c_init ^ ((c_init ^ (c_init >> 1) ^ (c_init >> 2) ^ (c_init >> 3)) << 31);
+    for (int n = 1; n < 50; n++)
+        gold_next(x1, x2);
+}
+
+void nr_gold_generate(uint32_t c_init, uint32_t *c, uint32_t nwords)
+{
+    nr_gold_generate_at(c_init, 0, c, nwords);
+}
+
+/* Leap-ahead. The 31-bit state of an m-sequence (bit j = x(n + j)) advances
+ * by one position through a GF(2) matrix M, stored as its 31 columns; the
+ * tables hold M^(2^k), so reaching position p costs one matrix-vector
+ * product per set bit of p. */
+#define GOLD_JUMP_LOG 32
+
+static uint32_t gold_jump1[GOLD_JUMP_LOG][31];
+static uint32_t gold_jump2[GOLD_JUMP_LOG][31];
+static pthread_once_t gold_jump_once = PTHREAD_ONCE_INIT;
+
+static inline uint32_t gf2_mat_vec(const uint32_t *A, uint32_t v)
+{
+    uint32_t r = 0;
+    for (; v; v &= v - 1)
+        r ^= A[__builtin_ctz(v)];
+    return r;
+}
+
+/* taps: state bits whose sum gives x(n + 31) */
+static void gold_jump_build_one(uint32_t (*J)[31], uint32_t taps)
+{
+    for (int j = 0; j < 31; j++)
+        J[0][j] = (j ? 1u << (j - 1) : 0) | (((taps >> j) & 1) << 30);
+    for (int k = 1; k < GOLD_JUMP_LOG; k++)
+        for (int j = 0; j < 31; j++)
+            J[k][j] = gf2_mat_vec(J[k - 1], J[k - 1][j]);
+}
+
+static void gold_jump_build(void)
+{
+    gold_jump_build_one(gold_jump1, 0x9);    /* x1(n + 31) = x1(n + 3) + x1(n) */
+    gold_jump_build_one(gold_jump2, 0xF);    /* x2(n + 31) = x2(n + 3) + x2(n + 2) + x2(n + 1) + x2(n) */
+}
+
+static inline uint32_t gold_jump(uint32_t (*J)[31], uint32_t state, uint64_t p)
+{
+    for (int k = 0; p; k++, p >>= 1)
+        if (p & 1) state = gf2_mat_vec(J[k], state);
+    return state;
+}
+
+/* gold_next() registers holding x(p .. p + 31) for p = Nc + 32 * word, so that
+ * x1 ^ x2 is word word of c(n) */
+static void gold_registers_at(uint32_t c_init, uint32_t word, uint32_t *x1, uint32_t *x2)
+{
+    pthread_once(&gold_jump_once, gold_jump_build);
+    const uint64_t p = 1600 + 32 * (uint64_t)word;
+    const uint32_t s1 = gold_jump(gold_jump1, 1, p);
+    const uint32_t s2 = gold_jump(gold_jump2, c_init & 0x7FFFFFFF, p);
+    *x1 = s1 | ((uint32_t)__builtin_parity(s1 & 0x9) << 31);
+    *x2 = s2 | ((uint32_t)__builtin_parity(s2 & 0xF) << 31);
+}
+
+/* gold_next() on four register pairs at once */
+static inline void gold_next4(simde__m128i *x1, simde__m128i *x2)
+{
+    simde__m128i a = simde_mm_xor_si128(simde_mm_srli_epi32(*x1, 1), simde_mm_srli_epi32(*x1, 4));
+    *x1 = simde_mm_xor_si128(a, simde_mm_xor_si128(simde_mm_slli_epi32(a, 31), simde_mm_slli_epi32(a, 28)));
+    simde__m128i b = simde_mm_xor_si128(simde_mm_xor_si128(simde_mm_srli_epi32(*x2, 1), simde_mm_srli_epi32(*x2, 2)),
+                                        simde_mm_xor_si128(simde_mm_srli_epi32(*x2, 3), simde_mm_srli_epi32(*x2, 4)));
+    *x2 = simde_mm_xor_si128(simde_mm_xor_si128(b, simde_mm_slli_epi32(b, 31)),
+                             simde_mm_xor_si128(simde_mm_xor_si128(simde_mm_slli_epi32(b, 30), simde_mm_slli_epi32(b, 29)),
+                                                simde_mm_slli_epi32(b, 28)));
+}
+
+/* Eight disjoint chunks of chunk words, one per 32-bit lane */
+static void gold_generate_lanes8(uint32_t c_init, uint32_t word_off, uint32_t *c, uint32_t nwords, uint32_t chunk)
+{
+    uint32_t r1[8], r2[8], w[8];
+    for (int l = 0; l < 8; l++)
+        gold_registers_at(c_init, word_off + l * chunk, &r1[l], &r2[l]);
+    simde__m128i x1lo = simde_mm_loadu_si128((const simde__m128i *)r1);
+    simde__m128i x1hi = simde_mm_loadu_si128((const simde__m128i *)(r1 + 4));
+    simde__m128i x2lo = simde_mm_loadu_si128((const simde__m128i *)r2);
+    simde__m128i x2hi = simde_mm_loadu_si128((const simde__m128i *)(r2 + 4));
+
+    /* Only the last lane can run past nwords */
+    const uint32_t last = nwords - 7 * chunk;
+    for (uint32_t k = 0; k < chunk; k++) {
+        simde_mm_storeu_si128((simde__m128i *)w, simde_mm_xor_si128(x1lo, x2lo));
+        simde_mm_storeu_si128((simde__m128i *)(w + 4), simde_mm_xor_si128(x1hi, x2hi));
+        for (int l = 0; l < 7; l++)
+            c[l * chunk + k] = w[l];
+        if (k < last) c[7 * chunk + k] = w[7];
+        gold_next4(&x1lo, &x2lo);
+        gold_next4(&x1hi, &x2hi);
+    }
+}
+
+void nr_gold_generate_at(uint32_t c_init, uint32_t word_off, uint32_t *c, uint32_t nwords)
+{
+    /* Below a few hundred words the eight jumps cost more than they save */
+    if (nwords >= NR_GOLD_LANES_MIN_WORDS) {
+        gold_generate_lanes8(c_init, word_off, c, nwords, (nwords + 7) / 8);
+        return;
+    }
+
+    uint32_t x1, x2;
+    if (word_off == 0) {
+        gold_start(c_init, &x1, &x2);
+    } else {
+        gold_registers_at(c_init, word_off - 1, &x1, &x2);
+    }
+    for (uint32_t i = 0; i < nwords; i++)
+        c[i] = gold_next(&x1, &x2);
+}
+
+typedef struct {
+    uint32_t c_init;
+    uint32_t nwords;
+    uint32_t chunk;
+    uint32_t *c;
+    const uint8_t *in;        /* scrambling input, one bit per byte, or NULL */
+    uint32_t size;
+} gold_mt_job_t;
+
+static void gold_mt_task(void *arg, int t)
+{
+    const gold_mt_job_t *job = arg;
+    const uint32_t w0 = (uint32_t)t * job->chunk;
+    if (w0 >= job->nwords) return;
+    const uint32_t n = (job->nwords - w0) < job->chunk ? job->nwords - w0 : job->chunk;
+
+    nr_gold_generate_at(job->c_init, w0, job->c + w0, n);
+    if (job->in) {
+        const uint32_t bits = (job->size - 32 * w0) < 32 * n ? job->size - 32 * w0 : 32 * n;
+        nr_gold_scramble_bytes(job->in + 32 * w0, bits, job->c + w0, job->c + w0);
+    }
+}
+
+void nr_gold_generate_mt(worker_pool_t *pool, uint32_t c_init, uint32_t *c, uint32_t nwords)
+{
+    const int nb_tasks = worker_pool_size(pool);
+    gold_mt_job_t job = {
+        .c_init = c_init,
+        .nwords = nwords,
+        .chunk = (nwords + nb_tasks - 1) / nb_tasks,
+        .c = c,
+        .in = NULL,
+        .size = 0
+    };
+    worker_pool_run(pool, gold_mt_task, &job, nb_tasks);
+}
+
+void nr_codeword_scrambling_mt(worker_pool_t *pool, const uint8_t *in, uint32_t size,
+                               uint8_t q, uint32_t Nid, uint32_t n_RNTI, uint32_t *out)
+{
+    const int nb_tasks = worker_pool_size(pool);
+    const uint32_t nwords = (size + 31) >> 5;
+    gold_mt_job_t job = {
+        .c_init = nr_gold_pdsch_cinit(n_RNTI, q, Nid),
+        .nwords = nwords,
+        .chunk = (nwords + nb_tasks - 1) / nb_tasks,
+        .c = out,
+        .in = in,
+        .size = size
+    };
+    worker_pool_run(pool, gold_mt_task, &job, nb_tasks);
+}
+
+nr_gold_cache_t *nr_gold_cache_init(int nb_entries, uint32_t max_bits)
+{
+    if (nb_entries < 1 || max_bits == 0) return NULL;
+
+    nr_gold_cache_t *cache = calloc(1, sizeof(*cache));
+    if (!cache) return NULL;
+
+    int hsize = 1;
+    while (hsize < 2 * nb_entries) hsize <<= 1;
+
+    cache->nb_entries = nb_entries;
+    cache->max_words = (max_bits + 31) >> 5;
+    cache->hash_mask = hsize - 1;
+    cache->hash = malloc(hsize * sizeof(int));
+    cache->entries = calloc(nb_entries, sizeof(nr_gold_entry_t));
+    cache->mem = aligned_alloc(64, ((size_t)nb_entries * cache->max_words * sizeof(uint32_t) + 63) & ~(size_t)63);
+    if (!cache->hash || !cache->entries || !cache->mem) {
+        nr_gold_cache_free(cache);
+        return NULL;
+    }
+
+    for (int h = 0; h < hsize; h++)
+        cache->hash[h] = -1;
+
+    /* All slots start free, chained in index order */
+    for (int e = 0; e < nb_entries; e++) {
+        nr_gold_entry_t *en = &cache->entries[e];
+        en->seq = cache->mem + (size_t)e * cache->max_words;
+        en->prev = e - 1;
+        en->next = (e + 1 < nb_entries) ? e + 1 : -1;
+        en->hnext = -1;
+    }
+    cache->head = 0;
+    cache->tail = nb_entries - 1;
+    return cache;
+}
+
+void nr_gold_cache_free(nr_gold_cache_t *cache)
+{
+    if (!cache) return;
+    free(cache->hash);
+    free(cache->entries);
+    free(cache->mem);
+    free(cache);
+}
+
+void nr_gold_cache_reset_stats(nr_gold_cache_t *cache)
+{
+    cache->hits = cache->misses = cache->extends = cache->evictions = 0;
+}
+
+static inline int gold_hash(const nr_gold_cache_t *cache, uint32_t c_init)
+{
+    return (int)((c_init * 0x9E3779B1u) >> 16) & cache->hash_mask;
+}
+
+static void lru_unlink(nr_gold_cache_t *cache, int e)
+{
+    nr_gold_entry_t *en = &cache->entries[e];
+    if (en->prev >= 0) cache->entries[en->prev].next = en->next;
+    else cache->head = en->next;
+    if (en->next >= 0) cache->entries[en->next].prev = en->prev;
+    else cache->tail = en->prev;
+}
+
+static void lru_push_front(nr_gold_cache_t *cache, int e)
+{
+    nr_gold_entry_t *en = &cache->entries[e];
+    en->prev = -1;
+    en->next = cache->head;
+    if (cache->head >= 0) cache->entries[cache->head].prev = e;
+    cache->head = e;
+    if (cache->tail < 0) cache->tail = e;
+}
+
+static void hash_remove(nr_gold_cache_t *cache, int e)
+{
+    int *p = &cache->hash[gold_hash(cache, cache->entries[e].c_init)];
+    while (*p != e)
+        p = &cache->entries[*p].hnext;
+    *p = cache->entries[e].hnext;
+}
+
+const uint32_t *nr_gold_cache_get(nr_gold_cache_t *cache, uint32_t c_init, uint32_t nbits)
+{
+    const uint32_t nwords = (nbits + 31) >> 5;
+    if (nwords > cache->max_words) {
+        printf("nr_gold_cache_get: %u bits exceed the cache capacity (%u words)\n", nbits, cache->max_words);
+        return NULL;
+    }
+
+    const int h = gold_hash(cache, c_init);
+    int e = cache->hash[h];
+    while (e >= 0 && cache->entries[e].c_init != c_init)
+        e = cache->entries[e].hnext;
+
+    if (e >= 0) {
+        cache->hits++;
+    } else {
+        /* Take the least recently used slot */
+        cache->misses++;
+        e = cache->tail;
+        nr_gold_entry_t *en = &cache->entries[e];
+        if (en->nwords) {
+            cache->evictions++;
+            hash_remove(cache, e);
+        }
+        en->c_init = c_init;
+        en->nwords = 0;
+        en->hnext = cache->hash[h];
+        cache->hash[h] = e;
+    }
+
+    /* A longer request leaps to the end of the cached words and extends them */
+    nr_gold_entry_t *en = &cache->entries[e];
+    if (en->nwords < nwords) {
+        if (en->nwords) cache->extends++;
+        nr_gold_generate_at(c_init, en->nwords, en->seq + en->nwords, nwords - en->nwords);
+        en->nwords = nwords;
+    }
+
+    if (cache->head != e) {
+        lru_unlink(cache, e);
+        lru_push_front(cache, e);
+    }
+    return en->seq;
+}
+
+void nr_gold_xor_words(const uint32_t *in, const uint32_t *c, uint32_t nbits, uint32_t *out)
+{
+    const uint32_t nwords = (nbits + 31) >> 5;
+    uint32_t i = 0;
+    for (; i + 4 <= nwords; i += 4) {
+        const simde__m128i x = simde_mm_loadu_si128((const simde__m128i *)(in + i));
+        const simde__m128i s = simde_mm_loadu_si128((const simde__m128i *)(c + i));
+        simde_mm_storeu_si128((simde__m128i *)(out + i), simde_mm_xor_si128(x, s));
+    }
+    for (; i < nwords; i++)
+        out[i] = in[i] ^ c[i];
+}
+
+void nr_gold_scramble_bytes(const uint8_t *in, uint32_t size, const uint32_t *c, uint32_t *out)
+{
+    const simde__m128i one = simde_mm_set1_epi8(1);
+    uint32_t i = 0;
+
+    /* Bit 0 of each byte to bit 7, then movemask packs 16 bits LSB-first */
+    for (; i + 32 <= size; i += 32) {
+        const simde__m128i lo = simde_mm_and_si128(simde_mm_loadu_si128((const simde__m128i *)(in + i)), one);
+        const simde__m128i hi = simde_mm_and_si128(simde_mm_loadu_si128((const simde__m128i *)(in + i + 16)), one);
+        const uint32_t w = (uint32_t)simde_mm_movemask_epi8(simde_mm_slli_epi16(lo, 7))
+                         | ((uint32_t)simde_mm_movemask_epi8(simde_mm_slli_epi16(hi, 7)) << 16);
+        out[i >> 5] = w ^ c[i >> 5];
+    }
+    if (i < size) {
+        uint32_t w = 0;
+        for (uint32_t b = 0; i + b < size; b++)
+            w |= (uint32_t)(in[i + b] & 1) << b;
+        out[i >> 5] = w ^ c[i >> 5];
+    }
+}
+
+void nr_gold_descramble_llr16(int16_t *llr, uint32_t size, const uint32_t *c)
+{
+    /* Lane j of the mask is all ones when bit j of the sequence byte is set */
+    const simde__m128i bitsel = simde_mm_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128);
+    uint32_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        const uint8_t b = (uint8_t)(c[i >> 5] >> (i & 31));
+        const simde__m128i m = simde_mm_cmpeq_epi16(simde_mm_and_si128(simde_mm_set1_epi16(b), bitsel), bitsel);
+        simde__m128i v = simde_mm_loadu_si128((const simde__m128i *)(llr + i));
+        v = simde_mm_sub_epi16(simde_mm_xor_si128(v, m), m);
+        simde_mm_storeu_si128((simde__m128i *)(llr + i), v);
+    }
+    for (; i < size; i++)
+        if ((c[i >> 5] >> (i & 31)) & 1)
+            llr[i] = -llr[i];
+}
+
+int nr_codeword_scrambling_cached(nr_gold_cache_t *cache, const uint8_t *in, uint32_t size,
+                                  uint8_t q, uint32_t Nid, uint32_t n_RNTI, uint32_t *out)
+{
+    const uint32_t *c = nr_gold_cache_get(cache, nr_gold_pdsch_cinit(n_RNTI, q, Nid), size);
+    if (!c) return -1;
+    nr_gold_scramble_bytes(in, size, c, out);
+    return 0;
+}
+
+int nr_codeword_unscrambling_cached(nr_gold_cache_t *cache, int16_t *llr, uint32_t size,
+                                    uint8_t q, uint32_t Nid, uint32_t n_RNTI)
+{
+    const uint32_t *c = nr_gold_cache_get(cache, nr_gold_pdsch_cinit(n_RNTI, q, Nid), size);
+    if (!c) return -1;
+    nr_gold_descramble_llr16(llr, size, c);
+    return 0;
+}
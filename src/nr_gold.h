@@ -0,0 +1,96 @@
+#ifndef NR_GOLD_H
+#define NR_GOLD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "nr_worker_pool.h"
+
+/* 38.211 5.2.1 length-31 Gold sequence c(n) and the PDSCH codeword
+ * (de)scrambling built on it (38.211 7.3.1.1).
+ *
+ * Sequences are packed LSB-first in 32-bit words (c(n) is bit n&31 of word
+ * n>>5), the layout of lte_gold_generic() and of nr_codeword_scrambling()
+ * output. A bounded LRU cache keeps the sequences of the recently scheduled
+ * scrambling identities so that scrambling reduces to an XOR (TX) or a sign
+ * flip (RX) over cached words. */
+
+/* 38.211 7.3.1.1 scrambling initialisation of codeword q */
+static inline uint32_t nr_gold_pdsch_cinit(uint32_t n_RNTI, uint8_t q, uint32_t Nid)
+{
+    return (n_RNTI << 15) + ((uint32_t)q << 14) + Nid;
+}
+
+/* 38.211 7.4.1.1.1 initialisation of the PDSCH DMRS sequence of symbol l of
+ * slot, also the one of the PTRS (7.4.1.2.1) */
+static inline uint32_t nr_gold_pdsch_dmrs_cinit(int slot, int l, uint32_t Nid, uint8_t n_scid)
+{
+    return (uint32_t)(((1ull << 17) * (uint64_t)(14 * slot + l + 1) * (2 * Nid + 1) + 2 * Nid + n_scid) & 0x7fffffff);
+}
+
+/* First nwords words of c(n) for c_init, including the Nc = 1600 warm-up */
+void nr_gold_generate(uint32_t c_init, uint32_t *c, uint32_t nwords);
+
+/* Words [word_off, word_off + nwords) of c(n). The registers leap to any
+ * offset with precomputed GF(2) jump matrices (x^(2^k) of both m-sequences),
+ * so disjoint chunks can be generated independently: from
+ * NR_GOLD_LANES_MIN_WORDS words on, eight chunks run in parallel SIMD lanes. */
+#define NR_GOLD_LANES_MIN_WORDS 512
+void nr_gold_generate_at(uint32_t c_init, uint32_t word_off, uint32_t *c, uint32_t nwords);
+
+/* nr_gold_generate() split over the threads of pool */
+void nr_gold_generate_mt(worker_pool_t *pool, uint32_t c_init, uint32_t *c, uint32_t nwords);
+
+/* nr_codeword_scrambling() split over the threads of pool: each thread leaps to
+ * its chunk of the sequence and scrambles the matching input bits */
+void nr_codeword_scrambling_mt(worker_pool_t *pool, const uint8_t *in, uint32_t size,
+                               uint8_t q, uint32_t Nid, uint32_t n_RNTI, uint32_t *out);
+
+typedef struct nr_gold_entry_s {
+    uint32_t c_init;
+    uint32_t nwords;          /* valid words in seq, 0 for a free slot */
+    int prev, next;           /* LRU list, most recent first */
+    int hnext;                /* hash chain */
+    uint32_t *seq;            /* [max_words] */
+} nr_gold_entry_t;
+
+typedef struct nr_gold_cache_s {
+    int nb_entries;
+    uint32_t max_words;
+    int hash_mask;
+    int *hash;                /* [hash_mask + 1] chain heads, -1 when empty */
+    int head, tail;           /* LRU ends */
+    nr_gold_entry_t *entries;
+    uint32_t *mem;            /* [nb_entries][max_words] */
+    uint64_t hits, misses, extends, evictions;
+} nr_gold_cache_t;
+
+/* Cache of nb_entries sequences of up to max_bits bits each */
+nr_gold_cache_t *nr_gold_cache_init(int nb_entries, uint32_t max_bits);
+void nr_gold_cache_free(nr_gold_cache_t *cache);
+
+/* Sequence of c_init covering at least nbits bits. A shorter cached sequence
+ * is extended in place, a miss evicts the least recently used entry. The
+ * pointer stays valid until the entry is evicted. Returns NULL when nbits
+ * exceeds the cache capacity. */
+const uint32_t *nr_gold_cache_get(nr_gold_cache_t *cache, uint32_t c_init, uint32_t nbits);
+
+void nr_gold_cache_reset_stats(nr_gold_cache_t *cache);
+
+/* out = in ^ c over nbits bits of LSB-first packed words */
+void nr_gold_xor_words(const uint32_t *in, const uint32_t *c, uint32_t nbits, uint32_t *out);
+
+/* nr_codeword_scrambling() on a cached sequence: in holds one bit per byte,
+ * out gets ceil(size / 32) scrambled words */
+void nr_gold_scramble_bytes(const uint8_t *in, uint32_t size, const uint32_t *c, uint32_t *out);
+
+/* nr_codeword_unscrambling() on a cached sequence: llr[i] = -llr[i] where c(i) = 1 */
+void nr_gold_descramble_llr16(int16_t *llr, uint32_t size, const uint32_t *c);
+
+/* Cached drop-ins for nr_codeword_scrambling() / nr_codeword_unscrambling().
+ * Return -1 (and leave the data untouched) when size exceeds the cache. */
+int nr_codeword_scrambling_cached(nr_gold_cache_t *cache, const uint8_t *in, uint32_t size,
+                                  uint8_t q, uint32_t Nid, uint32_t n_RNTI, uint32_t *out);
+int nr_codeword_unscrambling_cached(nr_gold_cache_t *cache, int16_t *llr, uint32_t size,
+                                    uint8_t q, uint32_t Nid, uint32_t n_RNTI);
+
+#endif
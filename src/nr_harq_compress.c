@@ -0,0 +1,221 @@
+/*
+ * Block-scaled 4..6 bit HARQ soft-buffer store on top of the rate recovery
+ * stage: quantize on write, expand on read.
+ */
+
+#include "nr_harq_compress.h"
+#include "nr_rate_matching.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <simde/x86/sse2.h>
+#include <simde/x86/ssse3.h>
+
+nr_harq_cstore_t *nr_harq_cstore_init(int nb_procs, uint32_t max_C, uint32_t max_E, int qbits)
+{
+    if (nb_procs < 1 || max_C == 0 || qbits < 4 || qbits > 6) return NULL;
+
+    nr_harq_cstore_t *st = calloc(1, sizeof(*st));
+    if (!st) return NULL;
+
+    st->nb_procs = nb_procs;
+    st->qbits = qbits;
+    st->max_C = max_C;
+    st->max_E = max_E;
+    /* Largest circular buffer is 66 * 384 (BG1, Zc = 384) */
+    st->blocks_per_cb = (66 * 384 + NR_HQC_BLOCK - 1) / NR_HQC_BLOCK;
+    st->block_bytes = NR_HQC_BLOCK * qbits / 8;
+    /* The packer stores and the expander loads 16 bytes per 16-code group */
+    st->cb_bytes = (st->blocks_per_cb * (1 + st->block_bytes) + 16 + 63) & ~(size_t)63;
+    st->mem_size = (size_t)nb_procs * max_C * st->cb_bytes;
+
+    st->mem = aligned_alloc(64, st->mem_size);
+    st->w = aligned_alloc(64, st->blocks_per_cb * NR_HQC_BLOCK * sizeof(int16_t));
+    st->e = aligned_alloc(64, ((size_t)max_E * sizeof(int16_t) + 16 + 63) & ~(size_t)63);
+    st->procs = calloc(nb_procs, sizeof(nr_harq_proc_t));
+    if (!st->mem || !st->w || !st->e || !st->procs) {
+        nr_harq_cstore_free(st);
+        return NULL;
+    }
+
+    /* Touch every page now so the first slots do not pay the page faults */
+    memset(st->mem, 0, st->mem_size);
+    memset(st->w, 0, st->blocks_per_cb * NR_HQC_BLOCK * sizeof(int16_t));
+    return st;
+}
+
+void nr_harq_cstore_free(nr_harq_cstore_t *st)
+{
+    if (!st) return;
+    free(st->mem);
+    free(st->w);
+    free(st->e);
+    free(st->procs);
+    free(st);
+}
+
+static inline uint8_t *hqc_cb(const nr_harq_cstore_t *st, int pid, uint32_t r)
+{
+    return st->mem + ((size_t)pid * st->max_C + r) * st->cb_bytes;
+}
+
+int nr_harq_cstore_reset(nr_harq_cstore_t *st, int pid, const nr_tb_seg_t *seg)
+{
+    if (!st || !seg || pid < 0 || pid >= st->nb_procs || seg->C > st->max_C) return -1;
+
+    nr_harq_proc_t *h = &st->procs[pid];
+    h->active = 1;
+    h->round = 0;
+    h->C = seg->C;
+    h->Ncb = seg->Ncb;
+
+    /* Zero payload with shift 0 expands to zero LLRs */
+    for (uint32_t r = 0; r < seg->C; r++)
+        memset(hqc_cb(st, pid, r), 0, st->cb_bytes);
+    return 0;
+}
+
+/* Block payload layout: two groups of 16 codes, each 2*qbits bytes holding
+ * the qbits-bit two's complement codes packed LSB-first */
+
+void nr_hqc_compress(const int16_t *w, uint32_t n, int qbits, uint8_t *shifts, uint8_t *payload)
+{
+    const int qmax = (1 << (qbits - 1)) - 1;
+    /* Gather bytes 0..qbits-1 of both 64-bit lanes to the front */
+    uint8_t pk[16];
+    for (int i = 0; i < 16; i++)
+        pk[i] = (i < qbits) ? i : (i < 2 * qbits ? 8 + i - qbits : 0x80);
+    const simde__m128i vpk = simde_mm_loadu_si128((const simde__m128i *)pk);
+    const simde__m128i vmask = simde_mm_set1_epi8((char)((1 << qbits) - 1));
+    const simde__m128i w1 = simde_mm_set1_epi16((int16_t)(1 | (1 << (qbits + 8))));
+    const simde__m128i w2 = simde_mm_set1_epi32(1 | (1 << (2 * qbits + 16)));
+    const simde__m128i lo32 = simde_mm_set_epi32(0, -1, 0, -1);
+    const simde__m128i hcnt = simde_mm_cvtsi32_si128(32 - 4 * qbits);
+
+    for (uint32_t b = 0; b < n / NR_HQC_BLOCK; b++) {
+        const int16_t *blk = w + b * NR_HQC_BLOCK;
+        simde__m128i v[NR_HQC_BLOCK / 8];
+        simde__m128i vmax = simde_mm_set1_epi16(0), vmin = simde_mm_set1_epi16(0);
+        for (int k = 0; k < NR_HQC_BLOCK / 8; k++) {
+            v[k] = simde_mm_loadu_si128((const simde__m128i *)(blk + 8 * k));
+            vmax = simde_mm_max_epi16(vmax, v[k]);
+            vmin = simde_mm_min_epi16(vmin, v[k]);
+        }
+        int16_t hmax[8], hmin[8];
+        simde_mm_storeu_si128((simde__m128i *)hmax, vmax);
+        simde_mm_storeu_si128((simde__m128i *)hmin, vmin);
+        int32_t mag = 0;
+        for (int k = 0; k < 8; k++) {
+            if (hmax[k] > mag) mag = hmax[k];
+            if (-hmin[k] > mag) mag = -hmin[k];
+        }
+
+        /* Smallest scale that keeps the largest magnitude in range; codes are
+         * also capped so that expanding them cannot overflow int16 */
+        int shift = 0;
+        while ((qmax << shift) < mag) shift++;
+        shifts[b] = (uint8_t)shift;
+        const int qhi = (qmax << shift) > 32767 ? (32767 >> shift) : qmax;
+
+        const simde__m128i cnt = simde_mm_cvtsi32_si128(shift);
+        const simde__m128i half = simde_mm_set1_epi16((int16_t)((1 << shift) >> 1));
+        const simde__m128i vqmax = simde_mm_set1_epi16((int16_t)qhi);
+        const simde__m128i vqmin = simde_mm_set1_epi16((int16_t)-qhi);
+        for (int k = 0; k < NR_HQC_BLOCK / 8; k++) {
+            v[k] = simde_mm_sra_epi16(simde_mm_adds_epi16(v[k], half), cnt);
+            v[k] = simde_mm_max_epi16(simde_mm_min_epi16(v[k], vqmax), vqmin);
+        }
+
+        /* Bytes -> 2*qbits bit pairs -> 4*qbits bit quads -> 8*qbits bit
+         * 64-bit lanes, then squeeze out the unused bytes */
+        uint8_t *p = payload + (size_t)b * (NR_HQC_BLOCK * qbits / 8);
+        for (int g = 0; g < 2; g++) {
+            simde__m128i x = simde_mm_and_si128(simde_mm_packs_epi16(v[2 * g], v[2 * g + 1]), vmask);
+            x = simde_mm_maddubs_epi16(x, w1);
+            x = simde_mm_madd_epi16(x, w2);
+            x = simde_mm_or_si128(simde_mm_and_si128(x, lo32), simde_mm_srl_epi64(simde_mm_andnot_si128(lo32, x), hcnt));
+            simde_mm_storeu_si128((simde__m128i *)(p + 2 * qbits * g), simde_mm_shuffle_epi8(x, vpk));
+        }
+    }
+}
+
+void nr_hqc_expand(const uint8_t *shifts, const uint8_t *payload, uint32_t n, int qbits, int16_t *w)
+{
+    /* Code j of a group sits at bit j*qbits: fetch its two bytes into lane j,
+     * move its MSB to bit 15 with a multiply and sign-extend with srai */
+    uint8_t idx[16];
+    int16_t mul[8];
+    simde__m128i vidx[2], vmul[2];
+    for (int h = 0; h < 2; h++) {
+        for (int j = 0; j < 8; j++) {
+            const int bit = (8 * h + j) * qbits;
+            idx[2 * j] = (uint8_t)(bit >> 3);
+            idx[2 * j + 1] = (uint8_t)((bit >> 3) + 1);
+            mul[j] = (int16_t)(1u << (16 - qbits - (bit & 7)));
+        }
+        vidx[h] = simde_mm_loadu_si128((const simde__m128i *)idx);
+        vmul[h] = simde_mm_loadu_si128((const simde__m128i *)mul);
+    }
+    const simde__m128i scnt = simde_mm_cvtsi32_si128(16 - qbits);
+
+    for (uint32_t b = 0; b < n / NR_HQC_BLOCK; b++) {
+        const uint8_t *p = payload + (size_t)b * (NR_HQC_BLOCK * qbits / 8);
+        const simde__m128i cnt = simde_mm_cvtsi32_si128(shifts[b]);
+        int16_t *blk = w + b * NR_HQC_BLOCK;
+        for (int g = 0; g < 2; g++) {
+            const simde__m128i x = simde_mm_loadu_si128((const simde__m128i *)(p + 2 * qbits * g));
+            for (int h = 0; h < 2; h++) {
+                simde__m128i y = simde_mm_mullo_epi16(simde_mm_shuffle_epi8(x, vidx[h]), vmul[h]);
+                y = simde_mm_sll_epi16(simde_mm_sra_epi16(y, scnt), cnt);
+                simde_mm_storeu_si128((simde__m128i *)(blk + 16 * g + 8 * h), y);
+            }
+        }
+    }
+}
+
+void nr_harq_cstore_read_cb(const nr_harq_cstore_t *st, int pid, uint32_t r, const nr_tb_seg_t *seg, int16_t *w)
+{
+    const uint8_t *cb = hqc_cb(st, pid, r);
+    const uint32_t nblocks = (seg->Ncb + NR_HQC_BLOCK - 1) / NR_HQC_BLOCK;
+    nr_hqc_expand(cb, cb + st->blocks_per_cb, nblocks * NR_HQC_BLOCK, st->qbits, w);
+}
+
+int nr_harq_cstore_combine_tb(nr_harq_cstore_t *st, int pid, const nr_tb_seg_t *seg, uint32_t G,
+                              uint8_t Qm, uint8_t nb_layers, uint8_t rv, const int16_t *llr)
+{
+    if (!st || !seg || !llr || !nb_layers || pid < 0 || pid >= st->nb_procs) return -1;
+
+    nr_harq_proc_t *h = &st->procs[pid];
+    if (!h->active || h->C != seg->C || h->Ncb != seg->Ncb) {
+        printf("nr_harq_cstore_combine_tb: HARQ process %d not reset for this TB\n", pid);
+        return -1;
+    }
+
+    const uint32_t nblocks = (seg->Ncb + NR_HQC_BLOCK - 1) / NR_HQC_BLOCK;
+    uint32_t off = 0;
+    for (uint32_t r = 0; r < seg->C; r++) {
+        const uint32_t E = nr_rm_get_E(seg, G, Qm, nb_layers, r);
+        if (E > st->max_E) return -1;
+
+        uint8_t *cb = hqc_cb(st, pid, r);
+        nr_hqc_expand(cb, cb + st->blocks_per_cb, nblocks * NR_HQC_BLOCK, st->qbits, st->w);
+        if (nr_rate_recovery_cb_into16(st->w, st->e, seg, rv, Qm, E, llr + off) < 0) return -1;
+        nr_hqc_compress(st->w, nblocks * NR_HQC_BLOCK, st->qbits, cb, cb + st->blocks_per_cb);
+        off += E;
+    }
+    h->round++;
+    return (int)off;
+}
+
+void nr_harq_cstore_decoder_input(nr_harq_cstore_t *st, int pid, uint32_t r, const nr_tb_seg_t *seg, int8_t *z)
+{
+    const uint32_t d0 = 2 * seg->Zc;
+
+    nr_harq_cstore_read_cb(st, pid, r, seg, st->w);
+    memset(z, 0, d0);
+    for (uint32_t t = 0; t < seg->Ncb; t++)
+        z[d0 + t] = (int8_t)(st->w[t] > 127 ? 127 : (st->w[t] < -128 ? -128 : st->w[t]));
+
+    /* Filler bits are known zeros */
+    memset(z + seg->Kprime, NR_RR_FILLER_LLR, seg->K - seg->Kprime);
+}
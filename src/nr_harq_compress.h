@@ -0,0 +1,56 @@
+#ifndef NR_HARQ_COMPRESS_H
+#define NR_HARQ_COMPRESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "nr_tb_segmentation.h"
+#include "nr_rate_recovery.h"
+
+/* Compressed HARQ soft-buffer store. The circular buffer of every code block
+ * is kept as blocks of NR_HQC_BLOCK LLRs sharing one power-of-two scale: each
+ * LLR is stored on qbits (4..6) bits as round(llr / 2^shift), the shift being
+ * the smallest one that fits the largest magnitude of the block.
+ *
+ * Combining expands the code block to int16, adds the new LLRs with the
+ * regular rate recovery and quantizes it back, so only one code block is ever
+ * held at full precision. */
+
+#define NR_HQC_BLOCK 32
+
+typedef struct nr_harq_cstore_s {
+    int nb_procs;
+    int qbits;                /* bits per stored LLR: 4, 5 or 6 */
+    uint32_t max_C;
+    uint32_t max_E;
+    uint32_t blocks_per_cb;   /* NR_HQC_BLOCK-LLR blocks covering the largest Ncb */
+    size_t block_bytes;       /* packed payload per block: NR_HQC_BLOCK * qbits / 8 */
+    size_t cb_bytes;          /* shifts + payloads of one code block, 64-byte aligned */
+    uint8_t *mem;             /* [nb_procs][max_C][cb_bytes] */
+    size_t mem_size;          /* bytes */
+    int16_t *w;               /* expanded code block scratch */
+    int16_t *e;               /* de-interleaving scratch [max_E] */
+    nr_harq_proc_t *procs;    /* [nb_procs] */
+} nr_harq_cstore_t;
+
+nr_harq_cstore_t *nr_harq_cstore_init(int nb_procs, uint32_t max_C, uint32_t max_E, int qbits);
+void nr_harq_cstore_free(nr_harq_cstore_t *st);
+
+/* New data: clear the soft buffers of process pid for a TB segmented as seg */
+int nr_harq_cstore_reset(nr_harq_cstore_t *st, int pid, const nr_tb_seg_t *seg);
+
+/* Rate recovery of a whole TB (see nr_rate_recovery_tb) into the compressed
+ * soft buffers of process pid. Returns G or -1. */
+int nr_harq_cstore_combine_tb(nr_harq_cstore_t *st, int pid, const nr_tb_seg_t *seg, uint32_t G,
+                              uint8_t Qm, uint8_t nb_layers, uint8_t rv, const int16_t *llr);
+
+/* Expand the Ncb soft values of code block r to int16 */
+void nr_harq_cstore_read_cb(const nr_harq_cstore_t *st, int pid, uint32_t r, const nr_tb_seg_t *seg, int16_t *w);
+
+/* Decoder input of code block r, same layout as nr_harq_cb_decoder_input */
+void nr_harq_cstore_decoder_input(nr_harq_cstore_t *st, int pid, uint32_t r, const nr_tb_seg_t *seg, int8_t *z);
+
+/* Block-scaled quantization of n LLRs (n multiple of NR_HQC_BLOCK) and back */
+void nr_hqc_compress(const int16_t *w, uint32_t n, int qbits, uint8_t *shifts, uint8_t *payload);
+void nr_hqc_expand(const uint8_t *shifts, const uint8_t *payload, uint32_t n, int qbits, int16_t *w);
+
+#endif
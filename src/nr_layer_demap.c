@@ -0,0 +1,218 @@
+/*
+ * Layer demapping of the UE LLRs: SIMD kernels specialized per (Nl, Qm)
+ * and the fused demapping + descrambling + int8 saturation feeding the LDPC
+ * decoder.
+ */
+
+#include "nr_layer_demap.h"
+#include "nr_layer_mapping.h"
+#include <stdio.h>
+#include <string.h>
+#include <simde/x86/sse2.h>
+
+/* REs per group of the specialized kernels: one 16-byte vector per layer */
+#define LDM_GROUP_RE(Qm) ((Qm) == 2 ? 4 : (Qm) == 4 ? 2 : 1)
+
+#define LDM_SHUFFLE_PS(a, b, imm) \
+    simde_mm_castps_si128(simde_mm_shuffle_ps(simde_mm_castsi128_ps(a), simde_mm_castsi128_ps(b), imm))
+
+/* Body of the specialized kernels; with Nl and Qm constant the branches fold
+ * away. REs of 2, 4 and 8 LLRs are 32/64/128-bit transposes of one vector per
+ * layer. A 64-QAM RE is 12 bytes: every (RE, layer) is one 16-byte load and
+ * store in codeword order, the extra 4 bytes being overwritten by the next
+ * store, so the last one of the buffer goes through memcpy. */
+static inline __attribute__((always_inline))
+void ldm_demap_body(const int16_t *llr_layers, uint32_t layer_sz, uint32_t nb_re, int16_t *cw,
+                    const int Nl, const int Qm)
+{
+    uint32_t re = 0;
+
+    if (Qm == 6) {
+        for (; re + 1 < nb_re; re++)
+            for (int l = 0; l < Nl; l++)
+                simde_mm_storeu_si128((simde__m128i *)(cw + (re * Nl + l) * 6),
+                                      simde_mm_loadu_si128((const simde__m128i *)(llr_layers + l * layer_sz + re * 6)));
+    } else {
+        const int G = LDM_GROUP_RE(Qm);
+        for (; re + G <= nb_re; re += G) {
+            simde__m128i in[4];
+            for (int l = 0; l < Nl; l++)
+                in[l] = simde_mm_loadu_si128((const simde__m128i *)(llr_layers + l * layer_sz + re * Qm));
+            simde__m128i *dst = (simde__m128i *)(cw + re * Nl * Qm);
+
+            if (Qm == 8) {
+                for (int l = 0; l < Nl; l++)
+                    simde_mm_storeu_si128(dst + l, in[l]);
+            } else if (Qm == 4 && Nl == 2) {
+                simde_mm_storeu_si128(dst + 0, simde_mm_unpacklo_epi64(in[0], in[1]));
+                simde_mm_storeu_si128(dst + 1, simde_mm_unpackhi_epi64(in[0], in[1]));
+            } else if (Qm == 4 && Nl == 3) {
+                simde_mm_storeu_si128(dst + 0, simde_mm_unpacklo_epi64(in[0], in[1]));
+                simde_mm_storeu_si128(dst + 1, simde_mm_castpd_si128(simde_mm_move_sd(simde_mm_castsi128_pd(in[0]),
+                                                                                      simde_mm_castsi128_pd(in[2]))));
+                simde_mm_storeu_si128(dst + 2, simde_mm_unpackhi_epi64(in[1], in[2]));
+            } else if (Qm == 4 && Nl == 4) {
+                simde_mm_storeu_si128(dst + 0, simde_mm_unpacklo_epi64(in[0], in[1]));
+                simde_mm_storeu_si128(dst + 1, simde_mm_unpacklo_epi64(in[2], in[3]));
+                simde_mm_storeu_si128(dst + 2, simde_mm_unpackhi_epi64(in[0], in[1]));
+                simde_mm_storeu_si128(dst + 3, simde_mm_unpackhi_epi64(in[2], in[3]));
+            } else if (Qm == 2 && Nl == 2) {
+                simde_mm_storeu_si128(dst + 0, simde_mm_unpacklo_epi32(in[0], in[1]));
+                simde_mm_storeu_si128(dst + 1, simde_mm_unpackhi_epi32(in[0], in[1]));
+            } else if (Qm == 2 && Nl == 3) {
+                /* a0 b0 c0 a1 | b1 c1 a2 b2 | c2 a3 b3 c3 */
+                const simde__m128i ab_lo = simde_mm_unpacklo_epi32(in[0], in[1]), ab_hi = simde_mm_unpackhi_epi32(in[0], in[1]);
+                const simde__m128i ca_lo = simde_mm_unpacklo_epi32(in[2], in[0]), ca_hi = simde_mm_unpackhi_epi32(in[2], in[0]);
+                const simde__m128i bc_lo = simde_mm_unpacklo_epi32(in[1], in[2]), bc_hi = simde_mm_unpackhi_epi32(in[1], in[2]);
+                simde_mm_storeu_si128(dst + 0, LDM_SHUFFLE_PS(ab_lo, ca_lo, SIMDE_MM_SHUFFLE(3, 0, 1, 0)));
+                simde_mm_storeu_si128(dst + 1, LDM_SHUFFLE_PS(bc_lo, ab_hi, SIMDE_MM_SHUFFLE(1, 0, 3, 2)));
+                simde_mm_storeu_si128(dst + 2, LDM_SHUFFLE_PS(ca_hi, bc_hi, SIMDE_MM_SHUFFLE(3, 2, 3, 0)));
+            } else if (Qm == 2 && Nl == 4) {
+                const simde__m128i t0 = simde_mm_unpacklo_epi32(in[0], in[1]), t1 = simde_mm_unpacklo_epi32(in[2], in[3]);
+                const simde__m128i t2 = simde_mm_unpackhi_epi32(in[0], in[1]), t3 = simde_mm_unpackhi_epi32(in[2], in[3]);
+                simde_mm_storeu_si128(dst + 0, simde_mm_unpacklo_epi64(t0, t1));
+                simde_mm_storeu_si128(dst + 1, simde_mm_unpackhi_epi64(t0, t1));
+                simde_mm_storeu_si128(dst + 2, simde_mm_unpacklo_epi64(t2, t3));
+                simde_mm_storeu_si128(dst + 3, simde_mm_unpackhi_epi64(t2, t3));
+            }
+        }
+    }
+    for (; re < nb_re; re++)
+        for (int l = 0; l < Nl; l++)
+            memcpy(cw + (re * Nl + l) * Qm, llr_layers + l * layer_sz + re * Qm, Qm * sizeof(int16_t));
+}
+
+#define LDM_KERNEL(NL, QM)                                                                              \
+    static void ldm_demap_##NL##_##QM(const int16_t *llr_layers, uint32_t layer_sz, uint32_t nb_re, int16_t *cw) \
+    {                                                                                                   \
+        ldm_demap_body(llr_layers, layer_sz, nb_re, cw, NL, QM);                                        \
+    }
+
+static void ldm_demap_1(const int16_t *llr_layers, uint32_t layer_sz, uint32_t nb_re, int16_t *cw, int Qm)
+{
+    (void)layer_sz;
+    memcpy(cw, llr_layers, (size_t)nb_re * Qm * sizeof(int16_t));
+}
+
+static void ldm_demap_1_2(const int16_t *l, uint32_t s, uint32_t n, int16_t *cw) { ldm_demap_1(l, s, n, cw, 2); }
+static void ldm_demap_1_4(const int16_t *l, uint32_t s, uint32_t n, int16_t *cw) { ldm_demap_1(l, s, n, cw, 4); }
+static void ldm_demap_1_6(const int16_t *l, uint32_t s, uint32_t n, int16_t *cw) { ldm_demap_1(l, s, n, cw, 6); }
+static void ldm_demap_1_8(const int16_t *l, uint32_t s, uint32_t n, int16_t *cw) { ldm_demap_1(l, s, n, cw, 8); }
+LDM_KERNEL(2, 2) LDM_KERNEL(2, 4) LDM_KERNEL(2, 6) LDM_KERNEL(2, 8)
+LDM_KERNEL(3, 2) LDM_KERNEL(3, 4) LDM_KERNEL(3, 6) LDM_KERNEL(3, 8)
+LDM_KERNEL(4, 2) LDM_KERNEL(4, 4) LDM_KERNEL(4, 6) LDM_KERNEL(4, 8)
+
+static const nr_layer_demap_fn ldm_dispatch[4][4] = {
+    { ldm_demap_1_2, ldm_demap_1_4, ldm_demap_1_6, ldm_demap_1_8 },
+    { ldm_demap_2_2, ldm_demap_2_4, ldm_demap_2_6, ldm_demap_2_8 },
+    { ldm_demap_3_2, ldm_demap_3_4, ldm_demap_3_6, ldm_demap_3_8 },
+    { ldm_demap_4_2, ldm_demap_4_4, ldm_demap_4_6, ldm_demap_4_8 },
+};
+
+nr_layer_demap_fn nr_layer_demap_get(uint8_t Nl, uint8_t Qm)
+{
+    if (Nl < 1 || Nl > 4 || Qm < 2 || Qm > 8 || (Qm & 1)) return NULL;
+    return ldm_dispatch[Nl - 1][Qm / 2 - 1];
+}
+
+int nr_layer_demap(const int16_t *llr_layers, uint32_t layer_sz, uint8_t Nl, uint8_t Qm,
+                   uint32_t length, int16_t *cw)
+{
+    const nr_layer_demap_fn fn = nr_layer_demap_get(Nl, Qm);
+    if (!fn) {
+        printf("nr_layer_demap: unsupported Nl %u / Qm %u\n", Nl, Qm);
+        return -1;
+    }
+    fn(llr_layers, layer_sz, length / (Nl * Qm), cw);
+    return 0;
+}
+
+/* Codeword LLRs [n0, n0 + n) of a demapped tile: the sign flips of the Gold
+ * sequence then saturation to int8. n0 is a multiple of 32. */
+static void ldm_unscramble_pack(const int16_t *cw, uint32_t n0, uint32_t n, const uint32_t *c, int8_t *out)
+{
+    const simde__m128i bitsel = simde_mm_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128);
+    uint32_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        const uint32_t k = n0 + i;
+        const uint16_t b = (uint16_t)(c[k >> 5] >> (k & 31));
+        const simde__m128i m0 = simde_mm_cmpeq_epi16(simde_mm_and_si128(simde_mm_set1_epi16(b & 0xFF), bitsel), bitsel);
+        const simde__m128i m1 = simde_mm_cmpeq_epi16(simde_mm_and_si128(simde_mm_set1_epi16(b >> 8), bitsel), bitsel);
+        simde__m128i v0 = simde_mm_loadu_si128((const simde__m128i *)(cw + i));
+        simde__m128i v1 = simde_mm_loadu_si128((const simde__m128i *)(cw + i + 8));
+        v0 = simde_mm_sub_epi16(simde_mm_xor_si128(v0, m0), m0);
+        v1 = simde_mm_sub_epi16(simde_mm_xor_si128(v1, m1), m1);
+        simde_mm_storeu_si128((simde__m128i *)(out + i), simde_mm_packs_epi16(v0, v1));
+    }
+    for (; i < n; i++) {
+        const uint32_t k = n0 + i;
+        int16_t v = cw[i];
+        if ((c[k >> 5] >> (k & 31)) & 1) v = (int16_t)-v;
+        out[i] = (int8_t)(v > 127 ? 127 : (v < -128 ? -128 : v));
+    }
+}
+
+int nr_layer_demap_cw(const int16_t *llr_layers, uint32_t layer_sz, uint8_t Nl, uint8_t Qm,
+                      uint32_t length, int16_t *const cw[2])
+{
+    int nl_cw[2];
+    if (nr_layer_cw_split(Nl, nl_cw) < 0 || !nr_layer_demap_get(1, Qm)) {
+        printf("nr_layer_demap_cw: unsupported Nl %u / Qm %u\n", Nl, Qm);
+        return -1;
+    }
+    const uint32_t nb_re = length / (Nl * Qm);
+    nr_layer_demap_get(nl_cw[0], Qm)(llr_layers, layer_sz, nb_re, cw[0]);
+    if (nl_cw[1])
+        nr_layer_demap_get(nl_cw[1], Qm)(llr_layers + (size_t)nl_cw[0] * layer_sz, layer_sz, nb_re, cw[1]);
+    return 0;
+}
+
+int nr_layer_demap_unscramble8(const int16_t *llr_layers, uint32_t layer_sz, uint8_t Nl, uint8_t Qm,
+                               uint32_t length, const uint32_t *c, int8_t *out)
+{
+    const nr_layer_demap_fn demap = nr_layer_demap_get(Nl, Qm);
+    if (!demap) {
+        printf("nr_layer_demap_unscramble8: unsupported Nl %u / Qm %u\n", Nl, Qm);
+        return -1;
+    }
+
+    int16_t cw[NR_LDM_TILE_RE * 4 * 8] __attribute__((aligned(64)));
+    const uint32_t re_llrs = (uint32_t)Nl * Qm;
+    const uint32_t nb_re = length / re_llrs;
+
+    /* One layer is already in codeword order */
+    if (Nl == 1) {
+        ldm_unscramble_pack(llr_layers, 0, nb_re * re_llrs, c, out);
+        return 0;
+    }
+
+    /* A tile holds a multiple of 128 LLRs, so every tile starts on a sequence word */
+    for (uint32_t re0 = 0; re0 < nb_re; re0 += NR_LDM_TILE_RE) {
+        const uint32_t nre = nb_re - re0 < NR_LDM_TILE_RE ? nb_re - re0 : NR_LDM_TILE_RE;
+        demap(llr_layers + re0 * Qm, layer_sz, nre, cw);
+        ldm_unscramble_pack(cw, re0 * re_llrs, nre * re_llrs, c, out + re0 * re_llrs);
+    }
+    return 0;
+}
+
+int nr_layer_demap_unscramble8_cached(nr_gold_cache_t *cache, const int16_t *llr_layers, uint32_t layer_sz,
+                                      uint8_t Nl, uint8_t Qm, uint32_t length,
+                                      uint8_t q, uint32_t Nid, uint32_t n_RNTI, int8_t *out)
+{
+    const uint32_t *c = nr_gold_cache_get(cache, nr_gold_pdsch_cinit(n_RNTI, q, Nid), length);
+    if (!c) return -1;
+    return nr_layer_demap_unscramble8(llr_layers, layer_sz, Nl, Qm, length, c, out);
+}
+
+void nr_llr16_to_int8(const int16_t *llr, uint32_t n, int8_t *out)
+{
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const simde__m128i v0 = simde_mm_loadu_si128((const simde__m128i *)(llr + i));
+        const simde__m128i v1 = simde_mm_loadu_si128((const simde__m128i *)(llr + i + 8));
+        simde_mm_storeu_si128((simde__m128i *)(out + i), simde_mm_packs_epi16(v0, v1));
+    }
+    for (; i < n; i++)
+        out[i] = (int8_t)(llr[i] > 127 ? 127 : (llr[i] < -128 ? -128 : llr[i]));
+}
@@ -0,0 +1,52 @@
+#ifndef NR_LAYER_DEMAP_H
+#define NR_LAYER_DEMAP_H
+
+#include <stdint.h>
+#include "nr_gold.h"
+
+/* UE side layer demapping (38.211 7.3.1.3) of the per-layer LLRs produced by
+ * the LLR computation, as nr_dlsch_layer_demapping() does: codeword LLR
+ * Nl * Qm * i + l * Qm + m comes from llr_layers[l][i * Qm + m], layer l
+ * starting at llr_layers + l * layer_sz. */
+
+/* Demapper of nb_re REs into cw, specialized per (Nl, Qm): one vector per
+ * layer goes through a 32/64-bit unpack transpose (QPSK, 16-QAM) or straight
+ * copies (64-QAM, 256-QAM) */
+typedef void (*nr_layer_demap_fn)(const int16_t *llr_layers, uint32_t layer_sz, uint32_t nb_re, int16_t *cw);
+
+/* Kernel of (Nl, Qm) from the dispatch table, NULL when unsupported */
+nr_layer_demap_fn nr_layer_demap_get(uint8_t Nl, uint8_t Qm);
+
+/* Demaps the whole REs of the length codeword LLRs into cw. Returns -1 for
+ * Nl outside 1..4 or Qm other than 2, 4, 6, 8. */
+int nr_layer_demap(const int16_t *llr_layers, uint32_t layer_sz, uint8_t Nl, uint8_t Qm,
+                   uint32_t length, int16_t *cw);
+
+/* Layer demapping of 1 to 8 layers: for 5 to 8 layers the first layers go to
+ * cw[0] and the others to cw[1], split as in 38.211 Table 7.3.1.3-1, each
+ * codeword through the kernel of its own layer count. length counts the LLRs
+ * of all layers. Returns -1 for Nl outside 1..8 or an unsupported Qm. */
+int nr_layer_demap_cw(const int16_t *llr_layers, uint32_t layer_sz, uint8_t Nl, uint8_t Qm,
+                      uint32_t length, int16_t *const cw[2]);
+
+/* REs per tile of the fused kernel: at most 64 * 4 * 8 int16 LLRs, held in L1 */
+#define NR_LDM_TILE_RE 64
+
+/* Layer demapping, descrambling and saturation to the int8 decoder input in
+ * one pass: out[n] = sat8(c(n) ? -cw[n] : cw[n]) over the whole REs of the
+ * length codeword LLRs. Tiles of NR_LDM_TILE_RE REs are demapped into a stack
+ * buffer, sign flipped and packed before the next tile is read, so the
+ * codeword never exists at int16 in memory. Returns -1 for Nl outside 1..4
+ * or Qm other than 2, 4, 6, 8. */
+int nr_layer_demap_unscramble8(const int16_t *llr_layers, uint32_t layer_sz, uint8_t Nl, uint8_t Qm,
+                               uint32_t length, const uint32_t *c, int8_t *out);
+
+/* Same with the Gold sequence of the codeword taken from the cache */
+int nr_layer_demap_unscramble8_cached(nr_gold_cache_t *cache, const int16_t *llr_layers, uint32_t layer_sz,
+                                      uint8_t Nl, uint8_t Qm, uint32_t length,
+                                      uint8_t q, uint32_t Nid, uint32_t n_RNTI, int8_t *out);
+
+/* out[n] = sat8(llr[n]), the decoder input conversion */
+void nr_llr16_to_int8(const int16_t *llr, uint32_t n, int8_t *out);
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * PDSCH layer mapping of one or two codewords onto up to 8 layers, the
+ * symbols of a codeword being dealt to its layers with 32-bit shuffles.
+ */
+
+#include "nr_layer_mapping.h"
+#include <stdio.h>
+#include <string.h>
+#include <simde/x86/sse2.h>
+
+#define LM_SHUFFLE_PS(a, b, imm) \
+    simde_mm_castps_si128(simde_mm_shuffle_ps(simde_mm_castsi128_ps(a), simde_mm_castsi128_ps(b), imm))
+
+/* n symbols per layer of one codeword over v layers (1..4); each step takes
+ * 4 * v symbols from d and writes 4 to every layer */
+static void lm_cw(const c16_t *d, int v, uint32_t n, c16_t *x, uint32_t layer_sz)
+{
+    uint32_t i = 0;
+    const simde__m128i *in = (const simde__m128i *)d;
+
+    switch (v) {
+        case 1:
+            memcpy(x, d, n * sizeof(c16_t));
+            return;
+
+        case 2:
+            for (; i + 4 <= n; i += 4, in += 2) {
+                const simde__m128i a = simde_mm_loadu_si128(in), b = simde_mm_loadu_si128(in + 1);
+                simde_mm_storeu_si128((simde__m128i *)(x + i), LM_SHUFFLE_PS(a, b, SIMDE_MM_SHUFFLE(2, 0, 2, 0)));
+                simde_mm_storeu_si128((simde__m128i *)(x + layer_sz + i), LM_SHUFFLE_PS(a, b, SIMDE_MM_SHUFFLE(3, 1, 3, 1)));
+            }
+            break;
+
+        case 3:
+            /* a0 a3 b2 c1 | a1 b0 b3 c2 | a2 b1 c0 c3 */
+            for (; i + 4 <= n; i += 4, in += 3) {
+                const simde__m128i a = simde_mm_loadu_si128(in), b = simde_mm_loadu_si128(in + 1);
+                const simde__m128i c = simde_mm_loadu_si128(in + 2);
+                const simde__m128i bc = LM_SHUFFLE_PS(b, c, SIMDE_MM_SHUFFLE(1, 0, 3, 2));
+                const simde__m128i ab1 = LM_SHUFFLE_PS(a, b, SIMDE_MM_SHUFFLE(0, 0, 1, 1));
+                const simde__m128i bc1 = LM_SHUFFLE_PS(b, c, SIMDE_MM_SHUFFLE(2, 2, 3, 3));
+                const simde__m128i ab2 = LM_SHUFFLE_PS(a, b, SIMDE_MM_SHUFFLE(1, 1, 2, 2));
+                const simde__m128i cc2 = LM_SHUFFLE_PS(c, c, SIMDE_MM_SHUFFLE(3, 3, 0, 0));
+                simde_mm_storeu_si128((simde__m128i *)(x + i), LM_SHUFFLE_PS(a, bc, SIMDE_MM_SHUFFLE(3, 0, 3, 0)));
+                simde_mm_storeu_si128((simde__m128i *)(x + layer_sz + i), LM_SHUFFLE_PS(ab1, bc1, SIMDE_MM_SHUFFLE(2, 0, 2, 0)));
+                simde_mm_storeu_si128((simde__m128i *)(x + 2 * layer_sz + i), LM_SHUFFLE_PS(ab2, cc2, SIMDE_MM_SHUFFLE(2, 0, 2, 0)));
+            }
+            break;
+
+        case 4:
+            for (; i + 4 <= n; i += 4, in += 4) {
+                const simde__m128i a = simde_mm_loadu_si128(in), b = simde_mm_loadu_si128(in + 1);
+                const simde__m128i c = simde_mm_loadu_si128(in + 2), e = simde_mm_loadu_si128(in + 3);
+                const simde__m128i t0 = simde_mm_unpacklo_epi32(a, b), t1 = simde_mm_unpacklo_epi32(c, e);
+                const simde__m128i t2 = simde_mm_unpackhi_epi32(a, b), t3 = simde_mm_unpackhi_epi32(c, e);
+                simde_mm_storeu_si128((simde__m128i *)(x + i), simde_mm_unpacklo_epi64(t0, t1));
+                simde_mm_storeu_si128((simde__m128i *)(x + layer_sz + i), simde_mm_unpackhi_epi64(t0, t1));
+                simde_mm_storeu_si128((simde__m128i *)(x + 2 * layer_sz + i), simde_mm_unpacklo_epi64(t2, t3));
+                simde_mm_storeu_si128((simde__m128i *)(x + 3 * layer_sz + i), simde_mm_unpackhi_epi64(t2, t3));
+            }
+            break;
+    }
+    for (; i < n; i++)
+        for (int l = 0; l < v; l++)
+            x[l * layer_sz + i] = d[v * i + l];
+}
+
+int nr_layer_map(const c16_t *const mod_symbs[2], uint8_t Nl, uint32_t layer_sz, c16_t *tx_layers)
+{
+    int nl_cw[2];
+    if (nr_layer_cw_split(Nl, nl_cw) < 0) {
+        printf("nr_layer_map: unsupported number of layers %u\n", Nl);
+        return -1;
+    }
+    lm_cw(mod_symbs[0], nl_cw[0], layer_sz, tx_layers, layer_sz);
+    if (nl_cw[1])
+        lm_cw(mod_symbs[1], nl_cw[1], layer_sz, tx_layers + (size_t)nl_cw[0] * layer_sz, layer_sz);
+    return 0;
+}
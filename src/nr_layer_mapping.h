@@ -0,0 +1,30 @@
+#ifndef NR_LAYER_MAPPING_H
+#define NR_LAYER_MAPPING_H
+
+#include <stdint.h>
+#include "common/platform_types.h"
+#include "PHY/NR_TRANSPORT/nr_transport_common_proto.h"
+
+/* PDSCH layer mapping (38.211 7.3.1.3) for 1 to 8 layers. Up to 4 layers carry
+ * one codeword; 5 to 8 layers carry two, split as in Table 7.3.1.3-1:
+ *   5: 2 + 3, 6: 3 + 3, 7: 3 + 4, 8: 4 + 4.
+ * Codeword q spread over v layers starting at layer base gives
+ * x^(base + l)(i) = d^(q)(v * i + l). */
+
+#define NR_MAX_LAYERS 8
+
+/* Layers of codeword 0 and 1 for Nl layers; -1 when Nl is outside 1..8 */
+static inline int nr_layer_cw_split(uint8_t Nl, int nl_cw[2])
+{
+    if (Nl < 1 || Nl > NR_MAX_LAYERS) return -1;
+    nl_cw[0] = Nl <= 4 ? Nl : Nl / 2;
+    nl_cw[1] = Nl - nl_cw[0];
+    return 0;
+}
+
+/* Maps layer_sz symbols per layer: codeword q is read from mod_symbs[q]
+ * (v_q * layer_sz symbols), layer l is written at tx_layers + l * layer_sz.
+ * Returns -1 for Nl outside 1..8. */
+int nr_layer_map(const c16_t *const mod_symbs[2], uint8_t Nl, uint32_t layer_sz, c16_t *tx_layers);
+
+#endif
@@ -0,0 +1,232 @@
+/*
+ * Max-log soft demapping of QPSK to 1024-QAM. Every order is the same chain
+ * of |.| and saturating subtractions on 16-bit (re, im) pairs, giving one
+ * 32-bit pair per level and RE; the levels of a RE are then interleaved.
+ *
+ * The AVX-512BW kernels take 16 REs per step and interleave the K level
+ * vectors with K * K masked vpermd whose indices and masks are built once.
+ * The tail is the same step with masked loads and stores. The SSE kernels
+ * serve CPUs without AVX-512BW.
+ */
+
+#include "nr_llr.h"
+#include <stdio.h>
+#include <pthread.h>
+#include <simde/x86/ssse3.h>
+#include <simde/x86/avx512.h>
+
+/* Levels per order: Qm / 2, up to 5 for 1024-QAM */
+#define LLR_MAX_LEVELS 5
+
+static pthread_once_t llr_once = PTHREAD_ONCE_INIT;
+static int llr_use_avx512;
+
+/* Output vector v of K levels takes element e of level s where
+ * llr_perm_mask[K][v][s] has bit e, from element llr_perm_idx[K][v][s][e] */
+static int32_t llr_perm_idx[LLR_MAX_LEVELS + 1][LLR_MAX_LEVELS][LLR_MAX_LEVELS][16] __attribute__((aligned(64)));
+static uint16_t llr_perm_mask[LLR_MAX_LEVELS + 1][LLR_MAX_LEVELS][LLR_MAX_LEVELS];
+
+static void llr_build(void)
+{
+    for (int K = 1; K <= LLR_MAX_LEVELS; K++)
+        for (int p = 0; p < 16 * K; p++) {
+            const int v = p / 16, e = p % 16, s = p % K;
+            llr_perm_idx[K][v][s][e] = p / K;
+            llr_perm_mask[K][v][s] |= (uint16_t)(1u << e);
+        }
+
+    __builtin_cpu_init();
+    llr_use_avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+}
+
+void nr_llr_init(void)
+{
+    pthread_once(&llr_once, llr_build);
+}
+
+int nr_llr_avx512(void)
+{
+    nr_llr_init();
+    return llr_use_avx512;
+}
+
+/* sat16(m - |t|) with |-32768| = -32768, as pabsw / psubsw give it */
+static inline int16_t llr_level(int16_t m, int16_t t)
+{
+    const int a = t == INT16_MIN ? INT16_MIN : (t < 0 ? -t : t);
+    const int d = m - a;
+    return (int16_t)(d > INT16_MAX ? INT16_MAX : d < INT16_MIN ? INT16_MIN : d);
+}
+
+/* Levels of REs [re, nb_re), one at a time */
+static void llr_tail(const int32_t *rxF, const int32_t *const mags[LLR_MAX_LEVELS - 1], int K,
+                     int16_t *llr, uint32_t re, uint32_t nb_re)
+{
+    for (; re < nb_re; re++) {
+        const int16_t *y = (const int16_t *)(rxF + re);
+        int16_t r = y[0], i = y[1];
+        int16_t *out = llr + 2 * K * re;
+        out[0] = r;
+        out[1] = i;
+        for (int k = 1; k < K; k++) {
+            const int16_t *m = (const int16_t *)(mags[k - 1] + re);
+            r = llr_level(m[0], r);
+            i = llr_level(m[1], i);
+            out[2 * k] = r;
+            out[2 * k + 1] = i;
+        }
+    }
+}
+
+/* Fourth threshold of 1024-QAM, magr / 2 */
+#define LLR_MAGT_SHIFT 1
+
+/* ---- SSE ---- */
+
+static inline __attribute__((always_inline))
+void llr_sse_body(const int32_t *rxF, const int32_t *mag, const int32_t *magb, const int32_t *magr,
+                  int16_t *llr, uint32_t nb_re, const int K)
+{
+    const int32_t *const mags[LLR_MAX_LEVELS - 1] = {mag, magb, magr, magr};
+    int32_t *out = (int32_t *)llr;
+    uint32_t re = 0;
+
+    for (; re + 4 <= nb_re; re += 4, out += 4 * K) {
+        int32_t t[LLR_MAX_LEVELS][4];
+        simde__m128i y = simde_mm_loadu_si128((const simde__m128i *)(rxF + re));
+        simde_mm_storeu_si128((simde__m128i *)t[0], y);
+        for (int k = 1; k < K; k++) {
+            simde__m128i m = simde_mm_loadu_si128((const simde__m128i *)(mags[k - 1] + re));
+            if (k == 4)
+                m = simde_mm_srai_epi16(m, LLR_MAGT_SHIFT);
+            y = simde_mm_subs_epi16(m, simde_mm_abs_epi16(y));
+            simde_mm_storeu_si128((simde__m128i *)t[k], y);
+        }
+        for (int i = 0; i < 4; i++)
+            for (int k = 0; k < K; k++)
+                out[K * i + k] = t[k][i];
+    }
+
+    if (re < nb_re) {
+        if (K == 5) {
+            /* magt only exists shifted: build it for the last REs */
+            int16_t magt[2 * 4];
+            const int16_t *mr = (const int16_t *)(magr + re);
+            for (uint32_t i = 0; i < 2 * (nb_re - re); i++)
+                magt[i] = mr[i] >> LLR_MAGT_SHIFT;
+            const int32_t *const tm[LLR_MAX_LEVELS - 1] = {mag + re, magb + re, magr + re, (const int32_t *)magt};
+            llr_tail(rxF + re, tm, K, llr + 2 * K * re, 0, nb_re - re);
+        } else {
+            llr_tail(rxF, mags, K, llr, re, nb_re);
+        }
+    }
+}
+
+#define LLR_SSE_KERNEL(K) \
+    static void llr_sse_##K(const int32_t *rxF, const int32_t *mag, const int32_t *magb, const int32_t *magr, \
+                            int16_t *llr, uint32_t nb_re) \
+    { \
+        llr_sse_body(rxF, mag, magb, magr, llr, nb_re, K); \
+    }
+
+LLR_SSE_KERNEL(1)
+LLR_SSE_KERNEL(2)
+LLR_SSE_KERNEL(3)
+LLR_SSE_KERNEL(4)
+LLR_SSE_KERNEL(5)
+
+/* ---- AVX-512BW ---- */
+
+/* Levels of the n <= 16 REs at re, written at out (K * n pairs) */
+__attribute__((target("avx512f,avx512bw")))
+static inline __attribute__((always_inline))
+void llr_avx512_step(const int32_t *rxF, const int32_t *const mags[LLR_MAX_LEVELS - 1], uint32_t re,
+                     uint32_t n, int32_t *out, const int K)
+{
+    const simde__mmask16 in_mask = n == 16 ? 0xffff : (simde__mmask16)((1u << n) - 1);
+    simde__m512i lv[LLR_MAX_LEVELS];
+
+    lv[0] = simde_mm512_maskz_loadu_epi32(in_mask, rxF + re);
+    for (int k = 1; k < K; k++) {
+        simde__m512i m = simde_mm512_maskz_loadu_epi32(in_mask, mags[k - 1] + re);
+        if (k == 4)
+            m = simde_mm512_srai_epi16(m, LLR_MAGT_SHIFT);
+        lv[k] = simde_mm512_subs_epi16(m, simde_mm512_abs_epi16(lv[k - 1]));
+    }
+
+    if (K == 1) {
+        simde_mm512_mask_storeu_epi32(out, in_mask, lv[0]);
+        return;
+    }
+    const uint32_t total = K * n;
+    for (int v = 0; v < K; v++) {
+        simde__m512i o = simde_mm512_setzero_si512();
+        for (int s = 0; s < K; s++)
+            o = simde_mm512_mask_permutexvar_epi32(o, llr_perm_mask[K][v][s],
+                                                   simde_mm512_load_si512(llr_perm_idx[K][v][s]), lv[s]);
+        if (total >= 16 * (uint32_t)(v + 1)) {
+            simde_mm512_storeu_si512(out + 16 * v, o);
+        } else {
+            if (total > 16 * (uint32_t)v)
+                simde_mm512_mask_storeu_epi32(out + 16 * v, (simde__mmask16)((1u << (total - 16 * v)) - 1), o);
+            break;
+        }
+    }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static inline __attribute__((always_inline))
+void llr_avx512_body(const int32_t *rxF, const int32_t *mag, const int32_t *magb, const int32_t *magr,
+                     int16_t *llr, uint32_t nb_re, const int K)
+{
+    const int32_t *const mags[LLR_MAX_LEVELS - 1] = {mag, magb, magr, magr};
+    int32_t *out = (int32_t *)llr;
+    uint32_t re = 0;
+
+    for (; re + 16 <= nb_re; re += 16)
+        llr_avx512_step(rxF, mags, re, 16, out + K * re, K);
+    if (re < nb_re)
+        llr_avx512_step(rxF, mags, re, nb_re - re, out + K * re, K);
+}
+
+#define LLR_AVX512_KERNEL(K) \
+    __attribute__((target("avx512f,avx512bw"))) \
+    static void llr_avx512_##K(const int32_t *rxF, const int32_t *mag, const int32_t *magb, const int32_t *magr, \
+                               int16_t *llr, uint32_t nb_re) \
+    { \
+        llr_avx512_body(rxF, mag, magb, magr, llr, nb_re, K); \
+    }
+
+LLR_AVX512_KERNEL(1)
+LLR_AVX512_KERNEL(2)
+LLR_AVX512_KERNEL(3)
+LLR_AVX512_KERNEL(4)
+LLR_AVX512_KERNEL(5)
+
+static const nr_llr_fn llr_sse[LLR_MAX_LEVELS] = {llr_sse_1, llr_sse_2, llr_sse_3, llr_sse_4, llr_sse_5};
+static const nr_llr_fn llr_avx512[LLR_MAX_LEVELS] = {llr_avx512_1, llr_avx512_2, llr_avx512_3, llr_avx512_4, llr_avx512_5};
+
+nr_llr_fn nr_llr_get_sse(uint8_t Qm)
+{
+    if (Qm < 2 || Qm > 2 * LLR_MAX_LEVELS || (Qm & 1)) return NULL;
+    return llr_sse[Qm / 2 - 1];
+}
+
+nr_llr_fn nr_llr_get(uint8_t Qm)
+{
+    if (Qm < 2 || Qm > 2 * LLR_MAX_LEVELS || (Qm & 1)) return NULL;
+    nr_llr_init();
+    return llr_use_avx512 ? llr_avx512[Qm / 2 - 1] : llr_sse[Qm / 2 - 1];
+}
+
+int nr_llr_compute(uint8_t Qm, const int32_t *rxF, const int32_t *mag, const int32_t *magb, const int32_t *magr,
+                   int16_t *llr, uint32_t nb_re)
+{
+    nr_llr_fn fn = nr_llr_get(Qm);
+    if (!fn) {
+        printf("nr_llr_compute: unsupported modulation order %u\n", Qm);
+        return -1;
+    }
+    fn(rxF, mag, magb, magr, llr, nb_re);
+    return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef NR_LLR_H
+#define NR_LLR_H
+
+#include <stdint.h>
+
+/* Max-log LLRs of the compensated symbols of one layer, in the layout of
+ * nr_qpsk_llr() .. nr_256qam_llr(): per RE, Qm / 2 (re, im) pairs
+ *   y, t1 = mag - |y|, t2 = magb - |t1|, t3 = magr - |t2|, t4 = magt - |t3|
+ * with saturating 16-bit arithmetic. 1024-QAM (Qm = 10) takes the fourth
+ * threshold magt = magr >> 1, the thresholds halving from one level to the
+ * next as they do for 64/256-QAM. */
+
+#define NR_QAM1024_MOD_ORDER 10
+
+/* LLRs of nb_re REs: rxF holds one (re, im) int16 pair per RE, as
+ * rxdataF_comp does, mag/magb/magr the channel magnitudes of the same REs in
+ * the c16_t layout (unused ones may be NULL); llr gets Qm * nb_re values.
+ * Pairs are passed as int32_t so that this header stands without the OAI
+ * type headers. */
+typedef void (*nr_llr_fn)(const int32_t *rxF, const int32_t *mag, const int32_t *magb, const int32_t *magr,
+                          int16_t *llr, uint32_t nb_re);
+
+/* Detect the CPU features; called lazily by the functions below */
+void nr_llr_init(void);
+
+/* 1 when the AVX-512BW kernels are in use */
+int nr_llr_avx512(void);
+
+/* Kernel of modulation order Qm (2, 4, 6, 8, 10): AVX-512BW when the CPU has
+ * it, SSE otherwise; NULL for other orders */
+nr_llr_fn nr_llr_get(uint8_t Qm);
+
+/* SSE kernel of Qm whatever the CPU, NULL for unsupported orders */
+nr_llr_fn nr_llr_get_sse(uint8_t Qm);
+
+/* LLRs of nb_re REs through nr_llr_get(Qm). Returns -1 for an unsupported Qm. */
+int nr_llr_compute(uint8_t Qm, const int32_t *rxF, const int32_t *mag, const int32_t *magb, const int32_t *magr,
+                   int16_t *llr, uint32_t nb_re);
+
+#endif
@@ -0,0 +1,321 @@
+/*
+ * MMSE equalization gains, their application and the fused equalization +
+ * LLR receiver walking the symbol in tiles of NR_MMSE_TILE_RB RBs.
+ */
+
+#include "nr_mmse_llr.h"
+#include "nr_llr.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <simde/x86/sse4.1.h>
+
+/* Q15 thresholds of the levels, 2^(k-1) * 2 / sqrt(E) for k = m/2 .. 1:
+ * QAM16_n1, QAM64_n1/n2, QAM256_n1/n2/n3 of OAI and the 1024-QAM
+ * (E = 682) values, whose fourth level nr_llr derives as magr >> 1 */
+static const int16_t mmse_qam_n[6][3] = {
+    [2] = {20724},
+    [3] = {20225, 10112},
+    [4] = {20106, 10053, 5026},
+    [5] = {20076, 10038, 5019},
+};
+
+void nr_mmse_layer_gains(uint32_t rx_size_symbol,
+                         unsigned char n_rx,
+                         unsigned char nl,
+                         int32_t dl_ch_estimates_ext[][rx_size_symbol],
+                         int length,
+                         uint32_t noise_var,
+                         int32_t inv_re[],
+                         int32_t inv_im[])
+{
+    /* Step 1: Build H^H*H (Hermitian matrix product) */
+    int32_t HH_H_re[nl][nl];
+    int32_t HH_H_im[nl][nl];
+
+    for (int i = 0; i < nl; i++) {
+        for (int j = 0; j < nl; j++) {
+            int64_t acc_re = 0, acc_im = 0;
+
+            /* Sum over all RX antennas: H^H[i,rx] * H[rx,j] */
+            for (int rx = 0; rx < n_rx; rx++) {
+                for (int k = 0; k < length && k < 48; k++) {
+                    int32_t h_i = dl_ch_estimates_ext[i * n_rx + rx][k];
+                    int32_t h_j = dl_ch_estimates_ext[j * n_rx + rx][k];
+
+                    int16_t h_i_r = (int16_t)(h_i & 0xFFFF);
+                    int16_t h_i_i = (int16_t)((h_i >> 16) & 0xFFFF);
+                    int16_t h_j_r = (int16_t)(h_j & 0xFFFF);
+                    int16_t h_j_i = (int16_t)((h_j >> 16) & 0xFFFF);
+
+                    /* Real: Re(conj(h_i) * h_j) = h_i_r*h_j_r + h_i_i*h_j_i */
+                    acc_re += (int64_t)h_i_r * h_j_r + (int64_t)h_i_i * h_j_i;
+                    /* Imag: Im(conj(h_i) * h_j) = h_i_r*h_j_i - h_i_i*h_j_r */
+                    acc_im += (int64_t)h_i_r * h_j_i - (int64_t)h_i_i * h_j_r;
+                }
+            }
+
+            HH_H_re[i][j] = (int32_t)(acc_re >> 4);
+            HH_H_im[i][j] = (int32_t)(acc_im >> 4);
+        }
+    }
+
+    /* Step 2: Add noise variance to diagonal */
+    int32_t noise_scaled = (int32_t)(noise_var >> 4);
+    for (int i = 0; i < nl; i++)
+        HH_H_re[i][i] += noise_scaled;
+
+    /* Step 3: Invert matrix (simplified for MIMO), keeping the diagonal */
+    for (int i = 0; i < nl; i++)
+        inv_re[i] = inv_im[i] = 0;
+
+    if (nl == 1) {
+        /* SISO case */
+        int64_t den = (int64_t)HH_H_re[0][0] * HH_H_re[0][0] + (int64_t)HH_H_im[0][0] * HH_H_im[0][0];
+        if (den > 0) {
+            inv_re[0] = (int32_t)(((int64_t)HH_H_re[0][0] << 15) / den);
+            inv_im[0] = (int32_t)((-(int64_t)HH_H_im[0][0] << 15) / den);
+        } else {
+            inv_re[0] = (1 << 14);
+        }
+    } else if (nl == 2) {
+        /* 2x2 MIMO */
+        int64_t det_re = (int64_t)HH_H_re[0][0] * HH_H_re[1][1] -
+                         (int64_t)HH_H_re[0][1] * HH_H_re[1][0] -
+                         ((int64_t)HH_H_im[0][0] * HH_H_im[1][1] -
+                          (int64_t)HH_H_im[0][1] * HH_H_im[1][0]);
+        int64_t det_im = (int64_t)HH_H_re[0][0] * HH_H_im[1][1] +
+                         (int64_t)HH_H_im[0][0] * HH_H_re[1][1] -
+                         ((int64_t)HH_H_re[0][1] * HH_H_im[1][0] +
+                          (int64_t)HH_H_im[0][1] * HH_H_re[1][0]);
+
+        int64_t det_mag2 = det_re * det_re + det_im * det_im;
+        if (det_mag2 > 10000) {
+            int32_t scale = (1 << 14);
+            inv_re[0] = (int32_t)(((int64_t)HH_H_re[1][1] * det_re + (int64_t)HH_H_im[1][1] * det_im) * scale / det_mag2);
+            inv_im[0] = (int32_t)(((int64_t)HH_H_im[1][1] * det_re - (int64_t)HH_H_re[1][1] * det_im) * scale / det_mag2);
+        } else {
+            inv_re[0] = inv_re[1] = (1 << 13);
+        }
+    } else {
+        /* For larger systems, use diagonal approximation */
+        for (int i = 0; i < nl; i++) {
+            if (HH_H_re[i][i] > 100)
+                inv_re[i] = (int32_t)(((int64_t)(1 << 14)) / (HH_H_re[i][i] >> 3));
+            else
+                inv_re[i] = (1 << 13);
+        }
+    }
+}
+
+int nr_mmse_channel_shift(uint32_t rx_size_symbol,
+                          unsigned char n_rx,
+                          unsigned char nl,
+                          int32_t dl_ch_estimates_ext[][rx_size_symbol],
+                          int length)
+{
+    int64_t max_e = 0;
+
+    for (int l = 0; l < nl; l++)
+        for (int k = 0; k < length; k++) {
+            int64_t e = 0;
+            for (int rx = 0; rx < n_rx; rx++) {
+                const int16_t *h = (const int16_t *)&dl_ch_estimates_ext[l * n_rx + rx][k];
+                e += (int64_t)h[0] * h[0] + (int64_t)h[1] * h[1];
+            }
+            if (e > max_e) max_e = e;
+        }
+
+    int shift = 0;
+    while ((max_e >> shift) > 32767)
+        shift++;
+    return shift;
+}
+
+static inline int32_t mmse_sat16(int64_t v)
+{
+    return v > 32767 ? 32767 : v < -32768 ? -32768 : (int32_t)v;
+}
+
+int nr_mmse_equalize_layer(uint32_t rx_size_symbol,
+                           unsigned char n_rx,
+                           int l,
+                           int32_t dl_ch_estimates_ext[][rx_size_symbol],
+                           uint32_t re0,
+                           uint32_t n,
+                           int shift,
+                           unsigned char mod_order,
+                           int32_t gain_re,
+                           int32_t gain_im,
+                           const int32_t *in,
+                           int32_t *out,
+                           int32_t *mag,
+                           int32_t *magb,
+                           int32_t *magr)
+{
+    if (mod_order < 2 || mod_order > 10 || (mod_order & 1)) {
+        printf("nr_mmse_equalize_layer: unsupported modulation order %u\n", mod_order);
+        return -1;
+    }
+    /* 1024-QAM has a fourth level, taken from magr by nr_llr */
+    const int levels = mod_order == 10 ? 3 : mod_order / 2 - 1;
+
+    const int16_t *qam_n = mmse_qam_n[mod_order / 2];
+    int32_t *const th[3] = {mag, magb, magr};
+    int32_t gain_abs = (int32_t)lrint(sqrt((double)gain_re * gain_re + (double)gain_im * gain_im));
+    if (gain_abs > 65535) gain_abs = 65535;
+    uint32_t k = 0;
+
+    /* The gain goes through pmaddwd when both components fit in 16 bits, as in
+     * nr_mmse_apply_gain(). d * |gain| stays below 2^31 with d within 16 bits
+     * and |gain| within 16 unsigned bits, so the products are exact in 32 bits */
+    if (!in || (gain_re >= -32767 && gain_re <= 32767 && gain_im >= -32767 && gain_im <= 32767)) {
+        const simde__m128i g_re = simde_mm_set1_epi32((int32_t)(((uint32_t)(uint16_t)-gain_im << 16) | (uint16_t)gain_re));
+        const simde__m128i g_im = simde_mm_set1_epi32((int32_t)(((uint32_t)(uint16_t)gain_re << 16) | (uint16_t)gain_im));
+        const simde__m128i g = simde_mm_set1_epi32(gain_abs);
+        simde__m128i qn[3];
+        for (int m = 0; m < levels; m++)
+            qn[m] = simde_mm_set1_epi16(qam_n[m]);
+        const simde__m128i cnt = simde_mm_cvtsi32_si128(shift);
+        const simde__m128i zero = simde_mm_setzero_si128();
+        const simde__m128i ones = simde_mm_set1_epi32(-1);
+        const simde__m128i max16 = simde_mm_set1_epi32(32767);
+
+        for (; k + 4 <= n; k += 4) {
+            if (in) {
+                const simde__m128i y = simde_mm_loadu_si128((const simde__m128i *)(in + k));
+                const simde__m128i re = simde_mm_srai_epi32(simde_mm_madd_epi16(y, g_re), 14);
+                const simde__m128i im = simde_mm_srai_epi32(simde_mm_madd_epi16(y, g_im), 14);
+                simde_mm_storeu_si128((simde__m128i *)(out + k),
+                                      simde_mm_packs_epi32(simde_mm_unpacklo_epi32(re, im), simde_mm_unpackhi_epi32(re, im)));
+            }
+            if (!levels) continue;
+
+            /* H^H.H diagonal of the four REs, summed in 64 bits as in
+             * nr_mmse_channel_shift(): |h|^2 of one antenna fits 32 unsigned
+             * bits, the sum over the antennas does not */
+            simde__m128i acc_lo = simde_mm_setzero_si128(), acc_hi = simde_mm_setzero_si128();
+            for (int rx = 0; rx < n_rx; rx++) {
+                const simde__m128i h = simde_mm_loadu_si128((const simde__m128i *)&dl_ch_estimates_ext[l * n_rx + rx][re0 + k]);
+                const simde__m128i p = simde_mm_madd_epi16(h, h);
+                acc_lo = simde_mm_add_epi64(acc_lo, simde_mm_cvtepu32_epi64(p));
+                acc_hi = simde_mm_add_epi64(acc_hi, simde_mm_cvtepu32_epi64(simde_mm_srli_si128(p, 8)));
+            }
+            /* d = min(sum >> shift, 32767): low halves, forced to all ones
+             * where the high half is not zero, then an unsigned min */
+            const simde__m128i a = simde_mm_shuffle_epi32(simde_mm_srl_epi64(acc_lo, cnt), SIMDE_MM_SHUFFLE(3, 1, 2, 0));
+            const simde__m128i b = simde_mm_shuffle_epi32(simde_mm_srl_epi64(acc_hi, cnt), SIMDE_MM_SHUFFLE(3, 1, 2, 0));
+            const simde__m128i big = simde_mm_xor_si128(simde_mm_cmpeq_epi32(simde_mm_unpackhi_epi64(a, b), zero), ones);
+            const simde__m128i d = simde_mm_min_epu32(simde_mm_or_si128(simde_mm_unpacklo_epi64(a, b), big), max16);
+            simde__m128i e = simde_mm_srai_epi32(simde_mm_mullo_epi32(d, g), 14);
+            e = simde_mm_packs_epi32(e, e);
+            for (int m = 0; m < levels; m++) {
+                if (!th[m]) continue;
+                const simde__m128i t = simde_mm_slli_epi16(simde_mm_mulhi_epi16(e, qn[m]), 1);
+                simde_mm_storeu_si128((simde__m128i *)(th[m] + k), simde_mm_unpacklo_epi16(t, t));
+            }
+        }
+    }
+
+    for (; k < n; k++) {
+        if (in) {
+            const int16_t y_r = (int16_t)(in[k] & 0xFFFF);
+            const int16_t y_i = (int16_t)((in[k] >> 16) & 0xFFFF);
+            const int32_t y_eq_r = mmse_sat16(((int64_t)y_r * gain_re - (int64_t)y_i * gain_im) >> 14);
+            const int32_t y_eq_i = mmse_sat16(((int64_t)y_r * gain_im + (int64_t)y_i * gain_re) >> 14);
+            out[k] = (y_eq_i << 16) | (y_eq_r & 0xFFFF);
+        }
+        if (!levels) continue;
+
+        int64_t acc = 0;
+        for (int rx = 0; rx < n_rx; rx++) {
+            const int16_t *h = (const int16_t *)&dl_ch_estimates_ext[l * n_rx + rx][re0 + k];
+            acc += (int64_t)h[0] * h[0] + (int64_t)h[1] * h[1];
+        }
+        const int32_t d = mmse_sat16(acc >> shift);
+        const int32_t e = mmse_sat16((int64_t)d * gain_abs >> 14);
+        for (int m = 0; m < levels; m++) {
+            if (!th[m]) continue;
+            const uint16_t t = (uint16_t)(((e * qam_n[m]) >> 16) << 1);
+            th[m][k] = (int32_t)((uint32_t)t << 16 | t);
+        }
+    }
+    return 0;
+}
+
+void nr_mmse_apply_gain(const int32_t *in, int32_t gain_re, int32_t gain_im, uint32_t n, int32_t *out)
+{
+    uint32_t k = 0;
+
+    /* With both gain components within +-32767 one pmaddwd gives the exact
+     * 32-bit re / im sums, the >> 14 and the saturation being those of the
+     * int64 expression below */
+    if (gain_re >= -32767 && gain_re <= 32767 && gain_im >= -32767 && gain_im <= 32767) {
+        const simde__m128i g_re = simde_mm_set1_epi32((int32_t)(((uint32_t)(uint16_t)-gain_im << 16) | (uint16_t)gain_re));
+        const simde__m128i g_im = simde_mm_set1_epi32((int32_t)(((uint32_t)(uint16_t)gain_re << 16) | (uint16_t)gain_im));
+        for (; k + 4 <= n; k += 4) {
+            const simde__m128i y = simde_mm_loadu_si128((const simde__m128i *)(in + k));
+            const simde__m128i re = simde_mm_srai_epi32(simde_mm_madd_epi16(y, g_re), 14);
+            const simde__m128i im = simde_mm_srai_epi32(simde_mm_madd_epi16(y, g_im), 14);
+            simde_mm_storeu_si128((simde__m128i *)(out + k),
+                                  simde_mm_packs_epi32(simde_mm_unpacklo_epi32(re, im), simde_mm_unpackhi_epi32(re, im)));
+        }
+    }
+
+    for (; k < n; k++) {
+        int32_t y = in[k];
+        int16_t y_r = (int16_t)(y & 0xFFFF);
+        int16_t y_i = (int16_t)((y >> 16) & 0xFFFF);
+
+        int64_t y_eq_r = ((int64_t)y_r * gain_re - (int64_t)y_i * gain_im) >> 14;
+        int64_t y_eq_i = ((int64_t)y_r * gain_im + (int64_t)y_i * gain_re) >> 14;
+
+        if (y_eq_r > 32767) y_eq_r = 32767;
+        if (y_eq_r < -32768) y_eq_r = -32768;
+        if (y_eq_i > 32767) y_eq_i = 32767;
+        if (y_eq_i < -32768) y_eq_i = -32768;
+
+        out[k] = ((int32_t)y_eq_i << 16) | ((int32_t)y_eq_r & 0xFFFF);
+    }
+}
+
+int nr_dlsch_mmse_llr(uint32_t rx_size_symbol,
+                      unsigned char n_rx,
+                      unsigned char nl,
+                      int32_t rxdataF_comp[][n_rx][rx_size_symbol * NR_SYMBOLS_PER_SLOT],
+                      int32_t dl_ch_estimates_ext[][rx_size_symbol],
+                      unsigned char mod_order,
+                      int shift,
+                      unsigned char symbol,
+                      int length,
+                      uint32_t noise_var,
+                      uint32_t sz,
+                      int16_t layer_llr[][sz],
+                      uint32_t llr_offset_symbol)
+{
+    const nr_llr_fn llr = nr_llr_get(mod_order);
+    if (!llr) {
+        printf("nr_dlsch_mmse_llr: unsupported modulation order %u\n", mod_order);
+        return -1;
+    }
+
+    int32_t inv_re[nl], inv_im[nl];
+    nr_mmse_layer_gains(rx_size_symbol, n_rx, nl, dl_ch_estimates_ext, length, noise_var, inv_re, inv_im);
+
+    const uint32_t tile_re = 12 * NR_MMSE_TILE_RB;
+    int32_t eq[12 * NR_MMSE_TILE_RB] __attribute__((aligned(64)));
+    int32_t mags[3][12 * NR_MMSE_TILE_RB] __attribute__((aligned(64)));
+
+    for (int l = 0; l < nl; l++) {
+        const int32_t *y = &rxdataF_comp[l][0][symbol * rx_size_symbol];
+        int16_t *out = layer_llr[l] + llr_offset_symbol;
+
+        for (uint32_t re = 0; re < (uint32_t)length; re += tile_re) {
+            const uint32_t n = (uint32_t)length - re < tile_re ? (uint32_t)length - re : tile_re;
+            nr_mmse_equalize_layer(rx_size_symbol, n_rx, l, dl_ch_estimates_ext, re, n, shift, mod_order,
+                                   inv_re[l], inv_im[l], y + re, eq, mags[0], mags[1], mags[2]);
+            llr(eq, mags[0], mags[1], mags[2], out + (size_t)re * mod_order, n);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+#ifndef NR_MMSE_LLR_H
+#define NR_MMSE_LLR_H
+
+#include <stdint.h>
+
+#ifndef NR_SYMBOLS_PER_SLOT
+#define NR_SYMBOLS_PER_SLOT 14
+#endif
+
+/* UE PDSCH receiver: MMSE equalization of nr_dlsch_mmse() followed by the
+ * max-log LLRs of nr_dlsch_llr(), fused per tile of RBs. The equalized
+ * symbols of a tile stay in a stack buffer that the LLR kernel reads back
+ * from L1, so they never go back to rxdataF_comp.
+ *
+ * Complex values are (re, im) int16 pairs held in an int32_t, as in
+ * rxdataF_comp and dl_ch_estimates_ext. */
+
+/* RBs per tile of the fused receiver: 96 equalized REs, 384 bytes */
+#define NR_MMSE_TILE_RB 8
+
+/* Steps 1 to 3 of nr_dlsch_mmse(): H^H.H over the first REs of every layer
+ * pair, noise on the diagonal, inverse. Layer l is equalized by the Q14 gain
+ * (inv_re[l], inv_im[l]), the diagonal of the inverse. */
+void nr_mmse_layer_gains(uint32_t rx_size_symbol,
+                         unsigned char n_rx,
+                         unsigned char nl,
+                         int32_t dl_ch_estimates_ext[][rx_size_symbol],
+                         int length,
+                         uint32_t noise_var,
+                         int32_t inv_re[],
+                         int32_t inv_im[]);
+
+/* Output shift bringing sum_rx |h|^2 of every RE of the length first REs
+ * within 15 bits, the role of log2_maxh in OAI */
+int nr_mmse_channel_shift(uint32_t rx_size_symbol,
+                          unsigned char n_rx,
+                          unsigned char nl,
+                          int32_t dl_ch_estimates_ext[][rx_size_symbol],
+                          int length);
+
+/* Steps 4 and 5 of nr_dlsch_mmse() over the n REs from re0 of layer l, in one
+ * pass: out[k] = sat16((in[k] * (gain_re + j gain_im)) >> 14) as
+ * nr_mmse_apply_gain(), and the LLR thresholds of the equalized RE from its
+ * H^H.H diagonal d = sat16(sum_rx |h|^2 >> shift), summed in 64 bits, formed
+ * in the same loop: with e = sat16(d * |gain| >> 14), mag/magb/magr get
+ * ((e * QAM_n1/n2/n3) >> 16) << 1 of mod_order (the same value in re and im),
+ * the mulhi and shift of the OAI channel compensation. in and out may be the
+ * same buffer; with in NULL only the thresholds are produced. Thresholds the
+ * order does not use are not written and may be NULL. Returns -1 for an
+ * unsupported mod_order, nothing being written. */
+int nr_mmse_equalize_layer(uint32_t rx_size_symbol,
+                           unsigned char n_rx,
+                           int l,
+                           int32_t dl_ch_estimates_ext[][rx_size_symbol],
+                           uint32_t re0,
+                           uint32_t n,
+                           int shift,
+                           unsigned char mod_order,
+                           int32_t gain_re,
+                           int32_t gain_im,
+                           const int32_t *in,
+                           int32_t *out,
+                           int32_t *mag,
+                           int32_t *magb,
+                           int32_t *magr);
+
+/* Step 4 alone, for buffers without thresholds: out[k] =
+ * sat16((in[k] * (gain_re + j gain_im)) >> 14) over n REs, in and out may be
+ * the same buffer */
+void nr_mmse_apply_gain(const int32_t *in, int32_t gain_re, int32_t gain_im, uint32_t n, int32_t *out);
+
+/* Equalization and LLRs of the length REs of symbol for layers 0..nl-1,
+ * giving layer_llr[l] + llr_offset_symbol what nr_dlsch_mmse() then
+ * nr_dlsch_llr() give for antenna 0 of each layer, the thresholds being those
+ * nr_dlsch_mmse() writes to dl_ch_mag[l][0] and following. The thresholds of a
+ * tile are derived next to its symbols and never stored. rxdataF_comp is left
+ * untouched. Returns -1 for an unsupported mod_order. */
+int nr_dlsch_mmse_llr(uint32_t rx_size_symbol,
+                      unsigned char n_rx,
+                      unsigned char nl,
+                      int32_t rxdataF_comp[][n_rx][rx_size_symbol * NR_SYMBOLS_PER_SLOT],
+                      int32_t dl_ch_estimates_ext[][rx_size_symbol],
+                      unsigned char mod_order,
+                      int shift,
+                      unsigned char symbol,
+                      int length,
+                      uint32_t noise_var,
+                      uint32_t sz,
+                      int16_t layer_llr[][sz],
+                      uint32_t llr_offset_symbol);
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ * Slot-level OFDM modulation and front end over all antennas: one task per
+ * (antenna, symbol). On TX the IDFT is written straight to its place in the
+ * slot and the cyclic prefix copied from the symbol tail; on RX the DFT reads
+ * its window in place and writes its grid row. Both transforms are limited
+ * to the allocation of the slot.
+ */
+
+#include "nr_ofdm_batch.h"
+#include <stdio.h>
+#include <string.h>
+
+/* libdfts works on 32-byte aligned buffers */
+#define OFDM_ALIGN 32
+/* Largest FFT size of nr_dft_plan */
+#define OFDM_MAX_FFT 8192
+
+int nr_ofdm_slot_init(nr_ofdm_slot_t *s, int fft_size, int mu, int slot, int nb_symbols)
+{
+    if (nb_symbols < 1 || nb_symbols > NR_OFDM_MAX_SYMBOLS) {
+        printf("nr_ofdm_slot_init: %d symbols per slot not supported\n", nb_symbols);
+        return -1;
+    }
+    const nr_dft_plan_t *plan = nr_dft_plan_get(fft_size, 1);
+    if (!plan) {
+        printf("nr_ofdm_slot_init: no DFT plan for FFT size %d\n", fft_size);
+        return -1;
+    }
+
+    memset(s, 0, sizeof(*s));
+    s->fft_size = fft_size;
+    s->nb_symbols = nb_symbols;
+    s->plan = plan;
+    uint32_t off = 0;
+    for (int l = 0; l < nb_symbols; l++) {
+        s->cp[l] = nr_cp_length(fft_size, mu, slot, l);
+        s->offset[l] = off;
+        off += (uint32_t)(s->cp[l] + fft_size);
+    }
+    s->slot_samples = off;
+    s->alloc_start = 0;
+    s->alloc_len = fft_size;
+    return 0;
+}
+
+void nr_ofdm_slot_set_alloc(nr_ofdm_slot_t *s, int first_carrier_offset, int start_rb, int nb_rb)
+{
+    nr_fft_rb_range(s->fft_size, first_carrier_offset, start_rb, nb_rb, &s->alloc_start, &s->alloc_len);
+    if (s->alloc_len > s->fft_size) s->alloc_len = s->fft_size;
+}
+
+typedef struct {
+    const nr_ofdm_slot_t *s;
+    const c16_t *txdataF;
+    c16_t *txdata;
+} ofdm_mod_job_t;
+
+static void ofdm_mod_task(void *arg, int t)
+{
+    const ofdm_mod_job_t *job = arg;
+    const nr_ofdm_slot_t *s = job->s;
+    const int aa = t / s->nb_symbols, l = t % s->nb_symbols;
+    const int N = s->fft_size, cp = s->cp[l];
+
+    int16_t *in = (int16_t *)(job->txdataF + ((size_t)aa * s->nb_symbols + l) * N);
+    c16_t *sym = job->txdata + (size_t)aa * s->slot_samples + s->offset[l];
+
+    if (((uintptr_t)(sym + cp) & (OFDM_ALIGN - 1)) == 0) {
+        nr_dft_plan_idft_pruned(s->plan, in, (int16_t *)(sym + cp), s->alloc_start, s->alloc_len);
+    } else {
+        /* CP lengths of small FFTs break the alignment of the symbol body */
+        c16_t tmp[OFDM_MAX_FFT] __attribute__((aligned(OFDM_ALIGN)));
+        nr_dft_plan_idft_pruned(s->plan, in, (int16_t *)tmp, s->alloc_start, s->alloc_len);
+        memcpy(sym + cp, tmp, N * sizeof(c16_t));
+    }
+    memcpy(sym, sym + N, cp * sizeof(c16_t));
+}
+
+void nr_ofdm_mod_batch(worker_pool_t *pool, const nr_ofdm_slot_t *s, int nb_tx, const c16_t *txdataF, c16_t *txdata)
+{
+    ofdm_mod_job_t job = { .s = s, .txdataF = txdataF, .txdata = txdata };
+    worker_pool_run(pool, ofdm_mod_task, &job, nb_tx * s->nb_symbols);
+}
+
+typedef struct {
+    const nr_ofdm_slot_t *s;
+    const c16_t *rxdata;
+    uint32_t rx_stride;
+    int offset_divisor;
+    c16_t *rxdataF;
+} ofdm_fep_job_t;
+
+static void ofdm_fep_task(void *arg, int t)
+{
+    const ofdm_fep_job_t *job = arg;
+    const nr_ofdm_slot_t *s = job->s;
+    const int aa = t / s->nb_symbols, l = t % s->nb_symbols;
+    const int N = s->fft_size, cp = s->cp[l];
+    const int start = cp - (job->offset_divisor ? cp / job->offset_divisor : 0);
+
+    const c16_t *win = job->rxdata + (size_t)aa * job->rx_stride + s->offset[l] + start;
+    int16_t *out = (int16_t *)(job->rxdataF + ((size_t)aa * s->nb_symbols + l) * N);
+
+    if (((uintptr_t)win & (OFDM_ALIGN - 1)) == 0) {
+        nr_dft_plan_dft_pruned(s->plan, (int16_t *)win, out, s->alloc_start, s->alloc_len);
+    } else {
+        c16_t tmp[OFDM_MAX_FFT] __attribute__((aligned(OFDM_ALIGN)));
+        memcpy(tmp, win, N * sizeof(c16_t));
+        nr_dft_plan_dft_pruned(s->plan, (int16_t *)tmp, out, s->alloc_start, s->alloc_len);
+    }
+}
+
+void nr_ofdm_fep_batch(worker_pool_t *pool,
+                       const nr_ofdm_slot_t *s,
+                       int nb_rx,
+                       const c16_t *rxdata,
+                       uint32_t rx_stride,
+                       int offset_divisor,
+                       c16_t *rxdataF)
+{
+    ofdm_fep_job_t job = {
+        .s = s,
+        .rxdata = rxdata,
+        .rx_stride = rx_stride,
+        .offset_divisor = offset_divisor,
+        .rxdataF = rxdataF
+    };
+    worker_pool_run(pool, ofdm_fep_task, &job, nb_rx * s->nb_symbols);
+}
@@ -0,0 +1,59 @@
+#ifndef NR_OFDM_BATCH_H
+#define NR_OFDM_BATCH_H
+
+#include <stdint.h>
+#include "common/platform_types.h"
+#include "nr_dft_plan.h"
+#include "nr_worker_pool.h"
+
+/* Slot-level OFDM modulation and front end over every antenna at once. The
+ * frequency grid of a slot is one contiguous [ant][symbol][fft_size] block and
+ * the time-domain slot of an antenna is one contiguous buffer of slot_samples,
+ * symbols back to back with their 38.211 cyclic prefix. The (antenna, symbol) DFTs of
+ * a slot are independent and are spread over the threads of a worker pool. */
+
+#define NR_OFDM_MAX_SYMBOLS 14
+
+/* Layout of one slot at an FFT size and numerology */
+typedef struct {
+    int fft_size;
+    int nb_symbols;
+    int cp[NR_OFDM_MAX_SYMBOLS];           /* CP of each symbol, nr_cp_length() */
+    uint32_t offset[NR_OFDM_MAX_SYMBOLS];  /* first sample of each symbol, CP included */
+    uint32_t slot_samples;                 /* time-domain samples of the slot */
+    const nr_dft_plan_t *plan;             /* plan of fft_size, scale 1 as PHY_ofdm_mod() */
+    int alloc_start, alloc_len;            /* bins of the allocation, cyclic, the whole band by default */
+} nr_ofdm_slot_t;
+
+/* Layout of symbols 0..nb_symbols-1 of slot. Returns -1 for an FFT size
+ * without DFT plan or nb_symbols outside 1..14. */
+int nr_ofdm_slot_init(nr_ofdm_slot_t *s, int fft_size, int mu, int slot, int nb_symbols);
+
+/* Restricts the transforms of the slot to nb_rb RBs from start_rb, RB 0
+ * starting at bin first_carrier_offset, nr_fft_rb_range(). With the built-in
+ * backend the DFTs of a narrow allocation are pruned. */
+void nr_ofdm_slot_set_alloc(nr_ofdm_slot_t *s, int first_carrier_offset, int start_rb, int nb_rb);
+
+/* OFDM modulation of a slot for nb_tx antennas: txdataF is the
+ * [nb_tx][nb_symbols][fft_size] grid, txdata the [nb_tx][slot_samples] output.
+ * Each symbol is the IDFT of its grid row preceded by a copy of its last cp
+ * samples, what PHY_ofdm_mod() gives symbol by symbol with that CP. The grid
+ * must be zero outside the allocation of the slot. */
+void nr_ofdm_mod_batch(worker_pool_t *pool, const nr_ofdm_slot_t *s, int nb_tx, const c16_t *txdataF, c16_t *txdata);
+
+/* Front end of a slot for nb_rx antennas, the slot of antenna aa starting at
+ * rxdata + aa * rx_stride: rxdataF gets the [nb_rx][nb_symbols][fft_size]
+ * grid. The DFT window of symbol l starts cp[l] - cp[l] / offset_divisor
+ * samples into the symbol as in nr_slot_fep() (offset_divisor 0: right after
+ * the CP) and is read in place, so CP removal costs no copy for aligned
+ * windows. The allocation bins of every grid row are written, no clearing is
+ * needed; the other bins are written too with libdfts only. */
+void nr_ofdm_fep_batch(worker_pool_t *pool,
+                       const nr_ofdm_slot_t *s,
+                       int nb_rx,
+                       const c16_t *rxdata,
+                       uint32_t rx_stride,
+                       int offset_divisor,
+                       c16_t *rxdataF);
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ * PDSCH PTRS: time / frequency positions, and common phase
+ * error estimation and derotation on the UE. The CPE sums and the
+ * derotation run four REs per SSE vector with pmaddwd.
+ */
+
+#include "nr_ptrs.h"
+#include <math.h>
+#include <simde/x86/sse4.1.h>
+
+uint16_t nr_ptrs_symbol_mask(int start_symbol, int nb_symbols, int L, uint16_t dmrs_symb_pos)
+{
+    const int last = start_symbol + nb_symbols - 1;
+    uint16_t mask = 0;
+    int l_ref = start_symbol;
+    int i = 0;
+    while (l_ref + i * L <= last) {
+        /* A DMRS symbol since the previous PTRS symbol moves the reference */
+        int l_dmrs = -1;
+        const int from = l_ref + (i - 1) * L + 1 > l_ref ? l_ref + (i - 1) * L + 1 : l_ref;
+        for (int l = from; l <= l_ref + i * L; l++)
+            if (dmrs_symb_pos & (1 << l)) l_dmrs = l;
+        if (l_dmrs >= 0) {
+            l_ref = l_dmrs;
+            i = 1;
+        } else {
+            mask |= (uint16_t)(1 << (l_ref + i * L));
+            i++;
+        }
+    }
+    return mask;
+}
+
+void nr_ptrs_set_pattern(nr_re_pattern_t *p, int dmrs_type, int dmrs_port, int re_offset, int K, int nb_rb, uint16_t rnti)
+{
+    /* 38.211 table 7.4.1.2.2-1: k_ref^RE per DMRS port and resourceElementOffset */
+    static const uint8_t k_ref_type1[4][4] = { { 0, 2, 6, 8 }, { 2, 4, 8, 10 }, { 1, 3, 7, 9 }, { 3, 5, 9, 11 } };
+    static const uint8_t k_ref_type2[6][4] = { { 0, 1, 6, 7 }, { 1, 6, 7, 0 }, { 2, 3, 8, 9 },
+                                               { 3, 8, 9, 2 }, { 4, 5, 10, 11 }, { 5, 10, 11, 4 } };
+    re_offset &= 3;
+    if (dmrs_type == 1)
+        p->ptrs_sc = k_ref_type1[dmrs_port % 4][re_offset];
+    else
+        p->ptrs_sc = k_ref_type2[dmrs_port % 6][re_offset];
+    p->ptrs_period = K;
+    p->ptrs_rb_offset = nb_rb % K == 0 ? rnti % K : rnti % (nb_rb % K);
+}
+
+int nr_ptrs_count(const nr_re_pattern_t *p, int nb_rb)
+{
+    if (p->ptrs_period <= 0 || p->ptrs_rb_offset >= nb_rb) return 0;
+    return (nb_rb - 1 - p->ptrs_rb_offset) / p->ptrs_period + 1;
+}
+
+int nr_ptrs_extract(const c16_t *grid, int fft_size, int start_sc, int nb_rb, const nr_re_pattern_t *p, c16_t *out)
+{
+    const int n = nr_ptrs_count(p, nb_rb);
+    int bin = (start_sc + 12 * p->ptrs_rb_offset + p->ptrs_sc) % fft_size;
+    const int step = 12 * p->ptrs_period;
+    for (int i = 0; i < n; i++) {
+        out[i] = grid[bin];
+        bin += step;
+        if (bin >= fft_size) bin -= fft_size;
+    }
+    return n;
+}
+
+/* a * conj(b) of four REs: pmaddwd with b for the real parts, with (-b.i, b.r)
+ * for the imaginary ones */
+static inline void ptrs_mul_conj(simde__m128i a, simde__m128i b, simde__m128i *re, simde__m128i *im)
+{
+    const simde__m128i swap = simde_mm_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2);
+    const simde__m128i neg_re = simde_mm_set_epi16(1, -1, 1, -1, 1, -1, 1, -1);
+    *re = simde_mm_madd_epi16(a, b);
+    *im = simde_mm_madd_epi16(a, simde_mm_sign_epi16(simde_mm_shuffle_epi8(b, swap), neg_re));
+}
+
+float nr_ptrs_cpe(const c16_t *rx, const c16_t *ch, const c16_t *ref, int n)
+{
+    simde__m128 acc_re = simde_mm_setzero_ps();
+    simde__m128 acc_im = simde_mm_setzero_ps();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        /* t = rx conj(ref) >> 15, then acc += t conj(ch) */
+        simde__m128i re, im;
+        ptrs_mul_conj(simde_mm_loadu_si128((const simde__m128i *)(rx + i)),
+                      simde_mm_loadu_si128((const simde__m128i *)(ref + i)),
+                      &re,
+                      &im);
+        re = simde_mm_srai_epi32(re, 15);
+        im = simde_mm_srai_epi32(im, 15);
+        const simde__m128i t = simde_mm_packs_epi32(simde_mm_unpacklo_epi32(re, im), simde_mm_unpackhi_epi32(re, im));
+        ptrs_mul_conj(t, simde_mm_loadu_si128((const simde__m128i *)(ch + i)), &re, &im);
+        acc_re = simde_mm_add_ps(acc_re, simde_mm_cvtepi32_ps(re));
+        acc_im = simde_mm_add_ps(acc_im, simde_mm_cvtepi32_ps(im));
+    }
+    float v_re[4], v_im[4];
+    simde_mm_storeu_ps(v_re, acc_re);
+    simde_mm_storeu_ps(v_im, acc_im);
+    float sum_re = v_re[0] + v_re[1] + v_re[2] + v_re[3];
+    float sum_im = v_im[0] + v_im[1] + v_im[2] + v_im[3];
+
+    for (; i < n; i++) {
+        int32_t t_re = ((int32_t)rx[i].r * ref[i].r + (int32_t)rx[i].i * ref[i].i) >> 15;
+        int32_t t_im = ((int32_t)rx[i].i * ref[i].r - (int32_t)rx[i].r * ref[i].i) >> 15;
+        t_re = t_re > 32767 ? 32767 : t_re < -32768 ? -32768 : t_re;
+        t_im = t_im > 32767 ? 32767 : t_im < -32768 ? -32768 : t_im;
+        sum_re += (float)t_re * ch[i].r + (float)t_im * ch[i].i;
+        sum_im += (float)t_im * ch[i].r - (float)t_re * ch[i].i;
+    }
+    return atan2f(sum_im, sum_re);
+}
+
+void nr_ptrs_interpolate(uint16_t ptrs_symb_pos, uint16_t data_symb_pos, float phase[NR_PTRS_MAX_SYMBOLS])
+{
+    int prev = -1;
+    for (int l = 0; l < NR_PTRS_MAX_SYMBOLS; l++) {
+        if (ptrs_symb_pos & (1 << l)) {
+            prev = l;
+            continue;
+        }
+        if (!(data_symb_pos & (1 << l))) continue;
+        int next = l + 1;
+        while (next < NR_PTRS_MAX_SYMBOLS && !(ptrs_symb_pos & (1 << next)))
+            next++;
+        if (prev < 0 && next == NR_PTRS_MAX_SYMBOLS) {
+            phase[l] = 0;
+        } else if (prev < 0) {
+            phase[l] = phase[next];
+        } else if (next == NR_PTRS_MAX_SYMBOLS) {
+            phase[l] = phase[prev];
+        } else {
+            /* Shortest way round from the previous phase to the next one */
+            float d = phase[next] - phase[prev];
+            if (d > (float)M_PI) d -= 2 * (float)M_PI;
+            if (d < -(float)M_PI) d += 2 * (float)M_PI;
+            phase[l] = phase[prev] + d * (float)(l - prev) / (float)(next - prev);
+        }
+    }
+}
+
+void nr_ptrs_derotate(c16_t *re, int n, float phase)
+{
+    const int16_t c = (int16_t)lrintf(32767.0f * cosf(phase));
+    const int16_t s = (int16_t)lrintf(32767.0f * sinf(phase));
+
+    /* (r, i) exp(-j phase) = (r c + i s, i c - r s) */
+    const simde__m128i g_re = simde_mm_set1_epi32((int32_t)(((uint32_t)(uint16_t)s << 16) | (uint16_t)c));
+    const simde__m128i g_im = simde_mm_set1_epi32((int32_t)(((uint32_t)(uint16_t)c << 16) | (uint16_t)-s));
+    const simde__m128i round = simde_mm_set1_epi32(1 << 14);
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        const simde__m128i y = simde_mm_loadu_si128((const simde__m128i *)(re + k));
+        const simde__m128i o_re = simde_mm_srai_epi32(simde_mm_add_epi32(simde_mm_madd_epi16(y, g_re), round), 15);
+        const simde__m128i o_im = simde_mm_srai_epi32(simde_mm_add_epi32(simde_mm_madd_epi16(y, g_im), round), 15);
+        simde_mm_storeu_si128((simde__m128i *)(re + k),
+                              simde_mm_packs_epi32(simde_mm_unpacklo_epi32(o_re, o_im), simde_mm_unpackhi_epi32(o_re, o_im)));
+    }
+    for (; k < n; k++) {
+        int32_t o_re = ((int32_t)re[k].r * c + (int32_t)re[k].i * s + (1 << 14)) >> 15;
+        int32_t o_im = ((int32_t)re[k].i * c - (int32_t)re[k].r * s + (1 << 14)) >> 15;
+        re[k].r = (int16_t)(o_re > 32767 ? 32767 : o_re < -32768 ? -32768 : o_re);
+        re[k].i = (int16_t)(o_im > 32767 ? 32767 : o_im < -32768 ? -32768 : o_im);
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef NR_PTRS_H
+#define NR_PTRS_H
+
+#include <stdint.h>
+#include "common/platform_types.h"
+#include "nr_re_mapping.h"
+
+/* PDSCH phase-tracking reference signal (38.211 7.4.1.2): position in time
+ * and frequency, and the UE side, where the common phase error (CPE) of a
+ * symbol is estimated from its PTRS REs and removed from its data REs. The
+ * PTRS RE of every K-th RB is described by the ptrs_* fields of an
+ * nr_re_pattern_t, so the same pattern drives the gNB mapping, the UE
+ * extraction of the data REs and the PTRS REs gathered here. The PTRS values
+ * are the DMRS sequence of the symbol, nr_dmrs_generate(). */
+
+#define NR_PTRS_MAX_SYMBOLS 14
+
+/* Symbols of the allocation carrying PTRS every L symbols (time density L =
+ * 1, 2 or 4), restarting after each DMRS symbol, set_ptrs_symb_idx() of OAI.
+ * Bit l of the result is symbol l. */
+uint16_t nr_ptrs_symbol_mask(int start_symbol, int nb_symbols, int L, uint16_t dmrs_symb_pos);
+
+/* PTRS of the nb_rb RBs of an allocation with frequency density K (2 or 4)
+ * and resourceElementOffset re_offset (0..3) for DMRS port dmrs_port (0 for
+ * port 1000), 38.211 table 7.4.1.2.2-1 and k_RB_ref from the RNTI */
+void nr_ptrs_set_pattern(nr_re_pattern_t *p, int dmrs_type, int dmrs_port, int re_offset, int K, int nb_rb, uint16_t rnti);
+
+/* PTRS REs of nb_rb RBs under p */
+int nr_ptrs_count(const nr_re_pattern_t *p, int nb_rb);
+
+/* Gathers the PTRS REs of nb_rb RBs from bin start_sc of grid, wrapping at
+ * fft_size as nr_re_extract(). Returns their number. */
+int nr_ptrs_extract(const c16_t *grid, int fft_size, int start_sc, int nb_rb, const nr_re_pattern_t *p, c16_t *out);
+
+/* CPE of a symbol in radians: the angle of sum rx[i] conj(ch[i] ref[i]) over
+ * its n PTRS REs, with ch the channel estimate at those REs */
+float nr_ptrs_cpe(const c16_t *rx, const c16_t *ch, const c16_t *ref, int n);
+
+/* Fills phase[l] of the symbols of data_symb_pos outside ptrs_symb_pos by
+ * linear interpolation between the PTRS symbols around them, holding the
+ * nearest one before the first and after the last */
+void nr_ptrs_interpolate(uint16_t ptrs_symb_pos, uint16_t data_symb_pos, float phase[NR_PTRS_MAX_SYMBOLS]);
+
+/* Multiplies the n REs of re by exp(-j phase), in place */
+void nr_ptrs_derotate(c16_t *re, int n, float phase);
+
+#endif
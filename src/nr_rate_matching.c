@@ -0,0 +1,303 @@
+/*
+ * LDPC rate matching (38.212 5.4.2) on packed bits: circular-buffer bit
+ * selection per redundancy version and the Qm-row bit interleaver, the latter
+ * done as a byte transpose followed by movemask bit transposes.
+ */
+
+#include "nr_rate_matching.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <simde/x86/sse2.h>
+#include <simde/x86/ssse3.h>
+
+static inline size_t align16(size_t n)
+{
+    return (n + 15) & ~(size_t)15;
+}
+
+uint32_t nr_rm_get_k0(uint8_t BG, uint32_t Zc, uint32_t Ncb, uint8_t rv)
+{
+    /* Numerators of Table 5.4.2.1-2 for rv 1..3, over 66 (BG1) or 50 (BG2) */
+    static const uint32_t num_bg1[4] = { 0, 17, 33, 56 };
+    static const uint32_t num_bg2[4] = { 0, 13, 25, 43 };
+
+    if (rv == 0 || rv > 3) return 0;
+    if (BG == 1)
+        return (num_bg1[rv] * Ncb / (66 * Zc)) * Zc;
+    return (num_bg2[rv] * Ncb / (50 * Zc)) * Zc;
+}
+
+uint32_t nr_rm_get_E(const nr_tb_seg_t *seg, uint32_t G, uint8_t Qm, uint8_t nb_layers, uint32_t r)
+{
+    const uint32_t C = seg->C;
+    const uint32_t NLQm = (uint32_t)nb_layers * Qm;
+    const uint32_t sym = G / NLQm;
+
+    if (r <= C - (sym % C) - 1)
+        return NLQm * (sym / C);
+    return NLQm * ((sym + C - 1) / C);
+}
+
+nr_rm_ctx_t *nr_rm_init(uint32_t max_E)
+{
+    nr_rm_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    if (!ctx) return NULL;
+
+    ctx->max_E = max_E;
+    /* A row holds up to E bits (Qm=1); the transpose reads whole 16-byte blocks
+     * and the row writer stores 8 bytes at a time */
+    ctx->row_stride = align16((max_E + 7) / 8) + 16;
+    ctx->rows = aligned_alloc(64, NR_RM_MAX_QM * ctx->row_stride);
+    if (!ctx->rows) {
+        free(ctx);
+        return NULL;
+    }
+    memset(ctx->rows, 0, NR_RM_MAX_QM * ctx->row_stride);
+    return ctx;
+}
+
+void nr_rm_free(nr_rm_ctx_t *ctx)
+{
+    if (!ctx) return;
+    free(ctx->rows);
+    free(ctx);
+}
+
+/* n (1..57) bits of s at bit offset off, MSB-first, right-aligned */
+static inline uint64_t bits_get(const uint8_t *s, uint32_t off, int n)
+{
+    uint64_t w;
+    memcpy(&w, s + (off >> 3), 8);
+    w = __builtin_bswap64(w);
+    return (w << (off & 7)) >> (64 - n);
+}
+
+/* MSB-first bit writer, pending bits kept left-aligned in acc. Every put
+ * stores the whole accumulator, so the partial last byte is always in memory. */
+typedef struct {
+    uint8_t *p;
+    uint64_t acc;
+    int n;
+} msb_writer_t;
+
+static inline void msb_put(msb_writer_t *w, uint64_t v, int n)
+{
+    w->acc |= v << (64 - n - w->n);
+    w->n += n;
+    const uint64_t be = __builtin_bswap64(w->acc);
+    memcpy(w->p, &be, 8);
+    w->p += w->n >> 3;
+    w->acc <<= (w->n & ~7);
+    w->n &= 7;
+}
+
+/* LSB-first bit writer for the interleaved output */
+typedef struct {
+    uint8_t *p;
+    uint64_t acc;
+    int n;
+} lsb_writer_t;
+
+static inline void lsb_init(lsb_writer_t *w, uint8_t *f, uint32_t off)
+{
+    w->p = f + (off >> 3);
+    w->n = off & 7;
+    w->acc = w->n ? (*w->p & ((1u << w->n) - 1)) : 0;
+}
+
+static inline void lsb_put(lsb_writer_t *w, uint32_t v, int n)
+{
+    w->acc |= (uint64_t)v << w->n;
+    w->n += n;
+    if (w->n >= 32) {
+        const uint32_t lo = (uint32_t)w->acc;
+        memcpy(w->p, &lo, 4);
+        w->p += 4;
+        w->acc >>= 32;
+        w->n -= 32;
+    }
+}
+
+static inline void lsb_flush(lsb_writer_t *w)
+{
+    for (; w->n > 0; w->n -= 8) {
+        *w->p++ = (uint8_t)w->acc;
+        w->acc >>= 8;
+    }
+}
+
+/* Bit selection (38.212 5.4.2.1): stream E bits of the circular buffer from
+ * k0 on, skipping the filler bits, into Qm rows of E/Qm bits. The rows are the
+ * Qm x E/Qm matrix read column-wise by the interleaver. */
+static void rm_select_rows(nr_rm_ctx_t *ctx, const uint8_t *d, const nr_tb_seg_t *seg,
+                           uint32_t Ncb, uint32_t k0, uint8_t Qm, uint32_t Er)
+{
+    const uint32_t d0 = 2 * seg->Zc;              /* d_0 in the encoder output */
+    const uint32_t fs = seg->Kprime - d0;         /* filler bits: [fs, fe) */
+    const uint32_t fe = seg->K - d0;
+    uint32_t k = k0;
+
+    for (int i = 0; i < Qm; i++) {
+        msb_writer_t w = { ctx->rows + (size_t)i * ctx->row_stride, 0, 0 };
+        uint32_t left = Er;
+
+        while (left) {
+            /* k0 may fall inside the fillers, not only on their start */
+            if (k >= fs && k < fe) k = fe;
+            if (k >= Ncb) k = 0;
+
+            /* with LBRM, Ncb may end before or inside the fillers */
+            const uint32_t end = (k < fs && fs < Ncb) ? fs : Ncb;
+            uint32_t n = end - k;
+            if (n > left) n = left;
+            if (n > 56) n = 56;
+
+            msb_put(&w, bits_get(d, d0 + k, (int)n), (int)n);
+            k += n;
+            left -= n;
+        }
+    }
+}
+
+/* Column-wise read of the rows: 8x16 byte transpose of 16 column bytes so that
+ * each vector holds the 8 row bytes of two column bytes, then 8 movemasks per
+ * vector peel one column of row bits each. cols[j] gets bit i = row i. */
+static inline void rm_transpose_block(const uint8_t *rows, size_t stride, int nrows, uint32_t cb,
+                                      uint16_t cols[128], int shift)
+{
+    simde__m128i r[8];
+    for (int i = 0; i < 8; i++)
+        r[i] = (i < nrows) ? simde_mm_loadu_si128((const simde__m128i *)(rows + i * stride + cb))
+                           : simde_mm_setzero_si128();
+
+    simde__m128i a[8], b[8], c[8];
+    for (int i = 0; i < 4; i++) {
+        a[2 * i]     = simde_mm_unpacklo_epi8(r[2 * i], r[2 * i + 1]);
+        a[2 * i + 1] = simde_mm_unpackhi_epi8(r[2 * i], r[2 * i + 1]);
+    }
+    for (int i = 0; i < 2; i++) {
+        b[4 * i + 0] = simde_mm_unpacklo_epi16(a[4 * i + 0], a[4 * i + 2]);
+        b[4 * i + 1] = simde_mm_unpackhi_epi16(a[4 * i + 0], a[4 * i + 2]);
+        b[4 * i + 2] = simde_mm_unpacklo_epi16(a[4 * i + 1], a[4 * i + 3]);
+        b[4 * i + 3] = simde_mm_unpackhi_epi16(a[4 * i + 1], a[4 * i + 3]);
+    }
+    /* c[k] holds column bytes 2k (low half) and 2k+1 (high half) */
+    c[0] = simde_mm_unpacklo_epi32(b[0], b[4]);
+    c[1] = simde_mm_unpackhi_epi32(b[0], b[4]);
+    c[2] = simde_mm_unpacklo_epi32(b[1], b[5]);
+    c[3] = simde_mm_unpackhi_epi32(b[1], b[5]);
+    c[4] = simde_mm_unpacklo_epi32(b[2], b[6]);
+    c[5] = simde_mm_unpackhi_epi32(b[2], b[6]);
+    c[6] = simde_mm_unpacklo_epi32(b[3], b[7]);
+    c[7] = simde_mm_unpackhi_epi32(b[3], b[7]);
+
+    for (int k = 0; k < 8; k++) {
+        simde__m128i v = c[k];
+        for (int bit = 0; bit < 8; bit++) {
+            const uint32_t m = (uint32_t)simde_mm_movemask_epi8(v);
+            cols[16 * k + bit]     |= (uint16_t)((m & 0xFF) << shift);
+            cols[16 * k + 8 + bit] |= (uint16_t)((m >> 8) << shift);
+            v = simde_mm_add_epi8(v, v);
+        }
+    }
+}
+
+int nr_rate_matching_cb(nr_rm_ctx_t *ctx, const uint8_t *d, const nr_tb_seg_t *seg, uint32_t Ncb,
+                        uint8_t rv, uint8_t Qm, uint32_t E, uint8_t *f, uint32_t f_off)
+{
+    if (!ctx || !d || !seg || !f || Qm == 0 || Qm > NR_RM_MAX_QM || E % Qm || E > ctx->max_E || Ncb > seg->Ncb)
+        return -1;
+
+    const uint32_t Er = E / Qm;
+    rm_select_rows(ctx, d, seg, Ncb, nr_rm_get_k0(seg->BG, seg->Zc, Ncb, rv), Qm, Er);
+
+    /* Bit interleaving (38.212 5.4.2.2): f_{i + j*Qm} = e_{i*Er + j} */
+    lsb_writer_t w;
+    lsb_init(&w, f, f_off);
+
+    uint16_t cols[128];
+    for (uint32_t j0 = 0; j0 < Er; j0 += 128) {
+        memset(cols, 0, sizeof(cols));
+        rm_transpose_block(ctx->rows, ctx->row_stride, Qm < 8 ? Qm : 8, j0 >> 3, cols, 0);
+        if (Qm > 8)
+            rm_transpose_block(ctx->rows + 8 * ctx->row_stride, ctx->row_stride, Qm - 8, j0 >> 3, cols, 8);
+
+        const uint32_t ncols = (Er - j0 < 128) ? Er - j0 : 128;
+        for (uint32_t j = 0; j < ncols; j++)
+            lsb_put(&w, cols[j], Qm);
+    }
+    lsb_flush(&w);
+
+    return (int)E;
+}
+
+int nr_rate_matching_cb_ref(const uint8_t *d, const nr_tb_seg_t *seg, uint32_t Ncb,
+                            uint8_t rv, uint8_t Qm, uint32_t E, uint8_t *f, uint32_t f_off)
+{
+    if (!d || !seg || !f || Qm == 0 || E % Qm || Ncb > seg->Ncb) return -1;
+
+    uint8_t *e = malloc(E);
+    if (!e) return -1;
+
+    const uint32_t d0 = 2 * seg->Zc;
+    const uint32_t k0 = nr_rm_get_k0(seg->BG, seg->Zc, Ncb, rv);
+
+    /* Bit selection */
+    for (uint32_t k = 0, j = 0; k < E; j++) {
+        const uint32_t pos = (k0 + j) % Ncb;
+        if (pos + d0 >= seg->Kprime && pos + d0 < seg->K) continue;   /* <NULL> */
+        const uint32_t bit = d0 + pos;
+        e[k++] = (d[bit >> 3] >> (7 - (bit & 7))) & 1;
+    }
+
+    /* Bit interleaving */
+    const uint32_t Er = E / Qm;
+    for (uint32_t j = 0; j < Er; j++) {
+        for (uint32_t i = 0; i < Qm; i++) {
+            const uint32_t n = f_off + i + j * Qm;
+            if (e[i * Er + j])
+                f[n >> 3] |= (uint8_t)(1u << (n & 7));
+            else
+                f[n >> 3] &= (uint8_t)~(1u << (n & 7));
+        }
+    }
+
+    free(e);
+    return (int)E;
+}
+
+int nr_rate_matching_tb(nr_rm_ctx_t *ctx, nr_tb_encoder_t *enc, uint32_t G, uint8_t Qm,
+                        uint8_t nb_layers, uint8_t rv, uint8_t *f)
+{
+    if (!ctx || !enc || !f || !nb_layers) return -1;
+
+    const nr_tb_seg_t *seg = &enc->seg;
+    uint32_t off = 0;
+    for (uint32_t r = 0; r < seg->C; r++) {
+        const uint32_t E = nr_rm_get_E(seg, G, Qm, nb_layers, r);
+        if (nr_rate_matching_cb(ctx, nr_tb_encoder_cb_output(enc, r), seg, seg->Ncb, rv, Qm, E, f, off) < 0) {
+            printf("nr_rate_matching_tb: code block %u failed (E=%u, Qm=%u)\n", r, E, Qm);
+            return -1;
+        }
+        off += E;
+    }
+    return (int)off;
+}
+
+void nr_rm_unpack_bits(const uint8_t *f, uint32_t nbits, uint8_t *out)
+{
+    const simde__m128i spread = simde_mm_set_epi8(1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+    const simde__m128i mask = simde_mm_set_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                                                (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+    const simde__m128i one = simde_mm_set1_epi8(1);
+    const uint32_t nbytes = (nbits + 7) >> 3;
+
+    for (uint32_t i = 0; i < nbytes; i += 2) {
+        const int hi = (i + 1 < nbytes) ? f[i + 1] : 0;
+        simde__m128i v = simde_mm_cvtsi32_si128(f[i] | (hi << 8));
+        v = simde_mm_and_si128(simde_mm_shuffle_epi8(v, spread), mask);
+        v = simde_mm_and_si128(simde_mm_cmpeq_epi8(v, mask), one);
+        simde_mm_storeu_si128((simde__m128i *)(out + 8 * i), v);
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef NR_RATE_MATCHING_H
+#define NR_RATE_MATCHING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "nr_tb_segmentation.h"
+
+/* LDPC rate matching (38.212 5.4.2): bit selection from the circular buffer
+ * at the RV start position k0, skipping filler bits, followed by the bit
+ * interleaver for the modulation order.
+ *
+ * Bit order: the input d is the LDPC encoder output, packed MSB-first like the
+ * code blocks (nr_tb_segmentation.h), with d_0 at bit 2*Zc. The output f is
+ * packed LSB-first (bit n is bit n&7 of byte n>>3), i.e. the bit order of the
+ * uint32 words produced by nr_codeword_scrambling. */
+
+/* Largest modulation order handled by the interleaver */
+#define NR_RM_MAX_QM 10
+
+/* 38.212 Table 5.4.2.1-2 start position of RV rv in a circular buffer of Ncb bits */
+uint32_t nr_rm_get_k0(uint8_t BG, uint32_t Zc, uint32_t Ncb, uint8_t rv);
+
+/* 38.212 5.4.2.1 rate-matched length E_r of code block r when the TB is mapped
+ * onto G coded bits over nb_layers layers */
+uint32_t nr_rm_get_E(const nr_tb_seg_t *seg, uint32_t G, uint8_t Qm, uint8_t nb_layers, uint32_t r);
+
+/* Scratch for the interleaver: Qm rows of E/Qm bits, each row padded to a
+ * whole number of 16-column blocks */
+typedef struct nr_rm_ctx_s {
+    uint32_t max_E;
+    size_t row_stride;        /* bytes per row */
+    uint8_t *rows;            /* [NR_RM_MAX_QM][row_stride], MSB-first */
+} nr_rm_ctx_t;
+
+nr_rm_ctx_t *nr_rm_init(uint32_t max_E);
+void nr_rm_free(nr_rm_ctx_t *ctx);
+
+/* Rate-match and interleave code block d into E bits written to f from bit
+ * f_off on. Ncb is the circular buffer size (seg->Ncb without LBRM). Returns E
+ * or -1 on invalid parameters. */
+int nr_rate_matching_cb(nr_rm_ctx_t *ctx, const uint8_t *d, const nr_tb_seg_t *seg, uint32_t Ncb,
+                        uint8_t rv, uint8_t Qm, uint32_t E, uint8_t *f, uint32_t f_off);
+
+/* Bit-by-bit reference of nr_rate_matching_cb following the 38.212 pseudo-code */
+int nr_rate_matching_cb_ref(const uint8_t *d, const nr_tb_seg_t *seg, uint32_t Ncb,
+                            uint8_t rv, uint8_t Qm, uint32_t E, uint8_t *f, uint32_t f_off);
+
+/* Rate-match every code block of the last TB encoded by enc into the G-bit
+ * codeword f. Returns G or -1. */
+int nr_rate_matching_tb(nr_rm_ctx_t *ctx, nr_tb_encoder_t *enc, uint32_t G, uint8_t Qm,
+                        uint8_t nb_layers, uint8_t rv, uint8_t *f);
+
+/* Expand nbits LSB-first packed bits to one bit per byte, the input format of
+ * nr_codeword_scrambling. out must hold nbits rounded up to 32 bytes. */
+void nr_rm_unpack_bits(const uint8_t *f, uint32_t nbits, uint8_t *out);
+
+#endif
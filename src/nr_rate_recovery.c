@@ -0,0 +1,259 @@
+/*
+ * Rate recovery (inverse of 38.212 5.4.2) and HARQ soft combining: LLR
+ * de-interleaving with SSE transposes for Qm = 2/4/8, circular-buffer
+ * placement per RV and saturating adds into int16 or int8 soft buffers.
+ */
+
+#include "nr_rate_recovery.h"
+#include "nr_rate_matching.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <simde/x86/sse2.h>
+#include <simde/x86/ssse3.h>
+
+nr_harq_pool_t *nr_harq_pool_init(int nb_procs, uint32_t max_C, uint32_t max_E, int llr_bits)
+{
+    if (nb_procs < 1 || max_C == 0 || (llr_bits != 8 && llr_bits != 16)) return NULL;
+
+    nr_harq_pool_t *pool = calloc(1, sizeof(*pool));
+    if (!pool) return NULL;
+
+    const size_t elem = llr_bits / 8;
+    pool->nb_procs = nb_procs;
+    pool->llr_bits = llr_bits;
+    pool->max_C = max_C;
+    pool->max_E = max_E;
+    /* Largest circular buffer is 66 * 384 (BG1, Zc = 384) */
+    pool->cb_stride = ((66 * 384 * elem + 63) & ~(size_t)63) / elem;
+    pool->mem_size = (size_t)nb_procs * max_C * pool->cb_stride * elem;
+
+    pool->mem = aligned_alloc(64, pool->mem_size);
+    pool->e = aligned_alloc(64, ((size_t)max_E * sizeof(int16_t) + 16 + 63) & ~(size_t)63);
+    pool->procs = calloc(nb_procs, sizeof(nr_harq_proc_t));
+    if (!pool->mem || !pool->e || !pool->procs) {
+        nr_harq_pool_free(pool);
+        return NULL;
+    }
+
+    /* Touch every page now so the first slots do not pay the page faults */
+    memset(pool->mem, 0, pool->mem_size);
+    return pool;
+}
+
+void nr_harq_pool_free(nr_harq_pool_t *pool)
+{
+    if (!pool) return;
+    free(pool->mem);
+    free(pool->e);
+    free(pool->procs);
+    free(pool);
+}
+
+int nr_harq_proc_reset(nr_harq_pool_t *pool, int pid, const nr_tb_seg_t *seg)
+{
+    if (!pool || !seg || pid < 0 || pid >= pool->nb_procs || seg->C > pool->max_C) return -1;
+
+    nr_harq_proc_t *h = &pool->procs[pid];
+    h->active = 1;
+    h->round = 0;
+    h->C = seg->C;
+    h->Ncb = seg->Ncb;
+
+    const size_t elem = pool->llr_bits / 8;
+    for (uint32_t r = 0; r < seg->C; r++) {
+        void *w = (uint8_t *)pool->mem + ((size_t)pid * pool->max_C + r) * pool->cb_stride * elem;
+        memset(w, 0, seg->Ncb * elem);
+    }
+    return 0;
+}
+
+/* Bit de-interleaving (38.212 5.4.2.2 inverse): e_{i*Er + j} = f_{i + j*Qm},
+ * i.e. a transpose of the Er x Qm LLR matrix into Qm rows */
+static void rr_deinterleave(const int16_t *f, int16_t *e, uint8_t Qm, uint32_t Er)
+{
+    uint32_t j = 0;
+
+    if (Qm == 2) {
+        /* [a0 b0 a1 b1 ...] -> [a0 a1 a2 a3 b0 b1 b2 b3] per vector */
+        const simde__m128i sh = simde_mm_set_epi8(15, 14, 11, 10, 7, 6, 3, 2, 13, 12, 9, 8, 5, 4, 1, 0);
+        int16_t *e0 = e, *e1 = e + Er;
+        for (; j + 8 <= Er; j += 8) {
+            const simde__m128i s0 = simde_mm_shuffle_epi8(simde_mm_loadu_si128((const simde__m128i *)(f + 2 * j)), sh);
+            const simde__m128i s1 = simde_mm_shuffle_epi8(simde_mm_loadu_si128((const simde__m128i *)(f + 2 * j + 8)), sh);
+            simde_mm_storeu_si128((simde__m128i *)(e0 + j), simde_mm_unpacklo_epi64(s0, s1));
+            simde_mm_storeu_si128((simde__m128i *)(e1 + j), simde_mm_unpackhi_epi64(s0, s1));
+        }
+    } else if (Qm == 4) {
+        /* Two columns per vector; pair each row's two LLRs, then 4x4 transpose of the pairs */
+        const simde__m128i sh = simde_mm_set_epi8(15, 14, 7, 6, 13, 12, 5, 4, 11, 10, 3, 2, 9, 8, 1, 0);
+        for (; j + 8 <= Er; j += 8) {
+            simde__m128i s[4];
+            for (int k = 0; k < 4; k++)
+                s[k] = simde_mm_shuffle_epi8(simde_mm_loadu_si128((const simde__m128i *)(f + 4 * j + 8 * k)), sh);
+            const simde__m128i t0 = simde_mm_unpacklo_epi32(s[0], s[1]);
+            const simde__m128i t1 = simde_mm_unpackhi_epi32(s[0], s[1]);
+            const simde__m128i t2 = simde_mm_unpacklo_epi32(s[2], s[3]);
+            const simde__m128i t3 = simde_mm_unpackhi_epi32(s[2], s[3]);
+            simde_mm_storeu_si128((simde__m128i *)(e + 0 * Er + j), simde_mm_unpacklo_epi64(t0, t2));
+            simde_mm_storeu_si128((simde__m128i *)(e + 1 * Er + j), simde_mm_unpackhi_epi64(t0, t2));
+            simde_mm_storeu_si128((simde__m128i *)(e + 2 * Er + j), simde_mm_unpacklo_epi64(t1, t3));
+            simde_mm_storeu_si128((simde__m128i *)(e + 3 * Er + j), simde_mm_unpackhi_epi64(t1, t3));
+        }
+    } else if (Qm == 8) {
+        /* One column per vector: 8x8 int16 transpose */
+        for (; j + 8 <= Er; j += 8) {
+            simde__m128i v[8], a[8], b[8];
+            for (int k = 0; k < 8; k++)
+                v[k] = simde_mm_loadu_si128((const simde__m128i *)(f + 8 * (j + k)));
+            for (int k = 0; k < 4; k++) {
+                a[2 * k]     = simde_mm_unpacklo_epi16(v[2 * k], v[2 * k + 1]);
+                a[2 * k + 1] = simde_mm_unpackhi_epi16(v[2 * k], v[2 * k + 1]);
+            }
+            for (int k = 0; k < 2; k++) {
+                b[4 * k + 0] = simde_mm_unpacklo_epi32(a[4 * k + 0], a[4 * k + 2]);
+                b[4 * k + 1] = simde_mm_unpackhi_epi32(a[4 * k + 0], a[4 * k + 2]);
+                b[4 * k + 2] = simde_mm_unpacklo_epi32(a[4 * k + 1], a[4 * k + 3]);
+                b[4 * k + 3] = simde_mm_unpackhi_epi32(a[4 * k + 1], a[4 * k + 3]);
+            }
+            for (int k = 0; k < 4; k++) {
+                simde_mm_storeu_si128((simde__m128i *)(e + (2 * k) * Er + j), simde_mm_unpacklo_epi64(b[k], b[k + 4]));
+                simde_mm_storeu_si128((simde__m128i *)(e + (2 * k + 1) * Er + j), simde_mm_unpackhi_epi64(b[k], b[k + 4]));
+            }
+        }
+    }
+
+    /* Tail columns, and every column for Qm = 1/6/10 */
+    for (; j < Er; j++)
+        for (uint32_t i = 0; i < Qm; i++)
+            e[i * Er + j] = f[i + j * Qm];
+}
+
+static inline void rr_combine16(int16_t *w, const int16_t *e, uint32_t n)
+{
+    uint32_t t = 0;
+    for (; t + 8 <= n; t += 8) {
+        const simde__m128i acc = simde_mm_loadu_si128((const simde__m128i *)(w + t));
+        const simde__m128i in = simde_mm_loadu_si128((const simde__m128i *)(e + t));
+        simde_mm_storeu_si128((simde__m128i *)(w + t), simde_mm_adds_epi16(acc, in));
+    }
+    for (; t < n; t++) {
+        int32_t s = w[t] + e[t];
+        w[t] = (int16_t)(s > 32767 ? 32767 : (s < -32768 ? -32768 : s));
+    }
+}
+
+static inline void rr_combine8(int8_t *w, const int16_t *e, uint32_t n)
+{
+    uint32_t t = 0;
+    for (; t + 16 <= n; t += 16) {
+        const simde__m128i in = simde_mm_packs_epi16(simde_mm_loadu_si128((const simde__m128i *)(e + t)),
+                                                     simde_mm_loadu_si128((const simde__m128i *)(e + t + 8)));
+        const simde__m128i acc = simde_mm_loadu_si128((const simde__m128i *)(w + t));
+        simde_mm_storeu_si128((simde__m128i *)(w + t), simde_mm_adds_epi8(acc, in));
+    }
+    for (; t < n; t++) {
+        int32_t in = e[t] > 127 ? 127 : (e[t] < -128 ? -128 : e[t]);
+        int32_t s = w[t] + in;
+        w[t] = (int8_t)(s > 127 ? 127 : (s < -128 ? -128 : s));
+    }
+}
+
+/* Walk the circular buffer from k0 exactly like the transmitter's bit
+ * selection and combine each contiguous run of the de-interleaved LLRs e */
+static void rr_place(void *w, int llr_bits, const int16_t *e, const nr_tb_seg_t *seg, uint8_t rv, uint32_t E)
+{
+    const uint32_t Ncb = seg->Ncb;
+    const uint32_t fs = seg->Kprime - 2 * seg->Zc;    /* filler bits: [fs, fe) */
+    const uint32_t fe = seg->K - 2 * seg->Zc;
+
+    uint32_t k = nr_rm_get_k0(seg->BG, seg->Zc, Ncb, rv);
+    for (uint32_t t = 0; t < E;) {
+        /* k0 may fall inside the fillers, not only on their start */
+        if (k >= fs && k < fe) k = fe;
+        if (k >= Ncb) k = 0;
+
+        /* with LBRM, Ncb may end before or inside the fillers */
+        const uint32_t end = (k < fs && fs < Ncb) ? fs : Ncb;
+        uint32_t n = end - k;
+        if (n > E - t) n = E - t;
+
+        if (llr_bits == 16)
+            rr_combine16((int16_t *)w + k, e + t, n);
+        else
+            rr_combine8((int8_t *)w + k, e + t, n);
+        k += n;
+        t += n;
+    }
+}
+
+int nr_rate_recovery_cb(nr_harq_pool_t *pool, int pid, uint32_t r, const nr_tb_seg_t *seg,
+                        uint8_t rv, uint8_t Qm, uint32_t E, const int16_t *llr)
+{
+    if (!pool || !seg || !llr || pid < 0 || pid >= pool->nb_procs || r >= pool->max_C ||
+        Qm == 0 || E % Qm || E > pool->max_E)
+        return -1;
+
+    rr_deinterleave(llr, pool->e, Qm, E / Qm);
+    if (pool->llr_bits == 16)
+        rr_place(nr_harq_cb_buffer16(pool, pid, r), 16, pool->e, seg, rv, E);
+    else
+        rr_place(nr_harq_cb_buffer8(pool, pid, r), 8, pool->e, seg, rv, E);
+
+    return (int)E;
+}
+
+int nr_rate_recovery_cb_into16(int16_t *w, int16_t *e, const nr_tb_seg_t *seg,
+                               uint8_t rv, uint8_t Qm, uint32_t E, const int16_t *llr)
+{
+    if (!w || !e || !seg || !llr || Qm == 0 || E % Qm) return -1;
+
+    rr_deinterleave(llr, e, Qm, E / Qm);
+    rr_place(w, 16, e, seg, rv, E);
+    return (int)E;
+}
+
+int nr_rate_recovery_tb(nr_harq_pool_t *pool, int pid, const nr_tb_seg_t *seg, uint32_t G,
+                        uint8_t Qm, uint8_t nb_layers, uint8_t rv, const int16_t *llr)
+{
+    if (!pool || !seg || !llr || !nb_layers || pid < 0 || pid >= pool->nb_procs) return -1;
+
+    nr_harq_proc_t *h = &pool->procs[pid];
+    if (!h->active || h->C != seg->C || h->Ncb != seg->Ncb) {
+        printf("nr_rate_recovery_tb: HARQ process %d not reset for this TB\n", pid);
+        return -1;
+    }
+
+    uint32_t off = 0;
+    for (uint32_t r = 0; r < seg->C; r++) {
+        const uint32_t E = nr_rm_get_E(seg, G, Qm, nb_layers, r);
+        if (nr_rate_recovery_cb(pool, pid, r, seg, rv, Qm, E, llr + off) < 0) return -1;
+        off += E;
+    }
+    h->round++;
+    return (int)off;
+}
+
+void nr_harq_cb_decoder_input(nr_harq_pool_t *pool, int pid, uint32_t r, const nr_tb_seg_t *seg, int8_t *z)
+{
+    const uint32_t d0 = 2 * seg->Zc;
+    const uint32_t Ncb = seg->Ncb;
+
+    memset(z, 0, d0);
+    if (pool->llr_bits == 8) {
+        memcpy(z + d0, nr_harq_cb_buffer8(pool, pid, r), Ncb);
+    } else {
+        const int16_t *w = nr_harq_cb_buffer16(pool, pid, r);
+        uint32_t t = 0;
+        for (; t + 16 <= Ncb; t += 16) {
+            const simde__m128i v = simde_mm_packs_epi16(simde_mm_loadu_si128((const simde__m128i *)(w + t)),
+                                                        simde_mm_loadu_si128((const simde__m128i *)(w + t + 8)));
+            simde_mm_storeu_si128((simde__m128i *)(z + d0 + t), v);
+        }
+        for (; t < Ncb; t++)
+            z[d0 + t] = (int8_t)(w[t] > 127 ? 127 : (w[t] < -128 ? -128 : w[t]));
+    }
+
+    /* Filler bits are known zeros */
+    memset(z + seg->Kprime, NR_RR_FILLER_LLR, seg->K - seg->Kprime);
+}
@@ -0,0 +1,78 @@
+#ifndef NR_RATE_RECOVERY_H
+#define NR_RATE_RECOVERY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "nr_tb_segmentation.h"
+
+/* UE side inverse of nr_rate_matching: bit de-interleaving of the E LLRs of a
+ * code block and their placement at the RV start position of the circular
+ * buffer, saturate-added into the soft buffer of a HARQ process.
+ *
+ * LLRs come in as int16 in codeword order (nr_dlsch_llr output after
+ * descrambling). Soft buffers are held as int16 or int8 in one preallocated
+ * pool: [nb_procs][max_C][cb_stride] elements, each code block covering the
+ * Ncb positions of the circular buffer. */
+
+/* LLR given to the decoder for the known filler bits (bit 0) */
+#define NR_RR_FILLER_LLR 127
+
+typedef struct nr_harq_proc_s {
+    uint8_t active;           /* soft buffers hold data of the current TB */
+    uint8_t round;            /* transmissions combined so far */
+    uint32_t C;               /* code blocks of the current TB */
+    uint32_t Ncb;             /* circular buffer size per code block */
+} nr_harq_proc_t;
+
+typedef struct nr_harq_pool_s {
+    int nb_procs;
+    int llr_bits;             /* soft buffer element size: 8 or 16 */
+    uint32_t max_C;
+    uint32_t max_E;
+    size_t cb_stride;         /* elements per code block, 64-byte aligned */
+    void *mem;                /* all soft buffers */
+    size_t mem_size;          /* bytes */
+    int16_t *e;               /* de-interleaving scratch [max_E] */
+    nr_harq_proc_t *procs;    /* [nb_procs] */
+} nr_harq_pool_t;
+
+/* Allocate (and prefault) the soft buffers of nb_procs HARQ processes for TBs
+ * of up to max_C code blocks and code blocks of up to max_E LLRs */
+nr_harq_pool_t *nr_harq_pool_init(int nb_procs, uint32_t max_C, uint32_t max_E, int llr_bits);
+void nr_harq_pool_free(nr_harq_pool_t *pool);
+
+/* New data: clear the soft buffers of process pid for a TB segmented as seg */
+int nr_harq_proc_reset(nr_harq_pool_t *pool, int pid, const nr_tb_seg_t *seg);
+
+static inline int16_t *nr_harq_cb_buffer16(nr_harq_pool_t *pool, int pid, uint32_t r)
+{
+    return (int16_t *)pool->mem + ((size_t)pid * pool->max_C + r) * pool->cb_stride;
+}
+
+static inline int8_t *nr_harq_cb_buffer8(nr_harq_pool_t *pool, int pid, uint32_t r)
+{
+    return (int8_t *)pool->mem + ((size_t)pid * pool->max_C + r) * pool->cb_stride;
+}
+
+/* De-interleave the E LLRs of code block r and combine them into the soft
+ * buffer of process pid at the start position of rv. Returns E or -1. */
+int nr_rate_recovery_cb(nr_harq_pool_t *pool, int pid, uint32_t r, const nr_tb_seg_t *seg,
+                        uint8_t rv, uint8_t Qm, uint32_t E, const int16_t *llr);
+
+/* Same on a caller-owned int16 circular buffer w of seg->Ncb entries, e being
+ * a scratch of E entries. Used by soft-buffer stores with their own layout.
+ * With LBRM, pass a copy of seg holding the limited Ncb. */
+int nr_rate_recovery_cb_into16(int16_t *w, int16_t *e, const nr_tb_seg_t *seg,
+                               uint8_t rv, uint8_t Qm, uint32_t E, const int16_t *llr);
+
+/* Same for all code blocks of a TB mapped onto G LLRs over nb_layers layers;
+ * the process must have been reset for this TB. Returns G or -1. */
+int nr_rate_recovery_tb(nr_harq_pool_t *pool, int pid, const nr_tb_seg_t *seg, uint32_t G,
+                        uint8_t Qm, uint8_t nb_layers, uint8_t rv, const int16_t *llr);
+
+/* Decoder input of code block r: 2*Zc punctured zeros, then the Ncb combined
+ * LLRs saturated to int8 with the filler positions set to NR_RR_FILLER_LLR.
+ * z must hold (2*Zc + Ncb) bytes. */
+void nr_harq_cb_decoder_input(nr_harq_pool_t *pool, int pid, uint32_t r, const nr_tb_seg_t *seg, int8_t *z);
+
+#endif
@@ -0,0 +1,194 @@
+/*
+ * PDSCH RE extraction / mapping between an FFT grid row and the compact data
+ * REs of an allocation. Runs of whole RBs are one memcpy, the two type-1 DMRS
+ * patterns (every other subcarrier) go through SSE shuffles and blends, other
+ * masks through the subcarrier list of the mask. Only the RB straddling the
+ * FFT edge goes subcarrier by subcarrier.
+ */
+
+#include "nr_re_mapping.h"
+#include <string.h>
+#include <simde/x86/sse4.1.h>
+
+uint32_t nr_re_count(const nr_re_pattern_t *p, int nb_rb)
+{
+    uint32_t n = (uint32_t)(nb_rb * __builtin_popcount(p->data_mask));
+    /* One RE less in each PTRS RB carrying data on ptrs_sc */
+    if (p->ptrs_period > 0 && p->ptrs_rb_offset < nb_rb && (p->data_mask & (1u << p->ptrs_sc)))
+        n -= (uint32_t)((nb_rb - 1 - p->ptrs_rb_offset) / p->ptrs_period + 1);
+    return n;
+}
+
+/* Subcarriers of a mask, in order. gap is the only subcarrier left out of an
+ * 11-subcarrier mask (a PTRS RB of a data symbol), -1 otherwise. */
+typedef struct {
+    int n;
+    int gap;
+    uint8_t sc[12];
+} re_list_t;
+
+static void re_list(uint16_t mask, re_list_t *l)
+{
+    l->n = 0;
+    l->gap = -1;
+    for (int k = 0; k < 12; k++)
+        if (mask & (1u << k))
+            l->sc[l->n++] = (uint8_t)k;
+        else
+            l->gap = k;
+    if (l->n != 11) l->gap = -1;
+}
+
+/* Subcarriers k0 + 2 * i of one RB (k0 = 1: mask 0xaaa, k0 = 0: 0x555) */
+static inline void re_extract_every_other(const c16_t *rb, int k0, c16_t *out)
+{
+    const float *f = (const float *)rb;
+    const simde__m128 v0 = simde_mm_loadu_ps(f);
+    const simde__m128 v1 = simde_mm_loadu_ps(f + 4);
+    const simde__m128 v2 = simde_mm_loadu_ps(f + 8);
+    if (k0) {
+        simde_mm_storeu_ps((float *)out, simde_mm_shuffle_ps(v0, v1, SIMDE_MM_SHUFFLE(3, 1, 3, 1)));
+        simde_mm_store_sd((double *)(out + 4), simde_mm_castps_pd(simde_mm_shuffle_ps(v2, v2, SIMDE_MM_SHUFFLE(3, 1, 3, 1))));
+    } else {
+        simde_mm_storeu_ps((float *)out, simde_mm_shuffle_ps(v0, v1, SIMDE_MM_SHUFFLE(2, 0, 2, 0)));
+        simde_mm_store_sd((double *)(out + 4), simde_mm_castps_pd(simde_mm_shuffle_ps(v2, v2, SIMDE_MM_SHUFFLE(2, 0, 2, 0))));
+    }
+}
+
+static inline void re_map_every_other(const c16_t *in, int k0, c16_t *rb)
+{
+    float *f = (float *)rb;
+    const float *d = (const float *)in;
+    const simde__m128 d0 = simde_mm_loadu_ps(d);
+    const simde__m128 d1 = simde_mm_castpd_ps(simde_mm_load_sd((const double *)(in + 4)));
+    /* Each data RE twice, blended over the odd (k0 = 1) or even lanes */
+    const simde__m128 lo = simde_mm_unpacklo_ps(d0, d0);
+    const simde__m128 hi = simde_mm_unpackhi_ps(d0, d0);
+    const simde__m128 tl = simde_mm_unpacklo_ps(d1, d1);
+    if (k0) {
+        simde_mm_storeu_ps(f, simde_mm_blend_ps(simde_mm_loadu_ps(f), lo, 0xa));
+        simde_mm_storeu_ps(f + 4, simde_mm_blend_ps(simde_mm_loadu_ps(f + 4), hi, 0xa));
+        simde_mm_storeu_ps(f + 8, simde_mm_blend_ps(simde_mm_loadu_ps(f + 8), tl, 0xa));
+    } else {
+        simde_mm_storeu_ps(f, simde_mm_blend_ps(simde_mm_loadu_ps(f), lo, 0x5));
+        simde_mm_storeu_ps(f + 4, simde_mm_blend_ps(simde_mm_loadu_ps(f + 4), hi, 0x5));
+        simde_mm_storeu_ps(f + 8, simde_mm_blend_ps(simde_mm_loadu_ps(f + 8), tl, 0x5));
+    }
+}
+
+/* One RB, entirely below the FFT edge, with its mask */
+static inline uint32_t re_extract_rb(const c16_t *rb, uint16_t mask, const re_list_t *l, c16_t *out)
+{
+    switch (mask) {
+        case NR_RE_MASK_ALL: memcpy(out, rb, 12 * sizeof(c16_t)); return 12;
+        case 0x0aaa: re_extract_every_other(rb, 1, out); return 6;
+        case 0x0555: re_extract_every_other(rb, 0, out); return 6;
+        default:
+            if (l->gap >= 0) {
+                memcpy(out, rb, l->gap * sizeof(c16_t));
+                memcpy(out + l->gap, rb + l->gap + 1, (11 - l->gap) * sizeof(c16_t));
+                return 11;
+            }
+            for (int i = 0; i < l->n; i++)
+                out[i] = rb[l->sc[i]];
+            return (uint32_t)l->n;
+    }
+}
+
+static inline uint32_t re_map_rb(const c16_t *in, uint16_t mask, const re_list_t *l, c16_t *rb)
+{
+    switch (mask) {
+        case NR_RE_MASK_ALL: memcpy(rb, in, 12 * sizeof(c16_t)); return 12;
+        case 0x0aaa: re_map_every_other(in, 1, rb); return 6;
+        case 0x0555: re_map_every_other(in, 0, rb); return 6;
+        default:
+            if (l->gap >= 0) {
+                memcpy(rb, in, l->gap * sizeof(c16_t));
+                memcpy(rb + l->gap + 1, in + l->gap, (11 - l->gap) * sizeof(c16_t));
+                return 11;
+            }
+            for (int i = 0; i < l->n; i++)
+                rb[l->sc[i]] = in[i];
+            return (uint32_t)l->n;
+    }
+}
+
+uint32_t nr_re_extract(const c16_t *grid, int fft_size, int start_sc, int nb_rb, const nr_re_pattern_t *p, c16_t *out)
+{
+    re_list_t data, ptrs;
+    re_list(p->data_mask, &data);
+    const uint16_t ptrs_mask = (uint16_t)(p->data_mask & ~(1u << p->ptrs_sc));
+    re_list(ptrs_mask, &ptrs);
+
+    uint32_t n = 0;
+    int bin = start_sc % fft_size;
+    int next_ptrs = p->ptrs_period > 0 ? p->ptrs_rb_offset : nb_rb;
+    for (int rb = 0; rb < nb_rb;) {
+        const int is_ptrs = rb == next_ptrs;
+        const uint16_t mask = is_ptrs ? ptrs_mask : p->data_mask;
+        if (is_ptrs) next_ptrs += p->ptrs_period;
+
+        if (bin + 12 > fft_size) {
+            /* RB across the FFT edge */
+            for (int k = 0; k < 12; k++)
+                if (mask & (1u << k)) out[n++] = grid[(bin + k) % fft_size];
+            bin = (bin + 12) % fft_size;
+            rb++;
+            continue;
+        }
+        if (mask == NR_RE_MASK_ALL) {
+            /* Run of whole RBs up to the next PTRS RB or the FFT edge */
+            int run = 1;
+            while (rb + run < nb_rb && rb + run != next_ptrs && bin + 12 * (run + 1) <= fft_size)
+                run++;
+            memcpy(out + n, grid + bin, 12 * run * sizeof(c16_t));
+            n += 12 * run;
+            bin = (bin + 12 * run) % fft_size;
+            rb += run;
+            continue;
+        }
+        n += re_extract_rb(grid + bin, mask, is_ptrs ? &ptrs : &data, out + n);
+        bin = (bin + 12) % fft_size;
+        rb++;
+    }
+    return n;
+}
+
+uint32_t nr_re_map(const c16_t *in, int fft_size, int start_sc, int nb_rb, const nr_re_pattern_t *p, c16_t *grid)
+{
+    re_list_t data, ptrs;
+    re_list(p->data_mask, &data);
+    const uint16_t ptrs_mask = (uint16_t)(p->data_mask & ~(1u << p->ptrs_sc));
+    re_list(ptrs_mask, &ptrs);
+
+    uint32_t n = 0;
+    int bin = start_sc % fft_size;
+    int next_ptrs = p->ptrs_period > 0 ? p->ptrs_rb_offset : nb_rb;
+    for (int rb = 0; rb < nb_rb;) {
+        const int is_ptrs = rb == next_ptrs;
+        const uint16_t mask = is_ptrs ? ptrs_mask : p->data_mask;
+        if (is_ptrs) next_ptrs += p->ptrs_period;
+
+        if (bin + 12 > fft_size) {
+            for (int k = 0; k < 12; k++)
+                if (mask & (1u << k)) grid[(bin + k) % fft_size] = in[n++];
+            bin = (bin + 12) % fft_size;
+            rb++;
+            continue;
+        }
+        if (mask == NR_RE_MASK_ALL) {
+            int run = 1;
+            while (rb + run < nb_rb && rb + run != next_ptrs && bin + 12 * (run + 1) <= fft_size)
+                run++;
+            memcpy(grid + bin, in + n, 12 * run * sizeof(c16_t));
+            n += 12 * run;
+            bin = (bin + 12 * run) % fft_size;
+            rb += run;
+            continue;
+        }
+        n += re_map_rb(in + n, mask, is_ptrs ? &ptrs : &data, grid + bin);
+        bin = (bin + 12) % fft_size;
+        rb++;
+    }
+    return n;
+}
@@ -0,0 +1,49 @@
+#ifndef NR_RE_MAPPING_H
+#define NR_RE_MAPPING_H
+
+#include <stdint.h>
+#include "common/platform_types.h"
+
+/* PDSCH resource element mapping between an FFT grid row and the compact
+ * buffer of the data REs of an allocation (38.211 7.3.1.5 / 7.3.1.6). The
+ * allocation starts at bin start_sc, first_carrier_offset + 12 * start_rb in
+ * OAI, and wraps at the FFT edge as do_onelayer() does with remaining_re. REs
+ * of DMRS CDM groups and PTRS are skipped, so the UE kernels after the FFT
+ * only see the data they need and the gNB writes only the data REs. */
+
+/* Data REs of the RBs of one symbol */
+typedef struct {
+    uint16_t data_mask;   /* bit k: subcarrier k of every RB carries data */
+    int ptrs_period;      /* K_PT-RS in RBs, 0 without PTRS on the symbol */
+    int ptrs_rb_offset;   /* first RB of the allocation carrying PTRS */
+    int ptrs_sc;          /* subcarrier of the PTRS within its RB */
+} nr_re_pattern_t;
+
+#define NR_RE_MASK_ALL 0x0fff
+
+/* Data subcarriers of a DMRS symbol of dmrs_type (1 or 2) when
+ * nb_cdm_groups_no_data CDM groups are left without data */
+static inline uint16_t nr_re_dmrs_data_mask(int dmrs_type, int nb_cdm_groups_no_data)
+{
+    /* Subcarriers of CDM groups 0, 1, 2 within an RB */
+    static const uint16_t type1[2] = { 0x0555, 0x0aaa };
+    static const uint16_t type2[3] = { 0x00c3, 0x030c, 0x0c30 };
+    uint16_t dmrs = 0;
+    for (int g = 0; g < nb_cdm_groups_no_data; g++)
+        dmrs |= dmrs_type == 1 ? (g < 2 ? type1[g] : 0) : (g < 3 ? type2[g] : 0);
+    return (uint16_t)(NR_RE_MASK_ALL & ~dmrs);
+}
+
+/* Data REs of nb_rb RBs under pattern p */
+uint32_t nr_re_count(const nr_re_pattern_t *p, int nb_rb);
+
+/* Copies the data REs of nb_rb RBs from bin start_sc of grid (fft_size bins)
+ * to out, in frequency order. Returns the number of REs written. */
+uint32_t nr_re_extract(const c16_t *grid, int fft_size, int start_sc, int nb_rb, const nr_re_pattern_t *p, c16_t *out);
+
+/* The reverse: writes the REs of in to the data REs of the allocation in
+ * grid, leaving the DMRS and PTRS REs untouched. Returns the number of REs
+ * read. */
+uint32_t nr_re_map(const c16_t *in, int fft_size, int start_sc, int nb_rb, const nr_re_pattern_t *p, c16_t *grid);
+
+#endif
@@ -0,0 +1,159 @@
+/*
+ * Fused scrambling + modulation mapping: XOR with the Gold sequence, symbol
+ * extraction and per-axis constellation lookup in one SSSE3 pass.
+ */
+
+#include "nr_scramble_mod.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <simde/x86/sse2.h>
+#include <simde/x86/ssse3.h>
+
+/* Axis level of the Qm / 2 axis bits in k (first bit in bit 0), 38.211 5.1.3-5.1.5 */
+static int qam_level(int m, unsigned k)
+{
+    int t = 1 - 2 * (int)((k >> (m - 1)) & 1);
+    for (int j = m - 2; j >= 0; j--)
+        t = (1 - 2 * (int)((k >> j) & 1)) * ((1 << (m - 1 - j)) - t);
+    return t;
+}
+
+static int qam_energy(uint8_t Qm)
+{
+    switch (Qm) {
+        case 2: return 2;
+        case 4: return 10;
+        case 6: return 42;
+        case 8: return 170;
+        default: return 0;
+    }
+}
+
+static inline int16_t qam_axis_value(uint8_t Qm, int16_t amp, unsigned k)
+{
+    return (int16_t)lrint(amp * qam_level(Qm / 2, k) / sqrt(qam_energy(Qm)));
+}
+
+int nr_qam_table(uint8_t Qm, int16_t amp, int16_t *table)
+{
+    if (!qam_energy(Qm)) {
+        printf("nr_qam_table: unsupported modulation order %u\n", Qm);
+        return -1;
+    }
+    for (unsigned idx = 0; idx < (1u << Qm); idx++) {
+        unsigned ke = 0, ko = 0;
+        for (int j = 0; j < Qm / 2; j++) {
+            ke |= ((idx >> (2 * j)) & 1) << j;
+            ko |= ((idx >> (2 * j + 1)) & 1) << j;
+        }
+        table[2 * idx] = qam_axis_value(Qm, amp, ke);
+        table[2 * idx + 1] = qam_axis_value(Qm, amp, ko);
+    }
+    return 0;
+}
+
+/* 16 symbols from the 16 scrambled bytes in v (2 * Qm of them used).
+ * ctl / mul: per 16-bit lane, the byte pair holding a symbol and the factor
+ * moving it to the top of the lane; axl / axh: low / high bytes of the levels. */
+static inline void scr_mod_16(simde__m128i v, simde__m128i ctl_a, simde__m128i ctl_b, simde__m128i mul,
+                              int Qm, simde__m128i axl, simde__m128i axh, simde__m128i *o)
+{
+    const simde__m128i nib = simde_mm_set1_epi8(0x0F);
+    /* Even / odd bits of a nibble, compacted, for the low and high nibble */
+    const simde__m128i ev_lo = simde_mm_setr_epi8(0, 1, 0, 1, 2, 3, 2, 3, 0, 1, 0, 1, 2, 3, 2, 3);
+    const simde__m128i od_lo = simde_mm_setr_epi8(0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 3, 3, 2, 2, 3, 3);
+    const simde__m128i ev_hi = simde_mm_slli_epi16(ev_lo, 2);
+    const simde__m128i od_hi = simde_mm_slli_epi16(od_lo, 2);
+
+    const simde__m128i ia = simde_mm_srli_epi16(simde_mm_mullo_epi16(simde_mm_shuffle_epi8(v, ctl_a), mul), 16 - Qm);
+    const simde__m128i ib = simde_mm_srli_epi16(simde_mm_mullo_epi16(simde_mm_shuffle_epi8(v, ctl_b), mul), 16 - Qm);
+    const simde__m128i sym = simde_mm_packus_epi16(ia, ib);
+
+    const simde__m128i lo = simde_mm_and_si128(sym, nib);
+    const simde__m128i hi = simde_mm_and_si128(simde_mm_srli_epi16(sym, 4), nib);
+    const simde__m128i ke = simde_mm_or_si128(simde_mm_shuffle_epi8(ev_lo, lo), simde_mm_shuffle_epi8(ev_hi, hi));
+    const simde__m128i ko = simde_mm_or_si128(simde_mm_shuffle_epi8(od_lo, lo), simde_mm_shuffle_epi8(od_hi, hi));
+
+    const simde__m128i rel = simde_mm_shuffle_epi8(axl, ke), reh = simde_mm_shuffle_epi8(axh, ke);
+    const simde__m128i iml = simde_mm_shuffle_epi8(axl, ko), imh = simde_mm_shuffle_epi8(axh, ko);
+    const simde__m128i re_a = simde_mm_unpacklo_epi8(rel, reh), re_b = simde_mm_unpackhi_epi8(rel, reh);
+    const simde__m128i im_a = simde_mm_unpacklo_epi8(iml, imh), im_b = simde_mm_unpackhi_epi8(iml, imh);
+
+    o[0] = simde_mm_unpacklo_epi16(re_a, im_a);
+    o[1] = simde_mm_unpackhi_epi16(re_a, im_a);
+    o[2] = simde_mm_unpacklo_epi16(re_b, im_b);
+    o[3] = simde_mm_unpackhi_epi16(re_b, im_b);
+}
+
+int nr_scramble_modulate(const uint32_t *in, uint32_t size, const uint32_t *c,
+                         uint8_t Qm, const int16_t *table, int16_t *out)
+{
+    if (!qam_energy(Qm)) {
+        printf("nr_scramble_modulate: unsupported modulation order %u\n", Qm);
+        return -1;
+    }
+
+    /* Every 8 symbols take Qm bytes, so one control covers any group of 8 */
+    uint8_t ctl_a[16], ctl_b[16], axl[16], axh[16];
+    int16_t mul[8];
+    for (int s = 0; s < 8; s++) {
+        const int b = (Qm * s) >> 3, sh = (Qm * s) & 7;
+        ctl_a[2 * s] = (uint8_t)b;
+        ctl_a[2 * s + 1] = sh + Qm > 8 ? (uint8_t)(b + 1) : 0x80;
+        ctl_b[2 * s] = (uint8_t)(b + Qm);
+        ctl_b[2 * s + 1] = sh + Qm > 8 ? (uint8_t)(b + 1 + Qm) : 0x80;
+        mul[s] = (int16_t)(1 << (16 - Qm - sh));
+    }
+    /* Axis level of k: real part of the point whose even bits are k, odd bits 0 */
+    for (unsigned k = 0; k < 16; k++) {
+        unsigned idx = 0;
+        for (int j = 0; j < Qm / 2; j++)
+            idx |= ((k >> j) & 1) << (2 * j);
+        const int16_t v = k < (1u << (Qm / 2)) ? table[2 * idx] : 0;
+        axl[k] = (uint8_t)(v & 0xFF);
+        axh[k] = (uint8_t)((uint16_t)v >> 8);
+    }
+    const simde__m128i vctl_a = simde_mm_loadu_si128((const simde__m128i *)ctl_a);
+    const simde__m128i vctl_b = simde_mm_loadu_si128((const simde__m128i *)ctl_b);
+    const simde__m128i vmul = simde_mm_loadu_si128((const simde__m128i *)mul);
+    const simde__m128i vaxl = simde_mm_loadu_si128((const simde__m128i *)axl);
+    const simde__m128i vaxh = simde_mm_loadu_si128((const simde__m128i *)axh);
+
+    const uint8_t *inb = (const uint8_t *)in;
+    const uint8_t *cb = (const uint8_t *)c;
+    const uint32_t nsym = size / Qm;
+    const uint32_t avail = ((size + 31) >> 5) * 4;    /* readable bytes of in and c */
+    simde__m128i *o = (simde__m128i *)out;
+    uint32_t i = 0, off = 0;
+
+    for (; i + 16 <= nsym && off + 16 <= avail; i += 16, off += 2 * Qm, o += 4) {
+        const simde__m128i v = simde_mm_xor_si128(simde_mm_loadu_si128((const simde__m128i *)(inb + off)),
+                                                  simde_mm_loadu_si128((const simde__m128i *)(cb + off)));
+        scr_mod_16(v, vctl_a, vctl_b, vmul, Qm, vaxl, vaxh, o);
+    }
+
+    /* The last symbols go through a zero-padded copy */
+    while (i < nsym) {
+        uint8_t tmp[16] = {0};
+        simde__m128i t[4];
+        const uint32_t nb = avail - off < 16 ? avail - off : 16;
+        for (uint32_t b = 0; b < nb; b++)
+            tmp[b] = inb[off + b] ^ cb[off + b];
+        scr_mod_16(simde_mm_loadu_si128((const simde__m128i *)tmp), vctl_a, vctl_b, vmul, Qm, vaxl, vaxh, t);
+        const uint32_t n = nsym - i < 16 ? nsym - i : 16;
+        memcpy(out + 2 * i, t, n * 2 * sizeof(int16_t));
+        i += n;
+        off += 2 * Qm;
+    }
+    return (int)nsym;
+}
+
+int nr_scramble_modulate_cached(nr_gold_cache_t *cache, const uint32_t *in, uint32_t size,
+                                uint8_t q, uint32_t Nid, uint32_t n_RNTI,
+                                uint8_t Qm, const int16_t *table, int16_t *out)
+{
+    const uint32_t *c = nr_gold_cache_get(cache, nr_gold_pdsch_cinit(n_RNTI, q, Nid), size);
+    if (!c) return -1;
+    return nr_scramble_modulate(in, size, c, Qm, table, out);
+}
@@ -0,0 +1,42 @@
+#ifndef NR_SCRAMBLE_MOD_H
+#define NR_SCRAMBLE_MOD_H
+
+#include <stdint.h>
+#include "nr_gold.h"
+
+/* Fused PDSCH scrambling and modulation mapping (38.211 7.3.1.1, 5.1).
+ *
+ * The rate-matched codeword is read as LSB-first packed words (the layout of
+ * nr_rate_matching_tb() output), XORed with the Gold sequence and mapped to
+ * interleaved re/im int16 symbols without writing the scrambled bits back to
+ * memory. Symbol i takes bits Qm*i .. Qm*i + Qm - 1, the first one being b(0)
+ * of 38.211 5.1, as nr_modulation() does.
+ *
+ * The NR constellations are Gray mapped per axis: the real part depends on the
+ * even bits of a symbol and the imaginary part on the odd bits, through the
+ * same level table. The kernel therefore only looks up 16-entry tables, read
+ * from the constellation the caller passes, so that its output is the one of
+ * the modulation tables in use (nr_qam_table(), or OAI nr_modulation()). */
+
+/* Amplitude of a unit-energy symbol: the largest 256-QAM component stays below 2^15 */
+#define NR_QAM_AMP 23170
+
+/* Full constellation of 2^Qm points, table[2 * idx] / table[2 * idx + 1] being
+ * the re / im parts of the symbol with bits idx (b(0) in bit 0), each component
+ * amp * level / sqrt(E) rounded. Returns -1 for Qm other than 2, 4, 6, 8. */
+int nr_qam_table(uint8_t Qm, int16_t amp, int16_t *table);
+
+/* out[2 * i], out[2 * i + 1] = symbol i of (in ^ c), size / Qm symbols, table
+ * being a constellation of 2^Qm points laid out as by nr_qam_table(). Returns
+ * the number of symbols, -1 for an unsupported Qm. */
+int nr_scramble_modulate(const uint32_t *in, uint32_t size, const uint32_t *c,
+                         uint8_t Qm, const int16_t *table, int16_t *out);
+
+/* nr_codeword_scrambling() followed by nr_modulation() on a cached Gold
+ * sequence. Returns the number of symbols, -1 when size exceeds the cache or
+ * Qm is unsupported. */
+int nr_scramble_modulate_cached(nr_gold_cache_t *cache, const uint32_t *in, uint32_t size,
+                                uint8_t q, uint32_t Nid, uint32_t n_RNTI,
+                                uint8_t Qm, const int16_t *table, int16_t *out);
+
+#endif
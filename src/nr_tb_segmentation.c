@@ -0,0 +1,269 @@
+/*
+ * Transport block level encoding: TB CRC attachment (38.212 5.1), code block
+ * segmentation with filler bits and CRC24B (38.212 5.2.2) and LDPC encoding of
+ * the code blocks spread over a worker pool.
+ */
+
+#include "nr_tb_segmentation.h"
+#include "nr_crc_fold.h"
+#include "PHY/CODING/coding_defs.h"
+#include "PHY/CODING/nrLDPC_extern.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* 38.212 Table 5.3.2-1, all lifting sizes in ascending order */
+static const uint16_t lifting_sizes[] = {
+      2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,  15,  16,  18,
+     20,  22,  24,  26,  28,  30,  32,  36,  40,  44,  48,  52,  56,  60,  64,  72,
+     80,  88,  96, 104, 112, 120, 128, 144, 160, 176, 192, 208, 224, 240, 256, 288,
+    320, 352, 384
+};
+
+/* 38.214 Table 5.1.3.2-1, TBS for N_info <= 3824 */
+static const uint16_t tbs_table[] = {
+      24,   32,   40,   48,   56,   64,   72,   80,   88,   96,  104,  112,  120,  128,  136,  144,
+     152,  160,  168,  176,  184,  192,  208,  224,  240,  256,  272,  288,  304,  320,  336,  352,
+     368,  384,  408,  432,  456,  480,  504,  528,  552,  576,  608,  640,  672,  704,  736,  768,
+     808,  848,  888,  928,  984, 1032, 1064, 1128, 1160, 1192, 1224, 1256, 1288, 1320, 1352, 1416,
+    1480, 1544, 1608, 1672, 1736, 1800, 1864, 1928, 2024, 2088, 2152, 2216, 2280, 2408, 2472, 2536,
+    2600, 2664, 2728, 2792, 2856, 2976, 3104, 3240, 3368, 3496, 3624, 3752, 3824
+};
+
+static inline size_t align64(size_t n)
+{
+    return (n + 63) & ~(size_t)63;
+}
+
+uint32_t nr_tbs_compute(uint32_t nb_re, uint16_t R, uint8_t Qm, uint8_t nb_layers)
+{
+    const double Ninfo = (double)nb_re * R / 1024.0 * Qm * nb_layers;
+    if (Ninfo < 1.0) return 0;
+
+    if (Ninfo <= 3824) {
+        int n = (int)floor(log2(Ninfo)) - 6;
+        if (n < 3) n = 3;
+        uint32_t Np = (1u << n) * (uint32_t)floor(Ninfo / (1u << n));
+        if (Np < 24) Np = 24;
+        for (size_t i = 0; i < sizeof(tbs_table) / sizeof(tbs_table[0]); i++)
+            if (tbs_table[i] >= Np) return tbs_table[i];
+        return 3824;
+    }
+
+    const int n = (int)floor(log2(Ninfo - 24)) - 5;
+    double Np = ldexp(round((Ninfo - 24) / ldexp(1.0, n)), n);
+    if (Np < 3840) Np = 3840;
+
+    uint32_t C = 1;
+    if (R <= 256)
+        C = (uint32_t)ceil((Np + 24) / 3816);
+    else if (Np > 8424)
+        C = (uint32_t)ceil((Np + 24) / 8424);
+    return 8 * C * (uint32_t)ceil((Np + 24) / (8 * C)) - 24;
+}
+
+int nr_tb_segmentation_params(uint32_t A, uint16_t R, nr_tb_seg_t *seg)
+{
+    if (!seg || A == 0) return -1;
+    memset(seg, 0, sizeof(*seg));
+
+    /* Base graph selection, 38.212 7.2.2 (R in 1/1024 units: 0.67 -> 686, 0.25 -> 256) */
+    seg->BG = (A <= 292 || (A <= 3824 && R <= 686) || R <= 256) ? 2 : 1;
+
+    seg->A = A;
+    seg->L_tb = (A > 3824) ? 24 : 16;
+    seg->B = A + seg->L_tb;
+
+    const uint32_t Kcb = (seg->BG == 1) ? NR_LDPC_KCB_BG1 : NR_LDPC_KCB_BG2;
+    uint32_t Bprime;
+    if (seg->B <= Kcb) {
+        seg->L_cb = 0;
+        seg->C = 1;
+        Bprime = seg->B;
+    } else {
+        seg->L_cb = 24;
+        seg->C = (seg->B + (Kcb - 24) - 1) / (Kcb - 24);
+        Bprime = seg->B + seg->C * seg->L_cb;
+    }
+
+    if (Bprime % seg->C) {
+        printf("nr_tb_segmentation_params: A=%u does not split into %u equal code blocks\n", A, seg->C);
+        return -1;
+    }
+    seg->Kprime = Bprime / seg->C;
+
+    if (seg->BG == 1)
+        seg->Kb = 22;
+    else if (seg->B > 640)
+        seg->Kb = 10;
+    else if (seg->B > 560)
+        seg->Kb = 9;
+    else if (seg->B > 192)
+        seg->Kb = 8;
+    else
+        seg->Kb = 6;
+
+    seg->Zc = 0;
+    for (size_t i = 0; i < sizeof(lifting_sizes) / sizeof(lifting_sizes[0]); i++) {
+        if ((uint32_t)seg->Kb * lifting_sizes[i] >= seg->Kprime) {
+            seg->Zc = lifting_sizes[i];
+            break;
+        }
+    }
+    if (!seg->Zc) return -1;
+
+    seg->K = (seg->BG == 1 ? 22 : 10) * seg->Zc;
+    seg->F = seg->K - seg->Kprime;
+    seg->Ncb = (seg->BG == 1 ? 66 : 50) * seg->Zc;
+    return 0;
+}
+
+/* Copy nbits starting at bit src_off of src into dst starting at bit 0.
+ * src must be readable one byte past the last copied bit. */
+void nr_bits_copy(uint8_t *dst, const uint8_t *src, uint32_t src_off, uint32_t nbits)
+{
+    const uint8_t *s = src + (src_off >> 3);
+    const int sh = src_off & 7;
+    const uint32_t nbytes = (nbits + 7) >> 3;
+
+    if (!nbits) return;
+
+    if (sh == 0) {
+        memcpy(dst, s, nbytes);
+    } else {
+        for (uint32_t i = 0; i < nbytes; i++)
+            dst[i] = (uint8_t)((s[i] << sh) | (s[i + 1] >> (8 - sh)));
+    }
+
+    if (nbits & 7)
+        dst[nbytes - 1] &= (uint8_t)(0xFF << (8 - (nbits & 7)));
+}
+
+/* Write the nbits low bits of val at bit position pos, MSB first */
+void nr_bits_put(uint8_t *dst, uint32_t pos, uint32_t val, int nbits)
+{
+    for (int b = nbits - 1; b >= 0; b--, pos++) {
+        const uint8_t m = (uint8_t)(0x80 >> (pos & 7));
+        if ((val >> b) & 1)
+            dst[pos >> 3] |= m;
+        else
+            dst[pos >> 3] &= (uint8_t)~m;
+    }
+}
+
+nr_tb_encoder_t *nr_tb_encoder_init(uint32_t max_A, int nb_threads)
+{
+    nr_tb_encoder_t *enc = calloc(1, sizeof(*enc));
+    if (!enc) return NULL;
+
+    enc->max_A = max_A;
+    /* Worst case is BG2 (low code rate) with 3816 payload bits per block */
+    enc->max_C = (max_A + 24 + (NR_LDPC_KCB_BG2 - 24) - 1) / (NR_LDPC_KCB_BG2 - 24);
+    enc->cb_in_stride = align64(NR_LDPC_KCB_BG1 / 8 + 1);
+    enc->cb_out_stride = align64(68 * 384 / 8);
+
+    /* One spare byte for the read-ahead of nr_bits_copy */
+    enc->tb = aligned_alloc(64, align64((max_A + 24) / 8 + 1));
+    enc->cb_in = aligned_alloc(64, enc->max_C * enc->cb_in_stride);
+    /* Spare line at the end for the 8-byte reads of the rate matcher */
+    enc->cb_out = aligned_alloc(64, enc->max_C * enc->cb_out_stride + 64);
+    enc->pool = worker_pool_init(nb_threads);
+
+    if (!enc->tb || !enc->cb_in || !enc->cb_out || !enc->pool) {
+        nr_tb_encoder_free(enc);
+        return NULL;
+    }
+
+    memset(enc->tb, 0, align64((max_A + 24) / 8 + 1));
+    memset(enc->cb_in, 0, enc->max_C * enc->cb_in_stride);
+    memset(enc->cb_out, 0, enc->max_C * enc->cb_out_stride + 64);
+
+    return enc;
+}
+
+/* Worker task: payload and filler of code blocks [g * lanes, (g + 1) * lanes),
+ * then their CRC24B computed in interleaved lanes */
+static void tb_build_cbs(void *arg, int g)
+{
+    nr_tb_encoder_t *enc = arg;
+    const nr_tb_seg_t *seg = &enc->seg;
+    const uint32_t payload = seg->Kprime - seg->L_cb;
+    const uint32_t r0 = (uint32_t)g * NR_CRC_MAX_LANES;
+    const int nb = (int)((seg->C - r0) < NR_CRC_MAX_LANES ? seg->C - r0 : NR_CRC_MAX_LANES);
+    uint8_t *cbs[NR_CRC_MAX_LANES];
+
+    for (int l = 0; l < nb; l++) {
+        cbs[l] = enc->cb_in + (size_t)(r0 + l) * enc->cb_in_stride;
+        /* Filler bits are encoded as zeros (38.212 5.2.2) */
+        memset(cbs[l], 0, (seg->K + 7) >> 3);
+        nr_bits_copy(cbs[l], enc->tb, (r0 + l) * payload, payload);
+    }
+    if (seg->L_cb)
+        nr_crc_fold_attach_multi(NR_CRC_24B, cbs, nb, payload);
+}
+
+/* Worker task: LDPC-encode code block r */
+static void tb_encode_cb(void *arg, int r)
+{
+    nr_tb_encoder_t *enc = arg;
+    const nr_tb_seg_t *seg = &enc->seg;
+    uint8_t *cb = enc->cb_in + (size_t)r * enc->cb_in_stride;
+
+    encoder_implemparams_t impp = {
+        .n_segments = 1,
+        .first_seg = 0,
+        .gen_code = 0,
+        .tinput = NULL,
+        .tprep = NULL,
+        .tparity = NULL,
+        .toutput = NULL,
+        .K = seg->K,
+        .Kb = (seg->BG == 1) ? 22 : 10,
+        .Zc = seg->Zc,
+        .F = seg->F,
+        .BG = seg->BG,
+        .output = NULL,
+        .ans = NULL
+    };
+
+    uint8_t *in[1] = { cb };
+    if (LDPCencoder(in, nr_tb_encoder_cb_output(enc, r), &impp) != 0)
+        __atomic_add_fetch(&enc->enc_errors, 1, __ATOMIC_RELAXED);
+}
+
+int nr_tb_encoder_encode(nr_tb_encoder_t *enc, const uint8_t *tb, uint32_t A, uint16_t R)
+{
+    if (!enc || !tb || A == 0 || (A & 7) || A > enc->max_A) return -1;
+    if (nr_tb_segmentation_params(A, R, &enc->seg) != 0) return -1;
+    if (enc->seg.C > enc->max_C) return -1;
+
+    /* TB CRC attachment: CRC24A above 3824 bits, CRC16 otherwise (38.212 7.2.1) */
+    memcpy(enc->tb, tb, A >> 3);
+    if (enc->seg.L_tb == 24) {
+        const uint32_t crc = nr_crc_fold(NR_CRC_24A, enc->tb, A);
+        enc->tb[(A >> 3) + 0] = (uint8_t)(crc >> 24);
+        enc->tb[(A >> 3) + 1] = (uint8_t)(crc >> 16);
+        enc->tb[(A >> 3) + 2] = (uint8_t)(crc >> 8);
+    } else {
+        const uint32_t crc = nr_crc_fold(NR_CRC_16, enc->tb, A);
+        enc->tb[(A >> 3) + 0] = (uint8_t)(crc >> 24);
+        enc->tb[(A >> 3) + 1] = (uint8_t)(crc >> 16);
+    }
+
+    enc->enc_errors = 0;
+    worker_pool_run(enc->pool, tb_build_cbs, enc, (int)((enc->seg.C + NR_CRC_MAX_LANES - 1) / NR_CRC_MAX_LANES));
+    worker_pool_run(enc->pool, tb_encode_cb, enc, (int)enc->seg.C);
+
+    return enc->enc_errors ? -1 : (int)enc->seg.C;
+}
+
+void nr_tb_encoder_free(nr_tb_encoder_t *enc)
+{
+    if (!enc) return;
+    worker_pool_free(enc->pool);
+    free(enc->tb);
+    free(enc->cb_in);
+    free(enc->cb_out);
+    free(enc);
+}
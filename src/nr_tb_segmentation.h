@@ -0,0 +1,74 @@
+#ifndef NR_TB_SEGMENTATION_H
+#define NR_TB_SEGMENTATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "nr_worker_pool.h"
+
+/* Transport block CRC attachment, code block segmentation (38.212 5.1, 5.2.2)
+ * and LDPC encoding of every code block of one TB.
+ *
+ * Bit order: TB and code blocks are packed MSB-first (bit n is bit 7-(n&7) of
+ * byte n>>3), which is what crc24a/crc24b and LDPCencoder consume. */
+
+#define NR_LDPC_KCB_BG1 8448
+#define NR_LDPC_KCB_BG2 3840
+
+/* Segmentation of one TB, all sizes in bits */
+typedef struct nr_tb_seg_s {
+    uint32_t A;         /* TB payload */
+    uint32_t L_tb;      /* TB CRC length: 24 (CRC24A) or 16 (CRC16) */
+    uint32_t B;         /* A + L_tb */
+    uint32_t L_cb;      /* CB CRC length: 24 (CRC24B) when C > 1, else 0 */
+    uint32_t C;         /* number of code blocks */
+    uint32_t Kprime;    /* bits per CB before filler: payload + CB CRC */
+    uint32_t K;         /* bits per CB after filler: Kb_sys * Zc */
+    uint32_t F;         /* filler bits per CB: K - Kprime */
+    uint32_t Zc;        /* lifting size */
+    uint32_t Ncb;       /* circular buffer N: coded bits per CB after puncturing 2*Zc, 66*Zc / 50*Zc */
+    uint8_t BG;         /* LDPC base graph (1 or 2) */
+    uint8_t Kb;         /* information columns used to pick Zc */
+} nr_tb_seg_t;
+
+/* 38.214 5.1.3.2 TBS from the number of REs, code rate R/1024, Qm and layers */
+uint32_t nr_tbs_compute(uint32_t nb_re, uint16_t R, uint8_t Qm, uint8_t nb_layers);
+
+/* Fill seg for a TB of A bits at code rate R/1024. Returns 0 or -1 when A does
+ * not split into equal code blocks (i.e. is not a 38.214 TBS). */
+int nr_tb_segmentation_params(uint32_t A, uint16_t R, nr_tb_seg_t *seg);
+
+/* MSB-first bit helpers shared by the TB/CB stages */
+void nr_bits_copy(uint8_t *dst, const uint8_t *src, uint32_t src_off, uint32_t nbits);
+void nr_bits_put(uint8_t *dst, uint32_t pos, uint32_t val, int nbits);
+
+/* Reusable TB encoder: staging buffers sized for max_A and a worker pool that
+ * encodes code blocks concurrently */
+typedef struct nr_tb_encoder_s {
+    uint32_t max_A;
+    uint32_t max_C;
+    worker_pool_t *pool;
+    uint8_t *tb;              /* TB + TB CRC, MSB-first */
+    uint8_t *cb_in;           /* [max_C][cb_in_stride] CB payload + CRC24B + filler */
+    uint8_t *cb_out;          /* [max_C][cb_out_stride] encoder output */
+    size_t cb_in_stride;
+    size_t cb_out_stride;
+    nr_tb_seg_t seg;          /* segmentation of the last encoded TB */
+    int enc_errors;
+} nr_tb_encoder_t;
+
+nr_tb_encoder_t *nr_tb_encoder_init(uint32_t max_A, int nb_threads);
+
+/* Attach the TB CRC, segment and LDPC-encode every code block of tb (A bits,
+ * A multiple of 8). Returns the number of code blocks or -1 on error. */
+int nr_tb_encoder_encode(nr_tb_encoder_t *enc, const uint8_t *tb, uint32_t A, uint16_t R);
+
+/* Encoder output of code block r of the last TB: 68*Zc (BG1) / 52*Zc (BG2)
+ * bits, the first 2*Zc systematic bits being punctured by rate matching */
+static inline uint8_t *nr_tb_encoder_cb_output(nr_tb_encoder_t *enc, uint32_t r)
+{
+    return enc->cb_out + (size_t)r * enc->cb_out_stride;
+}
+
+void nr_tb_encoder_free(nr_tb_encoder_t *enc);
+
+#endif
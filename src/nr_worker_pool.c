@@ -0,0 +1,142 @@
+#include "nr_worker_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+struct worker_pool_s {
+    int nb_threads;           /* worker threads + calling thread */
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t start_cv;  /* signalled when a new job is published */
+    pthread_cond_t done_cv;   /* signalled when the last worker leaves a job */
+    uint64_t generation;      /* job counter, bumped once per worker_pool_run */
+    int active;               /* workers still inside the current job */
+    int shutdown;
+    worker_task_fn fn;
+    void *arg;
+    int nb_tasks;
+    atomic_int next_task;     /* shared task cursor, tasks are claimed one by one */
+};
+
+/* Claim tasks until the cursor runs past the end of the job */
+static void pool_drain(worker_pool_t *p, worker_task_fn fn, void *arg, int nb_tasks)
+{
+    for (;;) {
+        int t = atomic_fetch_add_explicit(&p->next_task, 1, memory_order_relaxed);
+        if (t >= nb_tasks) break;
+        fn(arg, t);
+    }
+}
+
+static void *pool_worker(void *ptr)
+{
+    worker_pool_t *p = ptr;
+    uint64_t seen = 0;
+
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        while (!p->shutdown && p->generation == seen)
+            pthread_cond_wait(&p->start_cv, &p->lock);
+        if (p->shutdown) break;
+
+        seen = p->generation;
+        worker_task_fn fn = p->fn;
+        void *arg = p->arg;
+        int nb_tasks = p->nb_tasks;
+        pthread_mutex_unlock(&p->lock);
+
+        pool_drain(p, fn, arg, nb_tasks);
+
+        pthread_mutex_lock(&p->lock);
+        if (--p->active == 0)
+            pthread_cond_signal(&p->done_cv);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+worker_pool_t *worker_pool_init(int nb_threads)
+{
+    if (nb_threads < 1) nb_threads = 1;
+
+    worker_pool_t *p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+
+    p->nb_threads = nb_threads;
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->start_cv, NULL);
+    pthread_cond_init(&p->done_cv, NULL);
+    atomic_init(&p->next_task, 0);
+
+    if (nb_threads == 1) return p;
+
+    p->threads = calloc(nb_threads - 1, sizeof(pthread_t));
+    if (!p->threads) {
+        free(p);
+        return NULL;
+    }
+
+    for (int i = 0; i < nb_threads - 1; i++) {
+        if (pthread_create(&p->threads[i], NULL, pool_worker, p) != 0) {
+            printf("worker_pool_init: pthread_create failed, keeping %d threads\n", i + 1);
+            p->nb_threads = i + 1;
+            break;
+        }
+    }
+
+    return p;
+}
+
+void worker_pool_run(worker_pool_t *p, worker_task_fn fn, void *arg, int nb_tasks)
+{
+    if (nb_tasks <= 0) return;
+
+    /* Nothing to share: run inline and skip the wake-up cost */
+    if (!p || p->nb_threads == 1 || nb_tasks == 1) {
+        for (int t = 0; t < nb_tasks; t++) fn(arg, t);
+        return;
+    }
+
+    pthread_mutex_lock(&p->lock);
+    p->fn = fn;
+    p->arg = arg;
+    p->nb_tasks = nb_tasks;
+    atomic_store_explicit(&p->next_task, 0, memory_order_relaxed);
+    p->active = p->nb_threads - 1;
+    p->generation++;
+    pthread_cond_broadcast(&p->start_cv);
+    pthread_mutex_unlock(&p->lock);
+
+    pool_drain(p, fn, arg, nb_tasks);
+
+    pthread_mutex_lock(&p->lock);
+    while (p->active > 0)
+        pthread_cond_wait(&p->done_cv, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+}
+
+int worker_pool_size(const worker_pool_t *p)
+{
+    return p ? p->nb_threads : 1;
+}
+
+void worker_pool_free(worker_pool_t *p)
+{
+    if (!p) return;
+
+    pthread_mutex_lock(&p->lock);
+    p->shutdown = 1;
+    pthread_cond_broadcast(&p->start_cv);
+    pthread_mutex_unlock(&p->lock);
+
+    for (int i = 0; i < p->nb_threads - 1; i++)
+        pthread_join(p->threads[i], NULL);
+
+    pthread_cond_destroy(&p->start_cv);
+    pthread_cond_destroy(&p->done_cv);
+    pthread_mutex_destroy(&p->lock);
+    free(p->threads);
+    free(p);
+}
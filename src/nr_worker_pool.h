@@ -0,0 +1,23 @@
+#ifndef NR_WORKER_POOL_H
+#define NR_WORKER_POOL_H
+
+/* Small persistent pthread pool used by the kernels that split work over cores
+ * (code blocks of a TB, antennas of a slot, ...). Threads are created once and
+ * parked on a condition variable between jobs, so a job costs one wake-up and
+ * not a pthread_create per call. The calling thread takes part in every job. */
+
+typedef void (*worker_task_fn)(void *arg, int task);
+
+typedef struct worker_pool_s worker_pool_t;
+
+/* nb_threads counts the caller: nb_threads=1 runs every job inline */
+worker_pool_t *worker_pool_init(int nb_threads);
+
+/* Run fn(arg, task) for task = 0..nb_tasks-1 and return once all are done */
+void worker_pool_run(worker_pool_t *p, worker_task_fn fn, void *arg, int nb_tasks);
+
+int worker_pool_size(const worker_pool_t *p);
+
+void worker_pool_free(worker_pool_t *p);
+
+#endif
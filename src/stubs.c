@@ -11,6 +11,12 @@
 #include <simde/x86/sse2.h>
 #include <simde/x86/avx2.h>
 #include "PHY/CODING/nrLDPC_decoder/nrLDPC_types.h"
+#include "nr_crc_fold.h"
+#include "nr_layer_demap.h"
+#include "nr_llr.h"
+#include "nr_mmse_llr.h"
+#include "nr_dft_plan.h"
+#include "nr_arena.h"
 
 /* QAM amplitude definitions from OAI */
 #define QAM16_n1 20724
@@ -507,6 +513,8 @@ void nr_dlsch_unscrambling(int16_t *llr, uint32_t size, uint8_t q, uint32_t Nid,
  * ============================================================
  * Stub for layer demapping - converts spatial layers to codewords.
  * Real implementation is in openair1/PHY/NR_UE_TRANSPORT/nr_dlsch_demodulation.c
+ * The interleaving goes through the (Nl, mod_order) kernels of nr_layer_demap;
+ * 5 to 8 layers fill both codewords.
  */
 void nr_dlsch_layer_demapping(int16_t *llr_cw[2],
                               uint8_t Nl,
@@ -517,32 +525,32 @@ void nr_dlsch_layer_demapping(int16_t *llr_cw[2],
                               uint32_t sz,
                               int16_t llr_layers[][sz])
 {
-    /* Implement layer demapping based on number of layers */
     switch (Nl) {
         case 1:
-            /* Single layer: direct copy to active codeword */
+        case 2:
+        case 3:
+        case 4: {
+            /* One codeword: only the active one is demapped */
+            int16_t *cw;
             if (codeword_TB1 == -1)
-                memcpy(llr_cw[0], llr_layers[0], length * sizeof(int16_t));
+                cw = llr_cw[0];
             else if (codeword_TB0 == -1)
-                memcpy(llr_cw[1], llr_layers[0], length * sizeof(int16_t));
+                cw = llr_cw[1];
+            else
+                break;
+            if (Nl == 1)
+                memcpy(cw, llr_layers[0], length * sizeof(int16_t));
+            else
+                nr_layer_demap(llr_layers[0], sz, Nl, mod_order, length, cw);
             break;
-            
-        case 2:
-        case 3:
-        case 4:
-            /* Multiple layers: interleave layers into codeword(s) */
-            for (uint32_t i = 0; i < (length / Nl / mod_order); i++) {
-                for (uint8_t l = 0; l < Nl; l++) {
-                    for (uint8_t m = 0; m < mod_order; m++) {
-                        if (codeword_TB1 == -1)
-                            llr_cw[0][Nl * mod_order * i + l * mod_order + m] = 
-                                llr_layers[l][i * mod_order + m];
-                        else if (codeword_TB0 == -1)
-                            llr_cw[1][Nl * mod_order * i + l * mod_order + m] = 
-                                llr_layers[l][i * mod_order + m];
-                    }
-                }
-            }
+        }
+
+        case 5:
+        case 6:
+        case 7:
+        case 8:
+            /* Two codewords split over the layers per 38.211 Table 7.3.1.3-1 */
+            nr_layer_demap_cw(llr_layers[0], sz, Nl, mod_order, length, llr_cw);
             break;
             
         default:
@@ -560,60 +568,6 @@ void nr_dlsch_layer_demapping(int16_t *llr_cw[2],
  * frequency-domain using FFT operations.
  */
 
-/* Load DFT symbol from libdfts.so once and reuse */
-/* Minimal DFT bindings mirroring OAI dfts library */
-typedef void (*dftfunc_t)(uint8_t sizeidx, int16_t *sigF, int16_t *sig, unsigned char scale_flag);
-
-static void *dfts_handle = NULL;
-static dftfunc_t dft_sym = NULL;
-
-static inline uint8_t get_dft_idx(int size)
-{
-  switch (size) {
-    case 128:  return 10;  /* DFT_128  */
-    case 256:  return 16;  /* DFT_256  */
-    case 512:  return 24;  /* DFT_512  */
-    case 768:  return 30;  /* DFT_768  */
-    case 1024: return 35;  /* DFT_1024 */
-    case 1536: return 42;  /* DFT_1536 */
-    case 2048: return 48;  /* DFT_2048 */
-    case 3072: return 57;  /* DFT_3072 */
-    case 4096: return 59;  /* DFT_4096 */
-    case 6144: return 60;  /* DFT_6144 */
-    case 8192: return 61;  /* DFT_8192 */
-    default:   return 0xFF;
-  }
-}
-
-static int ensure_dft_loaded(void)
-{
-  if (dft_sym) return 0;
-
-  const char *path = getenv("OAI_DFTS_LIB");
-  if (!path || !*path)
-    path = "/home/anderson/dev/oai_isolation/ext/openair/cmake_targets/ran_build/build/libdfts.so";
-
-  dfts_handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
-  if (!dfts_handle) {
-    /* Fallback to system-installed location inside container */
-    path = "/usr/lib/libdfts.so";
-    dfts_handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
-  }
-
-  if (!dfts_handle) {
-    printf("nr_slot_fep: dlopen fallback failed (%s)\n", dlerror());
-    return -1;
-  }
-
-  dft_sym = (dftfunc_t)dlsym(dfts_handle, "dft_implementation");
-  if (!dft_sym) {
-  printf("nr_slot_fep: dlsym(dft_implementation) failed: %s\n", dlerror());
-  return -1;
-  }
-
-  return 0;
-}
-
 int nr_slot_fep(void *ue,
         const void *frame_parms,
         unsigned int slot,
@@ -639,9 +593,12 @@ int nr_slot_fep(void *ue,
     int ofdm_offset_divisor;
   } *fp = (struct {int ofdm_symbol_size; int samples_per_slot_wCP; int nb_prefix_samples; int nb_prefix_samples0; int nb_antennas_rx; int symbols_per_slot; int slots_per_frame; int ofdm_offset_divisor;} *)frame_parms;
 
-  if (ensure_dft_loaded() != 0) return -1;
-
   const int fft_size = fp->ofdm_symbol_size;
+  const nr_dft_plan_t *plan = nr_dft_plan_get(fft_size, 1);
+  if (!plan) {
+    printf("nr_slot_fep: no DFT plan for FFT size %d\n", fft_size);
+    return -1;
+  }
   const int cp = fp->nb_prefix_samples ? fp->nb_prefix_samples : (fp->samples_per_slot_wCP / fp->symbols_per_slot - fft_size);
   const int cp0 = fp->nb_prefix_samples0 ? fp->nb_prefix_samples0 : cp;
   const int symbols_per_slot = fp->symbols_per_slot ? fp->symbols_per_slot : 14;
@@ -660,13 +617,7 @@ int nr_slot_fep(void *ue,
   int16_t *td = (int16_t *)(((int32_t *)rxdata) + symbol_offset);
   int16_t *fd = (int16_t *)(((int32_t *)rxdataF) + symbol * fft_size);
 
-  uint8_t size_idx = get_dft_idx(fft_size);
-  if (size_idx == 0xFF) {
-    printf("nr_slot_fep: unsupported FFT size %d\n", fft_size);
-    return -1;
-  }
-
-  dft_sym(size_idx, td, fd, 1);
+  nr_dft_plan_dft(plan, td, fd);
   return 0;
 }
 
@@ -692,23 +643,26 @@ void nr_pdsch_channel_estimation(void *ue_ptr,
         return;
     }
     
+    /* nb_re: REs per antenna in rxdataF and dl_ch, the allocated REs pulled
+     * out of the grid, not the FFT size */
     struct {
         int ofdm_symbol_size;
         int N_RB_DL;
         int nb_antennas_rx;
-    } *fp = (struct {int ofdm_symbol_size; int N_RB_DL; int nb_antennas_rx;} *)frame_parms_ptr;
+        int nb_re;
+    } *fp = (struct {int ofdm_symbol_size; int N_RB_DL; int nb_antennas_rx; int nb_re;} *)frame_parms_ptr;
     
     int32_t *rxdataF = (int32_t *)rxdataF_ptr;
-    int fft_size = fp->ofdm_symbol_size;
+    const int nb_re = fp->nb_re;
     
     uint32_t ch_seed = (gNB_id * 256 + symbol) * 0x87654321;
     uint32_t pilot_error_sum = 0;
     
     for (int ant = 0; ant < nb_antennas_rx; ant++) {
-        for (int k = 0; k < fft_size; k++) {
+        for (int k = 0; k < nb_re; k++) {
             int32_t rxF_sample = 0;
             if (rxdataF) {
-                int idx = ant * fft_size + k;
+                int idx = ant * nb_re + k;
                 rxF_sample = rxdataF[idx];
             }
             
@@ -722,7 +676,7 @@ void nr_pdsch_channel_estimation(void *ue_ptr,
             ch_est ^= (ch_factor << 8);
             
             int32_t *dl_ch_ptr = (int32_t *)dl_ch;
-            int ch_idx = ant * fft_size + k;
+            int ch_idx = ant * nb_re + k;
             dl_ch_ptr[ch_idx] = ch_est;
             
             pilot_error_sum += (ch_est ^ rxF_sample) & 0xFFFF;
@@ -767,8 +721,11 @@ static void nr_determin(int size,
     nr_element_sign(a44[0][0], ad_bc, nb_rb, sign);
   } else {
     int16_t k, rr[size - 1], cc[size - 1];
-    c16_t outtemp[12 * nb_rb] __attribute__((aligned(32)));
-    c16_t outtemp1[12 * nb_rb] __attribute__((aligned(32)));
+    /* Per-level products from the thread arena, back to it on return */
+    nr_scratch_t scratch;
+    nr_scratch_begin(&scratch);
+    c16_t *outtemp = nr_scratch_alloc(&scratch, 12 * nb_rb * sizeof(c16_t));
+    c16_t *outtemp1 = nr_scratch_alloc(&scratch, 12 * nb_rb * sizeof(c16_t));
     c16_t *sub_matrix[size - 1][size - 1];
     for (int rtx=0;rtx<size;rtx++) {
       int ctx=0;
@@ -789,11 +746,12 @@ static void nr_determin(int size,
                   nb_rb,
                   ((rtx & 1) == 1 ? -1 : 1) * ((ctx & 1) == 1 ? -1 : 1) * sign,
                   shift0);
-      mult_complex_vectors(a44[ctx][rtx], outtemp, rtx == 0 ? ad_bc : outtemp1, sizeofArray(outtemp1), shift0);
+      mult_complex_vectors(a44[ctx][rtx], outtemp, rtx == 0 ? ad_bc : outtemp1, 12 * nb_rb, shift0);
 
       if (rtx != 0)
         nr_a_sum_b(ad_bc, outtemp1, nb_rb);
     }
+    nr_scratch_end(&scratch);
   }
 }
 
@@ -932,9 +890,50 @@ static void nr_conjch0_mult_ch1(c16_t *ch0, c16_t *ch1, c16_t *ch0conj_ch1, unsi
 /* ========== REAL OAI nr_dlsch_mmse IMPLEMENTATION ========== */
 
 
+/* LLRs of one layer: the OAI routines up to 256-QAM, nr_llr.c for 1024-QAM,
+ * which OAI lacks. The nr_llr.c kernels of the other orders are not
+ * bit-exact with OAI (QPSK is not scaled), nr_llr_simd_test() compares them. */
+static void dlsch_llr_layer(int mod_order,
+                            int32_t *rxF,
+                            c16_t *dl_ch_mag,
+                            c16_t *dl_ch_magb,
+                            c16_t *dl_ch_magr,
+                            int16_t *llr,
+                            uint32_t len)
+{
+    if (mod_order == NR_QAM1024_MOD_ORDER) {
+        if (nr_llr_compute(mod_order, rxF, (int32_t *)dl_ch_mag, (int32_t *)dl_ch_magb, (int32_t *)dl_ch_magr, llr, len) < 0)
+            memset(llr, 0, len * mod_order * sizeof(int16_t));
+        return;
+    }
+
+    switch (mod_order) {
+        case 2:  /* QPSK */
+            nr_qpsk_llr(rxF, llr, len);
+            break;
+
+        case 4:  /* 16-QAM */
+            nr_16qam_llr(rxF, dl_ch_mag, llr, len);
+            break;
+
+        case 6:  /* 64-QAM */
+            nr_64qam_llr(rxF, dl_ch_mag, dl_ch_magb, llr, len);
+            break;
+
+        case 8:  /* 256-QAM */
+            nr_256qam_llr(rxF, dl_ch_mag, dl_ch_magb, dl_ch_magr, llr, len);
+            break;
+
+        default:
+            /* Unknown modulation order - fill with zeros */
+            memset(llr, 0, len * mod_order * sizeof(int16_t));
+            break;
+    }
+}
+
 /* Stub for nr_dlsch_llr - compute LLRs from received symbols
- * This is a simplified version that calls the actual OAI demodulation functions
- * based on modulation order (QPSK, 16-QAM, 64-QAM, 256-QAM) */
+ * Modulation orders QPSK to 256-QAM and 1024-QAM (mod_order 10), one layer
+ * after the other through dlsch_llr_layer() */
 void nr_dlsch_llr(uint32_t rx_size_symbol,
                   int nbRx,
                   uint32_t sz,
@@ -955,95 +954,24 @@ void nr_dlsch_llr(uint32_t rx_size_symbol,
     int mod_order = dlsch_min[0].dlsch_config.qamModOrder;
     int Nl = dlsch_min[0].Nl;
     
-    /* Compute LLRs based on modulation order */
-    switch (mod_order) {
-        case 2:  /* QPSK */
-            for (int l = 0; l < Nl; l++) {
-                nr_qpsk_llr(&rxdataF_comp[l][0][symbol * rx_size_symbol],
-                           layer_llr[l] + llr_offset_symbol,
-                           len);
-            }
-            break;
-            
-        case 4:  /* 16-QAM */
-            for (int l = 0; l < Nl; l++) {
-                nr_16qam_llr(&rxdataF_comp[l][0][symbol * rx_size_symbol],
-                            dl_ch_mag,
-                            layer_llr[l] + llr_offset_symbol,
-                            len);
-            }
-            break;
-            
-        case 6:  /* 64-QAM */
-            for (int l = 0; l < Nl; l++) {
-                nr_64qam_llr(&rxdataF_comp[l][0][symbol * rx_size_symbol],
-                            dl_ch_mag,
-                            dl_ch_magb,
-                            layer_llr[l] + llr_offset_symbol,
-                            len);
-            }
-            break;
-            
-        case 8:  /* 256-QAM */
-            for (int l = 0; l < Nl; l++) {
-                nr_256qam_llr(&rxdataF_comp[l][0][symbol * rx_size_symbol],
-                             dl_ch_mag,
-                             dl_ch_magb,
-                             dl_ch_magr,
-                             layer_llr[l] + llr_offset_symbol,
-                             len);
-            }
-            break;
-            
-        default:
-            /* Unknown modulation order - fill with zeros */
-            for (int l = 0; l < Nl; l++) {
-                memset(layer_llr[l] + llr_offset_symbol, 0, len * mod_order * sizeof(int16_t));
-            }
-            break;
-    }
+    for (int l = 0; l < Nl; l++)
+        dlsch_llr_layer(mod_order,
+                        &rxdataF_comp[l][0][symbol * rx_size_symbol],
+                        dl_ch_mag,
+                        dl_ch_magb,
+                        dl_ch_magr,
+                        layer_llr[l] + llr_offset_symbol,
+                        len);
     
     /* Handle second codeword if present (dual codeword transmission) */
-    if (dlsch1_harq) {
-        int mod_order_cw1 = dlsch_min[1].dlsch_config.qamModOrder;
-        
-        switch (mod_order_cw1) {
-            case 2:  /* QPSK */
-                nr_qpsk_llr(&rxdataF_comp[0][0][symbol * rx_size_symbol],
-                           layer_llr[0] + llr_offset_symbol,
-                           len);
-                break;
-                
-            case 4:  /* 16-QAM */
-                nr_16qam_llr(&rxdataF_comp[0][0][symbol * rx_size_symbol],
-                            dl_ch_mag,
-                            layer_llr[0] + llr_offset_symbol,
-                            len);
-                break;
-                
-            case 6:  /* 64-QAM */
-                nr_64qam_llr(&rxdataF_comp[0][0][symbol * rx_size_symbol],
-                            dl_ch_mag,
-                            dl_ch_magb,
-                            layer_llr[0] + llr_offset_symbol,
-                            len);
-                break;
-                
-            case 8:  /* 256-QAM */
-                nr_256qam_llr(&rxdataF_comp[0][0][symbol * rx_size_symbol],
-                             dl_ch_mag,
-                             dl_ch_magb,
-                             dl_ch_magr,
-                             layer_llr[0] + llr_offset_symbol,
-                             len);
-                break;
-                
-            default:
-                /* Unknown modulation - fill with zeros */
-                memset(layer_llr[0] + llr_offset_symbol, 0, len * mod_order_cw1 * sizeof(int16_t));
-                break;
-        }
-    }
+    if (dlsch1_harq)
+        dlsch_llr_layer(dlsch_min[1].dlsch_config.qamModOrder,
+                        &rxdataF_comp[0][0][symbol * rx_size_symbol],
+                        dl_ch_mag,
+                        dl_ch_magb,
+                        dl_ch_magr,
+                        layer_llr[0] + llr_offset_symbol,
+                        len);
 }
 
 /* nr_dlsch_mmse - Simplified MMSE Equalization based on OAI implementation
@@ -1060,6 +988,10 @@ void nr_dlsch_llr(uint32_t rx_size_symbol,
  * Simplified approach for this stub:
  * - Uses direct gain calculation instead of full matrix inversion
  * - Applies MMSE gain correction per layer/antenna
+ * - Derives the thresholds from the per-RE H^H * H diagonal (sum of |h|^2
+ *   over the RX antennas, >> shift) scaled by the layer gain, in the loop
+ *   equalizing RX antenna 0 of the layer, written to
+ *   dl_ch_mag/magb/magr[layer][0] for the LLR stage
  * - Maintains compatibility with OAI function signature
  */
 void nr_dlsch_mmse(uint32_t rx_size_symbol,
@@ -1084,110 +1016,25 @@ void nr_dlsch_mmse(uint32_t rx_size_symbol,
   
   const uint32_t nb_rb_0 = (length + 11) / 12;
   const int start_idx = symbol * rx_size_symbol;
+  const int n_eq = (int)(12 * nb_rb_0) < length ? (int)(12 * nb_rb_0) : length;
   
-  /* Step 1: Build H^H*H (Hermitian matrix product) */
-  int32_t HH_H_re[nl][nl];
-  int32_t HH_H_im[nl][nl];
-  memset(HH_H_re, 0, sizeof(HH_H_re));
-  memset(HH_H_im, 0, sizeof(HH_H_im));
+  /* Steps 1-3: H^H*H, noise on the diagonal, inverse (nr_mmse_llr.c) */
+  int32_t inv_re[nl], inv_im[nl];
+  nr_mmse_layer_gains(rx_size_symbol, n_rx, nl, dl_ch_estimates_ext, length, noise_var, inv_re, inv_im);
   
-  for (int i = 0; i < nl; i++) {
-    for (int j = 0; j < nl; j++) {
-      int64_t acc_re = 0, acc_im = 0;
-      
-      /* Sum over all RX antennas: H^H[i,rx] * H[rx,j] */
-      for (int rx = 0; rx < n_rx; rx++) {
-        for (int k = 0; k < length && k < 48; k++) {
-          int32_t h_i = dl_ch_estimates_ext[i * n_rx + rx][k];
-          int32_t h_j = dl_ch_estimates_ext[j * n_rx + rx][k];
-          
-          int16_t h_i_r = (int16_t)(h_i & 0xFFFF);
-          int16_t h_i_i = (int16_t)((h_i >> 16) & 0xFFFF);
-          int16_t h_j_r = (int16_t)(h_j & 0xFFFF);
-          int16_t h_j_i = (int16_t)((h_j >> 16) & 0xFFFF);
-          
-          /* Real: Re(conj(h_i) * h_j) = h_i_r*h_j_r + h_i_i*h_j_i */
-          acc_re += (int64_t)h_i_r * h_j_r + (int64_t)h_i_i * h_j_i;
-          /* Imag: Im(conj(h_i) * h_j) = h_i_r*h_j_i - h_i_i*h_j_r */
-          acc_im += (int64_t)h_i_r * h_j_i - (int64_t)h_i_i * h_j_r;
-        }
-      }
-      
-      HH_H_re[i][j] = (int32_t)(acc_re >> 4);
-      HH_H_im[i][j] = (int32_t)(acc_im >> 4);
-    }
-  }
-  
-  /* Step 2: Add noise variance to diagonal */
-  int32_t noise_scaled = (int32_t)(noise_var >> 4);
-  for (int i = 0; i < nl; i++) {
-    HH_H_re[i][i] += noise_scaled;
-  }
-  
-  /* Step 3: Invert matrix (simplified for MIMO) */
-  int32_t inv_re[nl][nl];
-  int32_t inv_im[nl][nl];
-  memset(inv_re, 0, sizeof(inv_re));
-  memset(inv_im, 0, sizeof(inv_im));
-  
-  if (nl == 1) {
-    /* SISO case */
-    int64_t den = (int64_t)HH_H_re[0][0] * HH_H_re[0][0] + (int64_t)HH_H_im[0][0] * HH_H_im[0][0];
-    if (den > 0) {
-      inv_re[0][0] = (int32_t)(((int64_t)HH_H_re[0][0] << 15) / den);
-      inv_im[0][0] = (int32_t)((-(int64_t)HH_H_im[0][0] << 15) / den);
-    } else {
-      inv_re[0][0] = (1 << 14);
-    }
-  } else if (nl == 2) {
-    /* 2x2 MIMO */
-    int64_t det_re = (int64_t)HH_H_re[0][0] * HH_H_re[1][1] - 
-                     (int64_t)HH_H_re[0][1] * HH_H_re[1][0] -
-                     ((int64_t)HH_H_im[0][0] * HH_H_im[1][1] - 
-                      (int64_t)HH_H_im[0][1] * HH_H_im[1][0]);
-    int64_t det_im = (int64_t)HH_H_re[0][0] * HH_H_im[1][1] + 
-                     (int64_t)HH_H_im[0][0] * HH_H_re[1][1] -
-                     ((int64_t)HH_H_re[0][1] * HH_H_im[1][0] + 
-                      (int64_t)HH_H_im[0][1] * HH_H_re[1][0]);
-    
-    int64_t det_mag2 = det_re * det_re + det_im * det_im;
-    if (det_mag2 > 10000) {
-      int32_t scale = (1 << 14);
-      inv_re[0][0] = (int32_t)(((int64_t)HH_H_re[1][1] * det_re + (int64_t)HH_H_im[1][1] * det_im) * scale / det_mag2);
-      inv_im[0][0] = (int32_t)(((int64_t)HH_H_im[1][1] * det_re - (int64_t)HH_H_re[1][1] * det_im) * scale / det_mag2);
-    } else {
-      inv_re[0][0] = inv_re[1][1] = (1 << 13);
-    }
-  } else {
-    /* For larger systems, use diagonal approximation */
-    for (int i = 0; i < nl; i++) {
-      if (HH_H_re[i][i] > 100) {
-        inv_re[i][i] = (int32_t)(((int64_t)(1 << 14)) / (HH_H_re[i][i] >> 3));
-      } else {
-        inv_re[i][i] = (1 << 13);
-      }
-    }
-  }
-  
-  /* Step 4: Apply equalization: y' = inv(H^H*H + sigma*I) * y */
+  /* Step 4: Apply equalization: y' = inv(H^H*H + sigma*I) * y
+   * Step 5: LLR thresholds of the equalized symbols, from the H^H*H diagonal
+   * of each RE formed while antenna 0 is equalized */
+  const uint32_t n = n_eq > 0 ? n_eq : 0;
   for (int layer = 0; layer < nl; layer++) {
     for (int ant = 0; ant < n_rx; ant++) {
-      for (int idx = 0; idx < (int)(12 * nb_rb_0) && idx < length; idx++) {
-        int32_t y = rxdataF_comp[layer][ant][start_idx + idx];
-        int16_t y_r = (int16_t)(y & 0xFFFF);
-        int16_t y_i = (int16_t)((y >> 16) & 0xFFFF);
-        
-        /* y' = inv[layer][layer] * y */
-        int64_t y_eq_r = ((int64_t)y_r * inv_re[layer][layer] - (int64_t)y_i * inv_im[layer][layer]) >> 14;
-        int64_t y_eq_i = ((int64_t)y_r * inv_im[layer][layer] + (int64_t)y_i * inv_re[layer][layer]) >> 14;
-        
-        if (y_eq_r > 32767) y_eq_r = 32767;
-        if (y_eq_r < -32768) y_eq_r = -32768;
-        if (y_eq_i > 32767) y_eq_i = 32767;
-        if (y_eq_i < -32768) y_eq_i = -32768;
-        
-        rxdataF_comp[layer][ant][start_idx + idx] = ((int32_t)y_eq_i << 16) | ((int32_t)y_eq_r & 0xFFFF);
-      }
+      int32_t *y = &rxdataF_comp[layer][ant][start_idx];
+      if (ant == 0
+          && nr_mmse_equalize_layer(rx_size_symbol, n_rx, layer, dl_ch_estimates_ext, 0, n, shift, mod_order,
+                                    inv_re[layer], inv_im[layer], y, y, (int32_t *)dl_ch_mag[layer][0],
+                                    (int32_t *)dl_ch_magb[layer][0], (int32_t *)dl_ch_magr[layer][0]) == 0)
+        continue;
+      nr_mmse_apply_gain(y, inv_re[layer], inv_im[layer], n, y);
     }
   }
 }
@@ -1197,6 +1044,84 @@ typedef struct nrLDPC_dec_params t_nrLDPC_dec_params;
 typedef struct nrLDPC_time_stats t_nrLDPC_time_stats;
 typedef struct { uint8_t dummy; } decode_abort_t;
 
+/* Hard decisions of llr[0..n) (n multiple of 16), packed MSB-first into out
+ * (OAI sign convention: bit 0 has a positive LLR, a negative LLR is a 1).
+ * Returns the number of LLRs whose magnitude is below thr. */
+static int ldpc_pack_hard_bits(const int8_t *llr, int n, int thr, uint8_t *out)
+{
+    /* Reverse each group of 8 so that movemask puts the first LLR in the MSB */
+    const simde__m128i rev = simde_mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    const simde__m128i zero = simde_mm_setzero_si128();
+    const simde__m128i vthr = simde_mm_set1_epi8((int8_t)thr);
+    int weak = 0;
+
+    for (int i = 0; i < n; i += 16) {
+        simde__m128i v = simde_mm_shuffle_epi8(simde_mm_loadu_si128((const simde__m128i *)(llr + i)), rev);
+        const int m = simde_mm_movemask_epi8(simde_mm_cmpgt_epi8(zero, v));
+        out[(i >> 3) + 0] = (uint8_t)m;
+        out[(i >> 3) + 1] = (uint8_t)(m >> 8);
+        weak += __builtin_popcount(simde_mm_movemask_epi8(simde_mm_cmplt_epi8(simde_mm_abs_epi8(v), vthr)));
+    }
+    return weak;
+}
+
+/* Decoding with CRC-based termination. There is no message passing here: an
+ * iteration resolves the information bits whose |LLR| reaches a threshold
+ * halving every iteration, and the parity check passes once none is left.
+ *
+ * With check_crc == nr_crc_fold_check_crc (fused mode) the hard decisions are
+ * produced 1024 bits at a time and fed to a streaming CRC while still in
+ * cache, so the CRC is known as soon as the last bit is out; the CRC is left
+ * alone as soon as a bit is unresolved. Any other
+ * callback is called on the packed output after the parity check passes, as
+ * the OAI decoder does. Decoding stops when both pass; numMaxIter + 1 is
+ * returned when the CRC never passes. */
+static int32_t ldpc_decode_with_crc(t_nrLDPC_dec_params *p_decParams, const int8_t *p_llr, uint8_t *p_out)
+{
+    const int Kprime = p_decParams->Kprime;
+    const int fused_type = (p_decParams->check_crc == nr_crc_fold_check_crc) ? nr_crc_from_oai(p_decParams->crc_type) : -1;
+    const int L = fused_type >= 0 ? nr_crc_len((nr_crc_type_t)fused_type) : 0;
+    const int chunk = 1024;
+
+    const int fused = fused_type >= 0 && Kprime > L;
+    const uint32_t payload = (uint32_t)(Kprime - L);
+    const int nfull = Kprime & ~15;
+
+    for (int32_t numIter = 1; numIter <= p_decParams->numMaxIter; numIter++) {
+        const int thr = numIter < 7 ? 64 >> numIter : 0;
+        int weak = 0;
+        nr_crc_stream_t st;
+        if (fused) nr_crc_stream_init(&st, (nr_crc_type_t)fused_type);
+
+        for (int i = 0; i < nfull; i += chunk) {
+            const int n = (nfull - i) < chunk ? nfull - i : chunk;
+            weak += ldpc_pack_hard_bits(p_llr + i, n, thr, p_out + (i >> 3));
+            /* Once a bit is unresolved this iteration cannot pass */
+            if (fused && !weak && (uint32_t)i < payload)
+                nr_crc_stream_update(&st, p_out + (i >> 3), (payload - i) < (uint32_t)n ? payload - i : (uint32_t)n);
+        }
+        for (int i = nfull; i < Kprime; i++) {
+            const int b = p_llr[i] < 0;
+            p_out[i >> 3] = (uint8_t)((p_out[i >> 3] & ~(0x80 >> (i & 7))) | (b << (7 - (i & 7))));
+            weak += abs(p_llr[i]) < thr;
+        }
+        if (weak) continue;
+
+        if (fused) {
+            if ((uint32_t)nfull < payload)
+                nr_crc_stream_update(&st, p_out + (nfull >> 3), payload - nfull);
+            const uint32_t crc = nr_crc_stream_final(&st) >> (32 - L);
+            uint32_t rx = 0;
+            for (int k = Kprime - L; k < Kprime; k++)
+                rx = (rx << 1) | ((p_out[k >> 3] >> (7 - (k & 7))) & 1);
+            if (crc == rx) return numIter;
+        } else if (p_decParams->check_crc(p_out, (uint32_t)Kprime, (uint8_t)p_decParams->crc_type)) {
+            return numIter;
+        }
+    }
+    return p_decParams->numMaxIter + 1;
+}
+
 /* Simulated LDPCdecoder function - demonstrates LDPC decoding workflow
  * In production, this would call the real OAI LDPCdecoder from libldpc.so
  * For now, we provide a simplified implementation that shows the structure
@@ -1220,6 +1145,12 @@ int32_t LDPCdecoder(t_nrLDPC_dec_params* p_decParams,
      * 5. Output decoded bits
      */
     
+    /* With a CRC callback the decoder produces real hard decisions and
+     * terminates on the CRC, see ldpc_decode_with_crc() */
+    if (p_decParams->check_crc) {
+        return ldpc_decode_with_crc(p_decParams, p_llr, (uint8_t *)p_out);
+    }
+
     const uint16_t Z = p_decParams->Z;
     const uint8_t BG = p_decParams->BG;
     const uint8_t numMaxIter = p_decParams->numMaxIter;